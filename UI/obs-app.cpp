@@ -402,6 +402,8 @@ bool OBSApp::InitGlobalConfigDefaults()
 				  DEFAULT_LANG);
 	config_set_default_uint(globalConfig, "General", "MaxLogs", 10);
 	config_set_default_int(globalConfig, "General", "InfoIncrement", -1);
+	config_set_default_bool(globalConfig, "General",
+				"ParallelSourceLoading", false);
 	config_set_default_string(globalConfig, "General", "ProcessPriority",
 				  "Normal");
 	config_set_default_bool(globalConfig, "General", "EnableAutoUpdates",
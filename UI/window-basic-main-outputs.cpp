@@ -942,6 +942,9 @@ bool SimpleOutput::ConfigureRecording(bool updateReplayBuffer)
 		obs_data_set_int(settings, "max_time_sec", rbTime);
 		obs_data_set_int(settings, "max_size_mb",
 				 usingRecordingPreset ? rbSize : 0);
+		obs_data_set_bool(settings, "disk_backed",
+				  config_get_bool(main->Config(), "Output",
+						  "RecRBDiskBacked"));
 	} else {
 		f = GetFormatString(filenameFormat, nullptr, nullptr);
 		strPath = GetOutputFilename(path, ffmpegOutput ? "avi" : format,
@@ -952,6 +955,9 @@ bool SimpleOutput::ConfigureRecording(bool updateReplayBuffer)
 	}
 
 	obs_data_set_string(settings, "muxer_settings", mux);
+	obs_data_set_bool(settings, "mux_in_process",
+			  config_get_bool(main->Config(), "Output",
+					  "MuxInProcess"));
 
 	if (updateReplayBuffer)
 		obs_output_update(replayBuffer, settings);
@@ -1355,6 +1361,9 @@ inline void AdvancedOutput::SetupRecording()
 
 	obs_data_set_string(settings, "path", path);
 	obs_data_set_string(settings, "muxer_settings", mux);
+	obs_data_set_bool(settings, "mux_in_process",
+			  config_get_bool(main->Config(), "Output",
+					  "MuxInProcess"));
 	obs_output_update(fileOutput, settings);
 	if (replayBuffer)
 		obs_output_update(replayBuffer, settings);
@@ -1781,6 +1790,9 @@ bool AdvancedOutput::StartReplayBuffer()
 		obs_data_set_int(settings, "max_time_sec", rbTime);
 		obs_data_set_int(settings, "max_size_mb",
 				 usesBitrate ? 0 : rbSize);
+		obs_data_set_bool(settings, "disk_backed",
+				  config_get_bool(main->Config(), "Output",
+						  "RecRBDiskBacked"));
 
 		obs_output_update(replayBuffer, settings);
 
@@ -969,7 +969,11 @@ void OBSBasic::Load(const char *file)
 		obs_data_array_push_back_array(sources, groups);
 	}
 
-	obs_load_sources(sources, nullptr, nullptr);
+	if (config_get_bool(App()->GlobalConfig(), "General",
+			    "ParallelSourceLoading"))
+		obs_load_sources_parallel(sources, nullptr, nullptr);
+	else
+		obs_load_sources(sources, nullptr, nullptr);
 
 	if (transitions)
 		LoadTransitions(transitions);
@@ -1361,6 +1365,10 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_bool(basicConfig, "Output", "LowLatencyEnable",
 				false);
 
+	config_set_default_bool(basicConfig, "Output", "RecRBDiskBacked",
+				false);
+	config_set_default_bool(basicConfig, "Output", "MuxInProcess", false);
+
 	int i = 0;
 	uint32_t scale_cx = cx;
 	uint32_t scale_cy = cy;
@@ -1405,6 +1413,7 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_uint(basicConfig, "Audio", "SampleRate", 48000);
 	config_set_default_string(basicConfig, "Audio", "ChannelSetup",
 				  "Stereo");
+	config_set_default_bool(basicConfig, "Audio", "RealtimeThread", false);
 	config_set_default_double(basicConfig, "Audio", "MeterDecayRate",
 				  VOLUME_METER_DECAY_FAST);
 	config_set_default_uint(basicConfig, "Audio", "PeakMeterType", 0);
@@ -3942,6 +3951,9 @@ int OBSBasic::ResetVideo()
 				ovi.base_height);
 	}
 
+	obs_set_parallel_video_encoders(
+		config_get_bool(basicConfig, "Video", "ParallelEncoders"));
+
 	ret = AttemptToResetVideo(&ovi);
 	if (IS_WIN32 && ret != OBS_VIDEO_SUCCESS) {
 		if (ret == OBS_VIDEO_CURRENTLY_ACTIVE) {
@@ -4000,7 +4012,13 @@ bool OBSBasic::ResetAudio()
 	else
 		ai.speakers = SPEAKERS_STEREO;
 
-	return obs_reset_audio(&ai);
+	if (!obs_reset_audio(&ai))
+		return false;
+
+	audio_output_set_realtime(obs_get_audio(),
+				  config_get_bool(basicConfig, "Audio",
+						  "RealtimeThread"));
+	return true;
 }
 
 void OBSBasic::ResetAudioDevice(const char *sourceId, const char *deviceId,
@@ -17,6 +17,12 @@ static bool updatingMultiview = false, drawLabel, drawSafeArea, mouseSwitching,
 static MultiviewLayout multiviewLayout;
 static size_t maxSrcs, numSrcs;
 
+/* the multiview is only for monitoring, so it doesn't need to take render
+ * time from the output at full frame rate.  libobs keeps the render cache of
+ * the program and preview scenes active between multiview frames, so they
+ * are still only rendered once on the frames the multiview is drawn. */
+#define MULTIVIEW_MAX_FPS 30.0
+
 OBSProjector::OBSProjector(QWidget *widget, obs_source_t *source_, int monitor,
 			   ProjectorType type_)
 	: OBSQTDisplay(widget, Qt::Window),
@@ -59,6 +65,9 @@ OBSProjector::OBSProjector(QWidget *widget, obs_source_t *source_, int monitor,
 			GetDisplay(),
 			isMultiview ? OBSRenderMultiview : OBSRender, this);
 		obs_display_set_background_color(GetDisplay(), 0x000000);
+		if (isMultiview)
+			obs_display_set_max_fps(GetDisplay(),
+						MULTIVIEW_MAX_FPS);
 	};
 
 	connect(this, &OBSQTDisplay::DisplayCreated, addDrawCallback);
@@ -258,6 +258,44 @@ failed:
 	blog(LOG_ERROR, "gs_texture_unmap (GL) failed");
 }
 
+bool gs_texture_set_image_region(gs_texture_t *tex, const uint8_t *data,
+				 uint32_t linesize, uint32_t x, uint32_t y,
+				 uint32_t cx, uint32_t cy)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+	uint32_t bpp;
+	bool success = true;
+
+	if (!is_texture_2d(tex, "gs_texture_set_image_region"))
+		return false;
+	if (gs_is_compressed_format(tex->format))
+		return false;
+
+	bpp = gs_get_format_bpp(tex->format) / 8;
+	if (!bpp || linesize % bpp != 0)
+		return false;
+
+	if (!gl_bind_texture(tex2d->base.gl_target, tex2d->base.texture))
+		return false;
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0))
+		success = false;
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, linesize / bpp);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(tex2d->base.gl_target, 0, x, y, cx, cy,
+			tex->gl_format, tex->gl_type, data);
+	if (!gl_success("glTexSubImage2D"))
+		success = false;
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	gl_bind_texture(tex2d->base.gl_target, 0);
+
+	if (!success)
+		blog(LOG_ERROR, "gs_texture_set_image_region (GL) failed");
+	return success;
+}
+
 bool gs_texture_is_rect(const gs_texture_t *tex)
 {
 	if (tex->type == GS_TEXTURE_3D)
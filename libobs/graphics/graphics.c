@@ -1180,6 +1180,31 @@ void gs_texture_set_image(gs_texture_t *tex, const uint8_t *data,
 	gs_texture_unmap(tex);
 }
 
+bool gs_texture_set_image_region(gs_texture_t *tex, const uint8_t *data,
+				 uint32_t linesize, uint32_t x, uint32_t y,
+				 uint32_t cx, uint32_t cy)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p2("gs_texture_set_image_region", tex, data))
+		return false;
+	if (!graphics->exports.gs_texture_set_image_region)
+		return false;
+
+	if (!cx || !cy)
+		return true;
+	if (x + cx > gs_texture_get_width(tex) ||
+	    y + cy > gs_texture_get_height(tex)) {
+		blog(LOG_ERROR, "gs_texture_set_image_region: region is "
+				"outside of the texture");
+		return false;
+	}
+
+	return graphics->exports.gs_texture_set_image_region(tex, data,
+							      linesize, x, y,
+							      cx, cy);
+}
+
 void gs_cubetexture_set_image(gs_texture_t *cubetex, uint32_t side,
 			      const void *data, uint32_t linesize, bool invert)
 {
@@ -589,6 +589,11 @@ EXPORT void gs_viewport_pop(void);
 
 EXPORT void gs_texture_set_image(gs_texture_t *tex, const uint8_t *data,
 				 uint32_t linesize, bool invert);
+/** updates part of a texture, returns false without touching the texture if
+ * the graphics subsystem can't update regions */
+EXPORT bool gs_texture_set_image_region(gs_texture_t *tex, const uint8_t *data,
+					uint32_t linesize, uint32_t x,
+					uint32_t y, uint32_t cx, uint32_t cy);
 EXPORT void gs_cubetexture_set_image(gs_texture_t *cubetex, uint32_t side,
 				     const void *data, uint32_t linesize,
 				     bool invert);
@@ -0,0 +1,294 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "image-cache.h"
+#include "../util/base.h"
+#include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/hash-table.h"
+#include "../util/task-pool.h"
+
+#define MAX_DECODE_THREADS 4
+
+struct gs_cached_image {
+	struct hash_node node;
+	char *path;
+	int64_t mtime;
+	int64_t size;
+	long refs;
+
+	os_event_t *decoded_event;
+	volatile bool decoded;
+
+	uint8_t *data;
+	enum gs_color_format format;
+	uint32_t cx;
+	uint32_t cy;
+	gs_texture_t *texture;
+};
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct hash_table cache_images = {0};
+static os_task_pool_t *decode_pool = NULL;
+
+static inline uint64_t hash_image(const char *path, int64_t mtime,
+				  int64_t size)
+{
+	return hash_str(path) ^
+	       hash_uint64((uint64_t)mtime * 31 + (uint64_t)size);
+}
+
+static struct gs_cached_image *find_image(const char *path, int64_t mtime,
+					  int64_t size, uint64_t hash)
+{
+	struct hash_node *node = hash_table_first(&cache_images, hash);
+
+	while (node) {
+		struct gs_cached_image *image =
+			hash_entry(node, struct gs_cached_image, node);
+
+		if (image->mtime == mtime && image->size == size &&
+		    strcmp(image->path, path) == 0)
+			return image;
+
+		node = hash_table_next(node);
+	}
+
+	return NULL;
+}
+
+static void free_image(struct gs_cached_image *image)
+{
+	gs_texture_destroy(image->texture);
+	os_event_destroy(image->decoded_event);
+	bfree(image->data);
+	bfree(image->path);
+	bfree(image);
+}
+
+/* call with cache_mutex held */
+static void set_decoded(struct gs_cached_image *image)
+{
+	os_atomic_set_bool(&image->decoded, true);
+	os_event_signal(image->decoded_event);
+}
+
+static void decode_image(struct gs_cached_image *image)
+{
+	image->data = gs_create_texture_file_data(image->path, &image->format,
+						  &image->cx, &image->cy);
+	if (!image->data)
+		blog(LOG_WARNING, "gs_image_cache: Failed to load file '%s'",
+		     image->path);
+}
+
+static void decode_task(void *param)
+{
+	struct gs_cached_image *image = param;
+	bool done = false;
+
+	/* the task's reference is dropped before the image is marked as
+	 * decoded, so that the texture can't have been created yet if it
+	 * happens to be the last reference, as there is no graphics context
+	 * on this thread.  decoding is skipped entirely if every user
+	 * released the image in the meantime */
+	for (;;) {
+		pthread_mutex_lock(&cache_mutex);
+		if (image->refs == 1) {
+			hash_table_remove(&cache_images, &image->node);
+			pthread_mutex_unlock(&cache_mutex);
+			free_image(image);
+			return;
+		}
+		if (done) {
+			image->refs--;
+			set_decoded(image);
+			pthread_mutex_unlock(&cache_mutex);
+			return;
+		}
+		pthread_mutex_unlock(&cache_mutex);
+
+		decode_image(image);
+		done = true;
+	}
+}
+
+static os_task_pool_t *get_decode_pool(void)
+{
+	if (!decode_pool) {
+		int threads = os_get_logical_cores();
+
+		if (threads < 1)
+			threads = 1;
+		else if (threads > MAX_DECODE_THREADS)
+			threads = MAX_DECODE_THREADS;
+
+		decode_pool = os_task_pool_create("libobs: image decode",
+						  (size_t)threads);
+	}
+
+	return decode_pool;
+}
+
+gs_cached_image_t *gs_image_cache_acquire(const char *path, bool async)
+{
+	struct gs_cached_image *image;
+	struct stat st;
+	os_task_pool_t *pool = NULL;
+	uint64_t hash;
+
+	if (!path || !*path || os_stat(path, &st) != 0)
+		return NULL;
+
+	hash = hash_image(path, (int64_t)st.st_mtime, (int64_t)st.st_size);
+
+	pthread_mutex_lock(&cache_mutex);
+
+	image = find_image(path, (int64_t)st.st_mtime, (int64_t)st.st_size,
+			   hash);
+	if (image) {
+		image->refs++;
+		pthread_mutex_unlock(&cache_mutex);
+
+		if (!async)
+			gs_cached_image_wait(image);
+		return image;
+	}
+
+	image = bzalloc(sizeof(struct gs_cached_image));
+	image->path = bstrdup(path);
+	image->mtime = (int64_t)st.st_mtime;
+	image->size = (int64_t)st.st_size;
+	image->refs = 1;
+	os_event_init(&image->decoded_event, OS_EVENT_TYPE_MANUAL);
+	hash_table_insert(&cache_images, &image->node, hash);
+
+	if (async) {
+		pool = get_decode_pool();
+		if (pool)
+			image->refs++;
+	}
+
+	pthread_mutex_unlock(&cache_mutex);
+
+	if (pool) {
+		os_task_pool_queue(pool, decode_task, image);
+	} else {
+		decode_image(image);
+
+		pthread_mutex_lock(&cache_mutex);
+		set_decoded(image);
+		pthread_mutex_unlock(&cache_mutex);
+	}
+
+	return image;
+}
+
+void gs_cached_image_release(gs_cached_image_t *image)
+{
+	bool last;
+
+	if (!image)
+		return;
+
+	pthread_mutex_lock(&cache_mutex);
+	last = --image->refs == 0;
+	if (last)
+		hash_table_remove(&cache_images, &image->node);
+	pthread_mutex_unlock(&cache_mutex);
+
+	if (last)
+		free_image(image);
+}
+
+void gs_image_cache_free(void)
+{
+	os_task_pool_t *pool;
+
+	pthread_mutex_lock(&cache_mutex);
+	pool = decode_pool;
+	decode_pool = NULL;
+	pthread_mutex_unlock(&cache_mutex);
+
+	os_task_pool_destroy(pool);
+
+	pthread_mutex_lock(&cache_mutex);
+	if (cache_images.num)
+		blog(LOG_WARNING,
+		     "gs_image_cache: %zu image(s) still referenced "
+		     "at shutdown",
+		     cache_images.num);
+	hash_table_clear(&cache_images);
+	hash_table_free(&cache_images);
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+bool gs_cached_image_ready(const gs_cached_image_t *image)
+{
+	return image && os_atomic_load_bool(&image->decoded);
+}
+
+void gs_cached_image_wait(gs_cached_image_t *image)
+{
+	if (image && !os_atomic_load_bool(&image->decoded))
+		os_event_wait(image->decoded_event);
+}
+
+bool gs_cached_image_loaded(const gs_cached_image_t *image)
+{
+	return gs_cached_image_ready(image) && image->cx && image->cy;
+}
+
+uint32_t gs_cached_image_get_width(const gs_cached_image_t *image)
+{
+	return gs_cached_image_ready(image) ? image->cx : 0;
+}
+
+uint32_t gs_cached_image_get_height(const gs_cached_image_t *image)
+{
+	return gs_cached_image_ready(image) ? image->cy : 0;
+}
+
+uint64_t gs_cached_image_get_memory_usage(const gs_cached_image_t *image)
+{
+	if (!gs_cached_image_loaded(image))
+		return 0;
+
+	return (uint64_t)image->cx * image->cy *
+	       gs_get_format_bpp(image->format) / 8;
+}
+
+gs_texture_t *gs_cached_image_get_texture(gs_cached_image_t *image)
+{
+	if (!gs_cached_image_ready(image))
+		return NULL;
+
+	/* only ever touched with the graphics context entered, which is what
+	 * serializes the texture creation between users */
+	if (!image->texture && image->data) {
+		image->texture = gs_texture_create(
+			image->cx, image->cy, image->format, 1,
+			(const uint8_t **)&image->data, 0);
+		bfree(image->data);
+		image->data = NULL;
+	}
+
+	return image->texture;
+}
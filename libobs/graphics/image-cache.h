@@ -0,0 +1,71 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "graphics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared image cache
+ *
+ *   Images are shared between every user of the same file, keyed by its path,
+ *   modification time and size, so that the same image used by several
+ *   sources is only decoded and uploaded once.  Decoding can happen on a pool
+ *   of worker threads, the decoded pixels are kept until the texture is
+ *   created and the image is freed when its last reference is released.
+ */
+
+struct gs_cached_image;
+typedef struct gs_cached_image gs_cached_image_t;
+
+/* returns a referenced image, or NULL if the file doesn't exist.  if async is
+ * true, the image is decoded on a worker thread and
+ * gs_cached_image_ready() can be used to poll it, otherwise this waits for
+ * the decode to finish */
+EXPORT gs_cached_image_t *gs_image_cache_acquire(const char *path,
+						 bool async);
+
+/* requires the graphics context if the texture has been created */
+EXPORT void gs_cached_image_release(gs_cached_image_t *image);
+
+/* waits for pending decodes and stops the worker threads */
+EXPORT void gs_image_cache_free(void);
+
+/* returns true once decoding finished, whether it succeeded or not */
+EXPORT bool gs_cached_image_ready(const gs_cached_image_t *image);
+EXPORT void gs_cached_image_wait(gs_cached_image_t *image);
+
+/* returns false if the image was decoded but failed to load */
+EXPORT bool gs_cached_image_loaded(const gs_cached_image_t *image);
+
+/* the functions below return 0 until the image is ready */
+EXPORT uint32_t gs_cached_image_get_width(const gs_cached_image_t *image);
+EXPORT uint32_t gs_cached_image_get_height(const gs_cached_image_t *image);
+EXPORT uint64_t
+gs_cached_image_get_memory_usage(const gs_cached_image_t *image);
+
+/* creates the shared texture on first use.  requires the graphics context,
+ * returns NULL until the image is ready */
+EXPORT gs_texture_t *gs_cached_image_get_texture(gs_cached_image_t *image);
+
+#ifdef __cplusplus
+}
+#endif
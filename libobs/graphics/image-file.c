@@ -18,6 +18,7 @@
 #include "image-file.h"
 #include "../util/base.h"
 #include "../util/platform.h"
+#include <limits.h>
 
 #define blog(level, format, ...) \
 	blog(level, "%s: " format, __FUNCTION__, __VA_ARGS__)
@@ -54,10 +55,38 @@ static void bi_def_bitmap_modified(void *bitmap)
 	UNUSED_PARAMETER(bitmap);
 }
 
-static inline int get_full_decoded_gif_size(gs_image_file_t *image)
+static inline size_t get_gif_frame_size(gs_image_file_t *image)
 {
-	return image->gif.width * image->gif.height * 4 *
-	       image->gif.frame_count;
+	return (size_t)image->gif.width * image->gif.height * 4;
+}
+
+/* returns how many frames apart the cached frames are, 1 if every frame fits
+ * within the limit */
+static int get_keyframe_interval(gs_image_file_t *image, uint64_t full_size,
+				 uint64_t limit)
+{
+	uint64_t frame_size = get_gif_frame_size(image);
+	uint64_t max_frames;
+
+	if (!limit || full_size <= limit)
+		return 1;
+
+	max_frames = limit / frame_size;
+	if (!max_frames)
+		max_frames = 1;
+
+	return (int)((image->gif.frame_count + max_frames - 1) / max_frames);
+}
+
+static void cache_keyframe(gs_image_file_t *image, int frame)
+{
+	int keyframe = frame / image->keyframe_interval;
+	size_t frame_size = get_gif_frame_size(image);
+
+	image->animation_frame_cache[frame] =
+		image->animation_frame_data + keyframe * frame_size;
+	memcpy(image->animation_frame_cache[frame], image->gif.frame_image,
+	       frame_size);
 }
 
 static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage,
@@ -71,11 +100,13 @@ static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage,
 }
 
 static bool init_animated_gif(gs_image_file_t *image, const char *path,
-			      uint64_t *mem_usage)
+			      uint64_t *mem_usage, uint64_t frame_cache_limit)
 {
 	bool is_animated_gif = true;
 	gif_result result;
 	uint64_t max_size;
+	unsigned int cached_frames;
+	int interval;
 	size_t size, size_read;
 	FILE *file;
 
@@ -125,7 +156,12 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 	max_size = (uint64_t)image->gif.width * (uint64_t)image->gif.height *
 		   (uint64_t)image->gif.frame_count * 4LLU;
 
-	if ((uint64_t)get_full_decoded_gif_size(image) != max_size) {
+	interval = get_keyframe_interval(image, max_size, frame_cache_limit);
+	cached_frames = (image->gif.frame_count + interval - 1) / interval;
+	image->frame_cache_size =
+		(uint64_t)cached_frames * get_gif_frame_size(image);
+
+	if (image->frame_cache_size > INT_MAX) {
 		blog(LOG_WARNING, "Gif '%s' overflowed maximum pointer size",
 		     path);
 		goto fail;
@@ -135,11 +171,17 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 	if (image->is_animated_gif) {
 		gif_decode_frame(&image->gif, 0);
 
+		/* when the decoded frames don't fit within the limit, only
+		 * every interval-th frame is kept, and the frames in between
+		 * are decoded again from the closest cached frame before
+		 * them */
+		image->keyframe_interval = interval > 1 ? interval : 0;
+
 		image->animation_frame_cache =
 			alloc_mem(image, mem_usage,
 				  image->gif.frame_count * sizeof(uint8_t *));
 		image->animation_frame_data = alloc_mem(
-			image, mem_usage, get_full_decoded_gif_size(image));
+			image, mem_usage, (size_t)image->frame_cache_size);
 
 		for (unsigned int i = 0; i < image->gif.frame_count; i++) {
 			if (gif_decode_frame(&image->gif, i) != GIF_OK)
@@ -147,8 +189,19 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 				     "Couldn't decode frame %u "
 				     "of '%s'",
 				     i, path);
+			else if (image->keyframe_interval &&
+				 i % image->keyframe_interval == 0)
+				cache_keyframe(image, (int)i);
 		}
 
+		if (image->keyframe_interval)
+			blog(LOG_INFO,
+			     "Caching %u of %u frames of '%s' "
+			     "(%.1f MB)",
+			     cached_frames, image->gif.frame_count, path,
+			     (double)image->frame_cache_size /
+				     (1024.0 * 1024.0));
+
 		gif_decode_frame(&image->gif, 0);
 
 		image->cx = (uint32_t)image->gif.width;
@@ -180,7 +233,8 @@ not_animated:
 }
 
 static void gs_image_file_init_internal(gs_image_file_t *image,
-					const char *file, uint64_t *mem_usage)
+					const char *file, uint64_t *mem_usage,
+					uint64_t frame_cache_limit)
 {
 	size_t len;
 
@@ -195,7 +249,8 @@ static void gs_image_file_init_internal(gs_image_file_t *image,
 	len = strlen(file);
 
 	if (len > 4 && strcmp(file + len - 4, ".gif") == 0) {
-		if (init_animated_gif(image, file, mem_usage))
+		if (init_animated_gif(image, file, mem_usage,
+				      frame_cache_limit))
 			return;
 	}
 
@@ -216,7 +271,7 @@ static void gs_image_file_init_internal(gs_image_file_t *image,
 
 void gs_image_file_init(gs_image_file_t *image, const char *file)
 {
-	gs_image_file_init_internal(image, file, NULL);
+	gs_image_file_init_internal(image, file, NULL, 0);
 }
 
 void gs_image_file_free(gs_image_file_t *image)
@@ -241,7 +296,14 @@ void gs_image_file_free(gs_image_file_t *image)
 
 void gs_image_file2_init(gs_image_file2_t *if2, const char *file)
 {
-	gs_image_file_init_internal(&if2->image, file, &if2->mem_usage);
+	gs_image_file_init_internal(&if2->image, file, &if2->mem_usage, 0);
+}
+
+void gs_image_file2_init_limited(gs_image_file2_t *if2, const char *file,
+				 uint64_t frame_cache_limit)
+{
+	gs_image_file_init_internal(&if2->image, file, &if2->mem_usage,
+				    frame_cache_limit);
 }
 
 void gs_image_file_init_texture(gs_image_file_t *image)
@@ -296,9 +358,42 @@ static inline int calculate_new_frame(gs_image_file_t *image,
 	return new_frame;
 }
 
+static void decode_from_keyframe(gs_image_file_t *image, int new_frame)
+{
+	int keyframe = new_frame - new_frame % image->keyframe_interval;
+	int last_frame = image->last_decoded_frame;
+
+	if (new_frame == last_frame)
+		return;
+
+	/* start over from the closest cached frame if it's closer than the
+	 * last decoded frame, or from frame 0 if it looped and there is no
+	 * cached frame to start from */
+	if ((new_frame < last_frame || keyframe > last_frame) &&
+	    image->animation_frame_cache[keyframe]) {
+		memcpy(image->gif.frame_image,
+		       image->animation_frame_cache[keyframe],
+		       get_gif_frame_size(image));
+		image->gif.decoded_frame = keyframe;
+		image->last_decoded_frame = last_frame = keyframe;
+
+	} else if (new_frame < last_frame) {
+		last_frame = -1;
+	}
+
+	for (int i = last_frame + 1; i <= new_frame; i++) {
+		if (gif_decode_frame(&image->gif, i) != GIF_OK)
+			return;
+		image->last_decoded_frame = i;
+	}
+}
+
 static void decode_new_frame(gs_image_file_t *image, int new_frame)
 {
-	if (!image->animation_frame_cache[new_frame]) {
+	if (image->keyframe_interval) {
+		decode_from_keyframe(image, new_frame);
+
+	} else if (!image->animation_frame_cache[new_frame]) {
 		int last_frame;
 
 		/* if looped, decode frame 0 */
@@ -359,6 +454,15 @@ void gs_image_file_update_texture(gs_image_file_t *image)
 	if (!image->is_animated_gif || !image->loaded)
 		return;
 
+	if (image->keyframe_interval) {
+		if (image->last_decoded_frame != image->cur_frame)
+			decode_new_frame(image, image->cur_frame);
+
+		gs_texture_set_image(image->texture, image->gif.frame_image,
+				     image->gif.width * 4, false);
+		return;
+	}
+
 	if (!image->animation_frame_cache[image->cur_frame])
 		decode_new_frame(image, image->cur_frame);
 
@@ -44,6 +44,10 @@ struct gs_image_file {
 
 	uint8_t *texture_data;
 	gif_bitmap_callback_vt bitmap_callbacks;
+
+	/* added after the original fields to keep their offsets */
+	int keyframe_interval;
+	uint64_t frame_cache_size;
 };
 
 struct gs_image_file2 {
@@ -63,6 +67,8 @@ EXPORT bool gs_image_file_tick(gs_image_file_t *image,
 EXPORT void gs_image_file_update_texture(gs_image_file_t *image);
 
 EXPORT void gs_image_file2_init(gs_image_file2_t *if2, const char *file);
+EXPORT void gs_image_file2_init_limited(gs_image_file2_t *if2, const char *file,
+					uint64_t frame_cache_limit);
 
 static void gs_image_file2_free(gs_image_file2_t *if2)
 {
@@ -0,0 +1,458 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#include "audio-dynamics.h"
+
+#include <math.h>
+#include <string.h>
+#include "../util/sse-intrin.h"
+#include "../util/cpu-features.h"
+
+/* 20 * log10(2), converts between log2 and dB */
+#define DB_PER_LOG2 6.0205999f
+#define LOG2_PER_DB 0.1660964f
+
+#define MIN_EXPANDER_GAIN_DB -60.0f
+
+/* log2(m) = 2/ln(2) * (t + t^3/3 + t^5/5 + t^7/7 + ...), t = (m-1)/(m+1).
+ * with m within sqrt(1/2)..sqrt(2), |t| <= 0.1716 and the first omitted
+ * term is below 5e-8 */
+#define LOG2_C1 2.8853901f
+#define LOG2_C3 0.9617967f
+#define LOG2_C5 0.5770780f
+#define LOG2_C7 0.4121986f
+
+/* 2^f = e^(f ln(2)) as a taylor series, within 3e-6 relative error for
+ * f within -0.5..0.5 */
+#define EXP2_C1 0.6931472f
+#define EXP2_C2 0.2402265f
+#define EXP2_C3 0.0555041f
+#define EXP2_C4 0.0096181f
+#define EXP2_C5 0.0013334f
+
+/* ------------------------------------------------------------------------- */
+/* scalar reference, used for the tails of the blocks                       */
+
+static inline float log2_scalar(float x)
+{
+	/* matches the vector version for 0 and denormals instead of
+	 * returning -inf */
+	return x < 1.1754944e-38f ? -127.0f : log2f(x);
+}
+
+static inline float compressor_gain(float env, float slope, float threshold,
+				    float output_gain)
+{
+	float gain = slope * (threshold - log2_scalar(env));
+	return exp2f(fminf(0.0f, gain)) * output_gain;
+}
+
+static inline float expander_gain_db(float env, float slope, float threshold)
+{
+	float diff = threshold - log2_scalar(env) * DB_PER_LOG2;
+	return diff > 0.0f ? fmaxf(slope * diff, MIN_EXPANDER_GAIN_DB) : 0.0f;
+}
+
+static inline float db_gain(float gain_db, float output_gain)
+{
+	return exp2f(fminf(0.0f, gain_db) * LOG2_PER_DB) * output_gain;
+}
+
+/* ------------------------------------------------------------------------- */
+/* SSE2                                                                      */
+
+static inline __m128 log2_sse2(__m128 x)
+{
+	const __m128i mant_mask = _mm_set1_epi32(0x007FFFFF);
+	const __m128i one_bits = _mm_set1_epi32(0x3F800000);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 sqrt2 = _mm_set1_ps(1.41421356f);
+
+	__m128i bits = _mm_castps_si128(x);
+	__m128i exp = _mm_sub_epi32(_mm_srli_epi32(bits, 23),
+				    _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(
+		_mm_or_si128(_mm_and_si128(bits, mant_mask), one_bits));
+
+	/* move m into sqrt(1/2)..sqrt(2) so that t stays small */
+	__m128 big = _mm_cmpgt_ps(m, sqrt2);
+	m = _mm_sub_ps(m, _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+	__m128 e = _mm_add_ps(_mm_cvtepi32_ps(exp), _mm_and_ps(big, one));
+
+	__m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 p = _mm_add_ps(_mm_set1_ps(LOG2_C5),
+			      _mm_mul_ps(t2, _mm_set1_ps(LOG2_C7)));
+	p = _mm_add_ps(_mm_set1_ps(LOG2_C3), _mm_mul_ps(t2, p));
+	p = _mm_add_ps(_mm_set1_ps(LOG2_C1), _mm_mul_ps(t2, p));
+
+	return _mm_add_ps(e, _mm_mul_ps(t, p));
+}
+
+/* x must be within -126..0 */
+static inline __m128 exp2_sse2(__m128 x)
+{
+	__m128i n = _mm_cvtps_epi32(x);
+	__m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+	__m128 p = _mm_add_ps(_mm_set1_ps(EXP2_C4),
+			      _mm_mul_ps(f, _mm_set1_ps(EXP2_C5)));
+	p = _mm_add_ps(_mm_set1_ps(EXP2_C3), _mm_mul_ps(f, p));
+	p = _mm_add_ps(_mm_set1_ps(EXP2_C2), _mm_mul_ps(f, p));
+	p = _mm_add_ps(_mm_set1_ps(EXP2_C1), _mm_mul_ps(f, p));
+	p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(f, p));
+
+	__m128i scale = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)),
+				       23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+}
+
+static void compressor_gain_sse2(float *gain, const float *env, size_t count,
+				 float slope, float threshold,
+				 float output_gain)
+{
+	const __m128 s = _mm_set1_ps(slope);
+	const __m128 t = _mm_set1_ps(threshold);
+	const __m128 og = _mm_set1_ps(output_gain);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 min_gain = _mm_set1_ps(-126.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 g = _mm_sub_ps(t, log2_sse2(_mm_loadu_ps(env + i)));
+		g = _mm_max_ps(_mm_min_ps(_mm_mul_ps(s, g), zero), min_gain);
+		_mm_storeu_ps(gain + i, _mm_mul_ps(exp2_sse2(g), og));
+	}
+
+	for (; i < count; i++)
+		gain[i] = compressor_gain(env[i], slope, threshold,
+					  output_gain);
+}
+
+static void expander_gain_db_sse2(float *gain_db, const float *env,
+				  size_t count, float slope, float threshold)
+{
+	const __m128 s = _mm_set1_ps(slope);
+	const __m128 t = _mm_set1_ps(threshold);
+	const __m128 db = _mm_set1_ps(DB_PER_LOG2);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 min_gain = _mm_set1_ps(MIN_EXPANDER_GAIN_DB);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 env_db =
+			_mm_mul_ps(log2_sse2(_mm_loadu_ps(env + i)), db);
+		__m128 diff = _mm_sub_ps(t, env_db);
+		__m128 g = _mm_max_ps(_mm_mul_ps(s, diff), min_gain);
+		_mm_storeu_ps(gain_db + i,
+			      _mm_and_ps(_mm_cmpgt_ps(diff, zero), g));
+	}
+
+	for (; i < count; i++)
+		gain_db[i] = expander_gain_db(env[i], slope, threshold);
+}
+
+static void apply_gain_sse2(float *samples, const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(samples + i);
+		_mm_storeu_ps(samples + i,
+			      _mm_mul_ps(val, _mm_loadu_ps(gain + i)));
+	}
+
+	for (; i < count; i++)
+		samples[i] *= gain[i];
+}
+
+static void apply_gain_db_sse2(float *samples, const float *gain_db,
+			       size_t count, float output_gain)
+{
+	const __m128 scale = _mm_set1_ps(LOG2_PER_DB);
+	const __m128 og = _mm_set1_ps(output_gain);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 min_gain = _mm_set1_ps(-126.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 g = _mm_mul_ps(_mm_loadu_ps(gain_db + i), scale);
+		g = _mm_max_ps(_mm_min_ps(g, zero), min_gain);
+		g = _mm_mul_ps(exp2_sse2(g), og);
+		_mm_storeu_ps(samples + i,
+			      _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+	}
+
+	for (; i < count; i++)
+		samples[i] *= db_gain(gain_db[i], output_gain);
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX2                                                                      */
+
+#if CPU_FEATURES_X86
+CPU_FEATURES_TARGET_AVX2
+static inline __m256 log2_avx2(__m256 x)
+{
+	const __m256i mant_mask = _mm256_set1_epi32(0x007FFFFF);
+	const __m256i one_bits = _mm256_set1_epi32(0x3F800000);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 sqrt2 = _mm256_set1_ps(1.41421356f);
+
+	__m256i bits = _mm256_castps_si256(x);
+	__m256i exp = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+				       _mm256_set1_epi32(127));
+	__m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+		_mm256_and_si256(bits, mant_mask), one_bits));
+
+	__m256 big = _mm256_cmp_ps(m, sqrt2, _CMP_GT_OQ);
+	__m256 half_m = _mm256_mul_ps(m, _mm256_set1_ps(0.5f));
+	m = _mm256_sub_ps(m, _mm256_and_ps(big, half_m));
+	__m256 e = _mm256_add_ps(_mm256_cvtepi32_ps(exp),
+				 _mm256_and_ps(big, one));
+
+	__m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+	__m256 t2 = _mm256_mul_ps(t, t);
+	__m256 p = _mm256_add_ps(_mm256_set1_ps(LOG2_C5),
+				 _mm256_mul_ps(t2, _mm256_set1_ps(LOG2_C7)));
+	p = _mm256_add_ps(_mm256_set1_ps(LOG2_C3), _mm256_mul_ps(t2, p));
+	p = _mm256_add_ps(_mm256_set1_ps(LOG2_C1), _mm256_mul_ps(t2, p));
+
+	return _mm256_add_ps(e, _mm256_mul_ps(t, p));
+}
+
+CPU_FEATURES_TARGET_AVX2
+static inline __m256 exp2_avx2(__m256 x)
+{
+	__m256i n = _mm256_cvtps_epi32(x);
+	__m256 f = _mm256_sub_ps(x, _mm256_cvtepi32_ps(n));
+	__m256 p = _mm256_add_ps(_mm256_set1_ps(EXP2_C4),
+				 _mm256_mul_ps(f, _mm256_set1_ps(EXP2_C5)));
+	p = _mm256_add_ps(_mm256_set1_ps(EXP2_C3), _mm256_mul_ps(f, p));
+	p = _mm256_add_ps(_mm256_set1_ps(EXP2_C2), _mm256_mul_ps(f, p));
+	p = _mm256_add_ps(_mm256_set1_ps(EXP2_C1), _mm256_mul_ps(f, p));
+	p = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(f, p));
+
+	__m256i scale = _mm256_slli_epi32(
+		_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void compressor_gain_avx2(float *gain, const float *env, size_t count,
+				 float slope, float threshold,
+				 float output_gain)
+{
+	const __m256 s = _mm256_set1_ps(slope);
+	const __m256 t = _mm256_set1_ps(threshold);
+	const __m256 og = _mm256_set1_ps(output_gain);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 min_gain = _mm256_set1_ps(-126.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 g = _mm256_sub_ps(t,
+					 log2_avx2(_mm256_loadu_ps(env + i)));
+		g = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(s, g), zero),
+				  min_gain);
+		_mm256_storeu_ps(gain + i, _mm256_mul_ps(exp2_avx2(g), og));
+	}
+
+	for (; i < count; i++)
+		gain[i] = compressor_gain(env[i], slope, threshold,
+					  output_gain);
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void expander_gain_db_avx2(float *gain_db, const float *env,
+				  size_t count, float slope, float threshold)
+{
+	const __m256 s = _mm256_set1_ps(slope);
+	const __m256 t = _mm256_set1_ps(threshold);
+	const __m256 db = _mm256_set1_ps(DB_PER_LOG2);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 min_gain = _mm256_set1_ps(MIN_EXPANDER_GAIN_DB);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 env_db = _mm256_mul_ps(
+			log2_avx2(_mm256_loadu_ps(env + i)), db);
+		__m256 diff = _mm256_sub_ps(t, env_db);
+		__m256 g = _mm256_max_ps(_mm256_mul_ps(s, diff), min_gain);
+		__m256 pos = _mm256_cmp_ps(diff, zero, _CMP_GT_OQ);
+		_mm256_storeu_ps(gain_db + i, _mm256_and_ps(pos, g));
+	}
+
+	for (; i < count; i++)
+		gain_db[i] = expander_gain_db(env[i], slope, threshold);
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void apply_gain_avx2(float *samples, const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(samples + i);
+		_mm256_storeu_ps(samples + i,
+				 _mm256_mul_ps(val, _mm256_loadu_ps(gain + i)));
+	}
+
+	for (; i < count; i++)
+		samples[i] *= gain[i];
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void apply_gain_db_avx2(float *samples, const float *gain_db,
+			       size_t count, float output_gain)
+{
+	const __m256 scale = _mm256_set1_ps(LOG2_PER_DB);
+	const __m256 og = _mm256_set1_ps(output_gain);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 min_gain = _mm256_set1_ps(-126.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 g = _mm256_mul_ps(_mm256_loadu_ps(gain_db + i), scale);
+		g = _mm256_max_ps(_mm256_min_ps(g, zero), min_gain);
+		g = _mm256_mul_ps(exp2_avx2(g), og);
+		_mm256_storeu_ps(samples + i,
+				 _mm256_mul_ps(_mm256_loadu_ps(samples + i),
+					       g));
+	}
+
+	for (; i < count; i++)
+		samples[i] *= db_gain(gain_db[i], output_gain);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+struct audio_dyn_kernels {
+	const char *name;
+	void (*compressor_gain)(float *gain, const float *env, size_t count,
+				float slope, float threshold,
+				float output_gain);
+	void (*expander_gain_db)(float *gain_db, const float *env,
+				 size_t count, float slope, float threshold);
+	void (*apply_gain)(float *samples, const float *gain, size_t count);
+	void (*apply_gain_db)(float *samples, const float *gain_db,
+			      size_t count, float output_gain);
+};
+
+static const struct audio_dyn_kernels sse2_kernels = {
+	"SSE2",
+	compressor_gain_sse2,
+	expander_gain_db_sse2,
+	apply_gain_sse2,
+	apply_gain_db_sse2,
+};
+
+#if CPU_FEATURES_X86
+static const struct audio_dyn_kernels avx2_kernels = {
+	"AVX2",
+	compressor_gain_avx2,
+	expander_gain_db_avx2,
+	apply_gain_avx2,
+	apply_gain_db_avx2,
+};
+#endif
+
+static const struct audio_dyn_kernels *kernels = NULL;
+
+static inline const struct audio_dyn_kernels *get_kernels(void)
+{
+	if (!kernels) {
+#if CPU_FEATURES_X86
+		kernels = cpu_has_avx2() ? &avx2_kernels : &sse2_kernels;
+#else
+		kernels = &sse2_kernels;
+#endif
+	}
+
+	return kernels;
+}
+
+bool audio_dyn_set_kernel(const char *name)
+{
+	if (!name) {
+		kernels = NULL;
+		return true;
+	}
+
+	if (strcmp(name, sse2_kernels.name) == 0) {
+		kernels = &sse2_kernels;
+		return true;
+	}
+
+#if CPU_FEATURES_X86
+	if (strcmp(name, avx2_kernels.name) == 0 && cpu_has_avx2()) {
+		kernels = &avx2_kernels;
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+float audio_dyn_peak_envelope(float *env_buf, const float *samples,
+			      size_t count, float env, float attack,
+			      float release)
+{
+	/* the recurrence can't be vectorized over samples, but keeping it
+	 * branch free lets the compiler turn the coefficient pick into a
+	 * blend */
+	for (size_t i = 0; i < count; i++) {
+		const float env_in = fabsf(samples[i]);
+		const float coef = env < env_in ? attack : release;
+
+		env = env_in + coef * (env - env_in);
+		env_buf[i] = fmaxf(env_buf[i], env);
+	}
+
+	return env;
+}
+
+void audio_dyn_compressor_gain(float *gain, const float *env, size_t count,
+			       float slope, float threshold_db,
+			       float output_gain)
+{
+	get_kernels()->compressor_gain(gain, env, count, slope,
+				       threshold_db * LOG2_PER_DB,
+				       output_gain);
+}
+
+void audio_dyn_expander_gain_db(float *gain_db, const float *env,
+				size_t count, float slope, float threshold_db)
+{
+	get_kernels()->expander_gain_db(gain_db, env, count, slope,
+					threshold_db);
+}
+
+void audio_dyn_apply_gain(float *samples, const float *gain, size_t count)
+{
+	get_kernels()->apply_gain(samples, gain, count);
+}
+
+void audio_dyn_apply_gain_db(float *samples, const float *gain_db,
+			     size_t count, float output_gain)
+{
+	get_kernels()->apply_gain_db(samples, gain_db, count, output_gain);
+}
+
+const char *audio_dyn_get_kernel_name(void)
+{
+	return get_kernels()->name;
+}
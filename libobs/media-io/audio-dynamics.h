@@ -0,0 +1,81 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Block kernels for the dynamics filters (compressor, limiter, expander).
+ *
+ * Gains are computed in the log2 domain with polynomial approximations of
+ * log2 and exp2 instead of log10f/powf per sample.  The approximations are
+ * within AUDIO_DYN_MAX_DB_ERROR of the exact gain for the whole range of
+ * gains the filters produce.  Like audio-mix, the implementation is picked
+ * once at runtime.
+ */
+
+#define AUDIO_DYN_MAX_DB_ERROR 0.001f
+
+/** Peak envelope follower for one channel.  Starting from env, follows
+ *  |samples[i]| with the attack coefficient while rising and the release
+ *  coefficient while falling, and stores the maximum of env_buf[i] and the
+ *  envelope in env_buf[i], so that several channels can be combined.
+ *  Returns the envelope after the last sample. */
+EXPORT float audio_dyn_peak_envelope(float *env_buf, const float *samples,
+				     size_t count, float env, float attack,
+				     float release);
+
+/** gain[i] = 10^(min(0, slope * (threshold_db - 20 * log10(env[i]))) / 20)
+ *            * output_gain
+ *  gain and env may be the same buffer. */
+EXPORT void audio_dyn_compressor_gain(float *gain, const float *env,
+				      size_t count, float slope,
+				      float threshold_db, float output_gain);
+
+/** Target gain of the expander in dB:
+ *  gain_db[i] = threshold_db > env_db ?
+ *               max(slope * (threshold_db - env_db), -60) : 0
+ *  with env_db = 20 * log10(env[i]).  gain_db and env may be the same
+ *  buffer. */
+EXPORT void audio_dyn_expander_gain_db(float *gain_db, const float *env,
+				       size_t count, float slope,
+				       float threshold_db);
+
+/** samples[i] *= gain[i] */
+EXPORT void audio_dyn_apply_gain(float *samples, const float *gain,
+				 size_t count);
+
+/** samples[i] *= 10^(min(0, gain_db[i]) / 20) * output_gain */
+EXPORT void audio_dyn_apply_gain_db(float *samples, const float *gain_db,
+				    size_t count, float output_gain);
+
+/** Name of the selected kernel set, for logging */
+EXPORT const char *audio_dyn_get_kernel_name(void);
+
+/** Forces the named kernel set ("SSE2" or "AVX2") so tests can check each
+ *  of them, NULL goes back to the runtime pick.  Returns false if the set
+ *  isn't supported by this CPU. */
+EXPORT bool audio_dyn_set_kernel(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
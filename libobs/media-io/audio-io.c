@@ -26,6 +26,7 @@
 #include "../util/util_uint64.h"
 
 #include "audio-io.h"
+#include "audio-mix.h"
 #include "audio-resampler.h"
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
@@ -63,6 +64,7 @@ struct audio_output {
 
 	pthread_t thread;
 	os_event_t *stop_event;
+	volatile bool realtime;
 
 	bool initialized;
 
@@ -122,7 +124,8 @@ static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
 	pthread_mutex_unlock(&audio->input_mutex);
 }
 
-static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
+static inline void clamp_audio_output(struct audio_output *audio, size_t bytes,
+				      uint32_t active_mixes)
 {
 	size_t float_size = bytes / sizeof(float);
 
@@ -130,20 +133,11 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		/* do not process mixing if a specific mix is inactive */
-		if (!mix->inputs.num)
+		if ((active_mixes & (1 << mix_idx)) == 0)
 			continue;
 
-		for (size_t plane = 0; plane < audio->planes; plane++) {
-			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val > 1.0f) ? 1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
-		}
+		for (size_t plane = 0; plane < audio->planes; plane++)
+			audio_clamp_float(mix->buffer[plane], float_size);
 	}
 }
 
@@ -171,14 +165,17 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 	}
 	pthread_mutex_unlock(&audio->input_mutex);
 
-	/* clear mix buffers */
+	/* clear mix buffers, inactive mixes are neither mixed nor output */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
-		memset(mix->buffer, 0, sizeof(mix->buffer));
+		if ((active_mixes & (1 << mix_idx)) == 0)
+			continue;
 
-		for (size_t i = 0; i < audio->planes; i++)
+		for (size_t i = 0; i < audio->planes; i++) {
+			memset(mix->buffer[i], 0, bytes);
 			data[mix_idx].data[i] = mix->buffer[i];
+		}
 	}
 
 	/* get new audio data */
@@ -188,11 +185,26 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 		return;
 
 	/* clamps audio data to -1.0..1.0 */
-	clamp_audio_output(audio, bytes);
+	clamp_audio_output(audio, bytes, active_mixes);
 
 	/* output */
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		if ((active_mixes & (1 << i)) != 0)
+			do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	}
+}
+
+static void set_audio_thread_priority(struct audio_output *audio,
+				      bool realtime)
+{
+	static const char *names[] = {"normal", "high", "realtime"};
+	enum os_thread_priority priority;
+
+	priority = os_set_thread_priority(realtime ? OS_THREAD_PRIORITY_REALTIME
+						   : OS_THREAD_PRIORITY_NORMAL);
+
+	blog(LOG_INFO, "audio_thread(%s): Running with %s priority",
+	     audio->info.name, names[priority]);
 }
 
 static void *audio_thread(void *param)
@@ -203,8 +215,8 @@ static void *audio_thread(void *param)
 	uint64_t start_time = os_gettime_ns();
 	uint64_t prev_time = start_time;
 	uint64_t audio_time = prev_time;
-	uint32_t audio_wait_time = (uint32_t)(
-		audio_frames_to_ns(rate, AUDIO_OUTPUT_FRAMES) / 1000000);
+	uint64_t tick_time = audio_frames_to_ns(rate, AUDIO_OUTPUT_FRAMES);
+	bool realtime = false;
 
 	os_set_thread_name("audio-io: audio thread");
 
@@ -212,10 +224,21 @@ static void *audio_thread(void *param)
 		profile_store_name(obs_get_profiler_name_store(),
 				   "audio_thread(%s)", audio->info.name);
 
+	/* the time between calls histogram of the root shows how far the
+	 * thread strays from the tick interval */
+	profile_register_root(audio_thread_name, tick_time);
+
 	while (os_event_try(audio->stop_event) == EAGAIN) {
 		uint64_t cur_time;
 
-		os_sleep_ms(audio_wait_time);
+		if (realtime != os_atomic_load_bool(&audio->realtime)) {
+			realtime = !realtime;
+			set_audio_thread_priority(audio, realtime);
+		}
+
+		/* wake up when the next tick is due, deadlines are absolute
+		 * so oversleeping once doesn't shift every following tick */
+		os_sleepto_ns(audio_time);
 
 		profile_start(audio_thread_name);
 
@@ -237,6 +260,12 @@ static void *audio_thread(void *param)
 	return NULL;
 }
 
+void audio_output_set_realtime(audio_t *audio, bool realtime)
+{
+	if (audio)
+		os_atomic_set_bool(&audio->realtime, realtime);
+}
+
 /* ------------------------------------------------------------------------- */
 
 static size_t audio_get_input_idx(const audio_t *audio, size_t mix_idx,
@@ -222,6 +222,10 @@ EXPORT void audio_output_disconnect(audio_t *video, size_t mix_idx,
 
 EXPORT bool audio_output_active(const audio_t *audio);
 
+/* runs the audio thread with realtime (or failing that, high) priority if
+ * the process is permitted to */
+EXPORT void audio_output_set_realtime(audio_t *audio, bool realtime);
+
 EXPORT size_t audio_output_get_block_size(const audio_t *audio);
 EXPORT size_t audio_output_get_planes(const audio_t *audio);
 EXPORT size_t audio_output_get_channels(const audio_t *audio);
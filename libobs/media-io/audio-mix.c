@@ -0,0 +1,153 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-mix.h"
+
+#include "../util/sse-intrin.h"
+#include "../util/cpu-features.h"
+
+static void mix_float_sse2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 d0 = _mm_loadu_ps(dst + i);
+		__m128 d1 = _mm_loadu_ps(dst + i + 4);
+		__m128 s0 = _mm_loadu_ps(src + i);
+		__m128 s1 = _mm_loadu_ps(src + i + 4);
+
+		_mm_storeu_ps(dst + i, _mm_add_ps(d0, s0));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(d1, s1));
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void clamp_float_sse2(float *data, size_t count)
+{
+	const __m128 min_val = _mm_set1_ps(-1.0f);
+	const __m128 max_val = _mm_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		val = _mm_min_ps(_mm_max_ps(val, min_val), max_val);
+		_mm_storeu_ps(data + i, val);
+	}
+
+	for (; i < count; i++) {
+		float val = data[i];
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+
+#if CPU_FEATURES_X86
+CPU_FEATURES_TARGET_AVX2
+static void mix_float_avx2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256 d0 = _mm256_loadu_ps(dst + i);
+		__m256 d1 = _mm256_loadu_ps(dst + i + 8);
+		__m256 s0 = _mm256_loadu_ps(src + i);
+		__m256 s1 = _mm256_loadu_ps(src + i + 8);
+
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(d0, s0));
+		_mm256_storeu_ps(dst + i + 8, _mm256_add_ps(d1, s1));
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void clamp_float_avx2(float *data, size_t count)
+{
+	const __m256 min_val = _mm256_set1_ps(-1.0f);
+	const __m256 max_val = _mm256_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		val = _mm256_min_ps(_mm256_max_ps(val, min_val), max_val);
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	for (; i < count; i++) {
+		float val = data[i];
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+#endif
+
+struct audio_mix_kernels {
+	const char *name;
+	void (*mix)(float *dst, const float *src, size_t count);
+	void (*clamp)(float *data, size_t count);
+};
+
+static const struct audio_mix_kernels sse2_kernels = {
+	"SSE2",
+	mix_float_sse2,
+	clamp_float_sse2,
+};
+
+#if CPU_FEATURES_X86
+static const struct audio_mix_kernels avx2_kernels = {
+	"AVX2",
+	mix_float_avx2,
+	clamp_float_avx2,
+};
+#endif
+
+static const struct audio_mix_kernels *kernels = NULL;
+
+/* selecting the kernels more than once is harmless, the result is always the
+ * same, so no locking is needed here */
+static inline const struct audio_mix_kernels *get_kernels(void)
+{
+	if (!kernels) {
+#if CPU_FEATURES_X86
+		kernels = cpu_has_avx2() ? &avx2_kernels : &sse2_kernels;
+#else
+		kernels = &sse2_kernels;
+#endif
+	}
+
+	return kernels;
+}
+
+void audio_mix_float(float *dst, const float *src, size_t count)
+{
+	get_kernels()->mix(dst, src, count);
+}
+
+void audio_clamp_float(float *data, size_t count)
+{
+	get_kernels()->clamp(data, count);
+}
+
+const char *audio_mix_get_kernel_name(void)
+{
+	return get_kernels()->name;
+}
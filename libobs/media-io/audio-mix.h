@@ -0,0 +1,43 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Audio mixing kernels used by the audio thread.  The implementation is
+ * picked once at runtime (AVX2 where available, SSE2 otherwise, with the
+ * simde/sse2neon wrappers covering non-x86 builds).
+ */
+
+/** dst[i] += src[i] */
+EXPORT void audio_mix_float(float *dst, const float *src, size_t count);
+
+/** Clamps each value to -1.0..1.0 */
+EXPORT void audio_clamp_float(float *data, size_t count);
+
+/** Name of the selected kernel set, for logging */
+EXPORT const char *audio_mix_get_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,933 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "video-convert.h"
+
+#include "../util/bmem.h"
+#include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/task-pool.h"
+#include "../util/sse-intrin.h"
+#include "../util/cpu-features.h"
+
+/* conversions are bound by memory bandwidth well before every core of a
+ * large machine is busy */
+#define MAX_CONVERT_THREADS 8
+
+/* smallest number of row pairs given to one thread */
+#define MIN_CHUNK_PAIRS 16
+
+/* ------------------------------------------------------------------------- */
+/* row kernels, scalar                                                       */
+
+static inline uint8_t avg_u8(uint8_t a, uint8_t b)
+{
+	return (uint8_t)(((unsigned)a + (unsigned)b + 1) >> 1);
+}
+
+static inline void deinterleave_scalar(uint8_t *a, uint8_t *b,
+				       const uint8_t *src, size_t i, size_t n)
+{
+	for (; i < n; i++) {
+		a[i] = src[i * 2];
+		b[i] = src[i * 2 + 1];
+	}
+}
+
+static inline void interleave_scalar(uint8_t *dst, const uint8_t *a,
+				     const uint8_t *b, size_t i, size_t n)
+{
+	for (; i < n; i++) {
+		dst[i * 2] = a[i];
+		dst[i * 2 + 1] = b[i];
+	}
+}
+
+static inline void average_scalar(uint8_t *dst, const uint8_t *a,
+				  const uint8_t *b, size_t i, size_t n)
+{
+	for (; i < n; i++)
+		dst[i] = avg_u8(a[i], b[i]);
+}
+
+static inline void downsample_scalar(uint8_t *dst, const uint8_t *src,
+				     size_t i, size_t n)
+{
+	for (; i < n; i++)
+		dst[i] = avg_u8(src[i * 2], src[i * 2 + 1]);
+}
+
+static inline void upsample_scalar(uint8_t *dst, const uint8_t *src, size_t i,
+				   size_t n)
+{
+	for (; i < n; i++) {
+		const size_t next = i + 1 < n ? i + 1 : i;
+		dst[i * 2] = src[i];
+		dst[i * 2 + 1] = avg_u8(src[i], src[next]);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* SSE2                                                                      */
+
+static void deinterleave_sse2(uint8_t *a, uint8_t *b, const uint8_t *src,
+			      size_t n)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(src + i * 2));
+		__m128i hi =
+			_mm_loadu_si128((const __m128i *)(src + i * 2 + 16));
+
+		_mm_storeu_si128((__m128i *)(a + i),
+				 _mm_packus_epi16(_mm_and_si128(lo, mask),
+						  _mm_and_si128(hi, mask)));
+		_mm_storeu_si128((__m128i *)(b + i),
+				 _mm_packus_epi16(_mm_srli_epi16(lo, 8),
+						  _mm_srli_epi16(hi, 8)));
+	}
+
+	deinterleave_scalar(a, b, src, i, n);
+}
+
+static void interleave_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+			    size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+
+		_mm_storeu_si128((__m128i *)(dst + i * 2),
+				 _mm_unpacklo_epi8(va, vb));
+		_mm_storeu_si128((__m128i *)(dst + i * 2 + 16),
+				 _mm_unpackhi_epi8(va, vb));
+	}
+
+	interleave_scalar(dst, a, b, i, n);
+}
+
+static void average_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+			 size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_avg_epu8(va, vb));
+	}
+
+	average_scalar(dst, a, b, i, n);
+}
+
+static void downsample_sse2(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(src + i * 2));
+		__m128i hi =
+			_mm_loadu_si128((const __m128i *)(src + i * 2 + 16));
+		__m128i even = _mm_packus_epi16(_mm_and_si128(lo, mask),
+						_mm_and_si128(hi, mask));
+		__m128i odd = _mm_packus_epi16(_mm_srli_epi16(lo, 8),
+					       _mm_srli_epi16(hi, 8));
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_avg_epu8(even, odd));
+	}
+
+	downsample_scalar(dst, src, i, n);
+}
+
+static void upsample_sse2(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i = 0;
+
+	/* reads one sample past the block, the last sample of the row is
+	 * left to the scalar tail */
+	for (; i + 17 <= n; i += 16) {
+		__m128i cur = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i next = _mm_loadu_si128((const __m128i *)(src + i + 1));
+		__m128i mid = _mm_avg_epu8(cur, next);
+
+		_mm_storeu_si128((__m128i *)(dst + i * 2),
+				 _mm_unpacklo_epi8(cur, mid));
+		_mm_storeu_si128((__m128i *)(dst + i * 2 + 16),
+				 _mm_unpackhi_epi8(cur, mid));
+	}
+
+	upsample_scalar(dst, src, i, n);
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX2                                                                      */
+
+#if CPU_FEATURES_X86
+CPU_FEATURES_TARGET_AVX2
+static void deinterleave_avx2(uint8_t *a, uint8_t *b, const uint8_t *src,
+			      size_t n)
+{
+	const __m256i mask = _mm256_set1_epi16(0x00FF);
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i lo = _mm256_loadu_si256((const __m256i *)(src + i * 2));
+		__m256i hi = _mm256_loadu_si256(
+			(const __m256i *)(src + i * 2 + 32));
+
+		/* packus works per 128 bit lane, put the quads back in
+		 * order afterwards */
+		__m256i even = _mm256_packus_epi16(_mm256_and_si256(lo, mask),
+						   _mm256_and_si256(hi, mask));
+		__m256i odd = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8),
+						  _mm256_srli_epi16(hi, 8));
+
+		_mm256_storeu_si256((__m256i *)(a + i),
+				    _mm256_permute4x64_epi64(even, 0xD8));
+		_mm256_storeu_si256((__m256i *)(b + i),
+				    _mm256_permute4x64_epi64(odd, 0xD8));
+	}
+
+	deinterleave_scalar(a, b, src, i, n);
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void interleave_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+			    size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+		__m256i lo = _mm256_unpacklo_epi8(va, vb);
+		__m256i hi = _mm256_unpackhi_epi8(va, vb);
+
+		_mm256_storeu_si256((__m256i *)(dst + i * 2),
+				    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst + i * 2 + 32),
+				    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	interleave_scalar(dst, a, b, i, n);
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void average_avx2(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+			 size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				    _mm256_avg_epu8(va, vb));
+	}
+
+	average_scalar(dst, a, b, i, n);
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void downsample_avx2(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	const __m256i mask = _mm256_set1_epi16(0x00FF);
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i lo = _mm256_loadu_si256((const __m256i *)(src + i * 2));
+		__m256i hi = _mm256_loadu_si256(
+			(const __m256i *)(src + i * 2 + 32));
+		__m256i even = _mm256_packus_epi16(_mm256_and_si256(lo, mask),
+						   _mm256_and_si256(hi, mask));
+		__m256i odd = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8),
+						  _mm256_srli_epi16(hi, 8));
+
+		/* the average doesn't care about the lane order, only the
+		 * result has to be permuted */
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				    _mm256_permute4x64_epi64(
+					    _mm256_avg_epu8(even, odd), 0xD8));
+	}
+
+	downsample_scalar(dst, src, i, n);
+}
+
+CPU_FEATURES_TARGET_AVX2
+static void upsample_avx2(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 33 <= n; i += 32) {
+		__m256i cur = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i next =
+			_mm256_loadu_si256((const __m256i *)(src + i + 1));
+		__m256i mid = _mm256_avg_epu8(cur, next);
+		__m256i lo = _mm256_unpacklo_epi8(cur, mid);
+		__m256i hi = _mm256_unpackhi_epi8(cur, mid);
+
+		_mm256_storeu_si256((__m256i *)(dst + i * 2),
+				    _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst + i * 2 + 32),
+				    _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	upsample_scalar(dst, src, i, n);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+struct video_convert_kernels {
+	const char *name;
+	/* a[i] = src[i * 2], b[i] = src[i * 2 + 1] */
+	void (*deinterleave)(uint8_t *a, uint8_t *b, const uint8_t *src,
+			     size_t n);
+	/* dst[i * 2] = a[i], dst[i * 2 + 1] = b[i] */
+	void (*interleave)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+			   size_t n);
+	/* dst[i] = (a[i] + b[i] + 1) / 2 */
+	void (*average)(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+			size_t n);
+	/* n samples from 2n */
+	void (*downsample)(uint8_t *dst, const uint8_t *src, size_t n);
+	/* 2n samples from n */
+	void (*upsample)(uint8_t *dst, const uint8_t *src, size_t n);
+};
+
+static const struct video_convert_kernels sse2_kernels = {
+	"SSE2",
+	deinterleave_sse2,
+	interleave_sse2,
+	average_sse2,
+	downsample_sse2,
+	upsample_sse2,
+};
+
+#if CPU_FEATURES_X86
+static const struct video_convert_kernels avx2_kernels = {
+	"AVX2",
+	deinterleave_avx2,
+	interleave_avx2,
+	average_avx2,
+	downsample_avx2,
+	upsample_avx2,
+};
+#endif
+
+static const struct video_convert_kernels *kernels = NULL;
+
+static inline const struct video_convert_kernels *get_kernels(void)
+{
+	if (!kernels) {
+#if CPU_FEATURES_X86
+		kernels = cpu_has_avx2() ? &avx2_kernels : &sse2_kernels;
+#else
+		kernels = &sse2_kernels;
+#endif
+	}
+
+	return kernels;
+}
+
+/* ------------------------------------------------------------------------- */
+/* formats                                                                   */
+
+enum yuv_layout {
+	LAYOUT_PLANAR,
+	LAYOUT_SEMI_PLANAR,
+	LAYOUT_YUYV,
+	LAYOUT_UYVY,
+	LAYOUT_YVYU,
+	LAYOUT_LUMA,
+};
+
+struct yuv_desc {
+	enum yuv_layout layout;
+	uint32_t shift_x;
+	uint32_t shift_y;
+	bool alpha;
+};
+
+static bool get_yuv_desc(enum video_format format, struct yuv_desc *desc)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+		*desc = (struct yuv_desc){LAYOUT_PLANAR, 1, 1, false};
+		return true;
+	case VIDEO_FORMAT_NV12:
+		*desc = (struct yuv_desc){LAYOUT_SEMI_PLANAR, 1, 1, false};
+		return true;
+	case VIDEO_FORMAT_I422:
+		*desc = (struct yuv_desc){LAYOUT_PLANAR, 1, 0, false};
+		return true;
+	case VIDEO_FORMAT_I444:
+		*desc = (struct yuv_desc){LAYOUT_PLANAR, 0, 0, false};
+		return true;
+	case VIDEO_FORMAT_YUY2:
+		*desc = (struct yuv_desc){LAYOUT_YUYV, 1, 0, false};
+		return true;
+	case VIDEO_FORMAT_UYVY:
+		*desc = (struct yuv_desc){LAYOUT_UYVY, 1, 0, false};
+		return true;
+	case VIDEO_FORMAT_YVYU:
+		*desc = (struct yuv_desc){LAYOUT_YVYU, 1, 0, false};
+		return true;
+	case VIDEO_FORMAT_Y800:
+		*desc = (struct yuv_desc){LAYOUT_LUMA, 0, 0, false};
+		return true;
+	case VIDEO_FORMAT_I40A:
+		*desc = (struct yuv_desc){LAYOUT_PLANAR, 1, 1, true};
+		return true;
+	case VIDEO_FORMAT_I42A:
+		*desc = (struct yuv_desc){LAYOUT_PLANAR, 1, 0, true};
+		return true;
+	case VIDEO_FORMAT_YUVA:
+		*desc = (struct yuv_desc){LAYOUT_PLANAR, 0, 0, true};
+		return true;
+
+	case VIDEO_FORMAT_NONE:
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_BGR3:
+	case VIDEO_FORMAT_AYUV:
+		break;
+	}
+
+	return false;
+}
+
+/* bytes per row and the vertical subsampling of each plane, for copies */
+static size_t get_planes(enum video_format format, uint32_t width,
+			 size_t row_bytes[MAX_AV_PLANES],
+			 uint32_t shift_y[MAX_AV_PLANES])
+{
+	struct yuv_desc desc;
+	size_t planes = 0;
+
+	switch (format) {
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_AYUV:
+		row_bytes[0] = (size_t)width * 4;
+		shift_y[0] = 0;
+		return 1;
+	case VIDEO_FORMAT_BGR3:
+		row_bytes[0] = (size_t)width * 3;
+		shift_y[0] = 0;
+		return 1;
+	default:
+		break;
+	}
+
+	if (!get_yuv_desc(format, &desc))
+		return 0;
+
+	switch (desc.layout) {
+	case LAYOUT_YUYV:
+	case LAYOUT_UYVY:
+	case LAYOUT_YVYU:
+		row_bytes[0] = (size_t)width * 2;
+		shift_y[0] = 0;
+		return 1;
+	case LAYOUT_SEMI_PLANAR:
+		row_bytes[0] = width;
+		row_bytes[1] = (size_t)(width >> desc.shift_x) * 2;
+		shift_y[0] = 0;
+		shift_y[1] = desc.shift_y;
+		return 2;
+	case LAYOUT_LUMA:
+		row_bytes[0] = width;
+		shift_y[0] = 0;
+		return 1;
+	case LAYOUT_PLANAR:
+		break;
+	}
+
+	planes = desc.alpha ? 4 : 3;
+	for (size_t i = 0; i < planes; i++) {
+		const bool chroma = i == 1 || i == 2;
+		row_bytes[i] = chroma ? width >> desc.shift_x : width;
+		shift_y[i] = chroma ? desc.shift_y : 0;
+	}
+
+	return planes;
+}
+
+bool video_convert_supported(enum video_format dst, enum video_format src)
+{
+	struct yuv_desc dst_desc, src_desc;
+
+	if (dst == src)
+		return dst != VIDEO_FORMAT_NONE;
+
+	return get_yuv_desc(dst, &dst_desc) && get_yuv_desc(src, &src_desc);
+}
+
+/* ------------------------------------------------------------------------- */
+/* conversion of a range of rows                                             */
+
+struct convert_params {
+	uint8_t *const *output;
+	const uint32_t *out_linesize;
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
+	uint32_t width;
+	uint32_t height;
+
+	bool copy;
+	enum video_format format;
+
+	struct yuv_desc dst;
+	struct yuv_desc src;
+};
+
+struct convert_chunk {
+	const struct convert_params *params;
+	uint32_t y_start;
+	uint32_t y_end;
+};
+
+static void copy_rows(const struct convert_params *p, uint32_t y_start,
+		      uint32_t y_end)
+{
+	size_t row_bytes[MAX_AV_PLANES];
+	uint32_t shift_y[MAX_AV_PLANES];
+	size_t planes = get_planes(p->format, p->width, row_bytes, shift_y);
+
+	for (size_t i = 0; i < planes; i++) {
+		/* like the planes of a video_frame, subsampled planes of odd
+		 * sized frames are rounded down */
+		const uint32_t start = y_start >> shift_y[i];
+		const uint32_t end = y_end >> shift_y[i];
+		const uint8_t *in = p->input[i] +
+				    (size_t)start * p->in_linesize[i];
+		uint8_t *out = p->output[i] +
+			       (size_t)start * p->out_linesize[i];
+
+		if (p->in_linesize[i] == p->out_linesize[i] &&
+		    row_bytes[i] == p->in_linesize[i]) {
+			memcpy(out, in, row_bytes[i] * (end - start));
+			continue;
+		}
+
+		for (uint32_t y = start; y < end; y++) {
+			memcpy(out, in, row_bytes[i]);
+			in += p->in_linesize[i];
+			out += p->out_linesize[i];
+		}
+	}
+}
+
+struct convert_rows {
+	const struct video_convert_kernels *k;
+	const struct convert_params *p;
+
+	uint8_t *mem;
+	uint8_t *luma[2];
+	uint8_t *packed_chroma;
+	uint8_t *src_u[2];
+	uint8_t *src_v[2];
+	uint8_t *avg_u;
+	uint8_t *avg_v;
+	uint8_t *out_u[2];
+	uint8_t *out_v[2];
+	uint8_t *gray;
+};
+
+#define ROW_ALIGN 32
+
+static void convert_rows_init(struct convert_rows *rows,
+			      const struct convert_params *p)
+{
+	const size_t stride = ((size_t)p->width + ROW_ALIGN - 1) &
+			      ~(size_t)(ROW_ALIGN - 1);
+	uint8_t *ptr;
+
+	rows->k = get_kernels();
+	rows->p = p;
+	rows->mem = bmalloc(stride * 14);
+
+	ptr = rows->mem;
+	for (size_t i = 0; i < 2; i++) {
+		rows->luma[i] = ptr;
+		rows->src_u[i] = ptr + stride;
+		rows->src_v[i] = ptr + stride * 2;
+		rows->out_u[i] = ptr + stride * 3;
+		rows->out_v[i] = ptr + stride * 4;
+		ptr += stride * 5;
+	}
+
+	rows->packed_chroma = ptr;
+	rows->avg_u = ptr + stride;
+	rows->avg_v = ptr + stride * 2;
+	rows->gray = ptr + stride * 3;
+
+	if (p->src.layout == LAYOUT_LUMA)
+		memset(rows->gray, 128, p->width);
+}
+
+static inline void convert_rows_free(struct convert_rows *rows)
+{
+	bfree(rows->mem);
+}
+
+static inline void split_packed(const struct convert_rows *rows,
+				enum yuv_layout layout, uint8_t *y,
+				uint8_t *u, uint8_t *v, const uint8_t *src)
+{
+	const size_t width = rows->p->width;
+	uint8_t *c = rows->packed_chroma;
+
+	if (layout == LAYOUT_UYVY)
+		rows->k->deinterleave(c, y, src, width);
+	else
+		rows->k->deinterleave(y, c, src, width);
+
+	if (layout == LAYOUT_YVYU)
+		rows->k->deinterleave(v, u, c, width / 2);
+	else
+		rows->k->deinterleave(u, v, c, width / 2);
+}
+
+static inline void merge_packed(const struct convert_rows *rows,
+				enum yuv_layout layout, uint8_t *dst,
+				const uint8_t *y, const uint8_t *u,
+				const uint8_t *v)
+{
+	const size_t width = rows->p->width;
+	uint8_t *c = rows->packed_chroma;
+
+	if (layout == LAYOUT_YVYU)
+		rows->k->interleave(c, v, u, width / 2);
+	else
+		rows->k->interleave(c, u, v, width / 2);
+
+	if (layout == LAYOUT_UYVY)
+		rows->k->interleave(dst, c, y, width);
+	else
+		rows->k->interleave(dst, y, c, width);
+}
+
+static inline bool is_packed(enum yuv_layout layout)
+{
+	return layout == LAYOUT_YUYV || layout == LAYOUT_UYVY ||
+	       layout == LAYOUT_YVYU;
+}
+
+static inline const uint8_t *in_row(const struct convert_params *p,
+				    size_t plane, uint32_t y)
+{
+	return p->input[plane] + (size_t)y * p->in_linesize[plane];
+}
+
+static inline uint8_t *out_row(const struct convert_params *p, size_t plane,
+			       uint32_t y)
+{
+	return p->output[plane] + (size_t)y * p->out_linesize[plane];
+}
+
+/* reads one or two luma rows starting at y along with the chroma that
+ * covers them, at the chroma resolution of the source */
+static void read_rows(struct convert_rows *rows, uint32_t y, uint32_t count,
+		      const uint8_t *luma[2], const uint8_t *u[2],
+		      const uint8_t *v[2])
+{
+	const struct convert_params *p = rows->p;
+	const struct yuv_desc *src = &p->src;
+	const uint32_t cy = y >> src->shift_y;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (is_packed(src->layout)) {
+			split_packed(rows, src->layout, rows->luma[i],
+				     rows->src_u[i], rows->src_v[i],
+				     in_row(p, 0, y + i));
+			luma[i] = rows->luma[i];
+			u[i] = rows->src_u[i];
+			v[i] = rows->src_v[i];
+			continue;
+		}
+
+		luma[i] = in_row(p, 0, y + i);
+
+		if (i > 0 && src->shift_y) {
+			u[i] = u[0];
+			v[i] = v[0];
+
+		} else if (p->dst.layout == LAYOUT_LUMA) {
+			/* chroma is dropped, don't bother reading it */
+			u[i] = NULL;
+			v[i] = NULL;
+
+		} else if (src->layout == LAYOUT_PLANAR) {
+			u[i] = in_row(p, 1, cy + i);
+			v[i] = in_row(p, 2, cy + i);
+
+		} else if (src->layout == LAYOUT_SEMI_PLANAR) {
+			rows->k->deinterleave(rows->src_u[i], rows->src_v[i],
+					      in_row(p, 1, cy + i),
+					      p->width >> src->shift_x);
+			u[i] = rows->src_u[i];
+			v[i] = rows->src_v[i];
+
+		} else {
+			u[i] = rows->gray;
+			v[i] = rows->gray;
+		}
+	}
+}
+
+/* brings chroma from the source to the destination resolution */
+static void resample_chroma(struct convert_rows *rows, uint32_t count,
+			    const uint8_t *u[2], const uint8_t *v[2])
+{
+	const struct convert_params *p = rows->p;
+	const struct video_convert_kernels *k = rows->k;
+	const size_t src_cx = p->width >> p->src.shift_x;
+	const size_t dst_cx = p->width >> p->dst.shift_x;
+
+	if (p->dst.shift_y && !p->src.shift_y && u[0] != u[1]) {
+		k->average(rows->avg_u, u[0], u[1], src_cx);
+		k->average(rows->avg_v, v[0], v[1], src_cx);
+		u[0] = u[1] = rows->avg_u;
+		v[0] = v[1] = rows->avg_v;
+	}
+
+	if (p->src.shift_x == p->dst.shift_x)
+		return;
+
+	/* rows shared by both luma rows are only resampled once */
+	const bool shared = u[0] == u[1] && v[0] == v[1];
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (i > 0 && shared) {
+			u[i] = rows->out_u[0];
+			v[i] = rows->out_v[0];
+			continue;
+		}
+
+		if (p->src.shift_x) {
+			k->upsample(rows->out_u[i], u[i], src_cx);
+			k->upsample(rows->out_v[i], v[i], src_cx);
+		} else {
+			k->downsample(rows->out_u[i], u[i], dst_cx);
+			k->downsample(rows->out_v[i], v[i], dst_cx);
+		}
+
+		u[i] = rows->out_u[i];
+		v[i] = rows->out_v[i];
+	}
+}
+
+static void write_rows(struct convert_rows *rows, uint32_t y, uint32_t count,
+		       const uint8_t *luma[2], const uint8_t *u[2],
+		       const uint8_t *v[2])
+{
+	const struct convert_params *p = rows->p;
+	const struct yuv_desc *dst = &p->dst;
+	const uint32_t cy = y >> dst->shift_y;
+	const uint32_t chroma_count = dst->shift_y ? 1 : count;
+	const size_t width = p->width;
+	const size_t dst_cx = width >> dst->shift_x;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (is_packed(dst->layout))
+			merge_packed(rows, dst->layout, out_row(p, 0, y + i),
+				     luma[i], u[i], v[i]);
+		else
+			memcpy(out_row(p, 0, y + i), luma[i], width);
+
+		if (!dst->alpha)
+			continue;
+
+		if (p->src.alpha)
+			memcpy(out_row(p, 3, y + i), in_row(p, 3, y + i),
+			       width);
+		else
+			memset(out_row(p, 3, y + i), 255, width);
+	}
+
+	for (uint32_t i = 0; i < chroma_count; i++) {
+		if (dst->layout == LAYOUT_PLANAR) {
+			memcpy(out_row(p, 1, cy + i), u[i], dst_cx);
+			memcpy(out_row(p, 2, cy + i), v[i], dst_cx);
+
+		} else if (dst->layout == LAYOUT_SEMI_PLANAR) {
+			rows->k->interleave(out_row(p, 1, cy + i), u[i], v[i],
+					    dst_cx);
+		}
+	}
+}
+
+static void convert_rows(const struct convert_params *p, uint32_t y_start,
+			 uint32_t y_end)
+{
+	struct convert_rows rows;
+
+	if (p->copy) {
+		copy_rows(p, y_start, y_end);
+		return;
+	}
+
+	convert_rows_init(&rows, p);
+
+	for (uint32_t y = y_start; y < y_end; y += 2) {
+		const uint32_t count = y + 1 < y_end ? 2 : 1;
+		const uint8_t *luma[2] = {NULL, NULL};
+		const uint8_t *u[2] = {NULL, NULL};
+		const uint8_t *v[2] = {NULL, NULL};
+
+		read_rows(&rows, y, count, luma, u, v);
+		if (p->dst.layout != LAYOUT_LUMA)
+			resample_chroma(&rows, count, u, v);
+		write_rows(&rows, y, count, luma, u, v);
+	}
+
+	convert_rows_free(&rows);
+}
+
+/* ------------------------------------------------------------------------- */
+/* threading                                                                 */
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static os_task_pool_t *worker_pool = NULL;
+
+os_task_pool_t *video_convert_get_pool(void)
+{
+	os_task_pool_t *ret;
+
+	pthread_mutex_lock(&pool_mutex);
+	if (!worker_pool) {
+		int threads = os_get_logical_cores();
+
+		if (threads < 1)
+			threads = 1;
+		else if (threads > MAX_CONVERT_THREADS)
+			threads = MAX_CONVERT_THREADS;
+
+		/* the calling thread takes a chunk as well */
+		if (threads > 1)
+			worker_pool = os_task_pool_create(
+				"libobs: video worker", (size_t)threads - 1);
+	}
+	ret = worker_pool;
+	pthread_mutex_unlock(&pool_mutex);
+
+	return ret;
+}
+
+void video_convert_free_pool(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+	os_task_pool_destroy(worker_pool);
+	worker_pool = NULL;
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+static void convert_task(void *param)
+{
+	struct convert_chunk *chunk = param;
+	convert_rows(chunk->params, chunk->y_start, chunk->y_end);
+}
+
+static void convert_threaded(const struct convert_params *p)
+{
+	struct convert_chunk chunks[MAX_CONVERT_THREADS];
+	const uint32_t pairs = (p->height + 1) / 2;
+	os_task_pool_t *pool = NULL;
+	size_t num_chunks = 1;
+
+	if ((uint64_t)p->width * p->height >=
+	    VIDEO_CONVERT_MIN_THREADED_PIXELS) {
+		pool = video_convert_get_pool();
+		if (pool)
+			num_chunks = os_task_pool_num_threads(pool) + 1;
+	}
+
+	if (num_chunks > pairs / MIN_CHUNK_PAIRS)
+		num_chunks = pairs / MIN_CHUNK_PAIRS;
+	if (num_chunks > MAX_CONVERT_THREADS)
+		num_chunks = MAX_CONVERT_THREADS;
+	if (num_chunks < 1)
+		num_chunks = 1;
+
+	/* chunks start on even rows so that 4:2:0 chroma rows aren't
+	 * shared */
+	for (size_t i = 0; i < num_chunks; i++) {
+		chunks[i].params = p;
+		chunks[i].y_start = (uint32_t)(pairs * i / num_chunks) * 2;
+		chunks[i].y_end = (uint32_t)(pairs * (i + 1) / num_chunks) * 2;
+
+		if (chunks[i].y_end > p->height)
+			chunks[i].y_end = p->height;
+	}
+
+	os_task_pool_run(pool, convert_task, chunks, sizeof(chunks[0]),
+			 num_chunks);
+}
+
+bool video_convert(uint8_t *const output[], const uint32_t out_linesize[],
+		   enum video_format dst_format, const uint8_t *const input[],
+		   const uint32_t in_linesize[], enum video_format src_format,
+		   uint32_t width, uint32_t height)
+{
+	struct convert_params p = {
+		.output = output,
+		.out_linesize = out_linesize,
+		.input = input,
+		.in_linesize = in_linesize,
+		.width = width,
+		.height = height,
+		.format = src_format,
+	};
+
+	if (!width || !height || !video_convert_supported(dst_format,
+							  src_format))
+		return false;
+
+	/* formats without a yuv_desc (RGB) are only copied and keep the
+	 * zeroed desc, without any subsampling */
+	get_yuv_desc(dst_format, &p.dst);
+	get_yuv_desc(src_format, &p.src);
+	p.copy = dst_format == src_format;
+
+	/* odd sizes would need a half chroma sample at the edge, copies round
+	 * the subsampled planes down instead */
+	if (!p.copy) {
+		if ((p.dst.shift_x || p.src.shift_x) && (width & 1) != 0)
+			return false;
+		if ((p.dst.shift_y || p.src.shift_y) && (height & 1) != 0)
+			return false;
+	}
+
+	convert_threaded(&p);
+	return true;
+}
+
+const char *video_convert_get_kernel_name(void)
+{
+	return get_kernels()->name;
+}
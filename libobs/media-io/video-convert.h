@@ -0,0 +1,79 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+#include "../util/task-pool.h"
+#include "video-io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * CPU pixel format conversion between frames of the same size
+ *
+ *   Converts between the YUV layouts used by libobs (I420, NV12, I422,
+ *   I444, YUY2, UYVY, YVYU, Y800 and the alpha formats I40A, I42A and YUVA)
+ *   and copies frames of any other format to the same format.  Only the
+ *   layout and the chroma subsampling change, so the color space and range
+ *   of the frame are kept as they are.  Conversions that involve RGB or
+ *   scaling are left to video-scaler.
+ *
+ *   Chroma is downsampled by averaging and upsampled by linear interpolation
+ *   horizontally and by repeating rows vertically.  Like audio-mix, the
+ *   SSE2 or AVX2 kernels are picked once at runtime, and large frames are
+ *   split by rows across a worker pool shared by all callers.
+ */
+
+/** Frames with at least this many pixels are split across the pool */
+#define VIDEO_CONVERT_MIN_THREADED_PIXELS (1280 * 720)
+
+/** Returns true if video_convert can convert src frames to dst frames */
+EXPORT bool video_convert_supported(enum video_format dst,
+				    enum video_format src);
+
+/**
+ * Converts a frame.  Unless the frame is copied to the same format, the
+ * width has to be even if either format has subsampled chroma, and the
+ * height as well if either one is 4:2:0.
+ *
+ * @return false if the formats aren't supported or the size doesn't fit
+ *         them, in which case nothing is written
+ */
+EXPORT bool video_convert(uint8_t *const output[],
+			  const uint32_t out_linesize[],
+			  enum video_format dst_format,
+			  const uint8_t *const input[],
+			  const uint32_t in_linesize[],
+			  enum video_format src_format, uint32_t width,
+			  uint32_t height);
+
+/** Name of the selected kernel set, for logging */
+EXPORT const char *video_convert_get_kernel_name(void);
+
+/** Worker pool shared by the video code of media-io, created on first use.
+ *  NULL on single core machines, where everything runs on the caller. */
+EXPORT os_task_pool_t *video_convert_get_pool(void);
+
+/** Frees the worker pool, called by obs_shutdown */
+EXPORT void video_convert_free_pool(void);
+
+#ifdef __cplusplus
+}
+#endif
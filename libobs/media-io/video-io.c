@@ -38,16 +38,37 @@ struct cached_frame_info {
 	struct video_data frame;
 	int skipped;
 	int count;
+
+	/* parallel mode: number of inputs that still have to read this frame,
+	 * or -1 while the frame is locked for writing */
+	long pending;
 };
 
 struct video_input {
 	struct video_scale_info conversion;
 	video_scaler_t *scaler;
+	const char *scale_name;
 	struct video_frame frame[MAX_CONVERT_BUFFERS];
 	int cur_frame;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	/* parallel mode only */
+	struct video_output *video;
+	pthread_t thread;
+	os_sem_t *sem;
+	bool thread_active;
+	volatile bool stop;
+
+	bool attached;
+	size_t cursor;
+	int emitted;
+	int carry;
+	uint64_t carry_ts;
+
+	volatile long skipped_frames;
+	volatile long total_frames;
 };
 
 static inline void video_input_free(struct video_input *input)
@@ -55,6 +76,8 @@ static inline void video_input_free(struct video_input *input)
 	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
 		video_frame_free(&input->frame[i]);
 	video_scaler_destroy(input->scaler);
+	os_sem_destroy(input->sem);
+	bfree(input);
 }
 
 struct video_output {
@@ -72,7 +95,13 @@ struct video_output {
 	bool initialized;
 
 	pthread_mutex_t input_mutex;
-	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_input *) inputs;
+
+	/* when set, each input runs on its own thread and reads the frame
+	 * cache through its own cursor (protected by data_mutex) */
+	bool parallel;
+	size_t parallel_inputs;
+	size_t last_ready;
 
 	size_t available_frames;
 	size_t first_added;
@@ -98,10 +127,12 @@ static inline bool scale_video_output(struct video_input *input,
 
 		frame = &input->frame[input->cur_frame];
 
+		profile_start(input->scale_name);
 		success = video_scaler_scale(input->scaler, frame->data,
 					     frame->linesize,
 					     (const uint8_t *const *)data->data,
 					     data->linesize);
+		profile_end(input->scale_name);
 
 		if (success) {
 			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
@@ -135,7 +166,7 @@ static inline bool video_output_cur_frame(struct video_output *video)
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		struct video_data frame = frame_info->frame;
 
 		if (scale_video_output(input, &frame))
@@ -198,6 +229,194 @@ static void *video_thread(void *param)
 	return NULL;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Parallel input dispatch
+ *
+ * Each input gets its own thread and a cursor into the frame cache.  A cached
+ * frame is only released once every input has moved past it, and an input
+ * always holds on to the newest frame until a newer one arrives so that any
+ * duplicated frames added to it are still delivered.  An input that falls
+ * behind skips ahead to the newest frame and repeats it in place of the frames
+ * it skipped, so its frame count (and thus its timestamps) stays intact while
+ * the other inputs keep running at full speed.
+ *
+ * last_ready is the newest frame that has been unlocked; last_added may
+ * already point to a frame that is still being written. */
+
+static inline size_t next_cache_idx(const struct video_output *video,
+				    size_t idx)
+{
+	return (++idx == video->info.cache_size) ? 0 : idx;
+}
+
+static inline size_t cache_frames_ahead(const struct video_output *video,
+					size_t idx)
+{
+	size_t size = video->info.cache_size;
+	return (video->last_ready + size - idx) % size;
+}
+
+/* data_mutex must be held */
+static void release_read_frames(struct video_output *video)
+{
+	while (video->available_frames < video->info.cache_size &&
+	       video->cache[video->first_added].pending == 0) {
+		if (++video->first_added == video->info.cache_size)
+			video->first_added = 0;
+
+		if (++video->available_frames == video->info.cache_size)
+			video->last_added = video->first_added;
+	}
+}
+
+/* data_mutex must be held */
+static inline void video_input_leave_frame(struct video_output *video,
+					   struct video_input *input)
+{
+	struct cached_frame_info *frame_info = &video->cache[input->cursor];
+
+	if (--frame_info->pending == 0)
+		release_read_frames(video);
+	input->cursor = next_cache_idx(video, input->cursor);
+	input->emitted = 0;
+}
+
+/* data_mutex must be held */
+static void video_input_advance(struct video_output *video,
+				struct video_input *input)
+{
+	size_t max_lag = video->info.cache_size / 2;
+	bool behind;
+
+	video_input_leave_frame(video, input);
+
+	behind = video->available_frames == 0 ||
+		 cache_frames_ahead(video, input->cursor) >= max_lag;
+	if (!behind)
+		return;
+
+	while (input->cursor != video->last_ready) {
+		struct cached_frame_info *frame_info =
+			&video->cache[input->cursor];
+
+		if (!input->carry)
+			input->carry_ts = frame_info->frame.timestamp;
+		input->carry += frame_info->count;
+		os_atomic_add_long(&input->skipped_frames, frame_info->count);
+
+		video_input_leave_frame(video, input);
+	}
+}
+
+static bool video_input_cur_frame(struct video_output *video,
+				  struct video_input *input)
+{
+	struct cached_frame_info *frame_info;
+	struct video_data frame;
+
+	pthread_mutex_lock(&video->data_mutex);
+
+	if (!input->attached) {
+		pthread_mutex_unlock(&video->data_mutex);
+		return false;
+	}
+
+	frame_info = &video->cache[input->cursor];
+
+	if (!input->carry && input->emitted >= frame_info->count) {
+		if (input->cursor == video->last_ready) {
+			pthread_mutex_unlock(&video->data_mutex);
+			return false;
+		}
+
+		video_input_advance(video, input);
+		frame_info = &video->cache[input->cursor];
+	}
+
+	frame = frame_info->frame;
+
+	if (input->carry) {
+		frame.timestamp = input->carry_ts;
+		input->carry_ts += video->frame_time;
+		input->carry--;
+	} else {
+		frame.timestamp += video->frame_time * input->emitted++;
+	}
+
+	pthread_mutex_unlock(&video->data_mutex);
+
+	if (scale_video_output(input, &frame))
+		input->callback(input->param, &frame);
+
+	os_atomic_inc_long(&input->total_frames);
+	return true;
+}
+
+static void *video_input_thread(void *param)
+{
+	struct video_input *input = param;
+	struct video_output *video = input->video;
+
+	os_set_thread_name("video-io: video input thread");
+
+	const char *video_input_thread_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				   "video_input_thread(%s)", video->info.name);
+
+	while (os_sem_wait(input->sem) == 0) {
+		if (input->stop)
+			break;
+
+		profile_start(video_input_thread_name);
+		while (!input->stop && video_input_cur_frame(video, input))
+			;
+		profile_end(video_input_thread_name);
+
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static bool video_input_start_thread(struct video_input *input)
+{
+	if (os_sem_init(&input->sem, 0) != 0)
+		return false;
+	if (pthread_create(&input->thread, NULL, video_input_thread, input) !=
+	    0)
+		return false;
+
+	input->thread_active = true;
+	return true;
+}
+
+static void video_input_stop_thread(struct video_input *input)
+{
+	if (input->thread_active) {
+		input->stop = true;
+		os_sem_post(input->sem);
+		pthread_join(input->thread, NULL);
+		input->thread_active = false;
+	}
+}
+
+/* data_mutex must be held */
+static void video_input_detach(struct video_output *video,
+			       struct video_input *input)
+{
+	if (input->attached) {
+		for (;;) {
+			bool last = input->cursor == video->last_ready;
+			video_input_leave_frame(video, input);
+			if (last)
+				break;
+		}
+		input->attached = false;
+	}
+
+	video->parallel_inputs--;
+}
+
 /* ------------------------------------------------------------------------- */
 
 static inline bool valid_video_params(const struct video_output_info *info)
@@ -270,8 +489,10 @@ void video_output_close(video_t *video)
 
 	video_output_stop(video);
 
-	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		video_input_stop_thread(video->inputs.array[i]);
+		video_input_free(video->inputs.array[i]);
+	}
 	da_free(video->inputs);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
@@ -289,7 +510,7 @@ static size_t video_get_input_idx(const video_t *video,
 				  void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -324,6 +545,14 @@ static inline bool video_input_init(struct video_input *input,
 			return false;
 		}
 
+		input->scale_name = profile_store_name(
+			obs_get_profiler_name_store(),
+			"video_scaler_scale(%s: %ux%u %s -> %ux%u %s)",
+			video->info.name, from.width, from.height,
+			get_video_format_name(from.format),
+			input->conversion.width, input->conversion.height,
+			get_video_format_name(input->conversion.format));
+
 		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
 			video_frame_init(&input->frame[i],
 					 input->conversion.format,
@@ -352,26 +581,29 @@ bool video_output_connect(
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(*input));
 
-		input.callback = callback;
-		input.param = param;
+		input->callback = callback;
+		input->param = param;
+		input->video = video;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format = video->info.format;
-			input.conversion.width = video->info.width;
-			input.conversion.height = video->info.height;
+			input->conversion.format = video->info.format;
+			input->conversion.width = video->info.width;
+			input->conversion.height = video->info.height;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
+
+		success = video_input_init(input, video);
+		if (success && video->parallel)
+			success = video_input_start_thread(input);
 
-		success = video_input_init(&input, video);
 		if (success) {
 			if (video->inputs.num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
@@ -379,7 +611,17 @@ bool video_output_connect(
 				}
 				os_atomic_set_bool(&video->raw_active, true);
 			}
+
+			/* the frame lock/unlock paths walk the inputs with
+			 * only data_mutex held */
+			pthread_mutex_lock(&video->data_mutex);
 			da_push_back(video->inputs, &input);
+			if (video->parallel)
+				video->parallel_inputs++;
+			pthread_mutex_unlock(&video->data_mutex);
+		} else {
+			video_input_stop_thread(input);
+			video_input_free(input);
 		}
 	}
 
@@ -405,6 +647,19 @@ static void log_skipped(video_t *video)
 		     percentage_skipped);
 }
 
+static void log_input_skipped(video_t *video, struct video_input *input)
+{
+	long skipped = os_atomic_load_long(&input->skipped_frames);
+	long total = os_atomic_load_long(&input->total_frames);
+
+	if (skipped)
+		blog(LOG_INFO,
+		     "Video input (%s) stopped, number of frames repeated "
+		     "due to its own encoding lag: %ld/%ld (%0.1f%%)",
+		     video->info.name, skipped, total,
+		     (double)skipped / (double)total * 100.0);
+}
+
 void video_output_disconnect(video_t *video,
 			     void (*callback)(void *param,
 					      struct video_data *frame),
@@ -417,8 +672,21 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
+		struct video_input *input = video->inputs.array[idx];
+
+		if (video->parallel)
+			video_input_stop_thread(input);
+
+		pthread_mutex_lock(&video->data_mutex);
+		if (video->parallel)
+			video_input_detach(video, input);
 		da_erase(video->inputs, idx);
+		pthread_mutex_unlock(&video->data_mutex);
+
+		if (video->parallel)
+			log_input_skipped(video, input);
+
+		video_input_free(input);
 
 		if (video->inputs.num == 0) {
 			os_atomic_set_bool(&video->raw_active, false);
@@ -443,6 +711,16 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+/* data_mutex must be held */
+static void post_parallel_inputs(struct video_output *video)
+{
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input *input = video->inputs.array[i];
+		if (input->thread_active)
+			os_sem_post(input->sem);
+	}
+}
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 			     int count, uint64_t timestamp)
 {
@@ -459,6 +737,12 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		video->cache[video->last_added].skipped += count;
 		locked = false;
 
+		if (video->parallel) {
+			os_atomic_add_long(&video->skipped_frames, count);
+			os_atomic_add_long(&video->total_frames, count);
+			post_parallel_inputs(video);
+		}
+
 	} else {
 		if (video->available_frames != video->info.cache_size) {
 			if (++video->last_added == video->info.cache_size)
@@ -469,6 +753,7 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		cfi->frame.timestamp = timestamp;
 		cfi->count = count;
 		cfi->skipped = 0;
+		cfi->pending = -1;
 
 		memcpy(frame, &cfi->frame, sizeof(*frame));
 
@@ -488,7 +773,29 @@ void video_output_unlock_frame(video_t *video)
 	pthread_mutex_lock(&video->data_mutex);
 
 	video->available_frames--;
-	os_sem_post(video->update_semaphore);
+
+	if (video->parallel) {
+		struct cached_frame_info *cfi =
+			&video->cache[video->last_added];
+
+		cfi->pending = (long)video->parallel_inputs;
+		video->last_ready = video->last_added;
+		os_atomic_add_long(&video->total_frames, cfi->count);
+
+		for (size_t i = 0; i < video->inputs.num; i++) {
+			struct video_input *input = video->inputs.array[i];
+			if (input->thread_active && !input->attached) {
+				input->cursor = video->last_added;
+				input->emitted = 0;
+				input->attached = true;
+			}
+		}
+
+		post_parallel_inputs(video);
+		release_read_frames(video);
+	} else {
+		os_sem_post(video->update_semaphore);
+	}
 
 	pthread_mutex_unlock(&video->data_mutex);
 }
@@ -554,6 +861,82 @@ uint32_t video_output_get_total_frames(const video_t *video)
 	return (uint32_t)os_atomic_load_long(&video->total_frames);
 }
 
+bool video_output_set_parallel_inputs(video_t *video, bool parallel)
+{
+	bool success = false;
+
+	if (!video)
+		return false;
+
+	pthread_mutex_lock(&video->input_mutex);
+	pthread_mutex_lock(&video->data_mutex);
+
+	if (video->parallel == parallel) {
+		success = true;
+
+	} else if (video->inputs.num == 0 &&
+		   video->available_frames == video->info.cache_size) {
+		video->parallel = parallel;
+		success = true;
+	}
+
+	pthread_mutex_unlock(&video->data_mutex);
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return success;
+}
+
+bool video_output_parallel_inputs(const video_t *video)
+{
+	return video ? video->parallel : false;
+}
+
+static inline struct video_input *
+get_input(const video_t *video,
+	  void (*callback)(void *param, struct video_data *frame), void *param)
+{
+	size_t idx = video_get_input_idx(video, callback, param);
+	return idx != DARRAY_INVALID ? video->inputs.array[idx] : NULL;
+}
+
+uint32_t video_output_get_input_skipped_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param)
+{
+	struct video_input *input;
+	uint32_t skipped = 0;
+
+	if (!video)
+		return 0;
+
+	pthread_mutex_lock(&video->input_mutex);
+	input = get_input(video, callback, param);
+	if (input)
+		skipped = (uint32_t)os_atomic_load_long(&input->skipped_frames);
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return skipped;
+}
+
+uint32_t video_output_get_input_total_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param)
+{
+	struct video_input *input;
+	uint32_t total = 0;
+
+	if (!video)
+		return 0;
+
+	pthread_mutex_lock(&video->input_mutex);
+	input = get_input(video, callback, param);
+	if (input)
+		total = (uint32_t)os_atomic_load_long(&input->total_frames);
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return total;
+}
+
 /* Note: These four functions below are a very slight bit of a hack.  If the
  * texture encoder thread is active while the raw encoder thread is active, the
  * total frame count will just be doubled while they're both active.  Which is
@@ -261,6 +261,26 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+/**
+ * Runs each connected input (scaler and callback) on its own thread instead
+ * of serially on the video thread, so a slow encoder only repeats its own
+ * frames rather than delaying every other encoder.  Can only be changed while
+ * no inputs are connected.
+ *
+ * @return  true if the mode was set, false if inputs are still connected
+ */
+EXPORT bool video_output_set_parallel_inputs(video_t *video, bool parallel);
+EXPORT bool video_output_parallel_inputs(const video_t *video);
+
+/** Frames repeated for a single input because it fell behind (parallel
+ * mode only) */
+EXPORT uint32_t video_output_get_input_skipped_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param);
+EXPORT uint32_t video_output_get_input_total_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
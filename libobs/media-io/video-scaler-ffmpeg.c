@@ -16,17 +16,66 @@
 ******************************************************************************/
 
 #include "../util/bmem.h"
+#include "../util/task-pool.h"
 #include "video-scaler.h"
+#include "video-convert.h"
 
 #include <libavutil/imgutils.h>
 #include <libswscale/swscale.h>
 
-struct video_scaler {
+/*
+ * Frames are split into horizontal slices that are scaled in parallel on
+ * the media-io worker pool, each by its own swscale context.  A slice only
+ * starts on an input row that maps to a whole output row, so every context
+ * uses the same scale factor and filter phase as one for the whole frame
+ * would.  Contexts scale SLICE_MARGIN input rows (scaled up for large
+ * downscales) past the edges of their slice so that the filters see the
+ * same neighbors, and only the rows of the slice itself are copied out.
+ */
+
+#define MAX_SLICES 8
+#define MIN_SLICE_ROWS 64
+#define SLICE_MARGIN 8
+
+struct scaler_slice {
+	struct video_scaler *scaler;
 	struct SwsContext *swscale;
+
+	/* rows of the input and output the context scales */
+	int src_y;
 	int src_height;
-	int dst_heights[4];
+	int dst_y;
+	int dst_height;
+
+	/* rows of the output that belong to this slice */
+	int out_y;
+	int out_height;
+
 	uint8_t *dst_pointers[4];
 	int dst_linesizes[4];
+	bool success;
+};
+
+struct video_scaler {
+	bool convert;
+	enum video_format dst_format;
+	enum video_format src_format;
+	uint32_t width;
+	int src_height;
+
+	bool has_plane[4];
+	int src_shifts[4];
+	int dst_shifts[4];
+
+	os_task_pool_t *pool;
+	struct scaler_slice slices[MAX_SLICES];
+	size_t num_slices;
+
+	/* frame being scaled */
+	uint8_t **output;
+	const uint32_t *out_linesize;
+	const uint8_t *const *input;
+	const uint32_t *in_linesize;
 };
 
 static inline enum AVPixelFormat
@@ -112,6 +161,111 @@ static inline int get_ffmpeg_range_type(enum video_range_type type)
 
 #define FIXED_1_0 (1 << 16)
 
+static inline bool is_full_range(enum video_range_type range)
+{
+	return range == VIDEO_RANGE_FULL;
+}
+
+/* frames of the same size that only change the layout are converted with
+ * video-convert instead of swscale, straight into the output */
+static bool can_convert(const struct video_scale_info *dst,
+			const struct video_scale_info *src)
+{
+	if (dst->width != src->width || dst->height != src->height)
+		return false;
+	if (is_full_range(dst->range) != is_full_range(src->range))
+		return false;
+	if ((src->width & 1) != 0 || (src->height & 1) != 0)
+		return false;
+
+	return video_convert_supported(dst->format, src->format);
+}
+
+static inline int get_gcd(int a, int b)
+{
+	while (b) {
+		const int r = a % b;
+		a = b;
+		b = r;
+	}
+
+	return a;
+}
+
+/* vertical chroma subsampling of each plane */
+static inline void get_plane_shifts(const AVPixFmtDescriptor *desc,
+				    int shifts[4])
+{
+	for (size_t i = 0; i < 4; i++)
+		shifts[i] = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+}
+
+static size_t get_num_slices(os_task_pool_t *pool, int dst_units,
+			     int dst_height)
+{
+	size_t num = pool ? os_task_pool_num_threads(pool) + 1 : 1;
+
+	if (num > MAX_SLICES)
+		num = MAX_SLICES;
+	if (num > (size_t)dst_units)
+		num = (size_t)dst_units;
+	if (num > (size_t)(dst_height / MIN_SLICE_ROWS))
+		num = (size_t)(dst_height / MIN_SLICE_ROWS);
+
+	return num ? num : 1;
+}
+
+static void init_slices(struct video_scaler *scaler,
+			const struct video_scale_info *dst,
+			const struct video_scale_info *src, bool subsampled)
+{
+	const int src_height = (int)src->height;
+	const int dst_height = (int)dst->height;
+	const int gcd = get_gcd(src_height, dst_height);
+	int src_unit = src_height / gcd;
+	int dst_unit = dst_height / gcd;
+
+	/* slices have to start on a chroma row of both frames */
+	if (subsampled && ((src_unit & 1) != 0 || (dst_unit & 1) != 0)) {
+		src_unit *= 2;
+		dst_unit *= 2;
+	}
+
+	const int units = dst_height / dst_unit;
+	const int ratio = (src_height + dst_height - 1) / dst_height;
+	const int margin_rows = SLICE_MARGIN * (ratio > 1 ? ratio : 1);
+	const int margin = (margin_rows + src_unit - 1) / src_unit;
+	const size_t num = get_num_slices(scaler->pool, units, dst_height);
+
+	scaler->num_slices = num;
+
+	for (size_t i = 0; i < num; i++) {
+		struct scaler_slice *slice = &scaler->slices[i];
+		const int start = (int)((size_t)units * i / num);
+		const int end = (int)((size_t)units * (i + 1) / num);
+		const int ctx_start = start > margin ? start - margin : 0;
+		const int ctx_end = end + margin;
+
+		slice->scaler = scaler;
+		slice->out_y = start * dst_unit;
+		slice->out_height = (i == num - 1 ? dst_height
+						  : end * dst_unit) -
+				    slice->out_y;
+		slice->src_y = ctx_start * src_unit;
+		slice->dst_y = ctx_start * dst_unit;
+
+		/* the rows past the last whole unit scale by the same factor,
+		 * they just can't be split */
+		if (ctx_end >= units) {
+			slice->src_height = src_height - slice->src_y;
+			slice->dst_height = dst_height - slice->dst_y;
+		} else {
+			slice->src_height = ctx_end * src_unit - slice->src_y;
+			slice->dst_height = ctx_end * dst_unit - slice->dst_y;
+		}
+	}
+}
+
 int video_scaler_create(video_scaler_t **scaler_out,
 			const struct video_scale_info *dst,
 			const struct video_scale_info *src,
@@ -130,51 +284,72 @@ int video_scaler_create(video_scaler_t **scaler_out,
 	if (!scaler_out)
 		return VIDEO_SCALER_FAILED;
 
+	if (can_convert(dst, src)) {
+		scaler = bzalloc(sizeof(struct video_scaler));
+		scaler->convert = true;
+		scaler->dst_format = dst->format;
+		scaler->src_format = src->format;
+		scaler->width = src->width;
+		scaler->src_height = src->height;
+
+		*scaler_out = scaler;
+		return VIDEO_SCALER_SUCCESS;
+	}
+
 	if (format_src == AV_PIX_FMT_NONE || format_dst == AV_PIX_FMT_NONE)
 		return VIDEO_SCALER_BAD_CONVERSION;
 
 	scaler = bzalloc(sizeof(struct video_scaler));
 	scaler->src_height = src->height;
+	scaler->pool = video_convert_get_pool();
 
 	const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format_dst);
-	bool has_plane[4] = {0};
+	const AVPixFmtDescriptor *src_desc = av_pix_fmt_desc_get(format_src);
 	for (size_t i = 0; i < 4; i++)
-		has_plane[desc->comp[i].plane] = 1;
-
-	scaler->dst_heights[0] = dst->height;
-	for (size_t i = 1; i < 4; ++i) {
-		if (has_plane[i]) {
-			const int s = (i == 1 || i == 2) ? desc->log2_chroma_h
-							 : 0;
-			scaler->dst_heights[i] = dst->height >> s;
+		scaler->has_plane[desc->comp[i].plane] = true;
+
+	get_plane_shifts(desc, scaler->dst_shifts);
+	get_plane_shifts(src_desc, scaler->src_shifts);
+
+	init_slices(scaler, dst, src,
+		    desc->log2_chroma_h > 0 || src_desc->log2_chroma_h > 0);
+
+	for (size_t i = 0; i < scaler->num_slices; i++) {
+		struct scaler_slice *slice = &scaler->slices[i];
+
+		ret = av_image_alloc(slice->dst_pointers, slice->dst_linesizes,
+				     dst->width, slice->dst_height,
+				     format_dst, 32);
+		if (ret < 0) {
+			blog(LOG_WARNING,
+			     "video_scaler_create: av_image_alloc failed: %d",
+			     ret);
+			goto fail;
 		}
-	}
 
-	ret = av_image_alloc(scaler->dst_pointers, scaler->dst_linesizes,
-			     dst->width, dst->height, format_dst, 32);
-	if (ret < 0) {
-		blog(LOG_WARNING,
-		     "video_scaler_create: av_image_alloc failed: %d", ret);
-		goto fail;
-	}
+		slice->swscale = sws_getCachedContext(
+			NULL, src->width, slice->src_height, format_src,
+			dst->width, slice->dst_height, format_dst, scale_type,
+			NULL, NULL, NULL);
+		if (!slice->swscale) {
+			blog(LOG_ERROR, "video_scaler_create: Could not create "
+					"swscale");
+			goto fail;
+		}
 
-	scaler->swscale = sws_getCachedContext(NULL, src->width, src->height,
-					       format_src, dst->width,
-					       dst->height, format_dst,
-					       scale_type, NULL, NULL, NULL);
-	if (!scaler->swscale) {
-		blog(LOG_ERROR, "video_scaler_create: Could not create "
-				"swscale");
-		goto fail;
+		ret = sws_setColorspaceDetails(slice->swscale, coeff_src,
+					       range_src, coeff_dst, range_dst,
+					       0, FIXED_1_0, FIXED_1_0);
+		if (ret < 0) {
+			blog(LOG_DEBUG, "video_scaler_create: "
+					"sws_setColorspaceDetails failed, "
+					"ignoring");
+		}
 	}
 
-	ret = sws_setColorspaceDetails(scaler->swscale, coeff_src, range_src,
-				       coeff_dst, range_dst, 0, FIXED_1_0,
-				       FIXED_1_0);
-	if (ret < 0) {
-		blog(LOG_DEBUG, "video_scaler_create: "
-				"sws_setColorspaceDetails failed, ignoring");
-	}
+	blog(LOG_DEBUG, "video_scaler_create: %ux%u -> %ux%u in %d slice(s)",
+	     src->width, src->height, dst->width, dst->height,
+	     (int)scaler->num_slices);
 
 	*scaler_out = scaler;
 	return VIDEO_SCALER_SUCCESS;
@@ -187,55 +362,111 @@ fail:
 void video_scaler_destroy(video_scaler_t *scaler)
 {
 	if (scaler) {
-		sws_freeContext(scaler->swscale);
+		for (size_t i = 0; i < scaler->num_slices; i++) {
+			struct scaler_slice *slice = &scaler->slices[i];
 
-		if (scaler->dst_pointers[0])
-			av_freep(scaler->dst_pointers);
+			sws_freeContext(slice->swscale);
+
+			if (slice->dst_pointers[0])
+				av_freep(slice->dst_pointers);
+		}
 
 		bfree(scaler);
 	}
 }
 
+static void copy_slice(const struct scaler_slice *slice, size_t plane)
+{
+	const struct video_scaler *scaler = slice->scaler;
+	const int shift = scaler->dst_shifts[plane];
+
+	/* subsampled planes of odd sized frames are rounded down, like the
+	 * planes of a video_frame */
+	const int out_y = slice->out_y >> shift;
+	const int out_end = (slice->out_y + slice->out_height) >> shift;
+	const int first_row = out_y - (slice->dst_y >> shift);
+
+	const size_t scaled_linesize = slice->dst_linesizes[plane];
+	const size_t plane_linesize = scaler->out_linesize[plane];
+	const size_t height = (size_t)(out_end - out_y);
+	uint8_t *dst = scaler->output[plane] + plane_linesize * out_y;
+	const uint8_t *src = slice->dst_pointers[plane] +
+			     scaled_linesize * first_row;
+
+	if (scaled_linesize == plane_linesize) {
+		memcpy(dst, src, scaled_linesize * height);
+	} else {
+		size_t linesize = scaled_linesize;
+		if (linesize > plane_linesize)
+			linesize = plane_linesize;
+
+		for (size_t y = 0; y < height; y++) {
+			memcpy(dst, src, linesize);
+			dst += plane_linesize;
+			src += scaled_linesize;
+		}
+	}
+}
+
+static void scale_slice(void *param)
+{
+	struct scaler_slice *slice = param;
+	const struct video_scaler *scaler = slice->scaler;
+	const uint8_t *input[4] = {NULL};
+
+	for (size_t plane = 0; plane < 4; plane++) {
+		if (!scaler->input[plane])
+			continue;
+
+		const int y = slice->src_y >> scaler->src_shifts[plane];
+		input[plane] = scaler->input[plane] +
+			       (size_t)scaler->in_linesize[plane] * y;
+	}
+
+	int ret = sws_scale(slice->swscale, input,
+			    (const int *)scaler->in_linesize, 0,
+			    slice->src_height, slice->dst_pointers,
+			    slice->dst_linesizes);
+	if (ret <= 0) {
+		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d",
+		     ret);
+		slice->success = false;
+		return;
+	}
+
+	for (size_t plane = 0; plane < 4; ++plane) {
+		if (scaler->has_plane[plane])
+			copy_slice(slice, plane);
+	}
+
+	slice->success = true;
+}
+
 bool video_scaler_scale(video_scaler_t *scaler, uint8_t *output[],
 			const uint32_t out_linesize[],
 			const uint8_t *const input[],
 			const uint32_t in_linesize[])
 {
+	bool success = true;
+
 	if (!scaler)
 		return false;
 
-	int ret = sws_scale(scaler->swscale, input, (const int *)in_linesize, 0,
-			    scaler->src_height, scaler->dst_pointers,
-			    scaler->dst_linesizes);
-	if (ret <= 0) {
-		blog(LOG_ERROR, "video_scaler_scale: sws_scale failed: %d",
-		     ret);
-		return false;
-	}
+	if (scaler->convert)
+		return video_convert(output, out_linesize, scaler->dst_format,
+				     input, in_linesize, scaler->src_format,
+				     scaler->width, scaler->src_height);
 
-	for (size_t plane = 0; plane < 4; ++plane) {
-		if (!scaler->dst_pointers[plane])
-			continue;
+	scaler->output = output;
+	scaler->out_linesize = out_linesize;
+	scaler->input = input;
+	scaler->in_linesize = in_linesize;
 
-		const size_t scaled_linesize = scaler->dst_linesizes[plane];
-		const size_t plane_linesize = out_linesize[plane];
-		uint8_t *dst = output[plane];
-		const uint8_t *src = scaler->dst_pointers[plane];
-		const size_t height = scaler->dst_heights[plane];
-		if (scaled_linesize == plane_linesize) {
-			memcpy(dst, src, scaled_linesize * height);
-		} else {
-			size_t linesize = scaled_linesize;
-			if (linesize > plane_linesize)
-				linesize = plane_linesize;
-
-			for (size_t y = 0; y < height; y++) {
-				memcpy(dst, src, linesize);
-				dst += plane_linesize;
-				src += scaled_linesize;
-			}
-		}
-	}
+	os_task_pool_run(scaler->pool, scale_slice, scaler->slices,
+			 sizeof(struct scaler_slice), scaler->num_slices);
+
+	for (size_t i = 0; i < scaler->num_slices; i++)
+		success = success && scaler->slices[i].success;
 
-	return true;
+	return success;
 }
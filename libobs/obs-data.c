@@ -20,13 +20,17 @@
 #include "util/dstr.h"
 #include "util/darray.h"
 #include "util/platform.h"
+#include "util/hash-table.h"
+#include "util/array-serializer.h"
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
 #include "graphics/vec4.h"
 #include "graphics/quat.h"
 #include "obs-data.h"
 
-#include <jansson.h>
+#include <math.h>
+#include <errno.h>
+#include <locale.h>
 
 struct obs_data_item {
 	volatile long ref;
@@ -40,12 +44,20 @@ struct obs_data_item {
 	size_t default_size;
 	size_t autoselect_size;
 	size_t capacity;
+	struct hash_node index_node;
 };
 
+/* objects with more items than this get a name index */
+#define OBS_DATA_INDEX_THRESHOLD 16
+
 struct obs_data {
 	volatile long ref;
 	char *json;
 	struct obs_data_item *first_item;
+	struct obs_data_item *last_item;
+	size_t num_items;
+	bool indexed;
+	struct hash_table index;
 };
 
 struct obs_data_array {
@@ -322,25 +334,64 @@ static struct obs_data_item **get_item_prev_next(struct obs_data *data,
 	return NULL;
 }
 
+static inline struct obs_data_item *
+get_prev_item(struct obs_data *data, struct obs_data_item **prev_next)
+{
+	if (prev_next == &data->first_item)
+		return NULL;
+
+	return (struct obs_data_item *)((uint8_t *)prev_next -
+					offsetof(struct obs_data_item, next));
+}
+
+static void obs_data_index_item(struct obs_data *data,
+				struct obs_data_item *item)
+{
+	if (data->indexed) {
+		hash_table_insert(&data->index, &item->index_node,
+				  hash_str(get_item_name(item)));
+
+	} else if (data->num_items > OBS_DATA_INDEX_THRESHOLD) {
+		data->indexed = true;
+
+		for (item = data->first_item; item; item = item->next)
+			hash_table_insert(&data->index, &item->index_node,
+					  hash_str(get_item_name(item)));
+	}
+}
+
 static inline void obs_data_item_detach(struct obs_data_item *item)
 {
-	struct obs_data_item **prev_next =
-		get_item_prev_next(item->parent, item);
+	struct obs_data *data = item->parent;
+	struct obs_data_item **prev_next = get_item_prev_next(data, item);
 
 	if (prev_next) {
+		if (data->last_item == item)
+			data->last_item = get_prev_item(data, prev_next);
+		if (data->indexed)
+			hash_table_remove(&data->index, &item->index_node);
+
 		*prev_next = item->next;
 		item->next = NULL;
+		data->num_items--;
 	}
 }
 
 static inline void obs_data_item_reattach(struct obs_data_item *old_ptr,
 					  struct obs_data_item *new_ptr)
 {
-	struct obs_data_item **prev_next =
-		get_item_prev_next(new_ptr->parent, old_ptr);
+	struct obs_data *data = new_ptr->parent;
+	struct obs_data_item **prev_next = get_item_prev_next(data, old_ptr);
 
-	if (prev_next)
+	if (prev_next) {
 		*prev_next = new_ptr;
+
+		if (data->last_item == old_ptr)
+			data->last_item = new_ptr;
+		if (data->indexed)
+			hash_table_replace(&data->index, &old_ptr->index_node,
+					   &new_ptr->index_node);
+	}
 }
 
 static struct obs_data_item *
@@ -470,155 +521,20 @@ obs_data_item_set_autoselect_data(struct obs_data_item **p_item,
 
 /* ------------------------------------------------------------------------- */
 
-static void obs_data_add_json_item(obs_data_t *data, const char *key,
-				   json_t *json);
-
-static inline void obs_data_add_json_object_data(obs_data_t *data, json_t *jobj)
-{
-	const char *item_key;
-	json_t *jitem;
-
-	json_object_foreach (jobj, item_key, jitem) {
-		obs_data_add_json_item(data, item_key, jitem);
-	}
-}
-
-static inline void obs_data_add_json_object(obs_data_t *data, const char *key,
-					    json_t *jobj)
-{
-	obs_data_t *sub_obj = obs_data_create();
-
-	obs_data_add_json_object_data(sub_obj, jobj);
-	obs_data_set_obj(data, key, sub_obj);
-	obs_data_release(sub_obj);
-}
-
-static void obs_data_add_json_array(obs_data_t *data, const char *key,
-				    json_t *jarray)
-{
-	obs_data_array_t *array = obs_data_array_create();
-	size_t idx;
-	json_t *jitem;
-
-	json_array_foreach (jarray, idx, jitem) {
-		obs_data_t *item;
-
-		if (!json_is_object(jitem))
-			continue;
-
-		item = obs_data_create();
-		obs_data_add_json_object_data(item, jitem);
-		obs_data_array_push_back(array, item);
-		obs_data_release(item);
-	}
-
-	obs_data_set_array(data, key, array);
-	obs_data_array_release(array);
-}
-
-static void obs_data_add_json_item(obs_data_t *data, const char *key,
-				   json_t *json)
-{
-	if (json_is_object(json))
-		obs_data_add_json_object(data, key, json);
-	else if (json_is_array(json))
-		obs_data_add_json_array(data, key, json);
-	else if (json_is_string(json))
-		obs_data_set_string(data, key, json_string_value(json));
-	else if (json_is_integer(json))
-		obs_data_set_int(data, key, json_integer_value(json));
-	else if (json_is_real(json))
-		obs_data_set_double(data, key, json_real_value(json));
-	else if (json_is_true(json))
-		obs_data_set_bool(data, key, true);
-	else if (json_is_false(json))
-		obs_data_set_bool(data, key, false);
-}
-
-/* ------------------------------------------------------------------------- */
-
-static inline void set_json_string(json_t *json, const char *name,
-				   obs_data_item_t *item)
-{
-	const char *val = obs_data_item_get_string(item);
-	json_object_set_new(json, name, json_string(val));
-}
-
-static inline void set_json_number(json_t *json, const char *name,
-				   obs_data_item_t *item)
-{
-	enum obs_data_number_type type = obs_data_item_numtype(item);
-
-	if (type == OBS_DATA_NUM_INT) {
-		long long val = obs_data_item_get_int(item);
-		json_object_set_new(json, name, json_integer(val));
-	} else {
-		double val = obs_data_item_get_double(item);
-		json_object_set_new(json, name, json_real(val));
-	}
-}
+#define JSON_MAX_DEPTH 2048
 
-static inline void set_json_bool(json_t *json, const char *name,
-				 obs_data_item_t *item)
-{
-	bool val = obs_data_item_get_bool(item);
-	json_object_set_new(json, name, val ? json_true() : json_false());
-}
-
-static json_t *obs_data_to_json(obs_data_t *data);
-
-static inline void set_json_obj(json_t *json, const char *name,
-				obs_data_item_t *item)
-{
-	obs_data_t *obj = obs_data_item_get_obj(item);
-	json_object_set_new(json, name, obs_data_to_json(obj));
-	obs_data_release(obj);
-}
-
-static inline void set_json_array(json_t *json, const char *name,
-				  obs_data_item_t *item)
-{
-	json_t *jarray = json_array();
-	obs_data_array_t *array = obs_data_item_get_array(item);
-	size_t count = obs_data_array_count(array);
-
-	for (size_t idx = 0; idx < count; idx++) {
-		obs_data_t *sub_item = obs_data_array_item(array, idx);
-		json_t *jitem = obs_data_to_json(sub_item);
-		json_array_append_new(jarray, jitem);
-		obs_data_release(sub_item);
-	}
-
-	json_object_set_new(json, name, jarray);
-	obs_data_array_release(array);
-}
-
-static json_t *obs_data_to_json(obs_data_t *data)
-{
-	json_t *json = json_object();
-	obs_data_item_t *item = NULL;
-
-	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
-		enum obs_data_type type = obs_data_item_gettype(item);
-		const char *name = get_item_name(item);
-
-		if (!obs_data_item_has_user_value(item))
-			continue;
-
-		if (type == OBS_DATA_STRING)
-			set_json_string(json, name, item);
-		else if (type == OBS_DATA_NUMBER)
-			set_json_number(json, name, item);
-		else if (type == OBS_DATA_BOOLEAN)
-			set_json_bool(json, name, item);
-		else if (type == OBS_DATA_OBJECT)
-			set_json_obj(json, name, item);
-		else if (type == OBS_DATA_ARRAY)
-			set_json_array(json, name, item);
-	}
+struct json_reader {
+	const char *pos;
+	int line;
+	int depth;
+	struct dstr str;
+	char error[160];
+	bool failed;
+};
 
-	return json;
-}
+static bool json_read_root(struct json_reader *r, obs_data_t *data,
+			   const char *json);
+static void json_write_root(obs_data_t *data, struct array_output_data *output);
 
 /* ------------------------------------------------------------------------- */
 
@@ -632,19 +548,22 @@ obs_data_t *obs_data_create()
 
 obs_data_t *obs_data_create_from_json(const char *json_string)
 {
-	obs_data_t *data = obs_data_create();
+	struct json_reader reader = {0};
+	obs_data_t *data;
 
-	json_error_t error;
-	json_t *root = json_loads(json_string, JSON_REJECT_DUPLICATES, &error);
+	if (!json_string) {
+		blog(LOG_ERROR, "obs-data.c: [obs_data_create_from_json] "
+				"NULL json string");
+		return NULL;
+	}
 
-	if (root) {
-		obs_data_add_json_object_data(data, root);
-		json_decref(root);
-	} else {
+	data = obs_data_create();
+
+	if (!json_read_root(&reader, data, json_string)) {
 		blog(LOG_ERROR,
 		     "obs-data.c: [obs_data_create_from_json] "
 		     "Failed reading json string (%d): %s",
-		     error.line, error.text);
+		     reader.line, reader.error);
 		obs_data_release(data);
 		data = NULL;
 	}
@@ -712,8 +631,8 @@ static inline void obs_data_destroy(struct obs_data *data)
 		item = next;
 	}
 
-	/* NOTE: don't use bfree for json text, allocated by json */
-	free(data->json);
+	hash_table_free(&data->index);
+	bfree(data->json);
 	bfree(data);
 }
 
@@ -728,43 +647,54 @@ void obs_data_release(obs_data_t *data)
 
 const char *obs_data_get_json(obs_data_t *data)
 {
+	const uint8_t terminator = 0;
+	struct array_output_data output;
+
 	if (!data)
 		return NULL;
 
-	/* NOTE: don't use libobs bfree for json text */
-	free(data->json);
-	data->json = NULL;
+	bfree(data->json);
 
-	json_t *root = obs_data_to_json(data);
-	data->json = json_dumps(root, JSON_PRESERVE_ORDER | JSON_INDENT(4));
-	json_decref(root);
+	json_write_root(data, &output);
+	da_push_back(output.bytes, &terminator);
+	data->json = (char *)output.bytes.array;
 
 	return data->json;
 }
 
 bool obs_data_save_json(obs_data_t *data, const char *file)
 {
-	const char *json = obs_data_get_json(data);
+	struct array_output_data output;
+	bool success;
 
-	if (json && *json) {
-		return os_quick_write_utf8_file(file, json, strlen(json),
-						false);
-	}
+	if (!data)
+		return false;
 
-	return false;
+	json_write_root(data, &output);
+	success = os_quick_write_utf8_file(file, (char *)output.bytes.array,
+					   output.bytes.num, false);
+	array_output_serializer_free(&output);
+
+	return success;
 }
 
 bool obs_data_save_json_safe(obs_data_t *data, const char *file,
 			     const char *temp_ext, const char *backup_ext)
 {
-	const char *json = obs_data_get_json(data);
+	struct array_output_data output;
+	bool success;
 
-	if (json && *json) {
-		return os_quick_write_utf8_file_safe(
-			file, json, strlen(json), false, temp_ext, backup_ext);
-	}
+	if (!data)
+		return false;
 
-	return false;
+	json_write_root(data, &output);
+	success = os_quick_write_utf8_file_safe(file,
+						(char *)output.bytes.array,
+						output.bytes.num, false,
+						temp_ext, backup_ext);
+	array_output_serializer_free(&output);
+
+	return success;
 }
 
 static struct obs_data_item *get_item(struct obs_data *data, const char *name)
@@ -772,6 +702,23 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 	if (!data)
 		return NULL;
 
+	if (data->indexed) {
+		struct hash_node *node =
+			hash_table_first(&data->index, hash_str(name));
+
+		while (node) {
+			struct obs_data_item *item = hash_entry(
+				node, struct obs_data_item, index_node);
+
+			if (strcmp(get_item_name(item), name) == 0)
+				return item;
+
+			node = hash_table_next(node);
+		}
+
+		return NULL;
+	}
+
 	struct obs_data_item *item = data->first_item;
 
 	while (item) {
@@ -784,6 +731,36 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 	return NULL;
 }
 
+static void insert_item_sorted(struct obs_data *data,
+			       struct obs_data_item *new_item, const char *name)
+{
+	obs_data_item_t *prev = obs_data_first(data);
+	obs_data_item_t *next = obs_data_first(data);
+	obs_data_item_next(&next);
+	for (; prev && next;
+	     obs_data_item_next(&prev), obs_data_item_next(&next)) {
+		if (strcmp(get_item_name(next), name) > 0)
+			break;
+	}
+
+	if (prev && strcmp(get_item_name(prev), name) < 0) {
+		prev->next = new_item;
+		new_item->next = next;
+
+	} else {
+		data->first_item = new_item;
+		new_item->next = prev;
+	}
+
+	if (!prev)
+		data->first_item = new_item;
+	if (!new_item->next)
+		data->last_item = new_item;
+
+	obs_data_item_release(&prev);
+	obs_data_item_release(&next);
+}
+
 static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 			  const char *name, const void *ptr, size_t size,
 			  enum obs_data_type type, bool default_data,
@@ -794,31 +771,20 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 	if ((!item || (item && !*item)) && data) {
 		new_item = obs_data_item_create(name, ptr, size, type,
 						default_data, autoselect_data);
-
-		obs_data_item_t *prev = obs_data_first(data);
-		obs_data_item_t *next = obs_data_first(data);
-		obs_data_item_next(&next);
-		for (; prev && next;
-		     obs_data_item_next(&prev), obs_data_item_next(&next)) {
-			if (strcmp(get_item_name(next), name) > 0)
-				break;
-		}
-
 		new_item->parent = data;
-		if (prev && strcmp(get_item_name(prev), name) < 0) {
-			prev->next = new_item;
-			new_item->next = next;
 
+		/* items are kept sorted and saved that way, so loading
+		 * usually just appends */
+		if (data->last_item &&
+		    strcmp(get_item_name(data->last_item), name) < 0) {
+			data->last_item->next = new_item;
+			data->last_item = new_item;
 		} else {
-			data->first_item = new_item;
-			new_item->next = prev;
+			insert_item_sorted(data, new_item, name);
 		}
 
-		if (!prev)
-			data->first_item = new_item;
-
-		obs_data_item_release(&prev);
-		obs_data_item_release(&next);
+		data->num_items++;
+		obs_data_index_item(data, new_item);
 
 	} else if (default_data) {
 		obs_data_item_set_default_data(item, ptr, size, type);
@@ -1076,6 +1042,783 @@ static inline void obs_take_obj(obs_data_t *data, obs_data_item_t **item,
 	obs_data_release(obj);
 }
 
+/* ------------------------------------------------------------------------- */
+/* JSON reader
+ *
+ * Builds the data directly while parsing instead of going through a jansson
+ * tree first.  Accepts the same documents json_loads did with
+ * JSON_REJECT_DUPLICATES: the root must be an object (an array root yields no
+ * items), arrays only keep their objects and null values are skipped. */
+
+static void json_error(struct json_reader *r, const char *format, ...)
+{
+	va_list args;
+
+	if (r->failed)
+		return;
+
+	va_start(args, format);
+	vsnprintf(r->error, sizeof(r->error), format, args);
+	va_end(args);
+
+	r->failed = true;
+}
+
+static inline void json_skip_whitespace(struct json_reader *r)
+{
+	for (;;) {
+		char c = *r->pos;
+
+		if (c == '\n')
+			r->line++;
+		else if (c != ' ' && c != '\t' && c != '\r')
+			return;
+
+		r->pos++;
+	}
+}
+
+/* returns the size of the UTF-8 sequence at str, or 0 if it's invalid */
+static size_t utf8_seq_size(const uint8_t *str)
+{
+	uint32_t val;
+	size_t size;
+
+	if (str[0] < 0x80) {
+		return 1;
+	} else if (str[0] >= 0xC2 && str[0] <= 0xDF) {
+		size = 2;
+		val = str[0] & 0x1F;
+	} else if (str[0] >= 0xE0 && str[0] <= 0xEF) {
+		size = 3;
+		val = str[0] & 0x0F;
+	} else if (str[0] >= 0xF0 && str[0] <= 0xF4) {
+		size = 4;
+		val = str[0] & 0x07;
+	} else {
+		return 0;
+	}
+
+	for (size_t i = 1; i < size; i++) {
+		if ((str[i] & 0xC0) != 0x80)
+			return 0;
+		val = (val << 6) | (str[i] & 0x3F);
+	}
+
+	/* overlong, surrogates or out of range */
+	if ((size == 3 && val < 0x800) || (size == 4 && val < 0x10000) ||
+	    (val >= 0xD800 && val <= 0xDFFF) || val > 0x10FFFF)
+		return 0;
+
+	return size;
+}
+
+static bool utf8_valid(const char *str)
+{
+	while (*str) {
+		size_t size = utf8_seq_size((const uint8_t *)str);
+		if (!size)
+			return false;
+		str += size;
+	}
+
+	return true;
+}
+
+static void utf8_cat_codepoint(struct dstr *str, uint32_t val)
+{
+	char seq[4];
+	size_t size;
+
+	if (val < 0x80) {
+		seq[0] = (char)val;
+		size = 1;
+	} else if (val < 0x800) {
+		seq[0] = (char)(0xC0 | (val >> 6));
+		seq[1] = (char)(0x80 | (val & 0x3F));
+		size = 2;
+	} else if (val < 0x10000) {
+		seq[0] = (char)(0xE0 | (val >> 12));
+		seq[1] = (char)(0x80 | ((val >> 6) & 0x3F));
+		seq[2] = (char)(0x80 | (val & 0x3F));
+		size = 3;
+	} else {
+		seq[0] = (char)(0xF0 | (val >> 18));
+		seq[1] = (char)(0x80 | ((val >> 12) & 0x3F));
+		seq[2] = (char)(0x80 | ((val >> 6) & 0x3F));
+		seq[3] = (char)(0x80 | (val & 0x3F));
+		size = 4;
+	}
+
+	dstr_ncat(str, seq, size);
+}
+
+static int32_t json_read_hex4(const char *str)
+{
+	int32_t val = 0;
+
+	for (int i = 0; i < 4; i++) {
+		char c = str[i];
+
+		val <<= 4;
+		if (c >= '0' && c <= '9')
+			val |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			val |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			val |= c - 'A' + 10;
+		else
+			return -1;
+	}
+
+	return val;
+}
+
+/* r->pos is at the 'u' of a \u escape */
+static bool json_read_unicode(struct json_reader *r, struct dstr *out)
+{
+	int32_t val = json_read_hex4(r->pos + 1);
+
+	if (val < 0) {
+		json_error(r, "invalid escape");
+		return false;
+	}
+
+	r->pos += 5;
+
+	if (val >= 0xD800 && val <= 0xDBFF) {
+		int32_t low = -1;
+
+		if (r->pos[0] == '\\' && r->pos[1] == 'u')
+			low = json_read_hex4(r->pos + 2);
+
+		if (low < 0xDC00 || low > 0xDFFF) {
+			json_error(r, "invalid Unicode '\\u%04X'", val);
+			return false;
+		}
+
+		val = ((val - 0xD800) << 10) + (low - 0xDC00) + 0x10000;
+		r->pos += 6;
+
+	} else if (val >= 0xDC00 && val <= 0xDFFF) {
+		json_error(r, "invalid Unicode '\\u%04X'", val);
+		return false;
+
+	} else if (val == 0) {
+		json_error(r, "\\u0000 is not allowed");
+		return false;
+	}
+
+	utf8_cat_codepoint(out, (uint32_t)val);
+	return true;
+}
+
+static inline void json_str_reset(struct dstr *str)
+{
+	str->len = 0;
+	if (str->array)
+		*str->array = 0;
+}
+
+static bool json_read_string(struct json_reader *r, struct dstr *out)
+{
+	json_str_reset(out);
+	r->pos++;
+
+	for (;;) {
+		const char *run = r->pos;
+		uint8_t c;
+
+		/* copy plain runs at once */
+		while ((uint8_t)*r->pos >= 0x20 && *r->pos != '"' &&
+		       *r->pos != '\\') {
+			size_t size = utf8_seq_size((const uint8_t *)r->pos);
+			if (!size) {
+				json_error(r, "unable to decode byte 0x%x",
+					   (uint8_t)*r->pos);
+				return false;
+			}
+
+			r->pos += size;
+		}
+
+		if (r->pos != run)
+			dstr_ncat(out, run, r->pos - run);
+
+		c = (uint8_t)*r->pos;
+		if (c == '"') {
+			r->pos++;
+			return true;
+
+		} else if (c == 0) {
+			json_error(r, "premature end of input");
+			return false;
+
+		} else if (c != '\\') {
+			json_error(r, "control character 0x%x", c);
+			return false;
+		}
+
+		r->pos++;
+
+		switch (*r->pos) {
+		case '"':
+		case '\\':
+		case '/':
+			dstr_cat_ch(out, *r->pos);
+			break;
+		case 'b':
+			dstr_cat_ch(out, '\b');
+			break;
+		case 'f':
+			dstr_cat_ch(out, '\f');
+			break;
+		case 'n':
+			dstr_cat_ch(out, '\n');
+			break;
+		case 'r':
+			dstr_cat_ch(out, '\r');
+			break;
+		case 't':
+			dstr_cat_ch(out, '\t');
+			break;
+		case 'u':
+			if (!json_read_unicode(r, out))
+				return false;
+			continue;
+		default:
+			json_error(r, "invalid escape");
+			return false;
+		}
+
+		r->pos++;
+	}
+}
+
+static inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool json_read_number(struct json_reader *r,
+			     struct obs_data_number *num)
+{
+	const char *start = r->pos;
+	const char *pos = r->pos;
+	struct dstr big = {0};
+	char buf[64];
+	char *str = buf;
+	size_t len;
+
+	num->type = OBS_DATA_NUM_INT;
+
+	if (*pos == '-')
+		pos++;
+
+	if (*pos == '0') {
+		pos++;
+		if (is_digit(*pos))
+			goto invalid;
+	} else if (is_digit(*pos)) {
+		while (is_digit(*pos))
+			pos++;
+	} else {
+		goto invalid;
+	}
+
+	if (*pos == '.') {
+		num->type = OBS_DATA_NUM_DOUBLE;
+		if (!is_digit(*++pos))
+			goto invalid;
+		while (is_digit(*pos))
+			pos++;
+	}
+
+	if (*pos == 'e' || *pos == 'E') {
+		num->type = OBS_DATA_NUM_DOUBLE;
+		pos++;
+		if (*pos == '+' || *pos == '-')
+			pos++;
+		if (!is_digit(*pos))
+			goto invalid;
+		while (is_digit(*pos))
+			pos++;
+	}
+
+	len = pos - start;
+	if (len < sizeof(buf)) {
+		memcpy(buf, start, len);
+		buf[len] = 0;
+	} else {
+		dstr_ncopy(&big, start, len);
+		str = big.array;
+	}
+
+	errno = 0;
+
+	if (num->type == OBS_DATA_NUM_INT) {
+		num->int_val = strtoll(str, NULL, 10);
+		if (errno == ERANGE)
+			json_error(r, num->int_val < 0
+					      ? "too big negative integer"
+					      : "too big integer");
+	} else {
+		/* strtod follows the locale's decimal point */
+		const char *point = localeconv()->decimal_point;
+		char *dot = strchr(str, '.');
+
+		if (dot && *point != '.')
+			*dot = *point;
+
+		num->double_val = strtod(str, NULL);
+		if (errno == ERANGE && (num->double_val == HUGE_VAL ||
+					num->double_val == -HUGE_VAL))
+			json_error(r, "real number overflow");
+	}
+
+	dstr_free(&big);
+	r->pos = pos;
+	return !r->failed;
+
+invalid:
+	json_error(r, "invalid token");
+	return false;
+}
+
+static bool json_read_literal(struct json_reader *r, const char *literal)
+{
+	size_t len = strlen(literal);
+
+	if (strncmp(r->pos, literal, len) != 0) {
+		json_error(r, "invalid token");
+		return false;
+	}
+
+	r->pos += len;
+	return true;
+}
+
+static void add_json_item(obs_data_t *data, obs_data_item_t **item,
+			  const char *name, const void *ptr, size_t size,
+			  enum obs_data_type type)
+{
+	UNUSED_PARAMETER(item);
+
+	/* duplicates were rejected already, always a new item */
+	set_item_data(data, NULL, name, ptr, size, type, false, false);
+}
+
+static void json_read_object(struct json_reader *r, obs_data_t *data);
+static void json_read_array(struct json_reader *r, obs_data_array_t *array);
+
+/* adds the value to data under name, or appends it to array if it's an
+ * object.  with neither the value is only validated */
+static void json_read_value(struct json_reader *r, obs_data_t *data,
+			    const char *name, obs_data_array_t *array)
+{
+	struct obs_data_number num;
+
+	switch (*r->pos) {
+	case '{': {
+		obs_data_t *obj = obs_data_create();
+
+		json_read_object(r, obj);
+		if (!r->failed && data)
+			obs_set_obj(data, NULL, name, obj, add_json_item);
+		else if (!r->failed && array)
+			obs_data_array_push_back(array, obj);
+
+		obs_data_release(obj);
+		break;
+	}
+	case '[': {
+		obs_data_array_t *sub_array =
+			data ? obs_data_array_create() : NULL;
+
+		json_read_array(r, sub_array);
+		if (!r->failed && data)
+			obs_set_array(data, NULL, name, sub_array,
+				      add_json_item);
+
+		obs_data_array_release(sub_array);
+		break;
+	}
+	case '"':
+		if (json_read_string(r, &r->str) && data)
+			obs_set_string(data, NULL, name, r->str.array,
+				       add_json_item);
+		break;
+	case 't':
+		if (json_read_literal(r, "true") && data)
+			obs_set_bool(data, NULL, name, true, add_json_item);
+		break;
+	case 'f':
+		if (json_read_literal(r, "false") && data)
+			obs_set_bool(data, NULL, name, false, add_json_item);
+		break;
+	case 'n':
+		json_read_literal(r, "null");
+		break;
+	default:
+		if (json_read_number(r, &num) && data)
+			add_json_item(data, NULL, name, &num, sizeof(num),
+				      OBS_DATA_NUMBER);
+	}
+}
+
+static bool json_enter(struct json_reader *r)
+{
+	if (++r->depth > JSON_MAX_DEPTH) {
+		json_error(r, "maximum parsing depth reached");
+		return false;
+	}
+
+	r->pos++;
+	json_skip_whitespace(r);
+	return true;
+}
+
+static inline bool is_null_name(char **names, size_t count, const char *name)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (strcmp(names[i], name) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void json_read_object(struct json_reader *r, obs_data_t *data)
+{
+	DARRAY(char *) null_names;
+	struct dstr name = {0};
+
+	da_init(null_names);
+
+	if (!json_enter(r))
+		return;
+
+	if (*r->pos == '}') {
+		r->pos++;
+		r->depth--;
+		return;
+	}
+
+	while (!r->failed) {
+		const char *key;
+
+		if (*r->pos != '"') {
+			json_error(r, "string or '}' expected");
+			break;
+		}
+
+		if (!json_read_string(r, &name))
+			break;
+
+		/* not set by json_str_reset if the name was empty */
+		key = name.array ? name.array : "";
+
+		/* nulls don't create items but still count as keys */
+		if (get_item(data, key) ||
+		    is_null_name(null_names.array, null_names.num, key)) {
+			json_error(r, "duplicate object key");
+			break;
+		}
+
+		json_skip_whitespace(r);
+		if (*r->pos != ':') {
+			json_error(r, "':' expected");
+			break;
+		}
+
+		r->pos++;
+		json_skip_whitespace(r);
+
+		if (*r->pos == 'n') {
+			char *null_name = bstrdup(key);
+
+			da_push_back(null_names, &null_name);
+			json_read_literal(r, "null");
+		} else {
+			json_read_value(r, data, key, NULL);
+		}
+
+		if (r->failed)
+			break;
+
+		json_skip_whitespace(r);
+		if (*r->pos == '}') {
+			r->pos++;
+			break;
+		} else if (*r->pos != ',') {
+			json_error(r, "'}' expected");
+			break;
+		}
+
+		r->pos++;
+		json_skip_whitespace(r);
+	}
+
+	for (size_t i = 0; i < null_names.num; i++)
+		bfree(null_names.array[i]);
+	da_free(null_names);
+	dstr_free(&name);
+	r->depth--;
+}
+
+static void json_read_array(struct json_reader *r, obs_data_array_t *array)
+{
+	if (!json_enter(r))
+		return;
+
+	if (*r->pos == ']') {
+		r->pos++;
+		r->depth--;
+		return;
+	}
+
+	while (!r->failed) {
+		json_read_value(r, NULL, NULL, array);
+		if (r->failed)
+			break;
+
+		json_skip_whitespace(r);
+		if (*r->pos == ']') {
+			r->pos++;
+			break;
+		} else if (*r->pos != ',') {
+			json_error(r, "']' expected");
+			break;
+		}
+
+		r->pos++;
+		json_skip_whitespace(r);
+	}
+
+	r->depth--;
+}
+
+static bool json_read_root(struct json_reader *r, obs_data_t *data,
+			   const char *json)
+{
+	r->pos = json;
+	r->line = 1;
+
+	json_skip_whitespace(r);
+
+	if (*r->pos == '{')
+		json_read_object(r, data);
+	else if (*r->pos == '[')
+		json_read_array(r, NULL);
+	else
+		json_error(r, "'[' or '{' expected");
+
+	if (!r->failed) {
+		json_skip_whitespace(r);
+		if (*r->pos)
+			json_error(r, "end of file expected");
+	}
+
+	dstr_free(&r->str);
+	return !r->failed;
+}
+
+/* ------------------------------------------------------------------------- */
+/* JSON writer
+ *
+ * Writes straight to a serializer, producing the same text json_dumps did
+ * with JSON_PRESERVE_ORDER | JSON_INDENT(4).  Values jansson refused to
+ * store (invalid UTF-8, non-finite numbers) are left out the same way. */
+
+static const char json_spaces[] = "                                ";
+
+static void json_write_indent(struct serializer *s, int depth)
+{
+	size_t count = (size_t)depth * 4;
+
+	s_w8(s, '\n');
+
+	while (count) {
+		size_t size = count < sizeof(json_spaces) - 1
+				      ? count
+				      : sizeof(json_spaces) - 1;
+		s_write(s, json_spaces, size);
+		count -= size;
+	}
+}
+
+static void json_write_string(struct serializer *s, const char *str)
+{
+	const char *run = str;
+
+	s_w8(s, '"');
+
+	for (; *str; str++) {
+		uint8_t c = (uint8_t)*str;
+		const char *esc;
+		char seq[8];
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		switch (c) {
+		case '"':
+			esc = "\\\"";
+			break;
+		case '\\':
+			esc = "\\\\";
+			break;
+		case '\b':
+			esc = "\\b";
+			break;
+		case '\f':
+			esc = "\\f";
+			break;
+		case '\n':
+			esc = "\\n";
+			break;
+		case '\r':
+			esc = "\\r";
+			break;
+		case '\t':
+			esc = "\\t";
+			break;
+		default:
+			snprintf(seq, sizeof(seq), "\\u%04X", c);
+			esc = seq;
+		}
+
+		if (str != run)
+			s_write(s, run, str - run);
+		s_write(s, esc, strlen(esc));
+		run = str + 1;
+	}
+
+	if (str != run)
+		s_write(s, run, str - run);
+
+	s_w8(s, '"');
+}
+
+static bool json_item_writable(struct obs_data_item *item)
+{
+	void *ptr = get_item_data(item);
+
+	if (!item->data_size || !utf8_valid(get_item_name(item)))
+		return false;
+
+	if (item->type == OBS_DATA_STRING) {
+		return utf8_valid(ptr);
+
+	} else if (item->type == OBS_DATA_NUMBER) {
+		struct obs_data_number *num = ptr;
+		return num->type == OBS_DATA_NUM_INT ||
+		       isfinite(num->double_val);
+	}
+
+	return item->type != OBS_DATA_NULL;
+}
+
+static void json_write_object(struct serializer *s, obs_data_t *data,
+			      int depth);
+
+static void json_write_array(struct serializer *s, obs_data_array_t *array,
+			     int depth)
+{
+	size_t count = array ? array->objects.num : 0;
+
+	if (!count) {
+		s_write(s, "[]", 2);
+		return;
+	}
+
+	s_w8(s, '[');
+
+	for (size_t i = 0; i < count; i++) {
+		if (i)
+			s_w8(s, ',');
+		json_write_indent(s, depth + 1);
+		json_write_object(s, array->objects.array[i], depth + 1);
+	}
+
+	json_write_indent(s, depth);
+	s_w8(s, ']');
+}
+
+static void json_write_item(struct serializer *s, struct obs_data_item *item,
+			    int depth)
+{
+	void *ptr = get_item_data(item);
+	struct obs_data_number *num;
+	char buf[100];
+	int len;
+
+	switch (item->type) {
+	case OBS_DATA_STRING:
+		json_write_string(s, ptr);
+		break;
+	case OBS_DATA_NUMBER:
+		num = ptr;
+		if (num->type == OBS_DATA_NUM_INT)
+			len = snprintf(buf, sizeof(buf), "%lld", num->int_val);
+		else
+			/* may leave garbage past the returned length */
+			len = os_dtostr(num->double_val, buf, sizeof(buf));
+		if (len > 0)
+			s_write(s, buf, len);
+		break;
+	case OBS_DATA_BOOLEAN:
+		if (*(bool *)ptr)
+			s_write(s, "true", 4);
+		else
+			s_write(s, "false", 5);
+		break;
+	case OBS_DATA_OBJECT:
+		json_write_object(s, *(obs_data_t **)ptr, depth);
+		break;
+	case OBS_DATA_ARRAY:
+		json_write_array(s, *(obs_data_array_t **)ptr, depth);
+		break;
+	case OBS_DATA_NULL:
+		break;
+	}
+}
+
+static void json_write_object(struct serializer *s, obs_data_t *data,
+			      int depth)
+{
+	struct obs_data_item *item = data ? data->first_item : NULL;
+	bool empty = true;
+
+	for (; item; item = item->next) {
+		if (!json_item_writable(item))
+			continue;
+
+		s_w8(s, empty ? '{' : ',');
+		empty = false;
+
+		json_write_indent(s, depth + 1);
+		json_write_string(s, get_item_name(item));
+		s_write(s, ": ", 2);
+		json_write_item(s, item, depth + 1);
+	}
+
+	if (empty) {
+		s_write(s, "{}", 2);
+	} else {
+		json_write_indent(s, depth);
+		s_w8(s, '}');
+	}
+}
+
+static void json_write_root(obs_data_t *data, struct array_output_data *output)
+{
+	struct serializer s;
+
+	array_output_serializer_init(&s, output);
+	json_write_object(&s, data, 0);
+}
+
 void obs_data_set_string(obs_data_t *data, const char *name, const char *val)
 {
 	obs_set_string(data, NULL, name, val, set_item);
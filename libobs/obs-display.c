@@ -183,20 +183,45 @@ static inline void render_display_end()
 	gs_end_scene();
 }
 
-void render_display(struct obs_display *display)
+/* displays skipped for this long are rendered even if the graphics thread is
+ * behind, so that they don't freeze */
+#define MAX_DISPLAY_DELAY_NS 100000000ULL
+
+static inline bool display_due(struct obs_display *display, bool late,
+			       uint64_t video_time)
+{
+	uint64_t elapsed = video_time - display->last_render_time;
+	uint64_t half_frame = obs->video.video_frame_interval_ns / 2;
+
+	if (elapsed + half_frame < display->render_interval_ns)
+		return false;
+
+	if (late && elapsed < MAX_DISPLAY_DELAY_NS) {
+		obs->video.skipped_display_frames++;
+		return false;
+	}
+
+	display->last_render_time = video_time;
+	return true;
+}
+
+bool render_display(struct obs_display *display, bool late)
 {
 	uint32_t cx, cy;
 	bool size_changed;
 
 	if (!display || !display->enabled)
-		return;
-
-	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DISPLAY, "obs_display");
+		return false;
 
 	/* -------------------------------------------- */
 
 	pthread_mutex_lock(&display->draw_info_mutex);
 
+	if (!display_due(display, late, obs->video.video_time)) {
+		pthread_mutex_unlock(&display->draw_info_mutex);
+		return false;
+	}
+
 	cx = display->cx;
 	cy = display->cy;
 	size_changed = display->size_changed;
@@ -208,6 +233,8 @@ void render_display(struct obs_display *display)
 
 	/* -------------------------------------------- */
 
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DISPLAY, "obs_display");
+
 	render_display_begin(display, cx, cy, size_changed);
 
 	pthread_mutex_lock(&display->draw_callbacks_mutex);
@@ -226,6 +253,7 @@ void render_display(struct obs_display *display)
 	GS_DEBUG_MARKER_END();
 
 	gs_present();
+	return true;
 }
 
 void obs_display_set_enabled(obs_display_t *display, bool enable)
@@ -245,6 +273,30 @@ void obs_display_set_background_color(obs_display_t *display, uint32_t color)
 		display->background_color = color;
 }
 
+void obs_display_set_max_fps(obs_display_t *display, double fps)
+{
+	if (!display)
+		return;
+
+	pthread_mutex_lock(&display->draw_info_mutex);
+	display->render_interval_ns =
+		fps > 0.0 ? (uint64_t)(1000000000.0 / fps) : 0;
+	pthread_mutex_unlock(&display->draw_info_mutex);
+}
+
+double obs_display_get_max_fps(obs_display_t *display)
+{
+	uint64_t interval = 0;
+
+	if (display) {
+		pthread_mutex_lock(&display->draw_info_mutex);
+		interval = display->render_interval_ns;
+		pthread_mutex_unlock(&display->draw_info_mutex);
+	}
+
+	return interval ? 1000000000.0 / (double)interval : 0.0;
+}
+
 void obs_display_size(obs_display_t *display, uint32_t *width, uint32_t *height)
 {
 	*width = 0;
@@ -115,7 +115,8 @@ create_encoder(const char *id, enum obs_encoder_type type, const char *name,
 	encoder->control->encoder = encoder;
 
 	obs_context_data_insert(&encoder->context, &obs->data.encoders_mutex,
-				&obs->data.first_encoder);
+				&obs->data.first_encoder,
+				&obs->data.encoder_names);
 
 	blog(LOG_DEBUG, "encoder '%s' (%s) created", name, id);
 	return encoder;
@@ -744,6 +745,17 @@ uint32_t obs_encoder_get_height(const obs_encoder_t *encoder)
 		       : video_output_get_height(encoder->media);
 }
 
+uint32_t obs_encoder_get_skipped_frames(const obs_encoder_t *encoder)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_skipped_frames"))
+		return 0;
+	if (encoder->info.type != OBS_ENCODER_VIDEO || !encoder->media)
+		return 0;
+
+	return video_output_get_input_skipped_frames(
+		encoder->media, receive_video, (void *)encoder);
+}
+
 uint32_t obs_encoder_get_sample_rate(const obs_encoder_t *encoder)
 {
 	if (!obs_encoder_valid(encoder, "obs_encoder_get_sample_rate"))
@@ -856,6 +868,7 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 				    struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
+	struct encoder_packet sei_packet;
 	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
@@ -875,14 +888,18 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	da_push_back_array(data, sei, size);
 	da_push_back_array(data, packet->data, packet->size);
 
-	first_packet = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	sei_packet = *packet;
+	sei_packet.data = data.array;
+	sei_packet.size = data.num;
+
+	/* callbacks may keep a reference, so it has to be a packet instance */
+	obs_encoder_packet_create_instance(&first_packet, &sei_packet);
+	da_free(data);
 
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static inline void send_packet(struct obs_encoder *encoder,
@@ -945,15 +962,23 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 		pkt->sys_dts_usec += encoder->pause.ts_offset / 1000;
 		pthread_mutex_unlock(&encoder->pause.mutex);
 
+		/* the encoder's packet data is only valid until the next
+		 * encode call, so make a single reference counted copy that
+		 * every output can hold on to instead of copying it again */
+		struct encoder_packet shared;
+		obs_encoder_packet_create_instance(&shared, pkt);
+
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt);
+			send_packet(encoder, cb, &shared);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+		obs_encoder_packet_release(&shared);
 	}
 }
 
@@ -1308,15 +1333,146 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 	pthread_mutex_unlock(&encoder->outputs_mutex);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Packet payload pool
+ *
+ * Encoded packets are copied once when they leave the encoder and are then
+ * shared between outputs by reference.  The payloads come from power-of-two
+ * size classes (1 KB to 8 MB) that are kept around for reuse, since packet
+ * sizes for a given encoder stay within a few classes.  Anything larger is
+ * allocated directly. */
+
+#define PACKET_POOL_MIN_SHIFT 10
+#define PACKET_POOL_MAX_CLASS_BYTES (16 * 1024 * 1024)
+
+static inline size_t packet_class_size(size_t size_class)
+{
+	return (size_t)1 << (size_class + PACKET_POOL_MIN_SHIFT);
+}
+
+static inline size_t packet_max_free(size_t size_class)
+{
+	size_t max =
+		PACKET_POOL_MAX_CLASS_BYTES / packet_class_size(size_class);
+	return max < 2 ? 2 : max;
+}
+
+static size_t packet_size_class(size_t size)
+{
+	for (size_t i = 0; i < PACKET_POOL_CLASSES; i++) {
+		if (size <= packet_class_size(i))
+			return i;
+	}
+
+	return PACKET_POOL_NO_CLASS;
+}
+
+static struct {
+	bool initialized;
+
+	struct packet_header *free_blocks[PACKET_POOL_CLASSES];
+	size_t free_count[PACKET_POOL_CLASSES];
+
+	uint64_t bytes_copied;
+	uint64_t bytes_shared;
+} packet_pool;
+
+/* never destroyed, blocks are returned to the pool until obs_shutdown and
+ * freed directly afterwards */
+static pthread_mutex_t packet_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void obs_packet_pool_init(void)
+{
+	pthread_mutex_lock(&packet_pool_mutex);
+	packet_pool.initialized = true;
+	packet_pool.bytes_copied = 0;
+	packet_pool.bytes_shared = 0;
+	pthread_mutex_unlock(&packet_pool_mutex);
+}
+
+void obs_packet_pool_free(void)
+{
+	pthread_mutex_lock(&packet_pool_mutex);
+	packet_pool.initialized = false;
+
+	for (size_t i = 0; i < PACKET_POOL_CLASSES; i++) {
+		struct packet_header *block = packet_pool.free_blocks[i];
+		while (block) {
+			struct packet_header *next = block->next;
+			bfree(block);
+			block = next;
+		}
+
+		packet_pool.free_blocks[i] = NULL;
+		packet_pool.free_count[i] = 0;
+	}
+
+	pthread_mutex_unlock(&packet_pool_mutex);
+}
+
+static struct packet_header *packet_block_alloc(size_t size)
+{
+	size_t size_class = packet_size_class(size);
+	struct packet_header *block = NULL;
+
+	pthread_mutex_lock(&packet_pool_mutex);
+	if (packet_pool.initialized) {
+		packet_pool.bytes_copied += size;
+
+		if (size_class != PACKET_POOL_NO_CLASS &&
+		    packet_pool.free_blocks[size_class]) {
+			block = packet_pool.free_blocks[size_class];
+			packet_pool.free_blocks[size_class] = block->next;
+			packet_pool.free_count[size_class]--;
+		}
+	}
+	pthread_mutex_unlock(&packet_pool_mutex);
+
+	if (!block) {
+		size_t alloc_size = size_class != PACKET_POOL_NO_CLASS
+					    ? packet_class_size(size_class)
+					    : size;
+		block = bmalloc(sizeof(*block) + alloc_size);
+	}
+
+	block->next = NULL;
+	block->size_class = size_class;
+	block->refs = 1;
+	return block;
+}
+
+static void packet_block_free(struct packet_header *block)
+{
+	size_t size_class = block->size_class;
+
+	if (size_class != PACKET_POOL_NO_CLASS) {
+		pthread_mutex_lock(&packet_pool_mutex);
+		if (packet_pool.initialized &&
+		    packet_pool.free_count[size_class] <
+			    packet_max_free(size_class)) {
+			block->next = packet_pool.free_blocks[size_class];
+			packet_pool.free_blocks[size_class] = block;
+			packet_pool.free_count[size_class]++;
+			block = NULL;
+		}
+		pthread_mutex_unlock(&packet_pool_mutex);
+	}
+
+	bfree(block);
+}
+
+static inline struct packet_header *get_packet_header(const uint8_t *data)
+{
+	return ((struct packet_header *)data) - 1;
+}
+
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 					const struct encoder_packet *src)
 {
-	long *p_refs;
+	struct packet_header *block = packet_block_alloc(src->size);
 
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
+	dst->data = (uint8_t *)(block + 1);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1339,23 +1495,44 @@ void obs_encoder_packet_ref(struct encoder_packet *dst,
 	if (!src)
 		return;
 
-	if (src->data) {
-		long *p_refs = ((long *)src->data) - 1;
-		os_atomic_inc_long(p_refs);
-	}
+	if (src->data)
+		os_atomic_inc_long(&get_packet_header(src->data)->refs);
 
 	*dst = *src;
 }
 
+void obs_encoder_packet_share(struct encoder_packet *dst,
+			      struct encoder_packet *src)
+{
+	obs_encoder_packet_ref(dst, src);
+
+	pthread_mutex_lock(&packet_pool_mutex);
+	if (packet_pool.initialized)
+		packet_pool.bytes_shared += src->size;
+	pthread_mutex_unlock(&packet_pool_mutex);
+}
+
+uint64_t obs_get_encoder_packet_bytes_not_copied(void)
+{
+	uint64_t saved = 0;
+
+	pthread_mutex_lock(&packet_pool_mutex);
+	if (packet_pool.bytes_shared > packet_pool.bytes_copied)
+		saved = packet_pool.bytes_shared - packet_pool.bytes_copied;
+	pthread_mutex_unlock(&packet_pool_mutex);
+
+	return saved;
+}
+
 void obs_encoder_packet_release(struct encoder_packet *pkt)
 {
 	if (!pkt)
 		return;
 
 	if (pkt->data) {
-		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
+		struct packet_header *block = get_packet_header(pkt->data);
+		if (os_atomic_dec_long(&block->refs) == 0)
+			packet_block_free(block);
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
@@ -0,0 +1,237 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/darray.h"
+#include "obs.h"
+
+/*
+ * Interleave merge queue
+ *
+ *   Holds encoded packets in one FIFO per track (video, plus one per audio
+ * mix) and merges them with a small binary heap keyed on each track's head
+ * packet.  Encoders emit packets in DTS order per track, so inserting and
+ * removing a packet costs O(log tracks) instead of the O(n) sorted insert
+ * over every buffered packet.
+ *
+ *   Ordering matches the sorted array it replaces: ascending dts_usec, video
+ * before audio on equal timestamps, and audio tracks with equal timestamps
+ * in arrival order.
+ */
+
+#define INTERLEAVE_TRACKS (MAX_AUDIO_MIXES + 1)
+
+struct interleave_entry {
+	struct encoder_packet packet;
+	uint64_t seq;
+};
+
+struct interleave_track {
+	DARRAY(struct interleave_entry) entries;
+	size_t start;
+};
+
+struct interleave_queue {
+	struct interleave_track tracks[INTERLEAVE_TRACKS];
+	size_t heap[INTERLEAVE_TRACKS];
+	size_t heap_size;
+	size_t num;
+	uint64_t next_seq;
+};
+
+static inline size_t interleave_track_idx(const struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO)
+		return 0;
+	return 1 + (packet->track_idx < MAX_AUDIO_MIXES ? packet->track_idx
+							: MAX_AUDIO_MIXES - 1);
+}
+
+static inline size_t interleave_track_size(const struct interleave_track *track)
+{
+	return track->entries.num - track->start;
+}
+
+static inline struct interleave_entry *
+interleave_track_head(const struct interleave_track *track)
+{
+	return track->entries.array + track->start;
+}
+
+/* returns true if entry a must be sent before entry b */
+static inline bool interleave_entry_before(const struct interleave_entry *a,
+					   const struct interleave_entry *b)
+{
+	bool a_video, b_video;
+
+	if (a->packet.dts_usec != b->packet.dts_usec)
+		return a->packet.dts_usec < b->packet.dts_usec;
+
+	a_video = a->packet.type == OBS_ENCODER_VIDEO;
+	b_video = b->packet.type == OBS_ENCODER_VIDEO;
+	if (a_video != b_video)
+		return a_video;
+
+	return a->seq < b->seq;
+}
+
+static inline bool interleave_heap_less(const struct interleave_queue *q,
+					size_t a, size_t b)
+{
+	return interleave_entry_before(
+		interleave_track_head(&q->tracks[q->heap[a]]),
+		interleave_track_head(&q->tracks[q->heap[b]]));
+}
+
+static inline void interleave_heap_swap(struct interleave_queue *q, size_t a,
+					size_t b)
+{
+	size_t tmp = q->heap[a];
+	q->heap[a] = q->heap[b];
+	q->heap[b] = tmp;
+}
+
+static inline void interleave_heap_up(struct interleave_queue *q, size_t i)
+{
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!interleave_heap_less(q, i, parent))
+			break;
+
+		interleave_heap_swap(q, i, parent);
+		i = parent;
+	}
+}
+
+static inline void interleave_heap_down(struct interleave_queue *q, size_t i)
+{
+	for (;;) {
+		size_t left = i * 2 + 1;
+		size_t right = left + 1;
+		size_t smallest = i;
+
+		if (left < q->heap_size &&
+		    interleave_heap_less(q, left, smallest))
+			smallest = left;
+		if (right < q->heap_size &&
+		    interleave_heap_less(q, right, smallest))
+			smallest = right;
+		if (smallest == i)
+			break;
+
+		interleave_heap_swap(q, i, smallest);
+		i = smallest;
+	}
+}
+
+static inline size_t interleave_heap_find(const struct interleave_queue *q,
+					  size_t track_idx)
+{
+	for (size_t i = 0; i < q->heap_size; i++) {
+		if (q->heap[i] == track_idx)
+			return i;
+	}
+
+	return DARRAY_INVALID;
+}
+
+static inline void interleave_queue_init(struct interleave_queue *q)
+{
+	memset(q, 0, sizeof(*q));
+}
+
+/* frees queue storage; packets still queued are not released */
+static inline void interleave_queue_free(struct interleave_queue *q)
+{
+	for (size_t i = 0; i < INTERLEAVE_TRACKS; i++)
+		da_free(q->tracks[i].entries);
+	memset(q, 0, sizeof(*q));
+}
+
+static inline size_t interleave_queue_size(const struct interleave_queue *q)
+{
+	return q->num;
+}
+
+static inline void interleave_queue_push(struct interleave_queue *q,
+					 const struct encoder_packet *packet)
+{
+	size_t track_idx = interleave_track_idx(packet);
+	struct interleave_track *track = &q->tracks[track_idx];
+	struct interleave_entry entry = {*packet, q->next_seq++};
+	bool was_empty = interleave_track_size(track) == 0;
+	size_t idx = track->entries.num;
+
+	/* encoders output in dts order, so this only walks back when a track
+	 * receives an out-of-order packet */
+	while (idx > track->start) {
+		struct interleave_entry *prev = &track->entries.array[idx - 1];
+		if (interleave_entry_before(prev, &entry))
+			break;
+		idx--;
+	}
+
+	da_insert(track->entries, idx, &entry);
+	q->num++;
+
+	if (was_empty) {
+		q->heap[q->heap_size] = track_idx;
+		interleave_heap_up(q, q->heap_size++);
+
+	} else if (idx == track->start) {
+		interleave_heap_up(q, interleave_heap_find(q, track_idx));
+	}
+}
+
+static inline struct encoder_packet *
+interleave_queue_peek(const struct interleave_queue *q)
+{
+	if (!q->heap_size)
+		return NULL;
+
+	return &interleave_track_head(&q->tracks[q->heap[0]])->packet;
+}
+
+static inline bool interleave_queue_pop(struct interleave_queue *q,
+					struct encoder_packet *packet)
+{
+	struct interleave_track *track;
+
+	if (!q->heap_size)
+		return false;
+
+	track = &q->tracks[q->heap[0]];
+	*packet = interleave_track_head(track)->packet;
+	track->start++;
+	q->num--;
+
+	if (!interleave_track_size(track)) {
+		da_resize(track->entries, 0);
+		track->start = 0;
+
+		q->heap[0] = q->heap[--q->heap_size];
+
+	} else if (track->start >= track->entries.num / 2) {
+		/* compact consumed entries away, amortized O(1) */
+		da_erase_range(track->entries, 0, track->start);
+		track->start = 0;
+	}
+
+	interleave_heap_down(q, 0);
+	return true;
+}
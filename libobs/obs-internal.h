@@ -20,10 +20,12 @@
 #include "util/c99defs.h"
 #include "util/darray.h"
 #include "util/circlebuf.h"
+#include "util/hash-table.h"
 #include "util/dstr.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
+#include "util/task-pool.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -35,9 +37,11 @@
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-interleave.h"
 
 #define NUM_TEXTURES 2
 #define NUM_CHANNELS 3
+#define MAX_TICK_THREADS 4
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 3
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
@@ -205,6 +209,8 @@ struct obs_display {
 	bool enabled;
 	uint32_t cx, cy;
 	uint32_t background_color;
+	uint64_t render_interval_ns;
+	uint64_t last_render_time;
 	gs_swapchain_t *swap;
 	pthread_mutex_t draw_callbacks_mutex;
 	pthread_mutex_t draw_info_mutex;
@@ -282,12 +288,21 @@ struct obs_core_video {
 	uint64_t video_time;
 	uint64_t video_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
+	uint64_t output_avg_render_time_ns;
+	uint64_t display_avg_render_time_ns;
+	uint32_t skipped_display_frames;
 	double video_fps;
 	video_t *video;
 	pthread_t video_thread;
 	uint32_t total_frames;
 	uint32_t lagged_frames;
+
+	/* incremented on each tick, keys the source render caches */
+	uint64_t render_frame;
+	uint32_t render_cache_hits;
+	uint32_t render_cache_misses;
 	bool thread_initialized;
+	bool parallel_encoders;
 
 	bool gpu_conversion;
 	const char *conversion_techs[NUM_CHANNELS];
@@ -316,6 +331,11 @@ struct obs_core_video {
 
 	pthread_mutex_t task_mutex;
 	struct circlebuf tasks;
+
+	/* runs the ticks of OBS_SOURCE_PARALLEL_TICK sources, NULL on single
+	 * core machines */
+	os_task_pool_t *tick_pool;
+	DARRAY(struct obs_source *) parallel_tick_sources;
 };
 
 struct audio_monitor;
@@ -340,6 +360,40 @@ struct obs_core_audio {
 };
 
 /* user sources, output channels, and displays */
+/* encoded packet payload pool, see obs-encoder.c */
+#define PACKET_POOL_CLASSES 14
+#define PACKET_POOL_NO_CLASS ((size_t)-1)
+
+/* precedes the payload of every encoded packet instance.  padded so that
+ * payloads keep the 32 byte alignment of bmalloc */
+#define PACKET_HEADER_SIZE 32
+
+struct packet_header {
+	union {
+		struct {
+			struct packet_header *next;
+			size_t size_class;
+			volatile long refs;
+		};
+		uint8_t padding[PACKET_HEADER_SIZE];
+	};
+};
+
+/* for packet data built in a bmalloc'd buffer (such as a darray) that starts
+ * with a packet_header, instead of coming from the pool */
+static inline void packet_header_init_unpooled(void *buffer)
+{
+	struct packet_header *header = buffer;
+	header->next = NULL;
+	header->size_class = PACKET_POOL_NO_CLASS;
+	header->refs = 1;
+}
+
+/* the pool itself lives in obs-encoder.c for the lifetime of the process,
+ * since packets can be released after obs_shutdown */
+extern void obs_packet_pool_init(void);
+extern void obs_packet_pool_free(void);
+
 struct obs_core_data {
 	struct obs_source *first_source;
 	struct obs_source *first_audio_source;
@@ -348,6 +402,13 @@ struct obs_core_data {
 	struct obs_encoder *first_encoder;
 	struct obs_service *first_service;
 
+	/* name indexes of the lists above, guarded by their list mutex.
+	 * private contexts are indexed as well, lookups skip them */
+	struct hash_table source_names;
+	struct hash_table output_names;
+	struct hash_table encoder_names;
+	struct hash_table service_names;
+
 	pthread_mutex_t sources_mutex;
 	pthread_mutex_t displays_mutex;
 	pthread_mutex_t outputs_mutex;
@@ -440,6 +501,9 @@ struct obs_graphics_context {
 	uint64_t last_time;
 	uint64_t interval;
 	uint64_t frame_time_total_ns;
+	uint64_t output_time_total_ns;
+	uint64_t display_time_total_ns;
+	uint64_t last_display_time_ns;
 	uint64_t fps_total_ns;
 	uint32_t fps_total_frames;
 #ifdef _WIN32
@@ -495,6 +559,10 @@ struct obs_context_data {
 	struct obs_context_data *next;
 	struct obs_context_data **prev_next;
 
+	/* name index of the list, guarded by mutex as well */
+	struct hash_table *names;
+	struct hash_node name_node;
+
 	bool private;
 };
 
@@ -505,7 +573,8 @@ extern bool obs_context_data_init(struct obs_context_data *context,
 extern void obs_context_data_free(struct obs_context_data *context);
 
 extern void obs_context_data_insert(struct obs_context_data *context,
-				    pthread_mutex_t *mutex, void *first);
+				    pthread_mutex_t *mutex, void *first,
+				    struct hash_table *names);
 extern void obs_context_data_remove(struct obs_context_data *context);
 
 extern void obs_context_data_setname(struct obs_context_data *context,
@@ -603,6 +672,9 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* profiler name of the source tick, set when first ticked */
+	const char *profile_tick_name;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -711,6 +783,15 @@ struct obs_source {
 	enum obs_allow_direct_render allow_direct;
 	bool rendering_filter;
 
+	/* per-frame render cache, used once the source is rendered more than
+	 * once per frame */
+	gs_texrender_t *render_cache;
+	uint64_t render_cache_frame;
+	uint32_t render_count;
+	uint32_t render_cache_hold;
+	bool render_cache_active;
+	bool render_cache_valid;
+
 	/* sources specific hotkeys */
 	obs_hotkey_pair_id mute_unmute_key;
 	obs_hotkey_id push_to_mute_key;
@@ -833,9 +914,20 @@ convert_video_format(enum video_format format)
 	}
 }
 
+/* collects up to max sources named name, private ones included.  no references
+ * are taken, the pointers are only meant to be compared against */
+extern size_t obs_find_sources_by_name(const char *name, obs_source_t **sources,
+				       size_t max);
+
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
-extern void obs_source_video_tick(obs_source_t *source, float seconds);
+/* if call_tick is false the caller calls the video_tick callback itself */
+extern void obs_source_video_tick(obs_source_t *source, float seconds,
+				  bool call_tick);
+
+/* false if the source is dormant and can skip its tick this frame.  filters
+ * look at the source they're attached to, so sources_mutex has to be held */
+extern bool obs_source_tick_needed(obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 
@@ -927,7 +1019,11 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
+
+	/* sorted staging array used until audio and video have both been
+	 * received and offsets are initialized, then the per-track queue */
 	DARRAY(struct encoder_packet) interleaved_packets;
+	struct interleave_queue interleave_queue;
 	int stop_code;
 
 	int reconnect_retry_sec;
@@ -1127,6 +1223,11 @@ extern bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame);
 extern void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 				    bool received, struct encoder_packet *pkt);
 
+/* references a packet in place of making a copy of it, and counts the bytes
+ * that didn't need to be copied */
+extern void obs_encoder_packet_share(struct encoder_packet *dst,
+				     struct encoder_packet *src);
+
 void obs_encoder_destroy(obs_encoder_t *encoder);
 
 /* ------------------------------------------------------------------------- */
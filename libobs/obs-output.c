@@ -151,7 +151,8 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 	output->control->output = output;
 
 	obs_context_data_insert(&output->context, &obs->data.outputs_mutex,
-				&obs->data.first_output);
+				&obs->data.first_output,
+				&obs->data.output_names);
 
 	if (info)
 		output->context.data =
@@ -173,6 +174,11 @@ static inline void free_packets(struct obs_output *output)
 		obs_encoder_packet_release(output->interleaved_packets.array +
 					   i);
 	da_free(output->interleaved_packets);
+
+	struct encoder_packet packet;
+	while (interleave_queue_pop(&output->interleave_queue, &packet))
+		obs_encoder_packet_release(&packet);
+	interleave_queue_free(&output->interleave_queue);
 }
 
 static inline void clear_audio_buffers(obs_output_t *output)
@@ -1193,11 +1199,11 @@ static const uint8_t nal_start[4] = {0, 0, 0, 1};
 static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 {
 	struct encoder_packet backup = *out;
+	struct packet_header header = {0};
 	caption_frame_t cf;
 	sei_t sei;
 	uint8_t *data;
 	size_t size;
-	long ref = 1;
 
 	DARRAY(uint8_t) out_data;
 
@@ -1207,7 +1213,7 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	sei_init(&sei, 0.0);
 
 	da_init(out_data);
-	da_push_back_array(out_data, &ref, sizeof(ref));
+	da_push_back_array(out_data, &header, sizeof(header));
 	da_push_back_array(out_data, out->data, out->size);
 
 	caption_frame_init(&cf);
@@ -1224,9 +1230,11 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 
 	obs_encoder_packet_release(out);
 
+	packet_header_init_unpooled(out_data.array);
+
 	*out = backup;
-	out->data = (uint8_t *)out_data.array + sizeof(ref);
-	out->size = out_data.num - sizeof(ref);
+	out->data = (uint8_t *)out_data.array + sizeof(header);
+	out->size = out_data.num - sizeof(header);
 
 	sei_free(&sei);
 
@@ -1239,15 +1247,17 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct encoder_packet *next =
+		interleave_queue_peek(&output->interleave_queue);
+	struct encoder_packet out;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
 	 * this ensures that the timestamps are monotonic */
-	if (!has_higher_opposing_ts(output, &out))
+	if (!next || !has_higher_opposing_ts(output, next))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	interleave_queue_pop(&output->interleave_queue, &out);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1593,6 +1603,17 @@ static void resort_interleaved_packets(struct obs_output *output)
 	da_free(old_array);
 }
 
+/* moves the sorted staging array into the per-track merge queue once the
+ * output has started; from then on packets are merged in O(log tracks) */
+static void start_interleave_queue(struct obs_output *output)
+{
+	for (size_t i = 0; i < output->interleaved_packets.num; i++)
+		interleave_queue_push(&output->interleave_queue,
+				      &output->interleaved_packets.array[i]);
+
+	da_free(output->interleaved_packets);
+}
+
 static void discard_unused_audio_packets(struct obs_output *output,
 					 int64_t dts_usec)
 {
@@ -1640,14 +1661,16 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_share(&out, packet);
 
-	if (was_started)
+	if (was_started) {
 		apply_interleaved_packet_offset(output, &out);
-	else
+		interleave_queue_push(&output->interleave_queue, &out);
+	} else {
 		check_received(output, packet);
+		insert_interleaved_packet(output, &out);
+	}
 
-	insert_interleaved_packet(output, &out);
 	set_higher_ts(output, &out);
 
 	/* when both video and audio have been received, we're ready
@@ -1657,6 +1680,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 			if (prune_interleaved_packets(output)) {
 				if (initialize_interleaved_packets(output)) {
 					resort_interleaved_packets(output);
+					start_interleave_queue(output);
 					send_interleaved(output);
 				}
 			}
@@ -111,6 +111,11 @@ static void *scene_create(obs_data_t *settings, struct obs_source *source)
 				"mutex");
 		goto fail;
 	}
+	if (pthread_mutex_init(&scene->index_mutex, NULL) != 0) {
+		blog(LOG_ERROR, "scene_create: Couldn't initialize index "
+				"mutex");
+		goto fail;
+	}
 
 	UNUSED_PARAMETER(settings);
 	return scene;
@@ -183,6 +188,10 @@ static void scene_destroy(void *data)
 
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
+	pthread_mutex_destroy(&scene->index_mutex);
+	hash_table_free(&scene->items_by_id);
+	hash_table_free(&scene->items_by_source);
+	da_free(scene->groups);
 	bfree(scene);
 }
 
@@ -224,6 +233,56 @@ static void scene_enum_all_sources(void *data,
 	scene_enum_sources(data, enum_callback, param, false);
 }
 
+static void index_sceneitem(struct obs_scene *scene,
+			    struct obs_scene_item *item)
+{
+	pthread_mutex_lock(&scene->index_mutex);
+	hash_table_insert(&scene->items_by_id, &item->id_node,
+			  hash_uint64((uint64_t)item->id));
+	hash_table_insert(&scene->items_by_source, &item->source_node,
+			  hash_ptr(item->source));
+	if (item->is_group)
+		da_push_back(scene->groups, &item);
+	pthread_mutex_unlock(&scene->index_mutex);
+}
+
+static void unindex_sceneitem(struct obs_scene *scene,
+			      struct obs_scene_item *item)
+{
+	pthread_mutex_lock(&scene->index_mutex);
+	hash_table_remove(&scene->items_by_id, &item->id_node);
+	hash_table_remove(&scene->items_by_source, &item->source_node);
+	if (item->is_group)
+		da_erase_item(scene->groups, &item);
+	pthread_mutex_unlock(&scene->index_mutex);
+}
+
+/* the id node is hashed by id, so it has to be moved when the id changes */
+static void set_sceneitem_id(struct obs_scene_item *item, int64_t id)
+{
+	struct obs_scene *scene = item->parent;
+
+	pthread_mutex_lock(&scene->index_mutex);
+	hash_table_remove(&scene->items_by_id, &item->id_node);
+	item->id = id;
+	hash_table_insert(&scene->items_by_id, &item->id_node,
+			  hash_uint64((uint64_t)item->id));
+	pthread_mutex_unlock(&scene->index_mutex);
+}
+
+/* for code that relinks items directly rather than detaching them */
+static inline void set_sceneitem_parent(struct obs_scene_item *item,
+					struct obs_scene *parent)
+{
+	if (item->parent == parent)
+		return;
+
+	if (item->parent)
+		unindex_sceneitem(item->parent, item);
+	item->parent = parent;
+	index_sceneitem(parent, item);
+}
+
 static inline void detach_sceneitem(struct obs_scene_item *item)
 {
 	if (item->prev)
@@ -234,6 +293,7 @@ static inline void detach_sceneitem(struct obs_scene_item *item)
 	if (item->next)
 		item->next->prev = item->prev;
 
+	unindex_sceneitem(item->parent, item);
 	item->parent = NULL;
 }
 
@@ -243,6 +303,7 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 {
 	item->prev = prev;
 	item->parent = parent;
+	index_sceneitem(parent, item);
 
 	if (prev) {
 		item->next = prev->next;
@@ -744,7 +805,7 @@ static void scene_load_item(struct obs_scene *scene, obs_data_t *item_data)
 				 OBS_ALIGN_TOP | OBS_ALIGN_LEFT);
 
 	if (obs_data_has_user_value(item_data, "id"))
-		item->id = obs_data_get_int(item_data, "id");
+		set_sceneitem_id(item, obs_data_get_int(item_data, "id"));
 
 	item->rot = (float)obs_data_get_double(item_data, "rot");
 	item->align = (uint32_t)obs_data_get_int(item_data, "align");
@@ -1425,36 +1486,40 @@ obs_scene_t *obs_group_from_source(const obs_source_t *source)
 	return source->context.data;
 }
 
-obs_sceneitem_t *obs_scene_find_source(obs_scene_t *scene, const char *name)
+#define MAX_NAME_MATCHES 16
+
+/* index_mutex must be held */
+static struct obs_scene_item *
+find_indexed_source(struct obs_scene *scene, obs_source_t **sources,
+		    size_t count, const char *name)
 {
-	struct obs_scene_item *item;
+	for (size_t i = 0; i < count; i++) {
+		struct hash_node *node = hash_table_first(
+			&scene->items_by_source, hash_ptr(sources[i]));
 
-	if (!scene)
-		return NULL;
+		while (node) {
+			struct obs_scene_item *item = hash_entry(
+				node, struct obs_scene_item, source_node);
+			const char *item_name = item->source->context.name;
 
-	full_lock(scene);
+			/* the source may have been renamed or destroyed since
+			 * it was looked up, the item's source is alive */
+			if (item->source == sources[i] && item_name &&
+			    strcmp(item_name, name) == 0)
+				return item;
 
-	item = scene->first_item;
-	while (item) {
-		if (strcmp(item->source->context.name, name) == 0)
-			break;
-
-		item = item->next;
+			node = hash_table_next(node);
+		}
 	}
 
-	full_unlock(scene);
-
-	return item;
+	return NULL;
 }
 
-obs_sceneitem_t *obs_scene_find_source_recursive(obs_scene_t *scene,
-						 const char *name)
+static obs_sceneitem_t *scan_source(obs_scene_t *scene, const char *name,
+				    bool recursive)
 {
 	struct obs_scene_item *item;
 
-	if (!scene)
-		return NULL;
-
 	full_lock(scene);
 
 	item = scene->first_item;
@@ -1462,10 +1527,10 @@ obs_sceneitem_t *obs_scene_find_source_recursive(obs_scene_t *scene,
 		if (strcmp(item->source->context.name, name) == 0)
 			break;
 
-		if (item->is_group) {
+		if (recursive && item->is_group) {
 			obs_scene_t *group = item->source->context.data;
 			obs_sceneitem_t *child =
-				obs_scene_find_source(group, name);
+				scan_source(group, name, false);
 			if (child) {
 				item = child;
 				break;
@@ -1480,24 +1545,77 @@ obs_sceneitem_t *obs_scene_find_source_recursive(obs_scene_t *scene,
 	return item;
 }
 
-obs_sceneitem_t *obs_scene_find_sceneitem_by_id(obs_scene_t *scene, int64_t id)
+static obs_sceneitem_t *find_source(obs_scene_t *scene, const char *name,
+				    bool recursive)
 {
+	obs_source_t *sources[MAX_NAME_MATCHES];
 	struct obs_scene_item *item;
+	size_t count;
+
+	if (!scene || !name)
+		return NULL;
+
+	count = obs_find_sources_by_name(name, sources, MAX_NAME_MATCHES);
+	if (!count)
+		return NULL;
+
+	/* a pathological number of sources sharing a name */
+	if (count == MAX_NAME_MATCHES)
+		return scan_source(scene, name, recursive);
+
+	pthread_mutex_lock(&scene->index_mutex);
+
+	item = find_indexed_source(scene, sources, count, name);
+
+	for (size_t i = 0; recursive && !item && i < scene->groups.num; i++) {
+		obs_scene_t *group =
+			scene->groups.array[i]->source->context.data;
+
+		pthread_mutex_lock(&group->index_mutex);
+		item = find_indexed_source(group, sources, count, name);
+		pthread_mutex_unlock(&group->index_mutex);
+	}
+
+	pthread_mutex_unlock(&scene->index_mutex);
+
+	return item;
+}
+
+obs_sceneitem_t *obs_scene_find_source(obs_scene_t *scene, const char *name)
+{
+	return find_source(scene, name, false);
+}
+
+obs_sceneitem_t *obs_scene_find_source_recursive(obs_scene_t *scene,
+						 const char *name)
+{
+	return find_source(scene, name, true);
+}
+
+obs_sceneitem_t *obs_scene_find_sceneitem_by_id(obs_scene_t *scene, int64_t id)
+{
+	struct obs_scene_item *item = NULL;
+	struct hash_node *node;
 
 	if (!scene)
 		return NULL;
 
-	full_lock(scene);
+	pthread_mutex_lock(&scene->index_mutex);
 
-	item = scene->first_item;
-	while (item) {
-		if (item->id == id)
+	node = hash_table_first(&scene->items_by_id, hash_uint64((uint64_t)id));
+	while (node) {
+		struct obs_scene_item *cur =
+			hash_entry(node, struct obs_scene_item, id_node);
+
+		if (cur->id == id) {
+			item = cur;
 			break;
+		}
 
-		item = item->next;
+		node = hash_table_next(node);
 	}
 
-	full_unlock(scene);
+	pthread_mutex_unlock(&scene->index_mutex);
 
 	return item;
 }
@@ -1737,6 +1855,7 @@ static obs_sceneitem_t *obs_scene_add_internal(obs_scene_t *scene,
 		}
 	}
 
+	index_sceneitem(scene, item);
 	full_unlock(scene);
 
 	if (!scene->source->context.private)
@@ -2625,7 +2744,7 @@ obs_sceneitem_t *obs_scene_insert_group(obs_scene_t *scene, const char *name,
 		} else {
 			items[idx]->next = NULL;
 		}
-		items[idx]->parent = sub_scene;
+		set_sceneitem_parent(items[idx], sub_scene);
 		apply_group_transform(items[idx], item);
 	}
 	items[0]->prev = NULL;
@@ -2938,7 +3057,7 @@ bool obs_scene_reorder_items2(obs_scene_t *scene,
 
 				sub_item->prev = sub_prev;
 				sub_item->next = NULL;
-				sub_item->parent = sub_scene;
+				set_sceneitem_parent(sub_item, sub_scene);
 
 				if (sub_prev)
 					sub_prev->next = sub_item;
@@ -2956,7 +3075,7 @@ bool obs_scene_reorder_items2(obs_scene_t *scene,
 
 		item->prev = prev;
 		item->next = NULL;
-		item->parent = scene;
+		set_sceneitem_parent(item, scene);
 
 		if (prev)
 			prev->next = item;
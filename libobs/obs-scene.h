@@ -82,6 +82,10 @@ struct obs_scene_item {
 	/* would do **prev_next, but not really great for reordering */
 	struct obs_scene_item *prev;
 	struct obs_scene_item *next;
+
+	/* nodes of the parent's lookup indexes */
+	struct hash_node id_node;
+	struct hash_node source_node;
 };
 
 struct obs_scene {
@@ -97,4 +101,12 @@ struct obs_scene {
 	pthread_mutex_t video_mutex;
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
+
+	/* lookup indexes of the items, kept in sync with the item list.
+	 * modified with the full lock and index_mutex held, so lookups only
+	 * need index_mutex and never stall rendering */
+	pthread_mutex_t index_mutex;
+	struct hash_table items_by_id;
+	struct hash_table items_by_source;
+	DARRAY(struct obs_scene_item *) groups;
 };
@@ -27,6 +27,7 @@
 #include "callback/calldata.h"
 #include "graphics/matrix3.h"
 #include "graphics/vec3.h"
+#include "graphics/vec4.h"
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -235,7 +236,8 @@ static void obs_source_init_finalize(struct obs_source *source)
 	}
 
 	obs_context_data_insert(&source->context, &obs->data.sources_mutex,
-				&obs->data.first_source);
+				&obs->data.first_source,
+				&obs->data.source_names);
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id,
@@ -572,10 +574,22 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	}
 }
 
+/* frames handed over with obs_source_output_video_external don't own their
+ * planes, they are given back to the source instead */
+static void async_frame_destroy(struct obs_source_frame *frame)
+{
+	if (frame && frame->release) {
+		frame->release(frame->release_param);
+		bfree(frame);
+	} else {
+		obs_source_frame_destroy(frame);
+	}
+}
+
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
@@ -638,6 +652,8 @@ void obs_source_destroy(struct obs_source *source)
 	}
 	if (source->filter_texrender)
 		gs_texrender_destroy(source->filter_texrender);
+	if (source->render_cache)
+		gs_texrender_destroy(source->render_cache);
 	gs_leave_context();
 
 	for (i = 0; i < MAX_AV_PLANES; i++)
@@ -1090,7 +1106,45 @@ static void async_tick(obs_source_t *source)
 			set_async_texture_size(source, source->cur_async_frame);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+static inline bool source_awake(const obs_source_t *source)
+{
+	return source->showing || source->active ||
+	       os_atomic_load_long(&source->show_refs) > 0 ||
+	       os_atomic_load_long(&source->activate_refs) > 0;
+}
+
+static bool async_frames_queued(obs_source_t *source)
+{
+	bool queued;
+
+	pthread_mutex_lock(&source->async_mutex);
+	queued = source->async_frames.num || source->cur_async_frame;
+	pthread_mutex_unlock(&source->async_mutex);
+
+	return queued;
+}
+
+bool obs_source_tick_needed(obs_source_t *source)
+{
+	obs_source_t *parent = source->filter_parent;
+
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		return true;
+	if ((source->info.output_flags & OBS_SOURCE_ALWAYS_TICK) != 0)
+		return true;
+	if (os_atomic_load_long(&source->defer_update_count) > 0)
+		return true;
+	if (source_awake(source) || (parent && source_awake(parent)))
+		return true;
+
+	/* keep the frame queue drained so it doesn't fill up while hidden */
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0)
+		return async_frames_queued(source);
+
+	return false;
+}
+
+void obs_source_video_tick(obs_source_t *source, float seconds, bool call_tick)
 {
 	bool now_showing, now_active;
 
@@ -1158,7 +1212,7 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->active = now_active;
 	}
 
-	if (source->context.data && source->info.video_tick)
+	if (call_tick && source->context.data && source->info.video_tick)
 		source->info.video_tick(source->context.data, seconds);
 
 	source->async_rendered = false;
@@ -2161,6 +2215,123 @@ static const char *get_type_format(enum obs_source_type type)
 }
 #endif
 
+static inline void render_video_direct(obs_source_t *source)
+{
+	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_SOURCE,
+				     get_type_format(source->info.type),
+				     obs_source_get_name(source));
+
+	if (source->filters.num && !source->rendering_filter)
+		obs_source_render_filters(source);
+
+	else if (source->info.video_render)
+		obs_source_main_render(source);
+
+	else if (source->filter_target)
+		obs_source_video_render(source->filter_target);
+
+	else if (deinterlacing_enabled(source))
+		deinterlace_render(source);
+
+	else
+		obs_source_render_async_video(source);
+
+	GS_DEBUG_MARKER_END();
+}
+
+#define RENDER_CACHE_HOLD_FRAMES 8
+
+/* sources that are rendered more than once in a frame (by the preview, the
+ * multiview, projectors or several scenes) are rendered to a texture the
+ * first time, and that texture is drawn the other times.  the result is
+ * premultiplied like scene item textures. */
+static inline bool render_cache_allowed(const obs_source_t *source)
+{
+	return (source->info.type == OBS_SOURCE_TYPE_INPUT ||
+		source->info.type == OBS_SOURCE_TYPE_SCENE) &&
+	       (source->info.video_render || source->filters.num) &&
+	       !source->rendering_filter;
+}
+
+static bool render_cache_update(obs_source_t *source)
+{
+	uint32_t cx = obs_source_get_width(source);
+	uint32_t cy = obs_source_get_height(source);
+	struct vec4 clear_color;
+
+	if (!source->render_cache)
+		source->render_cache = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	if (!gs_texrender_begin(source->render_cache, cx, cy))
+		return false;
+
+	vec4_zero(&clear_color);
+	gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	gs_blend_state_push();
+	gs_reset_blend_state();
+	render_video_direct(source);
+	gs_blend_state_pop();
+
+	gs_texrender_end(source->render_cache);
+	return true;
+}
+
+static bool render_video_cached(obs_source_t *source)
+{
+	struct obs_core_video *video = &obs->video;
+	gs_effect_t *effect = video->default_effect;
+	gs_texture_t *tex;
+
+	/* the cache stays in use for a few frames after the source was last
+	 * rendered more than once in a frame, so that consumers rendering at
+	 * a lower rate (e.g. a rate limited multiview) still get hits */
+	if (source->render_cache_frame != video->render_frame) {
+		uint64_t frames =
+			video->render_frame - source->render_cache_frame;
+
+		if (source->render_count > 1)
+			source->render_cache_hold = RENDER_CACHE_HOLD_FRAMES;
+		source->render_cache_hold =
+			frames < source->render_cache_hold
+				? source->render_cache_hold - (uint32_t)frames
+				: 0;
+
+		source->render_cache_active = source->render_cache_hold > 0;
+		source->render_cache_valid = false;
+		source->render_cache_frame = video->render_frame;
+		source->render_count = 0;
+		gs_texrender_reset(source->render_cache);
+	}
+
+	source->render_count++;
+	if (!source->render_cache_active)
+		return false;
+
+	if (source->render_cache_valid) {
+		video->render_cache_hits++;
+	} else {
+		if (!render_cache_update(source))
+			return false;
+
+		source->render_cache_valid = true;
+		video->render_cache_misses++;
+	}
+
+	tex = gs_texrender_get_texture(source->render_cache);
+	if (!tex)
+		return false;
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	while (gs_effect_loop(effect, "Draw"))
+		obs_source_draw(tex, 0, 0, 0, 0, false);
+
+	gs_blend_state_pop();
+	return true;
+}
+
 static inline void render_video(obs_source_t *source)
 {
 	if (source->info.type != OBS_SOURCE_TYPE_FILTER &&
@@ -2184,26 +2355,10 @@ static inline void render_video(obs_source_t *source)
 		return;
 	}
 
-	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_SOURCE,
-				     get_type_format(source->info.type),
-				     obs_source_get_name(source));
-
-	if (source->filters.num && !source->rendering_filter)
-		obs_source_render_filters(source);
-
-	else if (source->info.video_render)
-		obs_source_main_render(source);
-
-	else if (source->filter_target)
-		obs_source_video_render(source->filter_target);
-
-	else if (deinterlacing_enabled(source))
-		deinterlace_render(source);
-
-	else
-		obs_source_render_async_video(source);
+	if (render_cache_allowed(source) && render_video_cached(source))
+		return;
 
-	GS_DEBUG_MARKER_END();
+	render_video_direct(source);
 }
 
 void obs_source_video_render(obs_source_t *source)
@@ -2718,7 +2873,7 @@ static void clean_cache(obs_source_t *source)
 		struct async_frame *af = &source->async_cache.array[i - 1];
 		if (!af->used) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				async_frame_destroy(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
@@ -2726,34 +2881,47 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *
-cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+
+static inline void update_async_cache_format(struct obs_source *source,
+					     enum video_format format,
+					     uint32_t width, uint32_t height,
+					     bool full_range)
 {
-	struct obs_source_frame *new_frame = NULL;
+	struct obs_source_frame info = {0};
+	info.format = format;
+	info.width = width;
+	info.height = height;
+	info.full_range = full_range;
 
-	pthread_mutex_lock(&source->async_mutex);
+	if (async_texture_changed(source, &info)) {
+		free_async_cache(source);
+		source->async_cache_width = width;
+		source->async_cache_height = height;
+	}
+
+	source->async_cache_format = format;
+	source->async_cache_full_range = full_range;
+}
+
+/* async_mutex must be held.  if the return value is not null, it holds an
+ * extra reference for the caller that gets dropped when it's queued */
+static struct obs_source_frame *
+get_cached_frame(struct obs_source *source, enum video_format format,
+		 uint32_t width, uint32_t height, bool full_range)
+{
+	struct obs_source_frame *new_frame = NULL;
 
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
 		free_async_cache(source);
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
 		return NULL;
 	}
 
-	if (async_texture_changed(source, frame)) {
-		free_async_cache(source);
-		source->async_cache_width = frame->width;
-		source->async_cache_height = frame->height;
-	}
-
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
-	source->async_cache_full_range = frame->full_range;
+	update_async_cache_format(source, format, width, height, full_range);
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!af->used && !af->frame->release) {
 			new_frame = af->frame;
 			new_frame->format = format;
 			af->used = true;
@@ -2767,8 +2935,7 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	if (!new_frame) {
 		struct async_frame new_af;
 
-		new_frame = obs_source_frame_create(format, frame->width,
-						    frame->height);
+		new_frame = obs_source_frame_create(format, width, height);
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
@@ -2777,15 +2944,42 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 		da_push_back(source->async_cache, &new_af);
 	}
 
+	new_frame->full_range = full_range;
 	os_atomic_inc_long(&new_frame->refs);
+	return new_frame;
+}
 
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+static inline struct obs_source_frame *
+cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+	new_frame = get_cached_frame(source, frame->format, frame->width,
+				     frame->height, frame->full_range);
 	pthread_mutex_unlock(&source->async_mutex);
 
-	copy_frame_data(new_frame, frame);
+	if (new_frame)
+		copy_frame_data(new_frame, frame);
 
 	return new_frame;
 }
 
+/* queues a frame returned by get_cached_frame/cache_external_video */
+static void queue_cached_frame(struct obs_source *source,
+			       struct obs_source_frame *output)
+{
+	pthread_mutex_lock(&source->async_mutex);
+	if (os_atomic_dec_long(&output->refs) == 0) {
+		async_frame_destroy(output);
+	} else {
+		da_push_back(source->async_frames, &output);
+		source->async_active = true;
+	}
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
 static void
 obs_source_output_video_internal(obs_source_t *source,
 				 const struct obs_source_frame *frame)
@@ -2798,21 +2992,9 @@ obs_source_output_video_internal(obs_source_t *source,
 		return;
 	}
 
-	struct obs_source_frame *output = !!frame ? cache_video(source, frame)
-						  : NULL;
-
-	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
-	if (output) {
-		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
-			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
-			source->async_active = true;
-		}
-	}
-	pthread_mutex_unlock(&source->async_mutex);
+	struct obs_source_frame *output = cache_video(source, frame);
+	if (output)
+		queue_cached_frame(source, output);
 }
 
 void obs_source_output_video(obs_source_t *source,
@@ -2864,6 +3046,131 @@ void obs_source_output_video2(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+static inline bool external_frame_valid(const struct obs_source_frame *frame)
+{
+	return frame->width && frame->height && frame->data[0];
+}
+
+void obs_source_output_video_external(obs_source_t *source,
+				      const struct obs_source_frame *frame,
+				      void (*release)(void *param),
+				      void *param)
+{
+	struct obs_source_frame *output;
+	struct async_frame new_af;
+
+	if (!release)
+		return;
+	if (!obs_source_valid(source, "obs_source_output_video_external") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video_external") ||
+	    !external_frame_valid(frame)) {
+		release(param);
+		return;
+	}
+
+	output = bzalloc(sizeof(*output));
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		output->data[i] = frame->data[i];
+		output->linesize[i] = frame->linesize[i];
+	}
+
+	output->width = frame->width;
+	output->height = frame->height;
+	output->timestamp = frame->timestamp;
+	output->format = frame->format;
+	output->full_range =
+		format_is_yuv(frame->format) ? frame->full_range : true;
+	output->flip = frame->flip;
+	output->release = release;
+	output->release_param = param;
+
+	memcpy(output->color_matrix, frame->color_matrix,
+	       sizeof(frame->color_matrix));
+	memcpy(output->color_range_min, frame->color_range_min,
+	       sizeof(frame->color_range_min));
+	memcpy(output->color_range_max, frame->color_range_max,
+	       sizeof(frame->color_range_max));
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		free_async_cache(source);
+		source->last_frame_ts = 0;
+		pthread_mutex_unlock(&source->async_mutex);
+
+		async_frame_destroy(output);
+		return;
+	}
+
+	update_async_cache_format(source, output->format, output->width,
+				  output->height, output->full_range);
+	clean_cache(source);
+
+	/* the cache entry is dropped again as soon as the frame is no longer
+	 * in use (see remove_async_frame) */
+	new_af.frame = output;
+	new_af.used = true;
+	new_af.unused_count = 0;
+	output->refs = 1;
+	da_push_back(source->async_cache, &new_af);
+
+	da_push_back(source->async_frames, &output);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+struct obs_source_frame *
+obs_source_get_writable_frame(obs_source_t *source, enum video_format format,
+			      uint32_t width, uint32_t height, bool full_range)
+{
+	struct obs_source_frame *frame;
+
+	if (!obs_source_valid(source, "obs_source_get_writable_frame"))
+		return NULL;
+	if (!width || !height)
+		return NULL;
+
+	if (!format_is_yuv(format))
+		full_range = true;
+
+	pthread_mutex_lock(&source->async_mutex);
+	frame = get_cached_frame(source, format, width, height, full_range);
+	pthread_mutex_unlock(&source->async_mutex);
+
+	if (frame)
+		frame->flip = false;
+
+	return frame;
+}
+
+void obs_source_output_writable_frame(obs_source_t *source,
+				      struct obs_source_frame *frame)
+{
+	if (!obs_source_valid(source, "obs_source_output_writable_frame"))
+		return;
+	if (!obs_ptr_valid(frame, "obs_source_output_writable_frame"))
+		return;
+
+	queue_cached_frame(source, frame);
+}
+
+void obs_source_discard_writable_frame(obs_source_t *source,
+				       struct obs_source_frame *frame)
+{
+	if (!obs_source_valid(source, "obs_source_discard_writable_frame"))
+		return;
+	if (!obs_ptr_valid(frame, "obs_source_discard_writable_frame"))
+		return;
+
+	pthread_mutex_lock(&source->async_mutex);
+	if (os_atomic_dec_long(&frame->refs) == 0)
+		async_frame_destroy(frame);
+	else
+		remove_async_frame(source, frame);
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 {
 	if (source)
@@ -3271,7 +3578,13 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			/* external frames can't be reused, give them back */
+			if (frame->release) {
+				da_erase(source->async_cache, i);
+				obs_source_frame_decref(frame);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
@@ -3422,12 +3735,12 @@ void obs_source_release_frame(obs_source_t *source,
 		return;
 
 	if (!source) {
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			async_frame_destroy(frame);
 		else
 			remove_async_frame(source, frame);
 
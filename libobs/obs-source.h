@@ -186,6 +186,20 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CONTROLLABLE_MEDIA (1 << 13)
 
+/**
+ * Source should be ticked every frame, even while it's neither showing nor
+ * active.  Without this flag video_tick is skipped while the source (or the
+ * source a filter is attached to) isn't shown or active.
+ */
+#define OBS_SOURCE_ALWAYS_TICK (1 << 14)
+
+/**
+ * video_tick doesn't use the graphics subsystem or other sources and can be
+ * called from a worker thread, at the same time as the video_tick of other
+ * sources with this flag.
+ */
+#define OBS_SOURCE_PARALLEL_TICK (1 << 15)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -293,7 +307,8 @@ struct obs_source_info {
 	void (*hide)(void *data);
 
 	/**
-	 * Called each video frame with the time elapsed
+	 * Called each video frame with the time elapsed, while the source is
+	 * showing or active unless OBS_SOURCE_ALWAYS_TICK is set
 	 *
 	 * @param  data     Source data
 	 * @param  seconds  Seconds elapsed since the last frame
@@ -23,15 +23,73 @@
 #include "graphics/vec4.h"
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
+#include "media-io/video-convert.h"
 
 #ifdef _WIN32
 #define WIN32_MEAN_AND_LEAN
 #include <windows.h>
 #endif
 
+struct tick_chunk {
+	struct obs_source *const *sources;
+	size_t num;
+	float seconds;
+};
+
+static const char *parallel_tick_name = "parallel_tick";
+static void parallel_tick(void *param)
+{
+	struct tick_chunk *chunk = param;
+
+	profile_start(parallel_tick_name);
+
+	for (size_t i = 0; i < chunk->num; i++) {
+		struct obs_source *source = chunk->sources[i];
+
+		profile_start(source->profile_tick_name);
+		source->info.video_tick(source->context.data, chunk->seconds);
+		profile_end(source->profile_tick_name);
+	}
+
+	profile_end(parallel_tick_name);
+}
+
+/* calls the video_tick callbacks of the sources with OBS_SOURCE_PARALLEL_TICK,
+ * split into one chunk per thread */
+static void tick_parallel_sources(struct obs_core_video *video, float seconds)
+{
+	struct tick_chunk chunks[MAX_TICK_THREADS];
+	size_t num = video->parallel_tick_sources.num;
+	size_t num_chunks = 1;
+	size_t start = 0;
+
+	if (!num)
+		return;
+
+	if (video->tick_pool)
+		num_chunks = os_task_pool_num_threads(video->tick_pool) + 1;
+	if (num_chunks > MAX_TICK_THREADS)
+		num_chunks = MAX_TICK_THREADS;
+	if (num_chunks > num)
+		num_chunks = num;
+
+	for (size_t i = 0; i < num_chunks; i++) {
+		size_t end = num * (i + 1) / num_chunks;
+
+		chunks[i].sources = video->parallel_tick_sources.array + start;
+		chunks[i].num = end - start;
+		chunks[i].seconds = seconds;
+		start = end;
+	}
+
+	os_task_pool_run(num_chunks > 1 ? video->tick_pool : NULL,
+			 parallel_tick, chunks, sizeof(chunks[0]), num_chunks);
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
+	struct obs_core_video *video = &obs->video;
 	struct obs_source *source;
 	uint64_t delta_time;
 	float seconds;
@@ -43,6 +101,9 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	delta_time = cur_time - last_time;
 	seconds = (float)((double)delta_time / 1000000000.0);
 
+	/* invalidates the render caches of the last frame */
+	video->render_frame++;
+
 	/* ------------------------------------- */
 	/* call tick callbacks                   */
 
@@ -64,28 +125,64 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	source = data->first_source;
 	while (source) {
 		struct obs_source *cur_source = obs_source_get_ref(source);
+		bool parallel;
+
 		source = (struct obs_source *)source->context.next;
 
-		if (cur_source) {
-			obs_source_video_tick(cur_source, seconds);
+		if (!cur_source)
+			continue;
+
+		/* dormant sources are skipped entirely */
+		if (!obs_source_tick_needed(cur_source)) {
 			obs_source_release(cur_source);
+			continue;
 		}
+
+		if (!cur_source->profile_tick_name)
+			cur_source->profile_tick_name = profile_store_name(
+				obs_get_profiler_name_store(), "video_tick(%s)",
+				cur_source->context.name);
+
+		/* callbacks that can run off the graphics thread are called
+		 * on the tick pool once everything else has been ticked, the
+		 * reference is kept until then */
+		parallel = cur_source->context.data &&
+			   cur_source->info.video_tick &&
+			   (cur_source->info.output_flags &
+			    OBS_SOURCE_PARALLEL_TICK) != 0;
+
+		profile_start(cur_source->profile_tick_name);
+		obs_source_video_tick(cur_source, seconds, !parallel);
+		profile_end(cur_source->profile_tick_name);
+
+		if (parallel)
+			da_push_back(video->parallel_tick_sources, &cur_source);
+		else
+			obs_source_release(cur_source);
 	}
 
+	tick_parallel_sources(video, seconds);
+
+	for (size_t i = 0; i < video->parallel_tick_sources.num; i++)
+		obs_source_release(video->parallel_tick_sources.array[i]);
+	da_resize(video->parallel_tick_sources, 0);
+
 	pthread_mutex_unlock(&data->sources_mutex);
 
 	return cur_time;
 }
 
 /* in obs-display.c */
-extern void render_display(struct obs_display *display);
+extern bool render_display(struct obs_display *display, bool late);
 
-static inline void render_displays(void)
+/* returns true if any display was rendered */
+static inline bool render_displays(bool late)
 {
 	struct obs_display *display;
+	bool rendered = false;
 
 	if (!obs->data.valid)
-		return;
+		return false;
 
 	gs_enter_context(obs->video.graphics);
 
@@ -94,13 +191,15 @@ static inline void render_displays(void)
 
 	display = obs->data.first_display;
 	while (display) {
-		render_display(display);
+		if (render_display(display, late))
+			rendered = true;
 		display = display->next;
 	}
 
 	pthread_mutex_unlock(&obs->data.displays_mutex);
 
 	gs_leave_context();
+	return rendered;
 }
 
 static inline void set_render_size(uint32_t width, uint32_t height)
@@ -533,133 +632,32 @@ static inline bool download_frame(struct obs_core_video *video,
 	return true;
 }
 
-static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
-					      uint32_t linesize_input,
-					      uint32_t linesize_output,
-					      const uint8_t *in, uint8_t *out)
-{
-	if ((width == linesize_input) && (width == linesize_output)) {
-		size_t total = (size_t)width * (size_t)height;
-		memcpy(out, in, total);
-		in += total;
-	} else {
-		for (size_t y = 0; y < height; y++) {
-			memcpy(out, in, width);
-			out += linesize_output;
-			in += linesize_input;
-		}
-	}
-
-	return in;
-}
-
 static void set_gpu_converted_data(struct obs_core_video *video,
 				   struct video_frame *output,
 				   const struct video_data *input,
 				   const struct video_output_info *info)
 {
 	if (video->using_nv12_tex) {
-		const uint32_t width = info->width;
-		const uint32_t height = info->height;
-
-		const uint8_t *const in_uv = set_gpu_converted_plane(
-			width, height, input->linesize[0], output->linesize[0],
-			input->data[0], output->data[0]);
-
-		const uint32_t height_d2 = height / 2;
-		set_gpu_converted_plane(width, height_d2, input->linesize[0],
-					output->linesize[1], in_uv,
-					output->data[1]);
+		/* both planes are in one surface, with the linesize of the
+		 * luma plane */
+		const uint32_t linesize = input->linesize[0];
+		const uint8_t *const in_planes[MAX_AV_PLANES] = {
+			input->data[0],
+			input->data[0] + (size_t)linesize * info->height};
+		const uint32_t in_linesize[MAX_AV_PLANES] = {linesize,
+							     linesize};
+
+		video_convert(output->data, output->linesize,
+			      VIDEO_FORMAT_NV12, in_planes, in_linesize,
+			      VIDEO_FORMAT_NV12, info->width, info->height);
 	} else {
-		switch (info->format) {
-		case VIDEO_FORMAT_I420: {
-			const uint32_t width = info->width;
-			const uint32_t height = info->height;
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[0],
-						output->linesize[0],
-						input->data[0],
-						output->data[0]);
-
-			const uint32_t width_d2 = width / 2;
-			const uint32_t height_d2 = height / 2;
-
-			set_gpu_converted_plane(width_d2, height_d2,
-						input->linesize[1],
-						output->linesize[1],
-						input->data[1],
-						output->data[1]);
-
-			set_gpu_converted_plane(width_d2, height_d2,
-						input->linesize[2],
-						output->linesize[2],
-						input->data[2],
-						output->data[2]);
-
-			break;
-		}
-		case VIDEO_FORMAT_NV12: {
-			const uint32_t width = info->width;
-			const uint32_t height = info->height;
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[0],
-						output->linesize[0],
-						input->data[0],
-						output->data[0]);
-
-			const uint32_t height_d2 = height / 2;
-			set_gpu_converted_plane(width, height_d2,
-						input->linesize[1],
-						output->linesize[1],
-						input->data[1],
-						output->data[1]);
-
-			break;
-		}
-		case VIDEO_FORMAT_I444: {
-			const uint32_t width = info->width;
-			const uint32_t height = info->height;
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[0],
-						output->linesize[0],
-						input->data[0],
-						output->data[0]);
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[1],
-						output->linesize[1],
-						input->data[1],
-						output->data[1]);
-
-			set_gpu_converted_plane(width, height,
-						input->linesize[2],
-						output->linesize[2],
-						input->data[2],
-						output->data[2]);
-
-			break;
-		}
-
-		case VIDEO_FORMAT_NONE:
-		case VIDEO_FORMAT_YVYU:
-		case VIDEO_FORMAT_YUY2:
-		case VIDEO_FORMAT_UYVY:
-		case VIDEO_FORMAT_RGBA:
-		case VIDEO_FORMAT_BGRA:
-		case VIDEO_FORMAT_BGRX:
-		case VIDEO_FORMAT_Y800:
-		case VIDEO_FORMAT_BGR3:
-		case VIDEO_FORMAT_I422:
-		case VIDEO_FORMAT_I40A:
-		case VIDEO_FORMAT_I42A:
-		case VIDEO_FORMAT_YUVA:
-		case VIDEO_FORMAT_AYUV:
-			/* unimplemented */
-			;
-		}
+		/* the surfaces are already in the output format, formats
+		 * that video_convert can't copy are never converted on the
+		 * GPU */
+		video_convert(output->data, output->linesize, info->format,
+			      (const uint8_t *const *)input->data,
+			      input->linesize, info->format, info->width,
+			      info->height);
 	}
 }
 
@@ -927,7 +925,9 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	const bool stop_requested = video_output_stopped(obs->video.video);
 
 	uint64_t frame_start = os_gettime_ns();
+	uint64_t output_end;
 	uint64_t frame_time_ns;
+	bool late;
 	bool raw_active = obs->video.raw_active > 0;
 #ifdef _WIN32
 	const bool gpu_active = obs->video.gpu_encoder_active > 0;
@@ -975,11 +975,21 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	output_frame(raw_active, gpu_active);
 	profile_end(output_frame_name);
 
+	/* displays come after the output frame and only get the time that is
+	 * left of the frame, so that they are skipped before frames lag */
+	output_end = os_gettime_ns();
+	late = output_end - frame_start + context->last_display_time_ns >
+	       context->interval;
+
 	profile_start(render_displays_name);
-	render_displays();
+	if (render_displays(late))
+		context->last_display_time_ns = os_gettime_ns() - output_end;
 	profile_end(render_displays_name);
 
 	frame_time_ns = os_gettime_ns() - frame_start;
+	context->output_time_total_ns += output_end - frame_start;
+	context->display_time_total_ns +=
+		frame_time_ns - (output_end - frame_start);
 
 	profile_end(context->video_thread_name);
 
@@ -999,8 +1009,16 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 		obs->video.video_avg_frame_time_ns =
 			context->frame_time_total_ns /
 			(uint64_t)context->fps_total_frames;
+		obs->video.output_avg_render_time_ns =
+			context->output_time_total_ns /
+			(uint64_t)context->fps_total_frames;
+		obs->video.display_avg_render_time_ns =
+			context->display_time_total_ns /
+			(uint64_t)context->fps_total_frames;
 
 		context->frame_time_total_ns = 0;
+		context->output_time_total_ns = 0;
+		context->display_time_total_ns = 0;
 		context->fps_total_ns = 0;
 		context->fps_total_frames = 0;
 	}
@@ -1034,6 +1052,9 @@ void *obs_graphics_thread(void *param)
 	struct obs_graphics_context context;
 	context.interval = video_output_get_frame_time(obs->video.video);
 	context.frame_time_total_ns = 0;
+	context.output_time_total_ns = 0;
+	context.display_time_total_ns = 0;
+	context.last_display_time_ns = 0;
 	context.fps_total_ns = 0;
 	context.fps_total_frames = 0;
 	context.last_time = 0;
@@ -18,7 +18,10 @@
 #include <inttypes.h>
 
 #include "graphics/matrix4.h"
+#include "graphics/image-cache.h"
 #include "callback/calldata.h"
+#include "media-io/audio-mix.h"
+#include "media-io/video-convert.h"
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -387,6 +390,7 @@ static int obs_init_video(struct obs_video_info *ovi)
 	struct obs_core_video *video = &obs->video;
 	struct video_output_info vi;
 	pthread_mutexattr_t attr;
+	int tick_threads;
 	int errorcode;
 
 	make_video_info(&vi, ovi);
@@ -411,6 +415,9 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 	}
 
+	video_output_set_parallel_inputs(video->video,
+					 video->parallel_encoders);
+
 	gs_enter_context(video->graphics);
 
 	if (ovi->gpu_conversion && !obs_init_gpu_conversion(ovi))
@@ -429,6 +436,14 @@ static int obs_init_video(struct obs_video_info *ovi)
 	if (pthread_mutex_init(&video->task_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
 
+	/* the graphics thread takes a share of the ticks as well */
+	tick_threads = os_get_logical_cores();
+	if (tick_threads > MAX_TICK_THREADS)
+		tick_threads = MAX_TICK_THREADS;
+	if (tick_threads > 1)
+		video->tick_pool = os_task_pool_create(
+			"libobs: source tick", (size_t)tick_threads - 1);
+
 #ifdef __APPLE__
 	errorcode = pthread_create(&video->video_thread, NULL,
 				   obs_graphics_thread_autorelease, obs);
@@ -530,6 +545,10 @@ static void obs_free_video(void)
 		pthread_mutex_init_value(&video->task_mutex);
 		circlebuf_free(&video->tasks);
 
+		os_task_pool_destroy(video->tick_pool);
+		video->tick_pool = NULL;
+		da_free(video->parallel_tick_sources);
+
 		video->gpu_encoder_active = 0;
 		video->cur_texture = 0;
 	}
@@ -645,6 +664,7 @@ static bool obs_init_data(void)
 		goto fail;
 	if (!obs_view_init(&data->main_view))
 		goto fail;
+	obs_packet_pool_init();
 
 	data->private_data = obs_data_create();
 	data->valid = true;
@@ -701,9 +721,14 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->encoders_mutex);
 	pthread_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
+	hash_table_free(&data->source_names);
+	hash_table_free(&data->output_names);
+	hash_table_free(&data->encoder_names);
+	hash_table_free(&data->service_names);
 	da_free(data->draw_callbacks);
 	da_free(data->tick_callbacks);
 	obs_data_release(data->private_data);
+	obs_packet_pool_free();
 }
 
 static const char *obs_signals[] = {
@@ -1038,7 +1063,9 @@ void obs_shutdown(void)
 
 	obs_free_audio();
 	obs_free_data();
+	gs_image_cache_free();
 	obs_free_video();
+	video_convert_free_pool();
 	obs_free_hotkeys();
 	obs_free_graphics();
 	proc_handler_destroy(obs->procs);
@@ -1176,11 +1203,13 @@ int obs_reset_video(struct obs_video_info *ovi)
 	     "\tdownscale filter:  %s\n"
 	     "\tfps:               %d/%d\n"
 	     "\tformat:            %s\n"
-	     "\tYUV mode:          %s%s%s",
+	     "\tYUV mode:          %s%s%s\n"
+	     "\tconvert kernels:   %s",
 	     ovi->base_width, ovi->base_height, ovi->output_width,
 	     ovi->output_height, scale_type_name, ovi->fps_num, ovi->fps_den,
 	     get_video_format_name(ovi->output_format),
-	     yuv ? yuv_format : "None", yuv ? "/" : "", yuv ? yuv_range : "");
+	     yuv ? yuv_format : "None", yuv ? "/" : "", yuv ? yuv_range : "",
+	     video_convert_get_kernel_name());
 
 	return obs_init_video(ovi);
 }
@@ -1207,8 +1236,10 @@ bool obs_reset_audio(const struct obs_audio_info *oai)
 	blog(LOG_INFO,
 	     "audio settings reset:\n"
 	     "\tsamples per sec: %d\n"
-	     "\tspeakers:        %d",
-	     (int)ai.samples_per_sec, (int)ai.speakers);
+	     "\tspeakers:        %d\n"
+	     "\tmixing kernels:  %s",
+	     (int)ai.samples_per_sec, (int)ai.speakers,
+	     audio_mix_get_kernel_name());
 
 	return obs_init_audio(&ai);
 }
@@ -1544,22 +1575,30 @@ void obs_enum_services(bool (*enum_proc)(void *, obs_service_t *), void *param)
 		 param);
 }
 
-static inline void *get_context_by_name(void *vfirst, const char *name,
+static inline void *get_context_by_name(struct hash_table *names,
+					const char *name,
 					pthread_mutex_t *mutex,
 					void *(*addref)(void *))
 {
-	struct obs_context_data **first = vfirst;
-	struct obs_context_data *context;
+	struct obs_context_data *context = NULL;
+	struct hash_node *node;
+
+	if (!name)
+		return NULL;
 
 	pthread_mutex_lock(mutex);
 
-	context = *first;
-	while (context) {
-		if (!context->private && strcmp(context->name, name) == 0) {
-			context = addref(context);
-			break;
+	node = hash_table_first(names, hash_str(name));
+	while (node) {
+		struct obs_context_data *cur = hash_entry(
+			node, struct obs_context_data, name_node);
+
+		if (!cur->private && strcmp(cur->name, name) == 0) {
+			context = addref(cur);
+			if (context)
+				break;
 		}
-		context = context->next;
+		node = hash_table_next(node);
 	}
 
 	pthread_mutex_unlock(mutex);
@@ -1591,30 +1630,55 @@ static inline void *obs_id_(void *data)
 	return data;
 }
 
+size_t obs_find_sources_by_name(const char *name, obs_source_t **sources,
+				size_t max)
+{
+	struct hash_node *node;
+	size_t count = 0;
+
+	if (!name)
+		return 0;
+
+	pthread_mutex_lock(&obs->data.sources_mutex);
+
+	node = hash_table_first(&obs->data.source_names, hash_str(name));
+	while (node && count < max) {
+		struct obs_source *source =
+			hash_entry(node, struct obs_source, context.name_node);
+
+		if (strcmp(source->context.name, name) == 0)
+			sources[count++] = source;
+		node = hash_table_next(node);
+	}
+
+	pthread_mutex_unlock(&obs->data.sources_mutex);
+	return count;
+}
+
 obs_source_t *obs_get_source_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_source, name,
+	return get_context_by_name(&obs->data.source_names, name,
 				   &obs->data.sources_mutex,
 				   obs_source_addref_safe_);
 }
 
 obs_output_t *obs_get_output_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_output, name,
+	return get_context_by_name(&obs->data.output_names, name,
 				   &obs->data.outputs_mutex,
 				   obs_output_addref_safe_);
 }
 
 obs_encoder_t *obs_get_encoder_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_encoder, name,
+	return get_context_by_name(&obs->data.encoder_names, name,
 				   &obs->data.encoders_mutex,
 				   obs_encoder_addref_safe_);
 }
 
 obs_service_t *obs_get_service_by_name(const char *name)
 {
-	return get_context_by_name(&obs->data.first_service, name,
+	return get_context_by_name(&obs->data.service_names, name,
 				   &obs->data.services_mutex,
 				   obs_service_addref_safe_);
 }
@@ -1737,7 +1801,110 @@ float obs_get_master_volume(void)
 	return obs->audio.user_volume;
 }
 
-static obs_source_t *obs_load_source_type(obs_data_t *source_data)
+struct load_type_stats {
+	char *id;
+	size_t count;
+	uint64_t create_ns;
+	uint64_t max_create_ns;
+	uint64_t load_ns;
+};
+
+struct load_stats {
+	pthread_mutex_t mutex;
+	DARRAY(struct load_type_stats) types;
+};
+
+static inline void load_stats_init(struct load_stats *stats)
+{
+	pthread_mutex_init_value(&stats->mutex);
+	pthread_mutex_init(&stats->mutex, NULL);
+	da_init(stats->types);
+}
+
+static inline void load_stats_free(struct load_stats *stats)
+{
+	for (size_t i = 0; i < stats->types.num; i++)
+		bfree(stats->types.array[i].id);
+	da_free(stats->types);
+	pthread_mutex_destroy(&stats->mutex);
+}
+
+static struct load_type_stats *get_type_stats(struct load_stats *stats,
+					      const char *id)
+{
+	struct load_type_stats *type;
+
+	for (size_t i = 0; i < stats->types.num; i++) {
+		type = &stats->types.array[i];
+		if (strcmp(type->id, id) == 0)
+			return type;
+	}
+
+	type = da_push_back_new(stats->types);
+	type->id = bstrdup(id);
+	return type;
+}
+
+static void load_stats_add(struct load_stats *stats, const char *id,
+			   uint64_t create_ns, uint64_t load_ns)
+{
+	struct load_type_stats *type;
+
+	if (!stats)
+		return;
+
+	pthread_mutex_lock(&stats->mutex);
+	type = get_type_stats(stats, id);
+	if (create_ns) {
+		type->count++;
+		type->create_ns += create_ns;
+		if (create_ns > type->max_create_ns)
+			type->max_create_ns = create_ns;
+	}
+	type->load_ns += load_ns;
+	pthread_mutex_unlock(&stats->mutex);
+}
+
+static int cmp_type_stats(const void *a, const void *b)
+{
+	const struct load_type_stats *type_a = a;
+	const struct load_type_stats *type_b = b;
+	uint64_t total_a = type_a->create_ns + type_a->load_ns;
+	uint64_t total_b = type_b->create_ns + type_b->load_ns;
+
+	return total_a < total_b ? 1 : (total_a > total_b ? -1 : 0);
+}
+
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+static void load_stats_log(struct load_stats *stats, size_t count,
+			   uint64_t total_ns, size_t threads)
+{
+	if (!count)
+		return;
+
+	qsort(stats->types.array, stats->types.num,
+	      sizeof(struct load_type_stats), cmp_type_stats);
+
+	blog(LOG_INFO, "Loaded %d sources in %.1f ms (%d thread%s)",
+	     (int)count, ns_to_ms(total_ns), (int)threads,
+	     threads == 1 ? "" : "s");
+	blog(LOG_INFO, "    %-32s %6s %12s %10s %10s", "type", "count",
+	     "create (ms)", "max (ms)", "load (ms)");
+
+	for (size_t i = 0; i < stats->types.num; i++) {
+		struct load_type_stats *type = &stats->types.array[i];
+		blog(LOG_INFO, "    %-32s %6d %12.1f %10.1f %10.1f", type->id,
+		     (int)type->count, ns_to_ms(type->create_ns),
+		     ns_to_ms(type->max_create_ns), ns_to_ms(type->load_ns));
+	}
+}
+
+static obs_source_t *obs_load_source_type(obs_data_t *source_data,
+					  struct load_stats *stats)
 {
 	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
 	obs_source_t *source;
@@ -1756,14 +1923,18 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 	int di_order;
 	int di_mode;
 	int monitoring_type;
+	uint64_t start_time;
 
 	prev_ver = (uint32_t)obs_data_get_int(source_data, "prev_ver");
 
 	if (!*v_id)
 		v_id = id;
 
+	start_time = os_gettime_ns();
 	source = obs_source_create_set_last_ver(v_id, name, settings, hotkeys,
 						prev_ver);
+	load_stats_add(stats, v_id, os_gettime_ns() - start_time, 0);
+
 	if (source->owns_info_id) {
 		bfree((void *)source->info.unversioned_id);
 		source->info.unversioned_id = bstrdup(id);
@@ -1851,7 +2022,7 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 				obs_data_array_item(filters, i);
 
 			obs_source_t *filter =
-				obs_load_source_type(filter_data);
+				obs_load_source_type(filter_data, stats);
 			if (filter) {
 				obs_source_filter_add(source, filter);
 				obs_source_release(filter);
@@ -1870,7 +2041,40 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 
 obs_source_t *obs_load_source(obs_data_t *source_data)
 {
-	return obs_load_source_type(source_data);
+	return obs_load_source_type(source_data, NULL);
+}
+
+static void load_source_data(obs_data_array_t *array, obs_source_t **sources,
+			     size_t count, obs_load_source_cb cb,
+			     void *private_data, struct load_stats *stats)
+{
+	/* tell sources that we want to load */
+	for (size_t i = 0; i < count; i++) {
+		obs_source_t *source = sources[i];
+		obs_data_t *source_data = obs_data_array_item(array, i);
+		if (source) {
+			uint64_t start_time = os_gettime_ns();
+
+			if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+				obs_transition_load(source, source_data);
+			obs_source_load(source);
+			load_stats_add(stats, source->info.id, 0,
+				       os_gettime_ns() - start_time);
+
+			for (size_t i = source->filters.num; i > 0; i--) {
+				obs_source_t *filter =
+					source->filters.array[i - 1];
+
+				start_time = os_gettime_ns();
+				obs_source_load(filter);
+				load_stats_add(stats, filter->info.id, 0,
+					       os_gettime_ns() - start_time);
+			}
+			if (cb)
+				cb(private_data, source);
+		}
+		obs_data_release(source_data);
+	}
 }
 
 void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
@@ -1878,10 +2082,13 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 {
 	struct obs_core_data *data = &obs->data;
 	DARRAY(obs_source_t *) sources;
+	struct load_stats stats;
+	uint64_t start_time = os_gettime_ns();
 	size_t count;
 	size_t i;
 
 	da_init(sources);
+	load_stats_init(&stats);
 
 	count = obs_data_array_count(array);
 	da_reserve(sources, count);
@@ -1890,40 +2097,443 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 
 	for (i = 0; i < count; i++) {
 		obs_data_t *source_data = obs_data_array_item(array, i);
-		obs_source_t *source = obs_load_source(source_data);
+		obs_source_t *source =
+			obs_load_source_type(source_data, &stats);
 
 		da_push_back(sources, &source);
 
 		obs_data_release(source_data);
 	}
 
-	/* tell sources that we want to load */
-	for (i = 0; i < sources.num; i++) {
-		obs_source_t *source = sources.array[i];
-		obs_data_t *source_data = obs_data_array_item(array, i);
-		if (source) {
-			if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
-				obs_transition_load(source, source_data);
-			obs_source_load(source);
-			for (size_t i = source->filters.num; i > 0; i--) {
-				obs_source_t *filter =
-					source->filters.array[i - 1];
-				obs_source_load(filter);
-			}
-			if (cb)
-				cb(private_data, source);
-		}
-		obs_data_release(source_data);
-	}
+	load_source_data(array, sources.array, sources.num, cb, private_data,
+			 &stats);
 
 	for (i = 0; i < sources.num; i++)
 		obs_source_release(sources.array[i]);
 
 	pthread_mutex_unlock(&data->sources_mutex);
 
+	load_stats_log(&stats, count, os_gettime_ns() - start_time, 1);
+	load_stats_free(&stats);
 	da_free(sources);
 }
 
+#define MAX_LOAD_THREADS 8
+
+struct load_node {
+	obs_data_t *data;
+	obs_source_t *source;
+	const char *name;
+	struct hash_node name_node;
+	DARRAY(size_t) dependents;
+	size_t deps;
+	bool input;
+	bool pooled;
+};
+
+struct source_loader {
+	struct load_node *nodes;
+	size_t count;
+	struct hash_table names;
+	struct load_stats *stats;
+
+	pthread_mutex_t mutex;
+	os_sem_t *ready_sem;
+	struct circlebuf ready;
+	size_t remaining;
+	size_t threads;
+};
+
+static struct load_node *find_load_node(struct source_loader *loader,
+					const char *name)
+{
+	struct hash_node *node = hash_table_first(&loader->names,
+						  hash_str(name));
+
+	while (node) {
+		struct load_node *load_node =
+			hash_entry(node, struct load_node, name_node);
+		if (strcmp(load_node->name, name) == 0)
+			return load_node;
+		node = hash_table_next(node);
+	}
+
+	return NULL;
+}
+
+static void add_load_dependency(struct source_loader *loader, size_t idx,
+				const char *name)
+{
+	struct load_node *dep = find_load_node(loader, name);
+	size_t num;
+
+	if (!dep || dep == &loader->nodes[idx])
+		return;
+
+	/* nodes are walked in order, so a repeated reference can only be
+	 * the last one added */
+	num = dep->dependents.num;
+	if (num && dep->dependents.array[num - 1] == idx)
+		return;
+
+	da_push_back(dep->dependents, &idx);
+	loader->nodes[idx].deps++;
+}
+
+static void add_array_dependencies(struct source_loader *loader, size_t idx,
+				   obs_data_array_t *array);
+
+/* any string in the settings that names another input is treated as a
+ * reference to it, which is what sources that look up other sources by name
+ * (masks, mirrors, audio captures of other sources) store */
+static void add_dependencies(struct source_loader *loader, size_t idx,
+			     obs_data_t *data)
+{
+	obs_data_item_t *item;
+
+	if (!data)
+		return;
+
+	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
+		enum obs_data_type type = obs_data_item_gettype(item);
+
+		if (type == OBS_DATA_STRING) {
+			add_load_dependency(loader, idx,
+					    obs_data_item_get_string(item));
+
+		} else if (type == OBS_DATA_OBJECT) {
+			obs_data_t *obj = obs_data_item_get_obj(item);
+			add_dependencies(loader, idx, obj);
+			obs_data_release(obj);
+
+		} else if (type == OBS_DATA_ARRAY) {
+			obs_data_array_t *array =
+				obs_data_item_get_array(item);
+			add_array_dependencies(loader, idx, array);
+			obs_data_array_release(array);
+		}
+	}
+}
+
+static void add_array_dependencies(struct source_loader *loader, size_t idx,
+				   obs_data_array_t *array)
+{
+	size_t count = obs_data_array_count(array);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *obj = obs_data_array_item(array, i);
+		add_dependencies(loader, idx, obj);
+		obs_data_release(obj);
+	}
+}
+
+static void add_source_dependencies(struct source_loader *loader, size_t idx)
+{
+	obs_data_t *source_data = loader->nodes[idx].data;
+	obs_data_t *settings = obs_data_get_obj(source_data, "settings");
+	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
+	size_t count = obs_data_array_count(filters);
+
+	add_dependencies(loader, idx, settings);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *filter_data = obs_data_array_item(filters, i);
+		obs_data_t *filter_settings =
+			obs_data_get_obj(filter_data, "settings");
+
+		add_dependencies(loader, idx, filter_settings);
+
+		obs_data_release(filter_settings);
+		obs_data_release(filter_data);
+	}
+
+	obs_data_array_release(filters);
+	obs_data_release(settings);
+}
+
+/* only inputs are created on the pool.  scenes and groups are cheap, and
+ * the frontend waits on its own thread when one is created, transitions
+ * create sources of their own */
+static bool can_pool_source(obs_data_t *source_data)
+{
+	const char *id = obs_data_get_string(source_data, "versioned_id");
+	const struct obs_source_info *info;
+
+	if (!*id)
+		id = obs_data_get_string(source_data, "id");
+
+	info = get_source_info(id);
+	return info && info->type == OBS_SOURCE_TYPE_INPUT;
+}
+
+/* inputs that are part of a reference cycle (or depend on one) can't be
+ * ordered and are created on the calling thread once the pool is done */
+static void exclude_cycles(struct source_loader *loader)
+{
+	size_t *deps = bmalloc(sizeof(size_t) * loader->count);
+	size_t *queue = bmalloc(sizeof(size_t) * loader->count);
+	bool *reached = bzalloc(sizeof(bool) * loader->count);
+	size_t head = 0;
+	size_t tail = 0;
+
+	for (size_t i = 0; i < loader->count; i++) {
+		deps[i] = loader->nodes[i].deps;
+		if (loader->nodes[i].pooled && !deps[i])
+			queue[tail++] = i;
+	}
+
+	while (head < tail) {
+		struct load_node *node = &loader->nodes[queue[head]];
+
+		reached[queue[head++]] = true;
+
+		for (size_t i = 0; i < node->dependents.num; i++) {
+			size_t idx = node->dependents.array[i];
+			if (--deps[idx] == 0)
+				queue[tail++] = idx;
+		}
+	}
+
+	for (size_t i = 0; i < loader->count; i++) {
+		struct load_node *node = &loader->nodes[i];
+		if (node->pooled && !reached[i]) {
+			blog(LOG_DEBUG, "Source '%s' has a circular reference, "
+					"creating it after the others",
+			     node->name);
+			node->pooled = false;
+		}
+	}
+
+	bfree(reached);
+	bfree(queue);
+	bfree(deps);
+}
+
+static void push_ready_node(struct source_loader *loader, size_t idx)
+{
+	circlebuf_push_back(&loader->ready, &idx, sizeof(idx));
+	os_sem_post(loader->ready_sem);
+}
+
+static void run_source_loader(struct source_loader *loader)
+{
+	while (os_sem_wait(loader->ready_sem) == 0) {
+		struct load_node *node;
+		size_t idx;
+
+		pthread_mutex_lock(&loader->mutex);
+
+		/* an empty queue means everything has been created */
+		if (!loader->ready.size) {
+			pthread_mutex_unlock(&loader->mutex);
+			break;
+		}
+
+		circlebuf_pop_front(&loader->ready, &idx, sizeof(idx));
+		pthread_mutex_unlock(&loader->mutex);
+
+		node = &loader->nodes[idx];
+		node->source = obs_load_source_type(node->data, loader->stats);
+
+		pthread_mutex_lock(&loader->mutex);
+
+		for (size_t i = 0; i < node->dependents.num; i++) {
+			size_t dep_idx = node->dependents.array[i];
+			if (--loader->nodes[dep_idx].deps == 0)
+				push_ready_node(loader, dep_idx);
+		}
+
+		if (--loader->remaining == 0) {
+			for (size_t i = 0; i < loader->threads; i++)
+				os_sem_post(loader->ready_sem);
+		}
+
+		pthread_mutex_unlock(&loader->mutex);
+	}
+}
+
+static void *source_loader_thread(void *param)
+{
+	os_set_thread_name("libobs: source loader");
+	run_source_loader(param);
+	return NULL;
+}
+
+static size_t run_source_pool(struct source_loader *loader)
+{
+	pthread_t threads[MAX_LOAD_THREADS - 1];
+	size_t num_threads = 0;
+	size_t max_threads = (size_t)os_get_logical_cores();
+
+	if (max_threads < 1)
+		max_threads = 1;
+	if (max_threads > MAX_LOAD_THREADS)
+		max_threads = MAX_LOAD_THREADS;
+	if (max_threads > loader->remaining)
+		max_threads = loader->remaining;
+
+	if (pthread_mutex_init(&loader->mutex, NULL) != 0)
+		return 0;
+	if (os_sem_init(&loader->ready_sem, 0) != 0) {
+		pthread_mutex_destroy(&loader->mutex);
+		return 0;
+	}
+
+	for (size_t i = 0; i < loader->count; i++) {
+		if (loader->nodes[i].pooled && !loader->nodes[i].deps)
+			push_ready_node(loader, i);
+	}
+
+	/* the calling thread takes part as well, and has to be counted
+	 * before any thread can finish the last source */
+	loader->threads = max_threads;
+
+	while (num_threads + 1 < max_threads) {
+		if (pthread_create(&threads[num_threads], NULL,
+				   source_loader_thread, loader) != 0) {
+			pthread_mutex_lock(&loader->mutex);
+			loader->threads = num_threads + 1;
+			pthread_mutex_unlock(&loader->mutex);
+			break;
+		}
+		num_threads++;
+	}
+
+	run_source_loader(loader);
+
+	for (size_t i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	circlebuf_free(&loader->ready);
+	os_sem_destroy(loader->ready_sem);
+	pthread_mutex_destroy(&loader->mutex);
+	return num_threads + 1;
+}
+
+/* moves a source to the front of the source list, so the list ends up in the
+ * same order as when everything is created serially */
+static void relink_source(struct obs_core_data *data, obs_source_t *source)
+{
+	struct obs_context_data **first =
+		(struct obs_context_data **)&data->first_source;
+	struct obs_context_data *context = &source->context;
+
+	if (!context->mutex)
+		return;
+
+	*context->prev_next = context->next;
+	if (context->next)
+		context->next->prev_next = context->prev_next;
+
+	context->prev_next = first;
+	context->next = *first;
+	*first = context;
+	if (context->next)
+		context->next->prev_next = &context->next;
+}
+
+void obs_load_sources_parallel(obs_data_array_t *array, obs_load_source_cb cb,
+			       void *private_data)
+{
+	struct obs_core_data *data = &obs->data;
+	struct source_loader loader = {0};
+	struct load_stats stats;
+	uint64_t start_time = os_gettime_ns();
+	obs_source_t **sources;
+	size_t threads = 1;
+	size_t i;
+
+	loader.count = obs_data_array_count(array);
+	loader.nodes = bzalloc(sizeof(struct load_node) * loader.count);
+	loader.stats = &stats;
+	load_stats_init(&stats);
+
+	for (i = 0; i < loader.count; i++) {
+		struct load_node *node = &loader.nodes[i];
+
+		node->data = obs_data_array_item(array, i);
+		node->name = obs_data_get_string(node->data, "name");
+		node->input = can_pool_source(node->data);
+		node->pooled = node->input;
+
+		if (node->input)
+			hash_table_insert(&loader.names, &node->name_node,
+					  hash_str(node->name));
+	}
+
+	for (i = 0; i < loader.count; i++) {
+		if (loader.nodes[i].input)
+			add_source_dependencies(&loader, i);
+	}
+
+	exclude_cycles(&loader);
+
+	/* scenes, groups and transitions first, in order, on this thread */
+	for (i = 0; i < loader.count; i++) {
+		struct load_node *node = &loader.nodes[i];
+		if (!node->input)
+			node->source = obs_load_source_type(node->data, &stats);
+	}
+
+	for (i = 0; i < loader.count; i++) {
+		if (loader.nodes[i].pooled)
+			loader.remaining++;
+	}
+
+	if (loader.remaining) {
+		threads = run_source_pool(&loader);
+
+		/* couldn't start the pool, fall back to serial creation */
+		if (!threads) {
+			threads = 1;
+			for (i = 0; i < loader.count; i++)
+				loader.nodes[i].pooled = false;
+		}
+	}
+
+	for (i = 0; i < loader.count; i++) {
+		struct load_node *node = &loader.nodes[i];
+		if (node->input && !node->pooled)
+			node->source = obs_load_source_type(node->data, &stats);
+	}
+
+	sources = bmalloc(sizeof(obs_source_t *) * loader.count);
+	for (i = 0; i < loader.count; i++)
+		sources[i] = loader.nodes[i].source;
+
+	pthread_mutex_lock(&data->sources_mutex);
+
+	for (i = 0; i < loader.count; i++) {
+		obs_source_t *source = sources[i];
+		if (!source)
+			continue;
+
+		relink_source(data, source);
+		for (size_t j = source->filters.num; j > 0; j--)
+			relink_source(data, source->filters.array[j - 1]);
+	}
+
+	load_source_data(array, sources, loader.count, cb, private_data,
+			 &stats);
+
+	for (i = 0; i < loader.count; i++)
+		obs_source_release(sources[i]);
+
+	pthread_mutex_unlock(&data->sources_mutex);
+
+	load_stats_log(&stats, loader.count, os_gettime_ns() - start_time,
+		       threads);
+	load_stats_free(&stats);
+
+	for (i = 0; i < loader.count; i++) {
+		obs_data_release(loader.nodes[i].data);
+		da_free(loader.nodes[i].dependents);
+	}
+	hash_table_free(&loader.names);
+	bfree(loader.nodes);
+	bfree(sources);
+}
+
 obs_data_t *obs_save_source(obs_source_t *source)
 {
 	obs_data_array_t *filters = obs_data_array_create();
@@ -2128,8 +2738,22 @@ void obs_context_data_free(struct obs_context_data *context)
 	memset(context, 0, sizeof(*context));
 }
 
+static inline void index_name(struct obs_context_data *context)
+{
+	if (context->names && context->name)
+		hash_table_insert(context->names, &context->name_node,
+				  hash_str(context->name));
+}
+
+static inline void unindex_name(struct obs_context_data *context)
+{
+	if (context->names && context->name)
+		hash_table_remove(context->names, &context->name_node);
+}
+
 void obs_context_data_insert(struct obs_context_data *context,
-			     pthread_mutex_t *mutex, void *pfirst)
+			     pthread_mutex_t *mutex, void *pfirst,
+			     struct hash_table *names)
 {
 	struct obs_context_data **first = pfirst;
 
@@ -2138,6 +2762,7 @@ void obs_context_data_insert(struct obs_context_data *context,
 	assert(first);
 
 	context->mutex = mutex;
+	context->names = names;
 
 	pthread_mutex_lock(mutex);
 	context->prev_next = first;
@@ -2145,6 +2770,7 @@ void obs_context_data_insert(struct obs_context_data *context,
 	*first = context;
 	if (context->next)
 		context->next->prev_next = &context->next;
+	index_name(context);
 	pthread_mutex_unlock(mutex);
 }
 
@@ -2156,22 +2782,34 @@ void obs_context_data_remove(struct obs_context_data *context)
 			*context->prev_next = context->next;
 		if (context->next)
 			context->next->prev_next = context->prev_next;
+		unindex_name(context);
 		pthread_mutex_unlock(context->mutex);
 
 		context->mutex = NULL;
+		context->names = NULL;
 	}
 }
 
 void obs_context_data_setname(struct obs_context_data *context,
 			      const char *name)
 {
+	pthread_mutex_t *mutex = context->mutex;
+
+	/* the list mutex keeps lookups from seeing the index and the name
+	 * out of sync */
+	if (mutex)
+		pthread_mutex_lock(mutex);
 	pthread_mutex_lock(&context->rename_cache_mutex);
 
+	unindex_name(context);
 	if (context->name)
 		da_push_back(context->rename_cache, &context->name);
 	context->name = dup_name(name, context->private);
+	index_name(context);
 
 	pthread_mutex_unlock(&context->rename_cache_mutex);
+	if (mutex)
+		pthread_mutex_unlock(mutex);
 }
 
 profiler_name_store_t *obs_get_profiler_name_store(void)
@@ -2199,6 +2837,21 @@ uint64_t obs_get_frame_interval_ns(void)
 	return obs->video.video_frame_interval_ns;
 }
 
+uint64_t obs_get_average_output_render_time_ns(void)
+{
+	return obs->video.output_avg_render_time_ns;
+}
+
+uint64_t obs_get_average_display_render_time_ns(void)
+{
+	return obs->video.display_avg_render_time_ns;
+}
+
+uint32_t obs_get_skipped_display_frames(void)
+{
+	return obs->video.skipped_display_frames;
+}
+
 enum obs_obj_type obs_obj_get_type(void *obj)
 {
 	struct obs_context_data *context = obj;
@@ -2337,6 +2990,34 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+uint32_t obs_get_render_cache_hits(void)
+{
+	return obs->video.render_cache_hits;
+}
+
+uint32_t obs_get_render_cache_misses(void)
+{
+	return obs->video.render_cache_misses;
+}
+
+void obs_set_parallel_video_encoders(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->video.parallel_encoders = enable;
+	if (obs->video.video &&
+	    !video_output_set_parallel_inputs(obs->video.video, enable))
+		blog(LOG_INFO, "Parallel video encoders will be %s on the next "
+			       "video reset",
+		     enable ? "enabled" : "disabled");
+}
+
+bool obs_parallel_video_encoders(void)
+{
+	return obs ? obs->video.parallel_encoders : false;
+}
+
 void start_raw_video(video_t *v, const struct video_scale_info *conversion,
 		     void (*callback)(void *param, struct video_data *frame),
 		     void *param)
@@ -242,6 +242,8 @@ struct obs_source_frame {
 	/* used internally by libobs */
 	volatile long refs;
 	bool prev_frame;
+	void (*release)(void *param);
+	void *release_param;
 };
 
 struct obs_source_frame2 {
@@ -695,6 +697,20 @@ typedef void (*obs_load_source_cb)(void *private_data, obs_source_t *source);
 EXPORT void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 			     void *private_data);
 
+/**
+ * Loads sources from a data array like obs_load_sources, but creates inputs on
+ * a pool of threads.  Inputs are only created after the inputs they reference
+ * by name in their settings.  Scenes, groups and transitions are created on
+ * the calling thread, and scene items, filters and the load callback are
+ * still handled in array order on the calling thread once everything exists.
+ *
+ *   Only use when the create callbacks of the loaded input types are safe to
+ *   call concurrently.
+ */
+EXPORT void obs_load_sources_parallel(obs_data_array_t *array,
+				      obs_load_source_cb cb,
+				      void *private_data);
+
 /** Saves sources to a data array */
 EXPORT obs_data_array_t *obs_save_sources(void);
 
@@ -747,9 +763,41 @@ EXPORT double obs_get_active_fps(void);
 EXPORT uint64_t obs_get_average_frame_time_ns(void);
 EXPORT uint64_t obs_get_frame_interval_ns(void);
 
+/** Average time spent per frame rendering the output and the displays */
+EXPORT uint64_t obs_get_average_output_render_time_ns(void);
+EXPORT uint64_t obs_get_average_display_render_time_ns(void);
+
+/** Number of times displays were skipped because rendering ran behind */
+EXPORT uint32_t obs_get_skipped_display_frames(void);
+
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/**
+ * Sources rendered more than once per frame, e.g. scenes shown in the
+ * preview, the multiview and projectors, are rendered to a texture once and
+ * then drawn from it.  The texture stays in use for a few frames after the
+ * last frame with more than one draw.  Hits count the draws from such a
+ * texture, misses the times it had to be rendered.
+ */
+EXPORT uint32_t obs_get_render_cache_hits(void);
+EXPORT uint32_t obs_get_render_cache_misses(void);
+
+/**
+ * Runs each raw video encoder on its own thread so that a slow encoder does
+ * not delay the others.  Takes effect once no raw encoders are active, and is
+ * kept across video resets.
+ */
+EXPORT void obs_set_parallel_video_encoders(bool enable);
+EXPORT bool obs_parallel_video_encoders(void);
+
+/**
+ * Returns the number of encoded packet bytes that outputs referenced instead
+ * of copying, less the single copy each packet gets when it leaves the
+ * encoder.
+ */
+EXPORT uint64_t obs_get_encoder_packet_bytes_not_copied(void);
+
 EXPORT bool obs_nv12_tex_active(void);
 
 EXPORT void obs_apply_private_data(obs_data_t *settings);
@@ -838,6 +886,15 @@ EXPORT bool obs_display_enabled(obs_display_t *display);
 EXPORT void obs_display_set_background_color(obs_display_t *display,
 					     uint32_t color);
 
+/**
+ * Sets the maximum rate the display is rendered at, 0 for no limit.  Whatever
+ * the rate, displays are rendered after the output frame and every display is
+ * skipped while the graphics thread runs behind (for at most 100 ms at a
+ * time), so that output frames don't lag.
+ */
+EXPORT void obs_display_set_max_fps(obs_display_t *display, double fps);
+EXPORT double obs_display_get_max_fps(obs_display_t *display);
+
 EXPORT void obs_display_size(obs_display_t *display, uint32_t *width,
 			     uint32_t *height);
 
@@ -1204,6 +1261,35 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+/**
+ * Outputs asynchronous video without copying it.  The frame's planes are used
+ * in place until libobs is done with them, after which release is called with
+ * the given param.  release is also called if the frame is dropped, so the
+ * caller must not touch the planes after this call.
+ *
+ * NOTE: release can be called from any thread, with the source's async frame
+ * lock held, so it must not call back into the source.
+ */
+EXPORT void obs_source_output_video_external(
+	obs_source_t *source, const struct obs_source_frame *frame,
+	void (*release)(void *param), void *param);
+
+/**
+ * Borrows a frame from the source's async frame pool so that a source can
+ * decode directly into it.  The caller fills in the planes, timestamp and
+ * color information, and then must pass it to
+ * obs_source_output_writable_frame or obs_source_discard_writable_frame.
+ *
+ * @return  The frame, or NULL if too many frames are already queued
+ */
+EXPORT struct obs_source_frame *
+obs_source_get_writable_frame(obs_source_t *source, enum video_format format,
+			      uint32_t width, uint32_t height, bool full_range);
+EXPORT void obs_source_output_writable_frame(obs_source_t *source,
+					     struct obs_source_frame *frame);
+EXPORT void obs_source_discard_writable_frame(obs_source_t *source,
+					      struct obs_source_frame *frame);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 /**
@@ -2035,6 +2121,13 @@ EXPORT uint32_t obs_encoder_get_width(const obs_encoder_t *encoder);
 /** For video encoders, returns the height of the encoded image */
 EXPORT uint32_t obs_encoder_get_height(const obs_encoder_t *encoder);
 
+/**
+ * For video encoders, returns the number of frames that were repeated because
+ * this encoder fell behind.  Only tracked when parallel encoder dispatch is
+ * enabled (see obs_set_parallel_video_encoders).
+ */
+EXPORT uint32_t obs_encoder_get_skipped_frames(const obs_encoder_t *encoder);
+
 /** For audio encoders, returns the sample rate of the audio */
 EXPORT uint32_t obs_encoder_get_sample_rate(const obs_encoder_t *encoder);
 
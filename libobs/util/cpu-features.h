@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * Runtime CPU feature detection for code that has optional AVX2 paths.
+ *
+ * The baseline for x86 builds is SSE2 (see ARCH_SIMD_FLAGS), so only features
+ * above that need to be checked.  AVX2 functions must be compiled with
+ * CPU_FEATURES_TARGET_AVX2 so that the rest of the file can keep using the
+ * baseline instruction set.
+ */
+
+#include "c99defs.h"
+
+#if !NEEDS_SIMDE && (defined(_M_X64) || defined(_M_IX86) || \
+		     defined(__x86_64__) || defined(__i386__))
+#define CPU_FEATURES_X86 1
+#else
+#define CPU_FEATURES_X86 0
+#endif
+
+#if CPU_FEATURES_X86
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CPU_FEATURES_TARGET_AVX2
+#else
+#define CPU_FEATURES_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static inline bool cpu_has_avx2(void)
+{
+#if CPU_FEATURES_X86
+#ifdef _MSC_VER
+	int info[4];
+	unsigned long long xcr0;
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	/* OSXSAVE and AVX, then check that the OS saves the YMM state */
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+		return false;
+
+	xcr0 = _xgetbv(0);
+	if ((xcr0 & 0x6) != 0x6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "bmem.h"
+#include "base.h"
+#include "platform.h"
+#include "threading.h"
+#include "file-watch.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#define WATCH_EVENTS                                                   \
+	(IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | \
+	 IN_MOVED_FROM | IN_MOVED_TO)
+#else
+#include <errno.h>
+
+#define POLL_INTERVAL_MS 500
+#endif
+
+struct os_file_watch {
+	char *path;
+	const char *name;
+	os_file_watch_cb callback;
+	void *param;
+
+	/* time the coalesced notification is due, 0 if nothing is pending */
+	uint64_t notify_time;
+	bool notify;
+
+#ifdef __linux__
+	int wd;
+#else
+	time_t mtime;
+	int64_t size;
+#endif
+
+	struct os_file_watch *next;
+};
+
+/* mutex protects the list and is the only one the thread takes besides
+ * callback_mutex, which is held while collecting and delivering notifications
+ * so a removed watch can't be called back.  thread_mutex serializes starting
+ * and stopping the thread */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t callback_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct os_file_watch *first_watch = NULL;
+static pthread_t watch_thread;
+static bool thread_active = false;
+static volatile bool stopping = false;
+
+#ifdef __linux__
+static int inotify_fd = -1;
+static int wake_fd = -1;
+#else
+static os_event_t *stop_event = NULL;
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static uint64_t next_notify_time(void)
+{
+	uint64_t next = 0;
+
+	pthread_mutex_lock(&mutex);
+	for (struct os_file_watch *watch = first_watch; watch;
+	     watch = watch->next) {
+		if (watch->notify_time &&
+		    (!next || watch->notify_time < next))
+			next = watch->notify_time;
+	}
+	pthread_mutex_unlock(&mutex);
+
+	return next;
+}
+
+static inline void queue_notify(struct os_file_watch *watch, uint64_t delay)
+{
+	if (!watch->notify_time)
+		watch->notify_time = os_gettime_ns() + delay;
+}
+
+static void dispatch_notifications(void)
+{
+	uint64_t now = os_gettime_ns();
+	struct os_file_watch *watch;
+
+	pthread_mutex_lock(&callback_mutex);
+	pthread_mutex_lock(&mutex);
+
+	watch = first_watch;
+	for (struct os_file_watch *cur = watch; cur; cur = cur->next) {
+		if (cur->notify_time && cur->notify_time <= now) {
+			cur->notify_time = 0;
+			cur->notify = true;
+		}
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	/* removal waits on callback_mutex and new watches are only added to
+	 * the front, so the list can be walked without the mutex here */
+	for (; watch; watch = watch->next) {
+		if (watch->notify) {
+			watch->notify = false;
+			watch->callback(watch->param, watch->path);
+		}
+	}
+
+	pthread_mutex_unlock(&callback_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef __linux__
+
+static inline const char *get_name(const char *path)
+{
+	const char *slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
+static void watch_init(struct os_file_watch *watch)
+{
+	char *dir = bstrdup(watch->path);
+	char *slash = strrchr(dir, '/');
+
+	watch->name = get_name(watch->path);
+
+	if (slash == dir)
+		slash[1] = 0;
+	else if (slash)
+		*slash = 0;
+	else
+		strcpy(dir, ".");
+
+	/* the directory is watched rather than the file itself, so that
+	 * files that are replaced (saved to a temporary file and renamed),
+	 * or that don't exist yet, are picked up as well.  watching the same
+	 * directory twice returns the same descriptor */
+	watch->wd = inotify_add_watch(inotify_fd, dir, WATCH_EVENTS);
+	if (watch->wd < 0)
+		blog(LOG_DEBUG, "os_file_watch: Failed to watch '%s': %s",
+		     dir, strerror(errno));
+
+	bfree(dir);
+}
+
+/* call with the mutex held, after the watch has been unlinked */
+static void watch_free(struct os_file_watch *watch)
+{
+	if (watch->wd < 0)
+		return;
+
+	for (struct os_file_watch *cur = first_watch; cur; cur = cur->next) {
+		if (cur->wd == watch->wd)
+			return;
+	}
+
+	inotify_rm_watch(inotify_fd, watch->wd);
+}
+
+static void process_events(void)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(
+		struct inotify_event))));
+	ssize_t len;
+
+	while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+		pthread_mutex_lock(&mutex);
+
+		for (char *ptr = buf; ptr < buf + len;) {
+			const struct inotify_event *event =
+				(const struct inotify_event *)ptr;
+
+			for (struct os_file_watch *watch = first_watch; watch;
+			     watch = watch->next) {
+				if (watch->wd == event->wd && event->len &&
+				    strcmp(watch->name, event->name) == 0)
+					queue_notify(watch,
+						     OS_FILE_WATCH_COALESCE_MS *
+							     1000000ULL);
+			}
+
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+static void *watch_thread_func(void *unused)
+{
+	struct pollfd fds[2] = {{.fd = wake_fd, .events = POLLIN},
+				{.fd = inotify_fd, .events = POLLIN}};
+
+	os_set_thread_name("os_file_watch");
+
+	while (!os_atomic_load_bool(&stopping)) {
+		uint64_t next = next_notify_time();
+		int timeout = -1;
+
+		if (next) {
+			uint64_t now = os_gettime_ns();
+			uint64_t delay_ms = 0;
+
+			if (next > now)
+				delay_ms = (next - now + 999999) / 1000000;
+			timeout = (int)delay_ms;
+		}
+
+		if (poll(fds, 2, timeout) < 0 && errno != EINTR)
+			break;
+
+		if (fds[0].revents & POLLIN) {
+			uint64_t val;
+			if (read(wake_fd, &val, sizeof(val)) < 0)
+				continue;
+		}
+		if (fds[1].revents & POLLIN)
+			process_events();
+
+		dispatch_notifications();
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static bool watch_thread_start(void)
+{
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0)
+		return false;
+
+	wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wake_fd < 0)
+		goto fail;
+
+	os_atomic_set_bool(&stopping, false);
+	if (pthread_create(&watch_thread, NULL, watch_thread_func, NULL) != 0)
+		goto fail;
+
+	return true;
+
+fail:
+	if (wake_fd >= 0)
+		close(wake_fd);
+	close(inotify_fd);
+	wake_fd = -1;
+	inotify_fd = -1;
+	return false;
+}
+
+static void watch_thread_stop(void)
+{
+	uint64_t val = 1;
+
+	os_atomic_set_bool(&stopping, true);
+	if (write(wake_fd, &val, sizeof(val)) < 0)
+		blog(LOG_WARNING, "os_file_watch: Failed to wake thread");
+	pthread_join(watch_thread, NULL);
+
+	close(wake_fd);
+	close(inotify_fd);
+	wake_fd = -1;
+	inotify_fd = -1;
+}
+
+#else
+
+static inline void get_file_state(const char *path, time_t *mtime,
+				  int64_t *size)
+{
+	struct stat st;
+
+	if (os_stat(path, &st) == 0) {
+		*mtime = st.st_mtime;
+		*size = (int64_t)st.st_size;
+	} else {
+		*mtime = 0;
+		*size = -1;
+	}
+}
+
+static void watch_init(struct os_file_watch *watch)
+{
+	get_file_state(watch->path, &watch->mtime, &watch->size);
+}
+
+static void watch_free(struct os_file_watch *watch)
+{
+	UNUSED_PARAMETER(watch);
+}
+
+static void check_files(void)
+{
+	pthread_mutex_lock(&mutex);
+
+	for (struct os_file_watch *watch = first_watch; watch;
+	     watch = watch->next) {
+		time_t mtime;
+		int64_t size;
+
+		get_file_state(watch->path, &mtime, &size);
+		if (mtime != watch->mtime || size != watch->size) {
+			watch->mtime = mtime;
+			watch->size = size;
+			queue_notify(watch, 0);
+		}
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+static void *watch_thread_func(void *unused)
+{
+	os_set_thread_name("os_file_watch");
+
+	while (os_event_timedwait(stop_event, POLL_INTERVAL_MS) == ETIMEDOUT) {
+		check_files();
+		dispatch_notifications();
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static bool watch_thread_start(void)
+{
+	if (os_event_init(&stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
+
+	if (pthread_create(&watch_thread, NULL, watch_thread_func, NULL) != 0) {
+		os_event_destroy(stop_event);
+		stop_event = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static void watch_thread_stop(void)
+{
+	os_event_signal(stop_event);
+	pthread_join(watch_thread, NULL);
+
+	os_event_destroy(stop_event);
+	stop_event = NULL;
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+os_file_watch_t *os_file_watch_add(const char *path, os_file_watch_cb callback,
+				   void *param)
+{
+	struct os_file_watch *watch;
+
+	if (!path || !*path || !callback)
+		return NULL;
+
+	pthread_mutex_lock(&thread_mutex);
+
+	if (!thread_active) {
+		thread_active = watch_thread_start();
+		if (!thread_active) {
+			pthread_mutex_unlock(&thread_mutex);
+			blog(LOG_WARNING, "os_file_watch: Failed to start "
+					  "watch thread");
+			return NULL;
+		}
+	}
+
+	watch = bzalloc(sizeof(struct os_file_watch));
+	watch->path = bstrdup(path);
+	watch->callback = callback;
+	watch->param = param;
+	watch_init(watch);
+
+	pthread_mutex_lock(&mutex);
+	watch->next = first_watch;
+	first_watch = watch;
+	pthread_mutex_unlock(&mutex);
+
+	pthread_mutex_unlock(&thread_mutex);
+	return watch;
+}
+
+void os_file_watch_remove(os_file_watch_t *watch)
+{
+	struct os_file_watch **cur;
+	bool empty;
+
+	if (!watch)
+		return;
+
+	pthread_mutex_lock(&thread_mutex);
+	pthread_mutex_lock(&callback_mutex);
+	pthread_mutex_lock(&mutex);
+
+	for (cur = &first_watch; *cur; cur = &(*cur)->next) {
+		if (*cur == watch) {
+			*cur = watch->next;
+			break;
+		}
+	}
+
+	watch_free(watch);
+	empty = !first_watch;
+
+	pthread_mutex_unlock(&mutex);
+	pthread_mutex_unlock(&callback_mutex);
+
+	/* the thread takes the other two mutexes, so it can only be joined
+	 * once they're released */
+	if (empty && thread_active) {
+		watch_thread_stop();
+		thread_active = false;
+	}
+
+	pthread_mutex_unlock(&thread_mutex);
+
+	bfree(watch->path);
+	bfree(watch);
+}
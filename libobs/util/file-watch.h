@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * File change notifications
+ *
+ *   Watches individual files and notifies from a shared background thread
+ *   when they're modified, created, replaced or deleted.  Uses inotify on
+ *   Linux, and checks the modification time and size of every watched file
+ *   twice a second elsewhere.  Bursts of changes to a file (e.g. a file
+ *   written in several chunks) are coalesced into a single notification.
+ *
+ *   Callbacks are serialized with each other and with os_file_watch_remove,
+ *   so a callback must not add or remove watches.
+ */
+
+#define OS_FILE_WATCH_COALESCE_MS 100
+
+struct os_file_watch;
+typedef struct os_file_watch os_file_watch_t;
+
+typedef void (*os_file_watch_cb)(void *param, const char *path);
+
+EXPORT os_file_watch_t *os_file_watch_add(const char *path,
+					  os_file_watch_cb callback,
+					  void *param);
+
+/* once this returns the callback isn't running and won't be called again */
+EXPORT void os_file_watch_remove(os_file_watch_t *watch);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+#include <string.h>
+#include <stddef.h>
+
+#include "bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Intrusive chained hash table
+ *
+ *   Objects embed a hash_node and are linked into the table by the caller,
+ *   the table itself never allocates anything but its bucket array.  Keys are
+ *   not stored, only their hashes, so the caller compares the actual keys
+ *   while walking the nodes of a hash with hash_table_first/hash_table_next.
+ *   Multiple nodes may share the same key.
+ *
+ *   Not thread safe, the owner is expected to protect it.
+ */
+
+struct hash_node {
+	struct hash_node *next;
+	uint64_t hash;
+};
+
+struct hash_table {
+	struct hash_node **buckets;
+	size_t num_buckets;
+	size_t num;
+};
+
+#define HASH_TABLE_MIN_BUCKETS 16
+
+#define hash_entry(node, type, member) \
+	((type *)((uint8_t *)(node)-offsetof(type, member)))
+
+/* FNV-1a */
+static inline uint64_t hash_str(const char *str)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	if (str) {
+		while (*str) {
+			hash ^= (uint8_t)*(str++);
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
+
+/* 64-bit finalizer of MurmurHash3, spreads ids and pointers over the
+ * low bits that are used to select a bucket */
+static inline uint64_t hash_uint64(uint64_t val)
+{
+	val ^= val >> 33;
+	val *= 0xff51afd7ed558ccdULL;
+	val ^= val >> 33;
+	val *= 0xc4ceb9fe1a85ec53ULL;
+	val ^= val >> 33;
+	return val;
+}
+
+static inline uint64_t hash_ptr(const void *ptr)
+{
+	return hash_uint64((uint64_t)(uintptr_t)ptr);
+}
+
+static inline void hash_table_init(struct hash_table *ht)
+{
+	memset(ht, 0, sizeof(struct hash_table));
+}
+
+static inline void hash_table_free(struct hash_table *ht)
+{
+	bfree(ht->buckets);
+	memset(ht, 0, sizeof(struct hash_table));
+}
+
+/* unlinks every node without freeing the buckets */
+static inline void hash_table_clear(struct hash_table *ht)
+{
+	if (ht->buckets)
+		memset(ht->buckets, 0,
+		       sizeof(struct hash_node *) * ht->num_buckets);
+	ht->num = 0;
+}
+
+static inline struct hash_node **hash_table_bucket(struct hash_table *ht,
+						   uint64_t hash)
+{
+	return &ht->buckets[hash & (ht->num_buckets - 1)];
+}
+
+static inline void hash_table_rehash(struct hash_table *ht,
+				     size_t num_buckets)
+{
+	struct hash_node **old_buckets = ht->buckets;
+	size_t old_num_buckets = ht->num_buckets;
+
+	ht->buckets = bzalloc(sizeof(struct hash_node *) * num_buckets);
+	ht->num_buckets = num_buckets;
+
+	for (size_t i = 0; i < old_num_buckets; i++) {
+		struct hash_node *node = old_buckets[i];
+
+		while (node) {
+			struct hash_node *next = node->next;
+			struct hash_node **bucket =
+				hash_table_bucket(ht, node->hash);
+
+			node->next = *bucket;
+			*bucket = node;
+			node = next;
+		}
+	}
+
+	bfree(old_buckets);
+}
+
+static inline void hash_table_insert(struct hash_table *ht,
+				     struct hash_node *node, uint64_t hash)
+{
+	struct hash_node **bucket;
+
+	if (ht->num >= ht->num_buckets)
+		hash_table_rehash(ht, ht->num_buckets
+					      ? ht->num_buckets * 2
+					      : HASH_TABLE_MIN_BUCKETS);
+
+	bucket = hash_table_bucket(ht, hash);
+	node->hash = hash;
+	node->next = *bucket;
+	*bucket = node;
+	ht->num++;
+}
+
+static inline bool hash_table_remove(struct hash_table *ht,
+				     struct hash_node *node)
+{
+	struct hash_node **cur;
+
+	if (!ht->num)
+		return false;
+
+	cur = hash_table_bucket(ht, node->hash);
+	while (*cur) {
+		if (*cur == node) {
+			*cur = node->next;
+			node->next = NULL;
+			ht->num--;
+			return true;
+		}
+		cur = &(*cur)->next;
+	}
+
+	return false;
+}
+
+/* swaps a linked node for new_node, which must already hold the same hash and
+ * next pointer (e.g. after the containing object was reallocated).  old_node
+ * is only compared against, never dereferenced */
+static inline bool hash_table_replace(struct hash_table *ht,
+				      struct hash_node *old_node,
+				      struct hash_node *new_node)
+{
+	struct hash_node **cur;
+
+	if (!ht->num)
+		return false;
+
+	cur = hash_table_bucket(ht, new_node->hash);
+	while (*cur) {
+		if (*cur == old_node) {
+			*cur = new_node;
+			return true;
+		}
+		cur = &(*cur)->next;
+	}
+
+	return false;
+}
+
+/* returns the first node with the given hash, or NULL */
+static inline struct hash_node *hash_table_first(struct hash_table *ht,
+						 uint64_t hash)
+{
+	struct hash_node *node;
+
+	if (!ht->num)
+		return NULL;
+
+	node = *hash_table_bucket(ht, hash);
+	while (node && node->hash != hash)
+		node = node->next;
+	return node;
+}
+
+/* returns the next node after node with the same hash, or NULL */
+static inline struct hash_node *hash_table_next(struct hash_node *node)
+{
+	uint64_t hash = node->hash;
+
+	node = node->next;
+	while (node && node->hash != hash)
+		node = node->next;
+	return node;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -152,6 +152,20 @@ bool os_sleepto_ns(uint64_t time_target)
 	if (time_target < current)
 		return false;
 
+#if !defined(__APPLE__)
+	/* os_gettime_ns is CLOCK_MONOTONIC, so sleep until the deadline
+	 * itself instead of for a duration: time lost to preemption or
+	 * signals between here and the sleep doesn't add up */
+	struct timespec deadline;
+	deadline.tv_sec = (time_t)(time_target / 1000000000);
+	deadline.tv_nsec = (long)(time_target % 1000000000);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+			       NULL) == EINTR)
+		;
+
+	return true;
+#else
 	time_target -= current;
 
 	struct timespec req, remain;
@@ -166,6 +180,7 @@ bool os_sleepto_ns(uint64_t time_target)
 	}
 
 	return true;
+#endif
 }
 
 void os_sleep_ms(uint32_t duration)
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "bmem.h"
+#include "base.h"
+#include "platform.h"
+#include "threading.h"
+#include "circlebuf.h"
+#include "darray.h"
+#include "task-pool.h"
+
+struct task {
+	os_task_t func;
+	void *param;
+};
+
+struct batch {
+	os_task_t func;
+	volatile long remaining;
+	os_event_t *done;
+};
+
+struct batch_task {
+	struct batch *batch;
+	void *param;
+};
+
+struct os_task_pool {
+	char *name;
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	os_event_t *idle;
+	struct circlebuf tasks;
+	long pending;
+	bool exit;
+
+	DARRAY(pthread_t) threads;
+};
+
+static void *task_thread(void *param)
+{
+	struct os_task_pool *pool = param;
+	struct task task;
+
+	os_set_thread_name(pool->name);
+
+	for (;;) {
+		os_sem_wait(pool->sem);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (!pool->tasks.size) {
+			bool exit = pool->exit;
+			pthread_mutex_unlock(&pool->mutex);
+			if (exit)
+				break;
+			continue;
+		}
+		circlebuf_pop_front(&pool->tasks, &task, sizeof(task));
+		pthread_mutex_unlock(&pool->mutex);
+
+		task.func(task.param);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->pending == 0)
+			os_event_signal(pool->idle);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return NULL;
+}
+
+os_task_pool_t *os_task_pool_create(const char *name, size_t num_threads)
+{
+	struct os_task_pool *pool = bzalloc(sizeof(struct os_task_pool));
+
+	if (!num_threads) {
+		int cores = os_get_logical_cores();
+		num_threads = cores > 0 ? (size_t)cores : 1;
+	}
+
+	pool->name = bstrdup(name ? name : "libobs: task pool");
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_sem_init(&pool->sem, 0) != 0)
+		goto fail_sem;
+	if (os_event_init(&pool->idle, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail_event;
+
+	os_event_signal(pool->idle);
+
+	for (size_t i = 0; i < num_threads; i++) {
+		pthread_t thread;
+
+		if (pthread_create(&thread, NULL, task_thread, pool) != 0)
+			break;
+		da_push_back(pool->threads, &thread);
+	}
+
+	if (!pool->threads.num) {
+		blog(LOG_ERROR, "%s: Failed to create any threads", pool->name);
+		os_task_pool_destroy(pool);
+		return NULL;
+	}
+
+	return pool;
+
+fail_event:
+	os_sem_destroy(pool->sem);
+fail_sem:
+	pthread_mutex_destroy(&pool->mutex);
+fail_mutex:
+	bfree(pool->name);
+	bfree(pool);
+	return NULL;
+}
+
+void os_task_pool_destroy(os_task_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	os_task_pool_wait(pool);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->exit = true;
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->sem);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	da_free(pool->threads);
+	circlebuf_free(&pool->tasks);
+	os_event_destroy(pool->idle);
+	os_sem_destroy(pool->sem);
+	pthread_mutex_destroy(&pool->mutex);
+	bfree(pool->name);
+	bfree(pool);
+}
+
+void os_task_pool_queue(os_task_pool_t *pool, os_task_t task, void *param)
+{
+	struct task new_task = {task, param};
+
+	if (!pool || !task)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	circlebuf_push_back(&pool->tasks, &new_task, sizeof(new_task));
+	if (pool->pending++ == 0)
+		os_event_reset(pool->idle);
+	pthread_mutex_unlock(&pool->mutex);
+
+	os_sem_post(pool->sem);
+}
+
+void os_task_pool_wait(os_task_pool_t *pool)
+{
+	if (pool)
+		os_event_wait(pool->idle);
+}
+
+static void batch_task(void *param)
+{
+	struct batch_task *task = param;
+	struct batch *batch = task->batch;
+
+	batch->func(task->param);
+
+	if (os_atomic_dec_long(&batch->remaining) == 0)
+		os_event_signal(batch->done);
+}
+
+static inline void run_serial(os_task_t task, uint8_t *params,
+			      size_t param_size, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		task(params + param_size * i);
+}
+
+void os_task_pool_run(os_task_pool_t *pool, os_task_t task, void *params,
+		      size_t param_size, size_t count)
+{
+	struct batch batch = {task, (long)count - 1, NULL};
+	struct batch_task *tasks;
+
+	if (!task || !count)
+		return;
+
+	if (!pool || count == 1 ||
+	    os_event_init(&batch.done, OS_EVENT_TYPE_MANUAL) != 0) {
+		run_serial(task, params, param_size, count);
+		return;
+	}
+
+	tasks = bmalloc(sizeof(struct batch_task) * (count - 1));
+
+	for (size_t i = 1; i < count; i++) {
+		tasks[i - 1].batch = &batch;
+		tasks[i - 1].param = (uint8_t *)params + param_size * i;
+		os_task_pool_queue(pool, batch_task, &tasks[i - 1]);
+	}
+
+	task(params);
+
+	os_event_wait(batch.done);
+	os_event_destroy(batch.done);
+	bfree(tasks);
+}
+
+size_t os_task_pool_num_threads(os_task_pool_t *pool)
+{
+	return pool ? pool->threads.num : 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Worker thread pool
+ *
+ *   Runs queued tasks on a fixed number of threads, in the order they were
+ *   queued.  Tasks may queue other tasks, but must not wait on or destroy
+ *   the pool they run on.
+ */
+
+struct os_task_pool;
+typedef struct os_task_pool os_task_pool_t;
+
+typedef void (*os_task_t)(void *param);
+
+/* creates a pool of num_threads threads, or one per logical core if 0 */
+EXPORT os_task_pool_t *os_task_pool_create(const char *name,
+					   size_t num_threads);
+
+/* waits for every queued task to finish before destroying the pool */
+EXPORT void os_task_pool_destroy(os_task_pool_t *pool);
+
+EXPORT void os_task_pool_queue(os_task_pool_t *pool, os_task_t task,
+			       void *param);
+
+/* waits until every task queued so far has finished */
+EXPORT void os_task_pool_wait(os_task_pool_t *pool);
+
+/* calls task once for each of the count params, which are param_size bytes
+ * apart.  the first one runs on the calling thread, the others on the pool,
+ * and this returns once all of them have finished.  unlike
+ * os_task_pool_wait it doesn't wait for other tasks.  everything runs on
+ * the calling thread if pool is NULL */
+EXPORT void os_task_pool_run(os_task_pool_t *pool, os_task_t task,
+			     void *params, size_t param_size, size_t count);
+
+EXPORT size_t os_task_pool_num_threads(os_task_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
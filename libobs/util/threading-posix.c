@@ -30,6 +30,13 @@
 #include <pthread_np.h>
 #endif
 
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <sched.h>
+
 #include "bmem.h"
 #include "threading.h"
 
@@ -271,3 +278,81 @@ void os_set_thread_name(const char *name)
 	}
 #endif
 }
+
+/* stay low in the realtime range, this only needs to preempt normal threads
+ * and not compete with the audio server or the kernel's own threads */
+#define REALTIME_PRIORITY_OFFSET 4
+
+static bool set_realtime_priority(void)
+{
+	struct sched_param param = {0};
+	int min = sched_get_priority_min(SCHED_FIFO);
+	int max = sched_get_priority_max(SCHED_FIFO);
+
+	param.sched_priority = min + REALTIME_PRIORITY_OFFSET;
+	if (param.sched_priority > max)
+		param.sched_priority = max;
+
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+#ifdef __linux__
+static bool set_thread_nice(int nice)
+{
+	/* nice values are per thread on linux */
+	return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice) == 0;
+}
+#endif
+
+static bool set_high_priority(void)
+{
+#ifdef __linux__
+	struct sched_param param = {0};
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+	return set_thread_nice(-10);
+#else
+	struct sched_param param = {0};
+	int policy;
+
+	if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+		return false;
+
+	param.sched_priority = sched_get_priority_max(policy);
+	return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+#endif
+}
+
+static void set_normal_priority(void)
+{
+	struct sched_param param = {0};
+
+#ifdef __linux__
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+	set_thread_nice(0);
+#else
+	int min = sched_get_priority_min(SCHED_OTHER);
+	int max = sched_get_priority_max(SCHED_OTHER);
+
+	param.sched_priority = (min + max) / 2;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#endif
+}
+
+enum os_thread_priority os_set_thread_priority(enum os_thread_priority priority)
+{
+	switch (priority) {
+	case OS_THREAD_PRIORITY_REALTIME:
+		if (set_realtime_priority())
+			return OS_THREAD_PRIORITY_REALTIME;
+		/* fall through */
+	case OS_THREAD_PRIORITY_HIGH:
+		if (set_high_priority())
+			return OS_THREAD_PRIORITY_HIGH;
+		/* fall through */
+	case OS_THREAD_PRIORITY_NORMAL:
+		break;
+	}
+
+	set_normal_priority();
+	return OS_THREAD_PRIORITY_NORMAL;
+}
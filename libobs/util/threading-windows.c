@@ -211,3 +211,24 @@ void os_set_thread_name(const char *name)
 	}
 	FreeLibrary(k32);
 }
+
+enum os_thread_priority os_set_thread_priority(enum os_thread_priority priority)
+{
+	HANDLE thread = GetCurrentThread();
+
+	switch (priority) {
+	case OS_THREAD_PRIORITY_REALTIME:
+		if (SetThreadPriority(thread, THREAD_PRIORITY_TIME_CRITICAL))
+			return OS_THREAD_PRIORITY_REALTIME;
+		/* fall through */
+	case OS_THREAD_PRIORITY_HIGH:
+		if (SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST))
+			return OS_THREAD_PRIORITY_HIGH;
+		/* fall through */
+	case OS_THREAD_PRIORITY_NORMAL:
+		break;
+	}
+
+	SetThreadPriority(thread, THREAD_PRIORITY_NORMAL);
+	return OS_THREAD_PRIORITY_NORMAL;
+}
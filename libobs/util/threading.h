@@ -78,6 +78,18 @@ EXPORT int os_sem_wait(os_sem_t *sem);
 
 EXPORT void os_set_thread_name(const char *name);
 
+enum os_thread_priority {
+	OS_THREAD_PRIORITY_NORMAL,
+	OS_THREAD_PRIORITY_HIGH,
+	OS_THREAD_PRIORITY_REALTIME,
+};
+
+/* changes the scheduling priority of the calling thread.  realtime falls
+ * back to high if the process isn't permitted to use realtime scheduling.
+ * returns the priority that was actually applied */
+EXPORT enum os_thread_priority
+os_set_thread_priority(enum os_thread_priority priority);
+
 #ifdef _MSC_VER
 #define THREAD_LOCAL __declspec(thread)
 #else
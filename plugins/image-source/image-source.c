@@ -1,5 +1,6 @@
 #include <obs-module.h>
 #include <graphics/image-file.h>
+#include <graphics/image-cache.h>
 #include <util/platform.h>
 #include <util/dstr.h>
 #include <sys/stat.h>
@@ -21,10 +22,21 @@ struct image_source {
 	float update_time_elapsed;
 	uint64_t last_time;
 	bool active;
+	uint64_t frame_cache_limit;
 
+	/* still images are shared with other sources through the image cache,
+	 * animated gifs are not as each source plays them back on its own */
+	gs_cached_image_t *cached;
+	gs_cached_image_t *pending;
 	gs_image_file2_t if2;
 };
 
+static inline bool use_image_cache(const char *file)
+{
+	const char *ext = os_get_path_extension(file);
+	return !ext || astrcmpi(ext, ".gif") != 0;
+}
+
 static time_t get_modified_timestamp(const char *filename)
 {
 	struct stat stats;
@@ -39,20 +51,45 @@ static const char *image_source_get_name(void *unused)
 	return obs_module_text("ImageInput");
 }
 
-static void image_source_load(struct image_source *context)
+/* when async, the image is decoded on a worker thread and replaces the
+ * current one in video_tick once it's ready */
+static void image_source_load(struct image_source *context, bool async)
 {
 	char *file = context->file;
+	gs_cached_image_t *image = NULL;
+
+	if (file && *file && use_image_cache(file))
+		image = gs_image_cache_acquire(file, async);
 
 	obs_enter_graphics();
 	gs_image_file2_free(&context->if2);
+	gs_cached_image_release(context->pending);
+	context->pending = NULL;
+
+	/* anything that isn't loaded through the cache replaces the cached
+	 * image right away, only cached images are swapped in once ready */
+	if (async && image) {
+		context->pending = image;
+	} else {
+		gs_cached_image_release(context->cached);
+		context->cached = image;
+	}
 	obs_leave_graphics();
 
 	if (file && *file) {
 		debug("loading texture '%s'", file);
 		context->file_timestamp = get_modified_timestamp(file);
-		gs_image_file2_init(&context->if2, file);
 		context->update_time_elapsed = 0;
 
+		if (image) {
+			if (!async && !gs_cached_image_loaded(image))
+				warn("failed to load texture '%s'", file);
+			return;
+		}
+
+		gs_image_file2_init_limited(&context->if2, file,
+					    context->frame_cache_limit);
+
 		obs_enter_graphics();
 		gs_image_file2_init_texture(&context->if2);
 		obs_leave_graphics();
@@ -66,6 +103,25 @@ static void image_source_unload(struct image_source *context)
 {
 	obs_enter_graphics();
 	gs_image_file2_free(&context->if2);
+	gs_cached_image_release(context->cached);
+	gs_cached_image_release(context->pending);
+	context->cached = NULL;
+	context->pending = NULL;
+	obs_leave_graphics();
+}
+
+static void swap_pending_image(struct image_source *context)
+{
+	if (!gs_cached_image_ready(context->pending))
+		return;
+
+	if (!gs_cached_image_loaded(context->pending))
+		warn("failed to load texture '%s'", context->file);
+
+	obs_enter_graphics();
+	gs_cached_image_release(context->cached);
+	context->cached = context->pending;
+	context->pending = NULL;
 	obs_leave_graphics();
 }
 
@@ -74,15 +130,18 @@ static void image_source_update(void *data, obs_data_t *settings)
 	struct image_source *context = data;
 	const char *file = obs_data_get_string(settings, "file");
 	const bool unload = obs_data_get_bool(settings, "unload");
+	const long long cache_mb =
+		obs_data_get_int(settings, "frame_cache_limit");
 
 	if (context->file)
 		bfree(context->file);
 	context->file = bstrdup(file);
 	context->persistent = !unload;
+	context->frame_cache_limit = (uint64_t)cache_mb * 1024 * 1024;
 
 	/* Load the image if the source is persistent or showing */
 	if (context->persistent || obs_source_showing(context->source))
-		image_source_load(data);
+		image_source_load(data, false);
 	else
 		image_source_unload(data);
 }
@@ -90,6 +149,7 @@ static void image_source_update(void *data, obs_data_t *settings)
 static void image_source_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, "unload", false);
+	obs_data_set_default_int(settings, "frame_cache_limit", 256);
 }
 
 static void image_source_show(void *data)
@@ -97,7 +157,7 @@ static void image_source_show(void *data)
 	struct image_source *context = data;
 
 	if (!context->persistent)
-		image_source_load(context);
+		image_source_load(context, true);
 }
 
 static void image_source_hide(void *data)
@@ -108,12 +168,41 @@ static void image_source_hide(void *data)
 		image_source_unload(context);
 }
 
+static unsigned int get_cached_frames(gs_image_file_t *image)
+{
+	unsigned int interval = image->keyframe_interval
+					? (unsigned int)image->keyframe_interval
+					: 1;
+
+	if (!image->is_animated_gif)
+		return 0;
+	return (image->gif.frame_count + interval - 1) / interval;
+}
+
+static void get_frame_cache_proc(void *data, calldata_t *cd)
+{
+	struct image_source *context = data;
+	gs_image_file_t *image = &context->if2.image;
+	unsigned int frames =
+		image->is_animated_gif ? image->gif.frame_count : 0;
+
+	calldata_set_int(cd, "bytes", (long long)image->frame_cache_size);
+	calldata_set_int(cd, "cached_frames", get_cached_frames(image));
+	calldata_set_int(cd, "frames", frames);
+}
+
 static void *image_source_create(obs_data_t *settings, obs_source_t *source)
 {
 	struct image_source *context = bzalloc(sizeof(struct image_source));
 	context->source = source;
 
 	image_source_update(context, settings);
+
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph,
+			 "void get_frame_cache(out int bytes, "
+			 "out int cached_frames, out int frames)",
+			 get_frame_cache_proc, context);
 	return context;
 }
 
@@ -131,26 +220,32 @@ static void image_source_destroy(void *data)
 static uint32_t image_source_getwidth(void *data)
 {
 	struct image_source *context = data;
-	return context->if2.image.cx;
+	return context->cached ? gs_cached_image_get_width(context->cached)
+			       : context->if2.image.cx;
 }
 
 static uint32_t image_source_getheight(void *data)
 {
 	struct image_source *context = data;
-	return context->if2.image.cy;
+	return context->cached ? gs_cached_image_get_height(context->cached)
+			       : context->if2.image.cy;
 }
 
 static void image_source_render(void *data, gs_effect_t *effect)
 {
 	struct image_source *context = data;
+	gs_texture_t *texture = context->cached
+					? gs_cached_image_get_texture(
+						  context->cached)
+					: context->if2.image.texture;
 
-	if (!context->if2.image.texture)
+	if (!texture)
 		return;
 
 	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"),
-			      context->if2.image.texture);
-	gs_draw_sprite(context->if2.image.texture, 0, context->if2.image.cx,
-		       context->if2.image.cy);
+			      texture);
+	gs_draw_sprite(texture, 0, gs_texture_get_width(texture),
+		       gs_texture_get_height(texture));
 }
 
 static void image_source_tick(void *data, float seconds)
@@ -160,13 +255,16 @@ static void image_source_tick(void *data, float seconds)
 
 	context->update_time_elapsed += seconds;
 
+	if (context->pending)
+		swap_pending_image(context);
+
 	if (obs_source_showing(context->source)) {
 		if (context->update_time_elapsed >= 1.0f) {
 			time_t t = get_modified_timestamp(context->file);
 			context->update_time_elapsed = 0.0f;
 
 			if (context->file_timestamp != t) {
-				image_source_load(context);
+				image_source_load(context, true);
 			}
 		}
 	}
@@ -224,6 +322,7 @@ static obs_properties_t *image_source_properties(void *data)
 {
 	struct image_source *s = data;
 	struct dstr path = {0};
+	obs_property_t *p;
 
 	obs_properties_t *props = obs_properties_create();
 
@@ -241,6 +340,22 @@ static obs_properties_t *image_source_properties(void *data)
 				OBS_PATH_FILE, image_filter, path.array);
 	obs_properties_add_bool(props, "unload",
 				obs_module_text("UnloadWhenNotShowing"));
+
+	p = obs_properties_add_int(props, "frame_cache_limit",
+				   obs_module_text("FrameCacheLimit"), 0,
+				   16384, 16);
+	obs_property_int_set_suffix(p, " MB");
+
+	if (s && s->if2.image.is_animated_gif) {
+		gs_image_file_t *image = &s->if2.image;
+
+		dstr_printf(&path, obs_module_text("FrameCacheLimit.Usage"),
+			    (double)image->frame_cache_size /
+				    (1024.0 * 1024.0),
+			    get_cached_frames(image), image->gif.frame_count);
+		obs_property_set_long_description(p, path.array);
+	}
+
 	dstr_free(&path);
 
 	return props;
@@ -249,7 +364,7 @@ static obs_properties_t *image_source_properties(void *data)
 uint64_t image_source_get_memory_usage(void *data)
 {
 	struct image_source *s = data;
-	return s->if2.mem_usage;
+	return s->if2.mem_usage + gs_cached_image_get_memory_usage(s->cached);
 }
 
 static struct obs_source_info image_source_info = {
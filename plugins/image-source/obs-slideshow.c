@@ -1,4 +1,5 @@
 #include <obs-module.h>
+#include <graphics/image-cache.h>
 #include <util/threading.h>
 #include <util/platform.h>
 #include <util/darray.h>
@@ -65,6 +66,7 @@ extern uint64_t image_source_get_memory_usage(void *data);
 
 #define BYTES_TO_MBYTES (1024 * 1024)
 #define MAX_MEM_USAGE (400 * BYTES_TO_MBYTES)
+#define PRELOAD_COUNT 4
 
 struct image_file_data {
 	char *path;
@@ -237,6 +239,51 @@ static void add_file(struct slideshow *ss, struct darray *array,
 	*array = new_files.da;
 }
 
+static inline bool can_preload(const char *path)
+{
+	/* animated gifs aren't shared through the image cache */
+	const char *ext = os_get_path_extension(path);
+	return !ext || astrcmpi(ext, ".gif") != 0;
+}
+
+static void release_preload(gs_cached_image_t **image)
+{
+	if (*image) {
+		obs_enter_graphics();
+		gs_cached_image_release(*image);
+		obs_leave_graphics();
+		*image = NULL;
+	}
+}
+
+static void add_files(struct slideshow *ss, struct darray *array,
+		      char **paths, size_t count, uint32_t *cx, uint32_t *cy)
+{
+	gs_cached_image_t *preload[PRELOAD_COUNT] = {0};
+	size_t next = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		/* decode the next few images on the image cache's worker
+		 * threads while the current one is being added, the image
+		 * sources then share the decoded images */
+		for (; next < count && next < i + PRELOAD_COUNT; next++) {
+			if (can_preload(paths[next]))
+				preload[next % PRELOAD_COUNT] =
+					gs_image_cache_acquire(paths[next],
+							       true);
+		}
+
+		add_file(ss, array, paths[i], cx, cy);
+		release_preload(&preload[i % PRELOAD_COUNT]);
+
+		if (ss->mem_usage >= MAX_MEM_USAGE)
+			break;
+	}
+
+	for (size_t i = 0; i < PRELOAD_COUNT; i++)
+		release_preload(&preload[i]);
+}
+
 static bool valid_extension(const char *ext)
 {
 	if (!ext)
@@ -277,6 +324,7 @@ static void ss_update(void *data, obs_data_t *settings)
 {
 	DARRAY(struct image_file_data) new_files;
 	DARRAY(struct image_file_data) old_files;
+	DARRAY(char *) paths;
 	obs_source_t *new_tr = NULL;
 	obs_source_t *old_tr = NULL;
 	struct slideshow *ss = data;
@@ -294,6 +342,7 @@ static void ss_update(void *data, obs_data_t *settings)
 	/* get settings data */
 
 	da_init(new_files);
+	da_init(paths);
 
 	behavior = obs_data_get_string(settings, S_BEHAVIOR);
 
@@ -361,25 +410,27 @@ static void ss_update(void *data, obs_data_t *settings)
 				dstr_copy(&dir_path, path);
 				dstr_cat_ch(&dir_path, '/');
 				dstr_cat(&dir_path, ent->d_name);
-				add_file(ss, &new_files.da, dir_path.array, &cx,
-					 &cy);
 
-				if (ss->mem_usage >= MAX_MEM_USAGE)
-					break;
+				char *file = bstrdup(dir_path.array);
+				da_push_back(paths, &file);
 			}
 
 			dstr_free(&dir_path);
 			os_closedir(dir);
 		} else {
-			add_file(ss, &new_files.da, path, &cx, &cy);
+			char *file = bstrdup(path);
+			da_push_back(paths, &file);
 		}
 
 		obs_data_release(item);
-
-		if (ss->mem_usage >= MAX_MEM_USAGE)
-			break;
 	}
 
+	add_files(ss, &new_files.da, paths.array, paths.num, &cx, &cy);
+
+	for (size_t i = 0; i < paths.num; i++)
+		bfree(paths.array[i]);
+	da_free(paths);
+
 	/* ------------------------------------- */
 	/* update settings data */
 
@@ -962,7 +1013,8 @@ struct obs_source_info slideshow_info = {
 	.id = "slideshow",
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA,
+			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA |
+			OBS_SOURCE_ALWAYS_TICK,
 	.get_name = ss_getname,
 	.create = ss_create,
 	.destroy = ss_destroy,
@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -25,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/darray.h>
+#include <util/platform.h>
 #include "xcursor-xcb.h"
 #include "xhelpers.h"
 
@@ -32,6 +35,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "xshm-input: " msg, ##__VA_ARGS__)
 
+/* beyond these the damaged regions are fetched as one full frame, which
+ * costs a single round trip */
+#define XSHM_MAX_DAMAGE_RECTS 64
+#define XSHM_MAX_DAMAGE_PERCENT 50
+
 struct xshm_data {
 	obs_source_t *source;
 
@@ -63,6 +71,21 @@ struct xshm_data {
 	bool use_xinerama;
 	bool use_randr;
 	bool advanced;
+
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	bool use_damage;
+	bool full_update;
+	DARRAY(xcb_rectangle_t) rects;
+
+	/* copy statistics, updated every second */
+	uint64_t stats_ts;
+	uint64_t copied_bytes;
+	uint64_t full_bytes;
+	uint64_t total_copied_bytes;
+	uint64_t total_full_bytes;
+	uint64_t copy_rate;
+	uint64_t full_rate;
 };
 
 /**
@@ -101,6 +124,69 @@ static bool xshm_check_extensions(xcb_connection_t *xcb)
 	return ok;
 }
 
+/**
+ * Start tracking damage of the root window
+ *
+ * Only the changed parts of the screen are fetched and uploaded when this
+ * succeeds, otherwise every tick captures a full frame.
+ */
+static void xshm_init_damage(struct xshm_data *data)
+{
+	xcb_damage_query_version_cookie_t dmg_c;
+	xcb_damage_query_version_reply_t *dmg_r;
+	xcb_xfixes_query_version_cookie_t xfix_c;
+	xcb_xfixes_query_version_reply_t *xfix_r;
+	bool regions;
+
+	if (!xcb_get_extension_data(data->xcb, &xcb_damage_id)->present) {
+		blog(LOG_INFO, "Missing Damage extension, "
+			       "capturing full frames");
+		return;
+	}
+
+	dmg_c = xcb_damage_query_version_unchecked(data->xcb,
+						   XCB_DAMAGE_MAJOR_VERSION,
+						   XCB_DAMAGE_MINOR_VERSION);
+	xfix_c = xcb_xfixes_query_version_unchecked(
+		data->xcb, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
+	dmg_r = xcb_damage_query_version_reply(data->xcb, dmg_c, NULL);
+	xfix_r = xcb_xfixes_query_version_reply(data->xcb, xfix_c, NULL);
+
+	/* regions were introduced with xfixes 2 */
+	regions = xfix_r && xfix_r->major_version >= 2;
+	free(xfix_r);
+
+	if (!dmg_r || !regions) {
+		blog(LOG_INFO, "Damage not usable, capturing full frames");
+		free(dmg_r);
+		return;
+	}
+	free(dmg_r);
+
+	data->damage = xcb_generate_id(data->xcb);
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root,
+			  XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+
+	data->damage_region = xcb_generate_id(data->xcb);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+
+	data->use_damage = true;
+	data->full_update = true;
+}
+
+/**
+ * Stop tracking damage
+ */
+static void xshm_free_damage(struct xshm_data *data)
+{
+	if (data->use_damage) {
+		xcb_damage_destroy(data->xcb, data->damage);
+		xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+	}
+
+	data->use_damage = false;
+}
+
 /**
  * Update the capture
  *
@@ -201,6 +287,23 @@ static void xshm_capture_stop(struct xshm_data *data)
 
 	obs_leave_graphics();
 
+	if (data->total_full_bytes) {
+		blog(LOG_INFO,
+		     "Copied %" PRIu64 " MB of %" PRIu64 " MB in full frames",
+		     data->total_copied_bytes / 1000000,
+		     data->total_full_bytes / 1000000);
+	}
+	data->stats_ts = 0;
+	data->copied_bytes = 0;
+	data->full_bytes = 0;
+	data->total_copied_bytes = 0;
+	data->total_full_bytes = 0;
+	data->copy_rate = 0;
+	data->full_rate = 0;
+
+	if (data->xcb)
+		xshm_free_damage(data);
+
 	if (data->xshm) {
 		xshm_xcb_detach(data->xshm);
 		data->xshm = NULL;
@@ -252,6 +355,8 @@ static void xshm_capture_start(struct xshm_data *data)
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->adj_x_org, data->adj_y_org);
 
+	xshm_init_damage(data);
+
 	obs_enter_graphics();
 
 	xshm_resize_texture(data);
@@ -450,10 +555,23 @@ static void xshm_destroy(void *vptr)
 		return;
 
 	xshm_capture_stop(data);
+	da_free(data->rects);
 
 	bfree(data);
 }
 
+/**
+ * Get the number of bytes copied per second, and how many full frames would
+ * have copied
+ */
+static void xshm_get_copy_stats(void *vptr, calldata_t *cd)
+{
+	XSHM_DATA(vptr);
+
+	calldata_set_int(cd, "bytes_per_sec", (long long)data->copy_rate);
+	calldata_set_int(cd, "full_bytes_per_sec", (long long)data->full_rate);
+}
+
 /**
  * Create the capture
  */
@@ -464,11 +582,191 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 
 	xshm_update(data, settings);
 
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph,
+			 "void get_copy_stats(out int bytes_per_sec, "
+			 "out int full_bytes_per_sec)",
+			 xshm_get_copy_stats, data);
 	return data;
 }
 
+/**
+ * Account for the bytes copied from the x server and uploaded
+ */
+static void xshm_add_copy_stats(struct xshm_data *data, uint64_t bytes)
+{
+	uint64_t full = (uint64_t)data->adj_width * data->adj_height * 4;
+	uint64_t ts = os_gettime_ns();
+
+	data->copied_bytes += bytes;
+	data->full_bytes += full;
+	data->total_copied_bytes += bytes;
+	data->total_full_bytes += full;
+
+	if (!data->stats_ts) {
+		data->stats_ts = ts;
+	} else if (ts - data->stats_ts >= 1000000000ULL) {
+		uint64_t elapsed = ts - data->stats_ts;
+		data->copy_rate = data->copied_bytes * 1000000000ULL / elapsed;
+		data->full_rate = data->full_bytes * 1000000000ULL / elapsed;
+		data->copied_bytes = 0;
+		data->full_bytes = 0;
+		data->stats_ts = ts;
+	}
+}
+
+/**
+ * Drop the damage notifications, the damage is fetched every tick
+ */
+static void xshm_drain_events(struct xshm_data *data)
+{
+	xcb_generic_event_t *ev;
+
+	while ((ev = xcb_poll_for_event(data->xcb)) != NULL)
+		free(ev);
+}
+
+/**
+ * Collect the damaged rectangles within the captured area
+ *
+ * @return false if a full frame should be fetched instead
+ */
+static bool xshm_get_damage(struct xshm_data *data,
+			    xcb_xfixes_fetch_region_reply_t *reg_r)
+{
+	xcb_rectangle_t *rects = xcb_xfixes_fetch_region_rectangles(reg_r);
+	int count = xcb_xfixes_fetch_region_rectangles_length(reg_r);
+	int_fast32_t right = data->adj_x_org + data->adj_width;
+	int_fast32_t bottom = data->adj_y_org + data->adj_height;
+	uint64_t area = 0;
+
+	da_resize(data->rects, 0);
+
+	for (int i = 0; i < count; i++) {
+		int_fast32_t x1 = rects[i].x;
+		int_fast32_t y1 = rects[i].y;
+		int_fast32_t x2 = x1 + rects[i].width;
+		int_fast32_t y2 = y1 + rects[i].height;
+
+		if (x1 < data->adj_x_org)
+			x1 = data->adj_x_org;
+		if (y1 < data->adj_y_org)
+			y1 = data->adj_y_org;
+		if (x2 > right)
+			x2 = right;
+		if (y2 > bottom)
+			y2 = bottom;
+		if (x1 >= x2 || y1 >= y2)
+			continue;
+
+		xcb_rectangle_t *rect = da_push_back_new(data->rects);
+		rect->x = (int16_t)(x1 - data->adj_x_org);
+		rect->y = (int16_t)(y1 - data->adj_y_org);
+		rect->width = (uint16_t)(x2 - x1);
+		rect->height = (uint16_t)(y2 - y1);
+		area += (uint64_t)rect->width * rect->height;
+	}
+
+	if (data->rects.num > XSHM_MAX_DAMAGE_RECTS)
+		return false;
+
+	return area * 100 <= (uint64_t)data->adj_width * data->adj_height *
+				     XSHM_MAX_DAMAGE_PERCENT;
+}
+
+/**
+ * Fetch the damaged rectangles from the x server
+ *
+ * The rectangles don't overlap, so they're packed one after another into the
+ * shared memory segment.
+ *
+ * @return false if a full frame has to be fetched instead
+ */
+static bool xshm_fetch_damage(struct xshm_data *data)
+{
+	xcb_shm_get_image_cookie_t img_c[XSHM_MAX_DAMAGE_RECTS];
+	uint32_t offset = 0;
+	bool success = true;
+
+	for (size_t i = 0; i < data->rects.num; i++) {
+		xcb_rectangle_t *rect = &data->rects.array[i];
+
+		img_c[i] = xcb_shm_get_image_unchecked(
+			data->xcb, data->xcb_screen->root,
+			data->adj_x_org + rect->x, data->adj_y_org + rect->y,
+			rect->width, rect->height, ~0,
+			XCB_IMAGE_FORMAT_Z_PIXMAP, data->xshm->seg, offset);
+
+		offset += (uint32_t)rect->width * rect->height * 4;
+	}
+
+	for (size_t i = 0; i < data->rects.num; i++) {
+		xcb_shm_get_image_reply_t *img_r;
+		img_r = xcb_shm_get_image_reply(data->xcb, img_c[i], NULL);
+		if (!img_r)
+			success = false;
+		free(img_r);
+	}
+
+	return success;
+}
+
+/**
+ * Upload the fetched rectangles to the texture
+ *
+ * @note requires to be called within the obs graphics context
+ */
+static void xshm_upload_damage(struct xshm_data *data)
+{
+	uint8_t *ptr = data->xshm->data;
+	uint64_t bytes = 0;
+
+	for (size_t i = 0; i < data->rects.num; i++) {
+		xcb_rectangle_t *rect = &data->rects.array[i];
+		uint32_t size = (uint32_t)rect->width * rect->height * 4;
+
+		if (!gs_texture_set_image_region(data->texture, ptr,
+						 rect->width * 4, rect->x,
+						 rect->y, rect->width,
+						 rect->height)) {
+			/* the next tick captures a full frame */
+			blog(LOG_INFO, "Texture regions can't be updated, "
+				       "capturing full frames");
+			xshm_free_damage(data);
+			return;
+		}
+
+		ptr += size;
+		bytes += size;
+	}
+
+	xshm_add_copy_stats(data, bytes);
+}
+
+/**
+ * Fetch the whole captured area from the x server
+ */
+static bool xshm_fetch_full(struct xshm_data *data)
+{
+	xcb_shm_get_image_cookie_t img_c;
+	xcb_shm_get_image_reply_t *img_r;
+
+	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
+					    data->adj_x_org, data->adj_y_org,
+					    data->adj_width, data->adj_height,
+					    ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+					    data->xshm->seg, 0);
+	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
+
+	free(img_r);
+	return img_r != NULL;
+}
+
 /**
  * Prepare the capture data
+ *
+ * With damage tracking only the rectangles that changed since the last tick
+ * are fetched and uploaded, and nothing is when the screen is static.
  */
 static void xshm_video_tick(void *vptr, float seconds)
 {
@@ -480,34 +778,54 @@ static void xshm_video_tick(void *vptr, float seconds)
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t img_c;
-	xcb_shm_get_image_reply_t *img_r;
 	xcb_xfixes_get_cursor_image_cookie_t cur_c;
 	xcb_xfixes_get_cursor_image_reply_t *cur_r;
+	xcb_xfixes_fetch_region_cookie_t reg_c;
+	xcb_xfixes_fetch_region_reply_t *reg_r;
+	bool full = true;
+	bool fetched;
 
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
-					    data->adj_x_org, data->adj_y_org,
-					    data->adj_width, data->adj_height,
-					    ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
-					    data->xshm->seg, 0);
 	cur_c = xcb_xfixes_get_cursor_image_unchecked(data->xcb);
 
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
-	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
+	if (data->use_damage) {
+		/* damage done after the subtraction is reported next tick */
+		xcb_damage_subtract(data->xcb, data->damage, XCB_NONE,
+				    data->damage_region);
+		reg_c = xcb_xfixes_fetch_region_unchecked(data->xcb,
+							  data->damage_region);
+		reg_r = xcb_xfixes_fetch_region_reply(data->xcb, reg_c, NULL);
+		xshm_drain_events(data);
+
+		if (reg_r && !data->full_update)
+			full = !xshm_get_damage(data, reg_r);
+		free(reg_r);
+	}
+
+	fetched = !full && xshm_fetch_damage(data);
+	if (!fetched) {
+		full = true;
+		fetched = xshm_fetch_full(data);
+	}
 
-	if (!img_r)
-		goto exit;
+	/* retry with a full frame if this one was lost */
+	data->full_update = !fetched;
+
+	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
 
 	obs_enter_graphics();
 
-	gs_texture_set_image(data->texture, (void *)data->xshm->data,
-			     data->adj_width * 4, false);
+	if (fetched && full) {
+		gs_texture_set_image(data->texture, (void *)data->xshm->data,
+				     data->adj_width * 4, false);
+		xshm_add_copy_stats(data, (uint64_t)data->adj_width *
+						  data->adj_height * 4);
+	} else if (fetched) {
+		xshm_upload_damage(data);
+	}
 	xcb_xcursor_update(data->cursor, cur_r);
 
 	obs_leave_graphics();
 
-exit:
-	free(img_r);
 	free(cur_r);
 }
 
@@ -16,6 +16,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <obs-module.h>
 
+#include "v4l2-decoder.h"
+
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("linux-v4l2", "en-US")
 MODULE_EXPORT const char *obs_module_description(void)
@@ -30,3 +32,8 @@ bool obs_module_load(void)
 	obs_register_source(&v4l2_input);
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	v4l2_decoder_free_pool();
+}
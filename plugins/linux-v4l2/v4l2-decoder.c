@@ -0,0 +1,538 @@
+/*
+Copyright (C) 2026 by agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <limits.h>
+#include <inttypes.h>
+
+#include <util/threading.h>
+#include <util/task-pool.h>
+#include <util/circlebuf.h>
+#include <util/bmem.h>
+#include <obs-ffmpeg-compat.h>
+
+#include <libavcodec/avcodec.h>
+
+#include "v4l2-decoder.h"
+
+#define blog(level, msg, ...) blog(level, "v4l2-decoder: " msg, ##__VA_ARGS__)
+
+/**
+ * A dequeued buffer waiting to be decoded
+ */
+struct v4l2_decode_job {
+	uint64_t seq;
+	uint64_t timestamp;
+	uint32_t index;
+	size_t size;
+};
+
+/**
+ * A decoded frame waiting for the frames before it to be output
+ */
+struct v4l2_decode_result {
+	struct obs_source_frame *frame;
+	uint32_t index;
+	bool finished;
+};
+
+/**
+ * One libavcodec decoder, only ever used by one pool thread at a time
+ */
+struct v4l2_decode_ctx {
+	struct v4l2_decoder *dec;
+	AVCodecContext *decoder;
+	AVFrame *frame;
+	uint8_t *packet_buffer;
+	size_t packet_size;
+	bool busy;
+};
+
+struct v4l2_decoder {
+	obs_source_t *source;
+	os_task_pool_t *pool;
+	int_fast32_t dev;
+	struct v4l2_buffer_data *buffers;
+	enum video_range_type range;
+
+	pthread_mutex_t mutex;
+	os_event_t *idle;
+	struct circlebuf jobs;
+	struct v4l2_decode_result *results;
+	uint64_t next_seq;
+	uint64_t next_out;
+
+	struct v4l2_decode_ctx ctxs[V4L2_DECODER_MAX_CONTEXTS];
+	size_t num_ctxs;
+	size_t busy_ctxs;
+
+	bool stopping;
+	bool warned;
+	uint64_t decoded;
+	uint64_t dropped;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static os_task_pool_t *pool = NULL;
+
+static os_task_pool_t *get_pool(void)
+{
+	os_task_pool_t *ret;
+
+	pthread_mutex_lock(&pool_mutex);
+	if (!pool)
+		pool = os_task_pool_create("v4l2: decoder", 0);
+	ret = pool;
+	pthread_mutex_unlock(&pool_mutex);
+
+	return ret;
+}
+
+void v4l2_decoder_free_pool(void)
+{
+	pthread_mutex_lock(&pool_mutex);
+	os_task_pool_destroy(pool);
+	pool = NULL;
+	pthread_mutex_unlock(&pool_mutex);
+}
+
+static enum AVCodecID v4l2_to_codec_id(uint_fast32_t format)
+{
+	switch (format) {
+	case V4L2_PIX_FMT_MJPEG:
+	case V4L2_PIX_FMT_JPEG:
+		return AV_CODEC_ID_MJPEG;
+	case V4L2_PIX_FMT_H264:
+		return AV_CODEC_ID_H264;
+	default:
+		return AV_CODEC_ID_NONE;
+	}
+}
+
+bool v4l2_decoder_supported(uint_fast32_t format)
+{
+	enum AVCodecID id = v4l2_to_codec_id(format);
+	return id != AV_CODEC_ID_NONE && avcodec_find_decoder(id) != NULL;
+}
+
+static inline enum video_format convert_pixel_format(int f, bool *full)
+{
+	*full = false;
+
+	switch (f) {
+	case AV_PIX_FMT_YUVJ420P:
+		*full = true;
+		/* fall through */
+	case AV_PIX_FMT_YUV420P:
+		return VIDEO_FORMAT_I420;
+	case AV_PIX_FMT_YUVJ422P:
+		*full = true;
+		/* fall through */
+	case AV_PIX_FMT_YUV422P:
+		return VIDEO_FORMAT_I422;
+	case AV_PIX_FMT_YUVJ444P:
+		*full = true;
+		/* fall through */
+	case AV_PIX_FMT_YUV444P:
+		return VIDEO_FORMAT_I444;
+	case AV_PIX_FMT_NV12:
+		return VIDEO_FORMAT_NV12;
+	case AV_PIX_FMT_YUYV422:
+		return VIDEO_FORMAT_YUY2;
+	case AV_PIX_FMT_UYVY422:
+		return VIDEO_FORMAT_UYVY;
+	default:
+		return VIDEO_FORMAT_NONE;
+	}
+}
+
+static inline uint32_t plane_height(enum video_format format, size_t plane,
+				    uint32_t height)
+{
+	if (plane && (format == VIDEO_FORMAT_I420 ||
+		      format == VIDEO_FORMAT_NV12))
+		return (height + 1) / 2;
+	return height;
+}
+
+static void copy_planes(struct obs_source_frame *out, const AVFrame *frame)
+{
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (!out->data[i] || !frame->data[i])
+			break;
+
+		uint32_t height = plane_height(out->format, i, out->height);
+		uint32_t src_linesize = (uint32_t)frame->linesize[i];
+		uint32_t dst_linesize = out->linesize[i];
+
+		if (src_linesize == dst_linesize) {
+			memcpy(out->data[i], frame->data[i],
+			       (size_t)dst_linesize * height);
+			continue;
+		}
+
+		uint32_t size = src_linesize < dst_linesize ? src_linesize
+							    : dst_linesize;
+		for (uint32_t y = 0; y < height; y++)
+			memcpy(out->data[i] + y * dst_linesize,
+			       frame->data[i] + y * src_linesize, size);
+	}
+}
+
+static bool init_ctx(struct v4l2_decoder *dec, struct v4l2_decode_ctx *ctx,
+		     enum AVCodecID id)
+{
+	AVCodec *codec = avcodec_find_decoder(id);
+	int ret;
+
+	ctx->dec = dec;
+	if (!codec)
+		return false;
+
+	ctx->decoder = avcodec_alloc_context3(codec);
+	ctx->frame = av_frame_alloc();
+	if (!ctx->decoder || !ctx->frame)
+		return false;
+
+	if (id == AV_CODEC_ID_H264) {
+		/* frame threading would add a frame of latency per thread,
+		 * slices keep the decoder one in one out */
+		ctx->decoder->thread_count = 0;
+		ctx->decoder->thread_type = FF_THREAD_SLICE;
+		ctx->decoder->flags |= AV_CODEC_FLAG_LOW_DELAY;
+	} else {
+		/* parallelism comes from decoding several frames at once */
+		ctx->decoder->thread_count = 1;
+	}
+
+	ret = avcodec_open2(ctx->decoder, codec, NULL);
+	if (ret < 0) {
+		blog(LOG_ERROR, "Failed to open %s decoder: %s", codec->name,
+		     av_err2str(ret));
+		return false;
+	}
+
+	return true;
+}
+
+static void free_ctx(struct v4l2_decode_ctx *ctx)
+{
+	avcodec_free_context(&ctx->decoder);
+	av_frame_free(&ctx->frame);
+	bfree(ctx->packet_buffer);
+}
+
+struct v4l2_decoder *v4l2_decoder_create(obs_source_t *source,
+					 int_fast32_t dev,
+					 struct v4l2_buffer_data *buf,
+					 uint_fast32_t format,
+					 enum video_range_type range)
+{
+	enum AVCodecID id = v4l2_to_codec_id(format);
+	os_task_pool_t *decode_pool;
+	struct v4l2_decoder *dec;
+	size_t num_ctxs = 1;
+
+	if (id == AV_CODEC_ID_NONE || buf->count < 2)
+		return NULL;
+
+	decode_pool = get_pool();
+	if (!decode_pool)
+		return NULL;
+
+	/* every frame in flight holds a mapped buffer, one of them has to
+	 * stay with the device */
+	if (id == AV_CODEC_ID_MJPEG) {
+		num_ctxs = os_task_pool_num_threads(decode_pool);
+		if (num_ctxs > V4L2_DECODER_MAX_CONTEXTS)
+			num_ctxs = V4L2_DECODER_MAX_CONTEXTS;
+		if (num_ctxs > buf->count - 1)
+			num_ctxs = buf->count - 1;
+		if (!num_ctxs)
+			num_ctxs = 1;
+	}
+
+	dec = bzalloc(sizeof(struct v4l2_decoder));
+	dec->source = source;
+	dec->pool = decode_pool;
+	dec->dev = dev;
+	dec->buffers = buf;
+	dec->range = range;
+	dec->num_ctxs = num_ctxs;
+	dec->results = bzalloc(buf->count * sizeof(struct v4l2_decode_result));
+
+	if (pthread_mutex_init(&dec->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_event_init(&dec->idle, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail_event;
+	os_event_signal(dec->idle);
+
+	for (size_t i = 0; i < num_ctxs; i++) {
+		if (!init_ctx(dec, &dec->ctxs[i], id))
+			goto fail;
+	}
+
+	blog(LOG_INFO, "Decoding %s with %zu decoder(s)",
+	     avcodec_get_name(id), num_ctxs);
+	return dec;
+
+fail:
+	for (size_t i = 0; i < num_ctxs; i++)
+		free_ctx(&dec->ctxs[i]);
+	os_event_destroy(dec->idle);
+fail_event:
+	pthread_mutex_destroy(&dec->mutex);
+fail_mutex:
+	bfree(dec->results);
+	bfree(dec);
+	return NULL;
+}
+
+void v4l2_decoder_destroy(struct v4l2_decoder *dec)
+{
+	if (!dec)
+		return;
+
+	pthread_mutex_lock(&dec->mutex);
+	dec->stopping = true;
+	pthread_mutex_unlock(&dec->mutex);
+
+	os_event_wait(dec->idle);
+
+	/* the last task signals the event with the mutex held */
+	pthread_mutex_lock(&dec->mutex);
+	pthread_mutex_unlock(&dec->mutex);
+
+	blog(LOG_INFO, "Decoded %" PRIu64 " frames, dropped %" PRIu64,
+	     dec->decoded, dec->dropped);
+
+	for (size_t i = 0; i < dec->num_ctxs; i++)
+		free_ctx(&dec->ctxs[i]);
+	circlebuf_free(&dec->jobs);
+	os_event_destroy(dec->idle);
+	pthread_mutex_destroy(&dec->mutex);
+	bfree(dec->results);
+	bfree(dec);
+}
+
+/* libavcodec may read past the end of the packet, so the padding is cleared
+ * in place when the mapped buffer has room for it */
+static uint8_t *get_packet_data(struct v4l2_decode_ctx *ctx,
+				const struct v4l2_decode_job *job)
+{
+	struct v4l2_mmap_info *info = &ctx->dec->buffers->info[job->index];
+	uint8_t *data = info->start;
+	size_t new_size = job->size + INPUT_BUFFER_PADDING_SIZE;
+
+	if (new_size <= info->length) {
+		memset(data + job->size, 0, INPUT_BUFFER_PADDING_SIZE);
+		return data;
+	}
+
+	if (ctx->packet_size < new_size) {
+		ctx->packet_buffer = brealloc(ctx->packet_buffer, new_size);
+		ctx->packet_size = new_size;
+	}
+
+	memset(ctx->packet_buffer + job->size, 0, INPUT_BUFFER_PADDING_SIZE);
+	memcpy(ctx->packet_buffer, data, job->size);
+	return ctx->packet_buffer;
+}
+
+static void decode_error(struct v4l2_decoder *dec, const char *msg, int ret)
+{
+	blog(dec->warned ? LOG_DEBUG : LOG_WARNING, "%s: %s", msg,
+	     av_err2str(ret));
+	dec->warned = true;
+}
+
+static struct obs_source_frame *decode(struct v4l2_decode_ctx *ctx,
+				       const struct v4l2_decode_job *job)
+{
+	struct v4l2_decoder *dec = ctx->dec;
+	struct obs_source_frame *out;
+	AVFrame *frame = ctx->frame;
+	AVPacket packet = {0};
+	enum video_range_type range = dec->range;
+	enum video_colorspace cs;
+	enum video_format format;
+	bool full;
+	int ret;
+
+	if (!job->size || job->size > INT_MAX)
+		return NULL;
+
+	av_init_packet(&packet);
+	packet.data = get_packet_data(ctx, job);
+	packet.size = (int)job->size;
+	packet.pts = (int64_t)job->timestamp;
+
+	ret = avcodec_send_packet(ctx->decoder, &packet);
+	if (ret == 0)
+		ret = avcodec_receive_frame(ctx->decoder, frame);
+	if (ret < 0) {
+		if (ret != AVERROR(EAGAIN))
+			decode_error(dec, "Failed to decode frame", ret);
+		return NULL;
+	}
+
+	format = convert_pixel_format(frame->format, &full);
+	if (format == VIDEO_FORMAT_NONE) {
+		decode_error(dec, "Unsupported decoded pixel format",
+			     AVERROR(EINVAL));
+		goto unref;
+	}
+
+	if (range == VIDEO_RANGE_DEFAULT)
+		range = (full || frame->color_range == AVCOL_RANGE_JPEG)
+				? VIDEO_RANGE_FULL
+				: VIDEO_RANGE_PARTIAL;
+	cs = frame->colorspace == AVCOL_SPC_BT709 ? VIDEO_CS_709
+						  : VIDEO_CS_DEFAULT;
+
+	out = obs_source_get_writable_frame(dec->source, format, frame->width,
+					    frame->height,
+					    range == VIDEO_RANGE_FULL);
+	if (!out)
+		goto unref;
+
+	copy_planes(out, frame);
+	video_format_get_parameters(cs, range, out->color_matrix,
+				    out->color_range_min,
+				    out->color_range_max);
+	out->timestamp = frame->best_effort_timestamp != AV_NOPTS_VALUE
+				 ? (uint64_t)frame->best_effort_timestamp
+				 : job->timestamp;
+
+	av_frame_unref(frame);
+	return out;
+
+unref:
+	av_frame_unref(frame);
+	return NULL;
+}
+
+static void requeue_buffer(struct v4l2_decoder *dec, uint32_t index)
+{
+	struct v4l2_buffer buf;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+
+	if (v4l2_ioctl(dec->dev, VIDIOC_QBUF, &buf) < 0 && !dec->stopping)
+		blog(LOG_DEBUG, "failed to enqueue buffer");
+}
+
+/* outputs finished frames in the order their buffers were dequeued.  the
+ * buffers are only handed back to the device here, which bounds the number
+ * of frames in flight by the number of mapped buffers */
+static void output_finished(struct v4l2_decoder *dec)
+{
+	uint32_t count = (uint32_t)dec->buffers->count;
+
+	while (dec->next_out != dec->next_seq) {
+		struct v4l2_decode_result *res =
+			&dec->results[dec->next_out % count];
+		if (!res->finished)
+			break;
+
+		if (!res->frame) {
+			dec->dropped++;
+		} else if (dec->stopping) {
+			obs_source_discard_writable_frame(dec->source,
+							  res->frame);
+			dec->dropped++;
+		} else {
+			obs_source_output_writable_frame(dec->source,
+							 res->frame);
+			dec->decoded++;
+		}
+
+		requeue_buffer(dec, res->index);
+		memset(res, 0, sizeof(*res));
+		dec->next_out++;
+	}
+}
+
+static void decode_task(void *param)
+{
+	struct v4l2_decode_ctx *ctx = param;
+	struct v4l2_decoder *dec = ctx->dec;
+	uint32_t count = (uint32_t)dec->buffers->count;
+
+	pthread_mutex_lock(&dec->mutex);
+
+	while (dec->jobs.size) {
+		struct v4l2_decode_job job;
+		struct obs_source_frame *frame = NULL;
+		bool stopping = dec->stopping;
+
+		circlebuf_pop_front(&dec->jobs, &job, sizeof(job));
+		pthread_mutex_unlock(&dec->mutex);
+
+		if (!stopping)
+			frame = decode(ctx, &job);
+
+		pthread_mutex_lock(&dec->mutex);
+		dec->results[job.seq % count].frame = frame;
+		dec->results[job.seq % count].finished = true;
+		output_finished(dec);
+	}
+
+	ctx->busy = false;
+	if (--dec->busy_ctxs == 0)
+		os_event_signal(dec->idle);
+
+	pthread_mutex_unlock(&dec->mutex);
+}
+
+void v4l2_decoder_push(struct v4l2_decoder *dec, uint32_t index, size_t size,
+		       uint64_t timestamp)
+{
+	struct v4l2_decode_job job;
+	struct v4l2_decode_result *res;
+
+	pthread_mutex_lock(&dec->mutex);
+
+	job.seq = dec->next_seq++;
+	job.timestamp = timestamp;
+	job.index = index;
+	job.size = size;
+
+	res = &dec->results[job.seq % dec->buffers->count];
+	res->index = index;
+	res->finished = false;
+
+	circlebuf_push_back(&dec->jobs, &job, sizeof(job));
+
+	if (dec->busy_ctxs < dec->num_ctxs) {
+		for (size_t i = 0; i < dec->num_ctxs; i++) {
+			struct v4l2_decode_ctx *ctx = &dec->ctxs[i];
+			if (ctx->busy)
+				continue;
+
+			ctx->busy = true;
+			if (dec->busy_ctxs++ == 0)
+				os_event_reset(dec->idle);
+			os_task_pool_queue(dec->pool, decode_task, ctx);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&dec->mutex);
+}
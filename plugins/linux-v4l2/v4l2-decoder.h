@@ -0,0 +1,100 @@
+/*
+Copyright (C) 2026 by agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <obs-module.h>
+
+#include "v4l2-helpers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Maximum number of frames of one device that are decoded in parallel
+ *
+ * Only formats without inter frame dependencies (MJPEG) use more than one
+ * decoder, H.264 is always decoded by a single one.
+ */
+#define V4L2_DECODER_MAX_CONTEXTS 4
+
+struct v4l2_decoder;
+
+/**
+ * Check if a compressed pixel format can be decoded
+ *
+ * @param format v4l2 format id
+ *
+ * @return true if the format is supported by the decoder
+ */
+bool v4l2_decoder_supported(uint_fast32_t format);
+
+/**
+ * Create a decoder for a device
+ *
+ * Frames are decoded on a thread pool shared by all v4l2 sources, straight
+ * from the mapped buffers and into the async frame cache of the source.
+ *
+ * @param source the source the decoded frames are output to
+ * @param dev handle for the v4l2 device
+ * @param buf buffer data of the device, must outlive the decoder
+ * @param format v4l2 format id of the compressed format
+ * @param range color range set by the user
+ *
+ * @return the decoder or NULL on failure
+ */
+struct v4l2_decoder *v4l2_decoder_create(obs_source_t *source,
+					 int_fast32_t dev,
+					 struct v4l2_buffer_data *buf,
+					 uint_fast32_t format,
+					 enum video_range_type range);
+
+/**
+ * Destroy a decoder
+ *
+ * Frames that haven't been decoded yet are dropped.  This waits until the
+ * decoder doesn't use any of the mapped buffers anymore, so it has to be
+ * called before the capture is stopped.
+ *
+ * @param dec the decoder
+ */
+void v4l2_decoder_destroy(struct v4l2_decoder *dec);
+
+/**
+ * Queue a dequeued buffer for decoding
+ *
+ * The decoder takes over the buffer and enqueues it on the device again once
+ * the frame has been output.  Frames are output in the order they were
+ * pushed.
+ *
+ * @param dec the decoder
+ * @param index index of the mapped buffer
+ * @param size number of bytes used in the buffer
+ * @param timestamp timestamp of the frame
+ */
+void v4l2_decoder_push(struct v4l2_decoder *dec, uint32_t index, size_t size,
+		       uint64_t timestamp);
+
+/**
+ * Free the decoder thread pool, called when the module is unloaded
+ */
+void v4l2_decoder_free_pool(void);
+
+#ifdef __cplusplus
+}
+#endif
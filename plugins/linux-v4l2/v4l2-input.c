@@ -37,6 +37,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "v4l2-controls.h"
 #include "v4l2-helpers.h"
+#include "v4l2-decoder.h"
 
 #if HAVE_UDEV
 #include "v4l2-udev.h"
@@ -161,6 +162,17 @@ static void *v4l2_thread(void *vptr)
 	struct v4l2_buffer buf;
 	struct obs_source_frame out;
 	size_t plane_offsets[MAX_AV_PLANES];
+	struct v4l2_decoder *decoder = NULL;
+
+	if (v4l2_decoder_supported(data->pixfmt)) {
+		decoder = v4l2_decoder_create(data->source, data->dev,
+					      &data->buffers, data->pixfmt,
+					      data->color_range);
+		if (!decoder) {
+			blog(LOG_ERROR, "Unable to create decoder");
+			goto exit;
+		}
+	}
 
 	if (v4l2_start_capture(data->dev, &data->buffers) < 0)
 		goto exit;
@@ -201,6 +213,14 @@ static void *v4l2_thread(void *vptr)
 			first_ts = out.timestamp;
 		out.timestamp -= first_ts;
 
+		/* the decoder hands the buffer back to the device itself */
+		if (decoder) {
+			v4l2_decoder_push(decoder, buf.index, buf.bytesused,
+					  out.timestamp);
+			frames++;
+			continue;
+		}
+
 		start = (uint8_t *)data->buffers.info[buf.index].start;
 		for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 			out.data[i] = start + plane_offsets[i];
@@ -217,6 +237,7 @@ static void *v4l2_thread(void *vptr)
 	blog(LOG_INFO, "Stopped capture after %" PRIu64 " frames", frames);
 
 exit:
+	v4l2_decoder_destroy(decoder);
 	v4l2_stop_capture(data->dev);
 	return NULL;
 }
@@ -398,7 +419,8 @@ static void v4l2_format_list(int dev, obs_property_t *prop)
 			dstr_cat(&buffer, " (Emulated)");
 
 		if (v4l2_to_obs_video_format(fmt.pixelformat) !=
-		    VIDEO_FORMAT_NONE) {
+			    VIDEO_FORMAT_NONE ||
+		    v4l2_decoder_supported(fmt.pixelformat)) {
 			obs_property_list_add_int(prop, buffer.array,
 						  fmt.pixelformat);
 			blog(LOG_INFO, "Pixelformat: %s (available)",
@@ -914,7 +936,8 @@ static void v4l2_init(struct v4l2_data *data)
 		blog(LOG_ERROR, "Unable to set format");
 		goto fail;
 	}
-	if (v4l2_to_obs_video_format(data->pixfmt) == VIDEO_FORMAT_NONE) {
+	if (v4l2_to_obs_video_format(data->pixfmt) == VIDEO_FORMAT_NONE &&
+	    !v4l2_decoder_supported(data->pixfmt)) {
 		blog(LOG_ERROR, "Selected video format not supported");
 		goto fail;
 	}
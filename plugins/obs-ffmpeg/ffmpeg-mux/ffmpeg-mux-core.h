@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "ffmpeg-mux.h"
+
+#include <libavformat/avformat.h>
+
+/*
+ * Muxing core shared by the obs-ffmpeg-mux helper process and the in-process
+ * muxer of the obs-ffmpeg plugin.  The caller fills in the parameters, hands
+ * over the codec headers, opens the output and then writes packets, exactly
+ * in the order they arrive over the helper's stdin.
+ *
+ * Strings in the parameters are owned by the caller and must stay valid
+ * until ffm_close.
+ */
+
+struct main_params {
+	char *file;
+	int has_video;
+	int tracks;
+	char *vcodec;
+	int vbitrate;
+	int gop;
+	int width;
+	int height;
+	int fps_num;
+	int fps_den;
+	int color_primaries;
+	int color_trc;
+	int colorspace;
+	int color_range;
+	char *acodec;
+	char *muxer_settings;
+};
+
+struct audio_params {
+	char *name;
+	int abitrate;
+	int sample_rate;
+	int channels;
+};
+
+struct header {
+	uint8_t *data;
+	int size;
+};
+
+struct audio_info {
+	AVStream *stream;
+	AVCodecContext *ctx;
+};
+
+typedef void (*ffm_log_cb)(void *param, bool error, const char *msg);
+
+struct ffmpeg_mux {
+	AVFormatContext *output;
+	AVStream *video_stream;
+	AVCodecContext *video_ctx;
+	struct audio_info *audio_infos;
+	struct main_params params;
+	struct audio_params *audio;
+	struct header video_header;
+	struct header *audio_header;
+	int num_audio_streams;
+	bool initialized;
+	char error[4096];
+
+	/* defaults to stdout/stderr when not set */
+	ffm_log_cb log;
+	void *log_param;
+};
+
+/* stores the codec extra data of a track, must be called for every track
+ * before ffm_open */
+extern void ffm_set_header(struct ffmpeg_mux *ffm, uint8_t *data,
+			   struct ffm_packet_info *info);
+
+/* creates the output and writes the container header, returns FFM_SUCCESS,
+ * FFM_ERROR or FFM_UNSUPPORTED */
+extern int ffm_open(struct ffmpeg_mux *ffm);
+
+extern bool ffm_write_packet(struct ffmpeg_mux *ffm, uint8_t *buf,
+			     struct ffm_packet_info *info);
+
+/* writes the trailer if opened and frees everything but the parameters */
+extern void ffm_close(struct ffmpeg_mux *ffm);
@@ -0,0 +1,286 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/bmem.h>
+#include <util/circlebuf.h>
+#include <util/threading.h>
+#include <util/platform.h>
+#include "mux-writer.h"
+
+struct mux_item {
+	struct ffm_packet_info info;
+	struct encoder_packet packet;
+	bool refcounted;
+	bool mapped;
+};
+
+struct mux_writer {
+	struct ffmpeg_mux ffm;
+	struct main_params params;
+	struct audio_params *audio;
+	int headers_left;
+	int result;
+	char error[4096];
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	os_sem_t *items;
+	os_event_t *space;
+	struct circlebuf queue;
+	size_t queued_size;
+	size_t max_size;
+	volatile bool failed;
+};
+
+static inline char *dup_str(const char *str)
+{
+	return bstrdup(str ? str : "");
+}
+
+static void mux_writer_log(void *param, bool error, const char *msg)
+{
+	struct mux_writer *writer = param;
+
+	/* muxer settings are already logged by the output */
+	if (error) {
+		strncpy(writer->error, msg, sizeof(writer->error) - 1);
+		blog(LOG_WARNING, "[ffmpeg-mux] %s", msg);
+	}
+}
+
+static void release_item(struct mux_item *item)
+{
+	if (item->refcounted)
+		obs_encoder_packet_release(&item->packet);
+	else if (!item->mapped)
+		bfree(item->packet.data);
+}
+
+/* mapped data isn't held by the queue, so it doesn't count towards its size */
+static inline size_t item_size(const struct mux_item *item)
+{
+	return item->mapped ? 0 : item->packet.size;
+}
+
+static void mux_writer_fail(struct mux_writer *writer, int result)
+{
+	writer->result = result;
+	os_atomic_set_bool(&writer->failed, true);
+	os_event_signal(writer->space);
+}
+
+static void process_item(struct mux_writer *writer, struct mux_item *item)
+{
+	/* the helper process reads one header per track before anything
+	 * else, so the codec extra data is known when opening the file */
+	if (writer->headers_left) {
+		ffm_set_header(&writer->ffm, item->packet.data, &item->info);
+
+		if (--writer->headers_left == 0) {
+			int ret = ffm_open(&writer->ffm);
+			if (ret != FFM_SUCCESS) {
+				blog(LOG_WARNING, "[ffmpeg-mux] Couldn't "
+						  "initialize muxer");
+				mux_writer_fail(writer, ret);
+			}
+		}
+		return;
+	}
+
+	ffm_write_packet(&writer->ffm, item->packet.data, &item->info);
+}
+
+static void *mux_writer_thread(void *data)
+{
+	struct mux_writer *writer = data;
+
+	os_set_thread_name("ffmpeg-mux: writer");
+
+	while (os_sem_wait(writer->items) == 0) {
+		struct mux_item item;
+
+		pthread_mutex_lock(&writer->mutex);
+
+		/* an empty queue means we're being asked to stop */
+		if (!writer->queue.size) {
+			pthread_mutex_unlock(&writer->mutex);
+			break;
+		}
+
+		circlebuf_pop_front(&writer->queue, &item, sizeof(item));
+		writer->queued_size -= item_size(&item);
+		pthread_mutex_unlock(&writer->mutex);
+
+		os_event_signal(writer->space);
+
+		if (!os_atomic_load_bool(&writer->failed))
+			process_item(writer, &item);
+
+		release_item(&item);
+	}
+
+	ffm_close(&writer->ffm);
+	return NULL;
+}
+
+struct mux_writer *mux_writer_create(const struct main_params *params,
+				     const struct audio_params *audio,
+				     size_t max_size)
+{
+	struct mux_writer *writer = bzalloc(sizeof(*writer));
+
+	writer->params = *params;
+	writer->params.file = dup_str(params->file);
+	writer->params.vcodec = dup_str(params->vcodec);
+	writer->params.acodec = dup_str(params->acodec);
+	writer->params.muxer_settings = dup_str(params->muxer_settings);
+
+	if (params->tracks) {
+		writer->audio =
+			bzalloc(sizeof(*writer->audio) * params->tracks);
+
+		for (int i = 0; i < params->tracks; i++) {
+			writer->audio[i] = audio[i];
+			writer->audio[i].name = dup_str(audio[i].name);
+		}
+	}
+
+	writer->ffm.params = writer->params;
+	writer->ffm.audio = writer->audio;
+	writer->ffm.log = mux_writer_log;
+	writer->ffm.log_param = writer;
+	writer->headers_left = params->has_video + params->tracks;
+	writer->max_size = max_size;
+
+	if (pthread_mutex_init(&writer->mutex, NULL) != 0)
+		goto fail_mutex;
+	if (os_sem_init(&writer->items, 0) != 0)
+		goto fail;
+	if (os_event_init(&writer->space, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (pthread_create(&writer->thread, NULL, mux_writer_thread,
+			   writer) != 0)
+		goto fail;
+
+	return writer;
+
+fail:
+	os_event_destroy(writer->space);
+	os_sem_destroy(writer->items);
+	pthread_mutex_destroy(&writer->mutex);
+fail_mutex:
+	blog(LOG_WARNING, "[ffmpeg-mux] Failed to create writer thread");
+	for (int i = 0; i < params->tracks; i++)
+		bfree(writer->audio[i].name);
+	bfree(writer->audio);
+	bfree(writer->params.file);
+	bfree(writer->params.vcodec);
+	bfree(writer->params.acodec);
+	bfree(writer->params.muxer_settings);
+	bfree(writer);
+	return NULL;
+}
+
+static bool queue_item(struct mux_writer *writer, struct mux_item *item,
+		       struct encoder_packet *packet)
+{
+	size_t size = item->mapped ? 0 : packet->size;
+
+	pthread_mutex_lock(&writer->mutex);
+
+	/* always let at least one item through so oversized packets can't
+	 * block forever */
+	while (writer->queue.size &&
+	       writer->queued_size + size > writer->max_size &&
+	       !os_atomic_load_bool(&writer->failed)) {
+		pthread_mutex_unlock(&writer->mutex);
+		os_event_wait(writer->space);
+		pthread_mutex_lock(&writer->mutex);
+	}
+
+	if (os_atomic_load_bool(&writer->failed)) {
+		pthread_mutex_unlock(&writer->mutex);
+		return false;
+	}
+
+	if (item->refcounted) {
+		obs_encoder_packet_ref(&item->packet, packet);
+	} else {
+		item->packet = *packet;
+		if (!item->mapped)
+			item->packet.data =
+				bmemdup(packet->data, packet->size);
+	}
+
+	circlebuf_push_back(&writer->queue, item, sizeof(*item));
+	writer->queued_size += size;
+	pthread_mutex_unlock(&writer->mutex);
+
+	os_sem_post(writer->items);
+	return true;
+}
+
+bool mux_writer_write(struct mux_writer *writer,
+		      const struct ffm_packet_info *info,
+		      struct encoder_packet *packet, bool refcounted)
+{
+	struct mux_item item = {.info = *info, .refcounted = refcounted};
+	return queue_item(writer, &item, packet);
+}
+
+bool mux_writer_write_mapped(struct mux_writer *writer,
+			     const struct ffm_packet_info *info,
+			     struct encoder_packet *packet)
+{
+	struct mux_item item = {.info = *info, .mapped = true};
+	return queue_item(writer, &item, packet);
+}
+
+const char *mux_writer_get_error(struct mux_writer *writer)
+{
+	return writer->error;
+}
+
+int mux_writer_destroy(struct mux_writer *writer)
+{
+	int result;
+
+	if (!writer)
+		return 0;
+
+	os_sem_post(writer->items);
+	pthread_join(writer->thread, NULL);
+
+	/* never received all headers, the helper would have failed to
+	 * initialize as well */
+	result = writer->headers_left ? FFM_ERROR : writer->result;
+
+	circlebuf_free(&writer->queue);
+	os_event_destroy(writer->space);
+	os_sem_destroy(writer->items);
+	pthread_mutex_destroy(&writer->mutex);
+
+	for (int i = 0; i < writer->params.tracks; i++)
+		bfree(writer->audio[i].name);
+	bfree(writer->audio);
+	bfree(writer->params.file);
+	bfree(writer->params.vcodec);
+	bfree(writer->params.acodec);
+	bfree(writer->params.muxer_settings);
+	bfree(writer);
+	return result;
+}
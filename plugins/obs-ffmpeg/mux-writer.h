@@ -0,0 +1,60 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+#include "ffmpeg-mux/ffmpeg-mux-core.h"
+
+#define MUX_WRITER_QUEUE_SIZE (16 * 1024 * 1024)
+
+/*
+ * In-process replacement for the obs-ffmpeg-mux helper process.  Takes the
+ * same stream of headers and packets that would be written to the helper's
+ * pipe, queues them and muxes them on a dedicated writer thread.
+ *
+ * The queue is bounded to max_size bytes, mux_writer_write blocks while it
+ * is full just like a full pipe would.
+ */
+
+struct mux_writer;
+
+/* parameters are copied */
+extern struct mux_writer *mux_writer_create(const struct main_params *params,
+					    const struct audio_params *audio,
+					    size_t max_size);
+
+/* queues a header or packet.  refcounted packets are referenced, anything
+ * else (codec headers, data that isn't owned by an encoder packet) is
+ * copied.  returns false once the muxer has failed */
+extern bool mux_writer_write(struct mux_writer *writer,
+			     const struct ffm_packet_info *info,
+			     struct encoder_packet *packet, bool refcounted);
+
+/* queues a packet without copying or referencing its data, which has to
+ * stay valid until mux_writer_destroy returns (e.g. packets stored in pinned
+ * replay buffer segments).  mapped data doesn't count towards max_size */
+extern bool mux_writer_write_mapped(struct mux_writer *writer,
+				    const struct ffm_packet_info *info,
+				    struct encoder_packet *packet);
+
+/* returns the last error reported by the muxer, if any */
+extern const char *mux_writer_get_error(struct mux_writer *writer);
+
+/* finishes writing everything queued, closes the file and returns the result
+ * the helper process would have exited with */
+extern int mux_writer_destroy(struct mux_writer *writer);
@@ -25,6 +25,8 @@
 #include <util/circlebuf.h>
 #include <util/threading.h>
 #include "ffmpeg-mux/ffmpeg-mux.h"
+#include "replay-segment.h"
+#include "mux-writer.h"
 
 #ifdef _WIN32
 #include "util/windows/win-version.h"
@@ -39,9 +41,30 @@
 #define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 
+/* a buffered replay packet, data is either a referenced encoder packet or
+ * points into a disk segment */
+struct replay_packet {
+	struct encoder_packet packet;
+	struct replay_segment *segment;
+};
+
+/* time spent handing packets to the muxer, either writing them to the
+ * helper's pipe or queueing them for the in-process writer */
+struct mux_stall_stats {
+	uint64_t packets;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t stalls;
+};
+
+#define MUX_STALL_THRESHOLD_NS 1000000ULL
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+	struct mux_writer *writer;
+	bool in_process;
+	struct mux_stall_stats stall_stats;
 	int64_t stop_ts;
 	uint64_t total_bytes;
 	struct dstr path;
@@ -51,20 +74,31 @@ struct ffmpeg_muxer {
 	volatile bool capturing;
 
 	/* replay buffer */
-	struct circlebuf packets;
+	struct circlebuf packets; /* struct replay_packet */
 	int64_t cur_size;
 	int64_t cur_time;
 	int64_t max_size;
 	int64_t max_time;
 	int64_t save_ts;
-	int keyframes;
+	struct circlebuf keyframes; /* uint64_t, buffered keyframe packets */
+	uint64_t first_packet;      /* sequence number of the oldest packet */
 	obs_hotkey_id hotkey;
 
-	DARRAY(struct encoder_packet) mux_packets;
+	DARRAY(struct replay_packet) mux_packets;
+	DARRAY(struct replay_segment *) mux_segments;
 	pthread_t mux_thread;
 	bool mux_thread_joinable;
 	volatile bool muxing;
 
+	/* disk-backed replay buffer: packet data lives in a ring of mapped
+	 * segments (oldest first, the last one is being written) */
+	bool disk_backed;
+	bool disk_store_failed;
+	struct dstr cache_dir;
+	size_t max_segments;
+	DARRAY(struct replay_segment *) segments;
+	DARRAY(struct replay_segment *) free_segments;
+
 	bool is_network;
 };
 
@@ -80,21 +114,42 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 	return obs_module_text("FFmpegMpegtsMuxer");
 }
 
+static inline void replay_packet_release(struct replay_packet *entry)
+{
+	if (entry->segment)
+		entry->segment->packets--;
+	else
+		obs_encoder_packet_release(&entry->packet);
+}
+
+static void free_segments(struct ffmpeg_muxer *stream)
+{
+	for (size_t i = 0; i < stream->segments.num; i++)
+		replay_segment_release(stream->segments.array[i]);
+	for (size_t i = 0; i < stream->free_segments.num; i++)
+		replay_segment_release(stream->free_segments.array[i]);
+
+	da_free(stream->segments);
+	da_free(stream->free_segments);
+}
+
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
 	while (stream->packets.size > 0) {
-		struct encoder_packet pkt;
-		circlebuf_pop_front(&stream->packets, &pkt, sizeof(pkt));
-		obs_encoder_packet_release(&pkt);
+		struct replay_packet entry;
+		circlebuf_pop_front(&stream->packets, &entry, sizeof(entry));
+		replay_packet_release(&entry);
 	}
 
 	circlebuf_free(&stream->packets);
+	circlebuf_free(&stream->keyframes);
+	free_segments(stream);
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
 	stream->max_time = 0;
 	stream->save_ts = 0;
-	stream->keyframes = 0;
+	stream->first_packet = 0;
 }
 
 static void ffmpeg_mux_destroy(void *data)
@@ -105,9 +160,12 @@ static void ffmpeg_mux_destroy(void *data)
 	if (stream->mux_thread_joinable)
 		pthread_join(stream->mux_thread, NULL);
 	da_free(stream->mux_packets);
+	da_free(stream->mux_segments);
 
 	os_process_pipe_destroy(stream->pipe);
+	mux_writer_destroy(stream->writer);
 	dstr_free(&stream->path);
+	dstr_free(&stream->cache_dir);
 	bfree(stream);
 }
 
@@ -146,8 +204,9 @@ static inline bool active(struct ffmpeg_muxer *stream)
 
 /* TODO: allow codecs other than h264 whenever we start using them */
 
-static void add_video_encoder_params(struct ffmpeg_muxer *stream,
-				     struct dstr *cmd, obs_encoder_t *vencoder)
+static void get_video_encoder_params(struct ffmpeg_muxer *stream,
+				     struct main_params *params,
+				     obs_encoder_t *vencoder)
 {
 	obs_data_t *settings = obs_encoder_get_settings(vencoder);
 	int bitrate = (int)obs_data_get_int(settings, "bitrate");
@@ -182,30 +241,31 @@ static void add_video_encoder_params(struct ffmpeg_muxer *stream,
 						? AVCOL_RANGE_JPEG
 						: AVCOL_RANGE_MPEG;
 
-	dstr_catf(cmd, "%s %d %d %d %d %d %d %d %d %d ",
-		  obs_encoder_get_codec(vencoder), bitrate,
-		  obs_output_get_width(stream->output),
-		  obs_output_get_height(stream->output), (int)pri, (int)trc,
-		  (int)spc, (int)range, (int)info->fps_num, (int)info->fps_den);
+	params->vcodec = (char *)obs_encoder_get_codec(vencoder);
+	params->vbitrate = bitrate;
+	params->width = (int)obs_output_get_width(stream->output);
+	params->height = (int)obs_output_get_height(stream->output);
+	params->color_primaries = (int)pri;
+	params->color_trc = (int)trc;
+	params->colorspace = (int)spc;
+	params->color_range = (int)range;
+	params->fps_num = (int)info->fps_num;
+	params->fps_den = (int)info->fps_den;
 }
 
-static void add_audio_encoder_params(struct dstr *cmd, obs_encoder_t *aencoder)
+static void get_audio_encoder_params(struct audio_params *audio,
+				     obs_encoder_t *aencoder)
 {
 	obs_data_t *settings = obs_encoder_get_settings(aencoder);
 	int bitrate = (int)obs_data_get_int(settings, "bitrate");
-	audio_t *audio = obs_get_audio();
-	struct dstr name = {0};
+	audio_t *audio_output = obs_get_audio();
 
 	obs_data_release(settings);
 
-	dstr_copy(&name, obs_encoder_get_name(aencoder));
-	dstr_replace(&name, "\"", "\"\"");
-
-	dstr_catf(cmd, "\"%s\" %d %d %d ", name.array, bitrate,
-		  (int)obs_encoder_get_sample_rate(aencoder),
-		  (int)audio_output_get_channels(audio));
-
-	dstr_free(&name);
+	audio->name = (char *)obs_encoder_get_name(aencoder);
+	audio->abitrate = bitrate;
+	audio->sample_rate = (int)obs_encoder_get_sample_rate(aencoder);
+	audio->channels = (int)audio_output_get_channels(audio_output);
 }
 
 static void log_muxer_params(struct ffmpeg_muxer *stream, const char *settings)
@@ -236,70 +296,152 @@ static void log_muxer_params(struct ffmpeg_muxer *stream, const char *settings)
 	av_dict_free(&dict);
 }
 
-static void add_muxer_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
-{
-	obs_data_t *settings = obs_output_get_settings(stream->output);
-	struct dstr mux = {0};
-
-	dstr_copy(&mux, obs_data_get_string(settings, "muxer_settings"));
-
-	log_muxer_params(stream, mux.array);
-
-	dstr_replace(&mux, "\"", "\\\"");
-	obs_data_release(settings);
-
-	dstr_catf(cmd, "\"%s\" ", mux.array ? mux.array : "");
-
-	dstr_free(&mux);
-}
+/* the parameters passed to ffmpeg-mux, either on its command line or to the
+ * in-process writer */
+struct mux_params {
+	struct main_params main;
+	struct audio_params audio[MAX_AUDIO_MIXES];
+	struct dstr muxer_settings;
+};
 
-static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
-			       const char *path)
+static void get_mux_params(struct ffmpeg_muxer *stream,
+			   struct mux_params *params, const char *path)
 {
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
-	obs_encoder_t *aencoders[MAX_AUDIO_MIXES];
+	obs_data_t *settings = obs_output_get_settings(stream->output);
 	int num_tracks = 0;
 
+	memset(params, 0, sizeof(*params));
+
 	for (;;) {
 		obs_encoder_t *aencoder = obs_output_get_audio_encoder(
 			stream->output, num_tracks);
 		if (!aencoder)
 			break;
 
-		aencoders[num_tracks] = aencoder;
+		get_audio_encoder_params(&params->audio[num_tracks], aencoder);
 		num_tracks++;
 	}
 
+	dstr_copy(&stream->path, path);
+
+	params->main.file = stream->path.array;
+	params->main.has_video = vencoder ? 1 : 0;
+	params->main.tracks = num_tracks;
+
+	if (vencoder)
+		get_video_encoder_params(stream, &params->main, vencoder);
+	if (num_tracks)
+		params->main.acodec = "aac";
+
+	dstr_copy(&params->muxer_settings,
+		  obs_data_get_string(settings, "muxer_settings"));
+	params->main.muxer_settings = params->muxer_settings.array;
+	obs_data_release(settings);
+
+	log_muxer_params(stream, params->muxer_settings.array);
+}
+
+static void cat_quoted(struct dstr *cmd, const char *str, const char *quote)
+{
+	struct dstr escaped = {0};
+
+	dstr_copy(&escaped, str);
+	dstr_replace(&escaped, "\"", quote);
+
+	dstr_catf(cmd, "\"%s\" ", escaped.array ? escaped.array : "");
+	dstr_free(&escaped);
+}
+
+static void build_command_line(const struct mux_params *params,
+			       struct dstr *cmd)
+{
+	const struct main_params *main = &params->main;
+
 	dstr_init_move_array(cmd, os_get_executable_path_ptr(FFMPEG_MUX));
 	dstr_insert_ch(cmd, 0, '\"');
-	dstr_cat(cmd, "\" \"");
+	dstr_cat(cmd, "\" ");
 
-	dstr_copy(&stream->path, path);
-	dstr_replace(&stream->path, "\"", "\"\"");
-	dstr_cat_dstr(cmd, &stream->path);
+	cat_quoted(cmd, main->file, "\"\"");
 
-	dstr_catf(cmd, "\" %d %d ", vencoder ? 1 : 0, num_tracks);
+	dstr_catf(cmd, "%d %d ", main->has_video, main->tracks);
 
-	if (vencoder)
-		add_video_encoder_params(stream, cmd, vencoder);
+	if (main->has_video)
+		dstr_catf(cmd, "%s %d %d %d %d %d %d %d %d %d ", main->vcodec,
+			  main->vbitrate, main->width, main->height,
+			  main->color_primaries, main->color_trc,
+			  main->colorspace, main->color_range, main->fps_num,
+			  main->fps_den);
+
+	if (main->tracks) {
+		dstr_catf(cmd, "%s ", main->acodec);
 
-	if (num_tracks) {
-		dstr_cat(cmd, "aac ");
+		for (int i = 0; i < main->tracks; i++) {
+			const struct audio_params *audio = &params->audio[i];
 
-		for (int i = 0; i < num_tracks; i++) {
-			add_audio_encoder_params(cmd, aencoders[i]);
+			cat_quoted(cmd, audio->name, "\"\"");
+			dstr_catf(cmd, "%d %d %d ", audio->abitrate,
+				  audio->sample_rate, audio->channels);
 		}
 	}
 
-	add_muxer_params(cmd, stream);
+	cat_quoted(cmd, main->muxer_settings, "\\\"");
+}
+
+static bool start_muxer(struct ffmpeg_muxer *stream, const char *path)
+{
+	struct mux_params params;
+
+	get_mux_params(stream, &params, path);
+	memset(&stream->stall_stats, 0, sizeof(stream->stall_stats));
+
+	if (stream->in_process) {
+		stream->writer = mux_writer_create(&params.main, params.audio,
+						   MUX_WRITER_QUEUE_SIZE);
+	} else {
+		struct dstr cmd;
+		build_command_line(&params, &cmd);
+		stream->pipe = os_process_pipe_create(cmd.array, "w");
+		dstr_free(&cmd);
+	}
+
+	dstr_free(&params.muxer_settings);
+	return stream->pipe || stream->writer;
 }
 
-static inline void start_pipe(struct ffmpeg_muxer *stream, const char *path)
+static void log_stall_stats(struct ffmpeg_muxer *stream)
 {
-	struct dstr cmd;
-	build_command_line(stream, &cmd, path);
-	stream->pipe = os_process_pipe_create(cmd.array, "w");
-	dstr_free(&cmd);
+	const struct mux_stall_stats *stats = &stream->stall_stats;
+
+	if (!stats->packets)
+		return;
+
+	info("%s: %llu packets, %.2f ms blocked in total "
+	     "(%.3f ms average, %.2f ms max), %llu writes blocked for over "
+	     "1 ms",
+	     stream->in_process ? "In-process muxer" : "Muxer pipe",
+	     (unsigned long long)stats->packets,
+	     (double)stats->total_ns / 1000000.0,
+	     (double)stats->total_ns / (double)stats->packets / 1000000.0,
+	     (double)stats->max_ns / 1000000.0,
+	     (unsigned long long)stats->stalls);
+}
+
+/* returns the result of the helper process, or of the in-process writer */
+static int stop_muxer(struct ffmpeg_muxer *stream)
+{
+	int ret;
+
+	if (stream->writer) {
+		ret = mux_writer_destroy(stream->writer);
+		stream->writer = NULL;
+	} else {
+		ret = os_process_pipe_destroy(stream->pipe);
+		stream->pipe = NULL;
+	}
+
+	log_stall_stats(stream);
+	return ret;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream,
@@ -361,13 +503,16 @@ static bool ffmpeg_mux_start(void *data)
 		os_unlink(path);
 	}
 
-	start_pipe(stream, path);
+	stream->in_process = obs_data_get_bool(settings, "mux_in_process");
+
+	bool started = start_muxer(stream, path);
 	obs_data_release(settings);
 
-	if (!stream->pipe) {
+	if (!started) {
 		obs_output_set_last_error(
 			stream->output, obs_module_text("HelperProcessFailed"));
-		warn("Failed to create process pipe");
+		warn("Failed to create %s",
+		     stream->in_process ? "muxer thread" : "process pipe");
 		return false;
 	}
 
@@ -386,8 +531,7 @@ static int deactivate(struct ffmpeg_muxer *stream, int code)
 	int ret = -1;
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_muxer(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -424,8 +568,15 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 
 	size_t len;
 
-	len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error,
-				       sizeof(error) - 1);
+	if (stream->writer) {
+		strncpy(error, mux_writer_get_error(stream->writer),
+			sizeof(error) - 1);
+		error[sizeof(error) - 1] = 0;
+		len = strlen(error);
+	} else {
+		len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error,
+					       sizeof(error) - 1);
+	}
 
 	if (len > 0) {
 		error[len] = 0;
@@ -447,11 +598,24 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 	os_atomic_set_bool(&stream->capturing, false);
 }
 
-static bool write_packet(struct ffmpeg_muxer *stream,
-			 struct encoder_packet *packet)
+static void add_stall_time(struct ffmpeg_muxer *stream, uint64_t start)
+{
+	struct mux_stall_stats *stats = &stream->stall_stats;
+	uint64_t elapsed = os_gettime_ns() - start;
+
+	stats->packets++;
+	stats->total_ns += elapsed;
+	if (elapsed > stats->max_ns)
+		stats->max_ns = elapsed;
+	if (elapsed > MUX_STALL_THRESHOLD_NS)
+		stats->stalls++;
+}
+
+/* refcounted is false for data that isn't owned by an encoder packet */
+static inline struct ffm_packet_info
+get_packet_info(const struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
-	size_t ret;
 
 	struct ffm_packet_info info = {.pts = packet->pts,
 				       .dts = packet->dts,
@@ -460,6 +624,28 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 				       .type = is_video ? FFM_PACKET_VIDEO
 							: FFM_PACKET_AUDIO,
 				       .keyframe = packet->keyframe};
+	return info;
+}
+
+static bool write_packet(struct ffmpeg_muxer *stream,
+			 struct encoder_packet *packet, bool refcounted)
+{
+	struct ffm_packet_info info = get_packet_info(packet);
+	uint64_t start = os_gettime_ns();
+	size_t ret;
+
+	if (stream->writer) {
+		if (!mux_writer_write(stream->writer, &info, packet,
+				      refcounted)) {
+			warn("In-process muxer failed");
+			signal_failure(stream);
+			return false;
+		}
+
+		add_stall_time(stream, start);
+		stream->total_bytes += packet->size;
+		return true;
+	}
 
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
 				    sizeof(info));
@@ -476,6 +662,29 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 		return false;
 	}
 
+	add_stall_time(stream, start);
+	stream->total_bytes += packet->size;
+	return true;
+}
+
+/* writes a packet whose data stays valid until the muxer is stopped, the
+ * in-process writer muxes it straight from there without a copy */
+static bool write_mapped_packet(struct ffmpeg_muxer *stream,
+				struct encoder_packet *packet)
+{
+	struct ffm_packet_info info = get_packet_info(packet);
+	uint64_t start = os_gettime_ns();
+
+	if (!stream->writer)
+		return write_packet(stream, packet, false);
+
+	if (!mux_writer_write_mapped(stream->writer, &info, packet)) {
+		warn("In-process muxer failed");
+		signal_failure(stream);
+		return false;
+	}
+
+	add_stall_time(stream, start);
 	stream->total_bytes += packet->size;
 	return true;
 }
@@ -487,7 +696,7 @@ static bool send_audio_headers(struct ffmpeg_muxer *stream,
 		.type = OBS_ENCODER_AUDIO, .timebase_den = 1, .track_idx = idx};
 
 	obs_encoder_get_extra_data(aencoder, &packet.data, &packet.size);
-	return write_packet(stream, &packet);
+	return write_packet(stream, &packet, false);
 }
 
 static bool send_video_headers(struct ffmpeg_muxer *stream)
@@ -498,7 +707,7 @@ static bool send_video_headers(struct ffmpeg_muxer *stream)
 					.timebase_den = 1};
 
 	obs_encoder_get_extra_data(vencoder, &packet.data, &packet.size);
-	return write_packet(stream, &packet);
+	return write_packet(stream, &packet, false);
 }
 
 static bool send_headers(struct ffmpeg_muxer *stream)
@@ -549,7 +758,7 @@ static void ffmpeg_mux_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	write_packet(stream, packet);
+	write_packet(stream, packet, true);
 }
 
 static obs_properties_t *ffmpeg_mux_properties(void *unused)
@@ -698,6 +907,39 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	stream->in_process = obs_data_get_bool(s, "mux_in_process");
+	stream->disk_backed = obs_data_get_bool(s, "disk_backed");
+
+	if (stream->disk_backed) {
+		const char *dir = obs_data_get_string(s, "disk_cache_dir");
+
+		if (dir && *dir) {
+			dstr_copy(&stream->cache_dir, dir);
+		} else {
+			char *path = obs_module_config_path("replay-cache");
+			dstr_copy(&stream->cache_dir, path);
+			bfree(path);
+		}
+
+		os_mkdirs(stream->cache_dir.array);
+
+		/* the size limit is enforced on packets, the extra segments
+		 * cover the partially filled ones at either end */
+		stream->max_segments =
+			stream->max_size
+				? (size_t)(stream->max_size /
+					   REPLAY_SEGMENT_SIZE) + 2
+				: 0;
+		stream->disk_store_failed = false;
+
+		/* saves mux the segment data in place, which needs the
+		 * in-process writer */
+		stream->in_process = true;
+
+		info("Buffering replay packets on disk in '%s'",
+		     stream->cache_dir.array);
+	}
+
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -708,45 +950,65 @@ static bool replay_buffer_start(void *data)
 	return true;
 }
 
+static inline size_t num_keyframes(struct ffmpeg_muxer *stream)
+{
+	return stream->keyframes.size / sizeof(uint64_t);
+}
+
+/* position of the oldest buffered keyframe, or of the oldest packet if
+ * there's none */
+static inline size_t first_keyframe(struct ffmpeg_muxer *stream)
+{
+	uint64_t seq;
+
+	if (!stream->keyframes.size)
+		return 0;
+
+	circlebuf_peek_front(&stream->keyframes, &seq, sizeof(seq));
+	return (size_t)(seq - stream->first_packet);
+}
+
 static bool purge_front(struct ffmpeg_muxer *stream)
 {
-	struct encoder_packet pkt;
+	struct replay_packet entry;
+	struct encoder_packet *pkt = &entry.packet;
 	bool keyframe;
 
-	circlebuf_pop_front(&stream->packets, &pkt, sizeof(pkt));
+	circlebuf_pop_front(&stream->packets, &entry, sizeof(entry));
+	stream->first_packet++;
 
-	keyframe = pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe;
+	keyframe = pkt->type == OBS_ENCODER_VIDEO && pkt->keyframe;
 
 	if (keyframe)
-		stream->keyframes--;
+		circlebuf_pop_front(&stream->keyframes, NULL,
+				    sizeof(uint64_t));
 
 	if (!stream->packets.size) {
 		stream->cur_size = 0;
 		stream->cur_time = 0;
 	} else {
-		struct encoder_packet first;
+		struct replay_packet first;
 		circlebuf_peek_front(&stream->packets, &first, sizeof(first));
-		stream->cur_time = first.dts_usec;
-		stream->cur_size -= (int64_t)pkt.size;
+		stream->cur_time = first.packet.dts_usec;
+		stream->cur_size -= (int64_t)pkt->size;
 	}
 
-	obs_encoder_packet_release(&pkt);
+	replay_packet_release(&entry);
 	return keyframe;
 }
 
 static inline void purge(struct ffmpeg_muxer *stream)
 {
+	/* drop the whole keyframe interval, up to the next indexed keyframe
+	 * (or everything if there isn't one) */
 	if (purge_front(stream)) {
-		struct encoder_packet pkt;
-
-		for (;;) {
-			circlebuf_peek_front(&stream->packets, &pkt,
-					     sizeof(pkt));
-			if (pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe)
-				return;
+		size_t count = stream->keyframes.size
+				       ? first_keyframe(stream)
+				       : stream->packets.size /
+						 sizeof(struct replay_packet);
 
+		while (count--)
 			purge_front(stream);
-		}
 	}
 }
 
@@ -754,7 +1016,7 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 				       struct encoder_packet *pkt)
 {
 	if (stream->max_size) {
-		if (!stream->packets.size || stream->keyframes <= 2)
+		if (!stream->packets.size || num_keyframes(stream) <= 2)
 			return;
 
 		while ((stream->cur_size + (int64_t)pkt->size) >
@@ -762,87 +1024,102 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 			purge(stream);
 	}
 
-	if (!stream->packets.size || stream->keyframes <= 2)
+	if (!stream->packets.size || num_keyframes(stream) <= 2)
 		return;
 
 	while ((pkt->dts_usec - stream->cur_time) > stream->max_time)
 		purge(stream);
 }
 
-static void insert_packet(struct darray *array, struct encoder_packet *packet,
-			  int64_t video_offset, int64_t *audio_offsets,
-			  int64_t video_dts_offset, int64_t *audio_dts_offsets)
+/* segments become empty in order as packets are purged from the front */
+static void recycle_segments(struct ffmpeg_muxer *stream)
 {
-	struct encoder_packet pkt;
-	DARRAY(struct encoder_packet) packets;
-	packets.da = *array;
-	size_t idx;
+	while (stream->segments.num > 1) {
+		struct replay_segment *seg = stream->segments.array[0];
+		if (seg->packets)
+			break;
 
-	obs_encoder_packet_ref(&pkt, packet);
+		da_erase(stream->segments, 0);
 
-	if (pkt.type == OBS_ENCODER_VIDEO) {
-		pkt.dts_usec -= video_offset;
-		pkt.dts -= video_dts_offset;
-		pkt.pts -= video_dts_offset;
-	} else {
-		pkt.dts_usec -= audio_offsets[pkt.track_idx];
-		pkt.dts -= audio_dts_offsets[pkt.track_idx];
-		pkt.pts -= audio_dts_offsets[pkt.track_idx];
-	}
-
-	for (idx = packets.num; idx > 0; idx--) {
-		struct encoder_packet *p = packets.array + (idx - 1);
-		if (p->dts_usec < pkt.dts_usec)
-			break;
+		/* still referenced by a save in progress, let it go and
+		 * allocate a fresh one when needed instead */
+		if (os_atomic_load_long(&seg->refs) == 1) {
+			seg->used = 0;
+			da_push_back(stream->free_segments, &seg);
+		} else {
+			replay_segment_release(seg);
+		}
 	}
-
-	da_insert(packets, idx, &pkt);
-	*array = packets.da;
 }
 
-static void *replay_buffer_mux_thread(void *data)
+static struct replay_segment *next_segment(struct ffmpeg_muxer *stream)
 {
-	struct ffmpeg_muxer *stream = data;
+	struct replay_segment *seg;
 
-	start_pipe(stream, stream->path.array);
+	if (stream->segments.num)
+		replay_segment_evict(
+			stream->segments.array[stream->segments.num - 1]);
 
-	if (!stream->pipe) {
-		warn("Failed to create process pipe");
-		goto error;
-	}
+	recycle_segments(stream);
 
-	if (!send_headers(stream)) {
-		warn("Could not write headers for file '%s'",
-		     stream->path.array);
-		goto error;
+	/* out of space: drop whole keyframe intervals from the front until
+	 * the oldest segment is free */
+	while (stream->max_segments && !stream->free_segments.num &&
+	       stream->segments.num >= stream->max_segments &&
+	       stream->packets.size) {
+		purge(stream);
+		recycle_segments(stream);
 	}
 
-	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
-		write_packet(stream, pkt);
-		obs_encoder_packet_release(pkt);
+	if (stream->free_segments.num) {
+		seg = stream->free_segments
+			      .array[stream->free_segments.num - 1];
+		da_pop_back(stream->free_segments);
+	} else {
+		seg = replay_segment_create(stream->cache_dir.array,
+					    REPLAY_SEGMENT_SIZE);
 	}
 
-	info("Wrote replay buffer to '%s'", stream->path.array);
-
-error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	da_free(stream->mux_packets);
-	os_atomic_set_bool(&stream->muxing, false);
-	return NULL;
+	if (seg)
+		da_push_back(stream->segments, &seg);
+	return seg;
 }
 
-static void replay_buffer_save(struct ffmpeg_muxer *stream)
+static bool store_packet(struct ffmpeg_muxer *stream,
+			 struct encoder_packet *packet,
+			 struct replay_packet *entry)
 {
-	const size_t size = sizeof(struct encoder_packet);
-	size_t num_packets = stream->packets.size / size;
+	struct replay_segment *seg = NULL;
+	size_t size = (packet->size + 15) & ~(size_t)15;
 
-	da_reserve(stream->mux_packets, num_packets);
+	if (size > REPLAY_SEGMENT_SIZE)
+		return false;
 
-	/* ---------------------------- */
-	/* reorder packets */
+	if (stream->segments.num)
+		seg = stream->segments.array[stream->segments.num - 1];
+
+	if (!seg || seg->used + size > seg->size) {
+		seg = next_segment(stream);
+		if (!seg)
+			return false;
+	}
+
+	memcpy(seg->data + seg->used, packet->data, packet->size);
+
+	entry->packet = *packet;
+	entry->packet.data = seg->data + seg->used;
+	entry->segment = seg;
+
+	seg->used += size;
+	seg->packets++;
+	return true;
+}
 
+/* packets are buffered in the order the encoders returned them, interleave
+ * them by timestamp starting every track at zero.  the tracks are already
+ * close to interleaved, so this only moves packets by a few slots */
+static void reorder_packets(struct replay_packet *packets, size_t num)
+{
 	bool found_video = false;
 	bool found_audio[MAX_AUDIO_MIXES] = {0};
 	int64_t video_offset = 0;
@@ -850,9 +1127,10 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
 	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
 
-	for (size_t i = 0; i < num_packets; i++) {
-		struct encoder_packet *pkt;
-		pkt = circlebuf_data(&stream->packets, i * size);
+	for (size_t i = 0; i < num; i++) {
+		struct replay_packet entry = packets[i];
+		struct encoder_packet *pkt = &entry.packet;
+		size_t idx;
 
 		if (pkt->type == OBS_ENCODER_VIDEO) {
 			if (!found_video) {
@@ -860,17 +1138,110 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 				video_dts_offset = pkt->dts;
 				found_video = true;
 			}
+
+			pkt->dts_usec -= video_offset;
+			pkt->dts -= video_dts_offset;
+			pkt->pts -= video_dts_offset;
 		} else {
 			if (!found_audio[pkt->track_idx]) {
 				found_audio[pkt->track_idx] = true;
 				audio_offsets[pkt->track_idx] = pkt->dts_usec;
 				audio_dts_offsets[pkt->track_idx] = pkt->dts;
 			}
+
+			pkt->dts_usec -= audio_offsets[pkt->track_idx];
+			pkt->dts -= audio_dts_offsets[pkt->track_idx];
+			pkt->pts -= audio_dts_offsets[pkt->track_idx];
 		}
 
-		insert_packet(&stream->mux_packets.da, pkt, video_offset,
-			      audio_offsets, video_dts_offset,
-			      audio_dts_offsets);
+		for (idx = i; idx > 0; idx--) {
+			if (packets[idx - 1].packet.dts_usec < pkt->dts_usec)
+				break;
+			packets[idx] = packets[idx - 1];
+		}
+
+		packets[idx] = entry;
+	}
+}
+
+static void *replay_buffer_mux_thread(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+
+	reorder_packets(stream->mux_packets.array, stream->mux_packets.num);
+
+	if (!start_muxer(stream, stream->path.array)) {
+		warn("Failed to create %s",
+		     stream->in_process ? "muxer thread" : "process pipe");
+		goto error;
+	}
+
+	if (!send_headers(stream)) {
+		warn("Could not write headers for file '%s'",
+		     stream->path.array);
+		goto error;
+	}
+
+	/* segment data stays mapped until the segments are released below,
+	 * after the muxer is done with it */
+	for (size_t i = 0; i < stream->mux_packets.num; i++) {
+		struct replay_packet *entry = &stream->mux_packets.array[i];
+
+		if (entry->segment)
+			write_mapped_packet(stream, &entry->packet);
+		else
+			write_packet(stream, &entry->packet, true);
+	}
+
+	info("Wrote replay buffer to '%s'", stream->path.array);
+
+error:
+	stop_muxer(stream);
+
+	for (size_t i = 0; i < stream->mux_packets.num; i++) {
+		struct replay_packet *entry = &stream->mux_packets.array[i];
+		if (!entry->segment)
+			obs_encoder_packet_release(&entry->packet);
+	}
+	for (size_t i = 0; i < stream->mux_segments.num; i++)
+		replay_segment_release(stream->mux_segments.array[i]);
+
+	da_free(stream->mux_packets);
+	da_free(stream->mux_segments);
+	os_atomic_set_bool(&stream->muxing, false);
+	return NULL;
+}
+
+static void replay_buffer_save(struct ffmpeg_muxer *stream)
+{
+	const size_t size = sizeof(struct replay_packet);
+	size_t num_packets = stream->packets.size / size;
+	size_t start = first_keyframe(stream);
+
+	/* only the packet index is copied here, reordering and muxing happen
+	 * on the mux thread.  disk-backed data isn't referenced or copied,
+	 * the thread muxes it straight from the pinned segments */
+	da_reserve(stream->mux_packets, num_packets - start);
+
+	/* keep the segments mapped until the mux thread is done with them,
+	 * even if the buffer purges or recycles them in the meantime */
+	for (size_t i = 0; i < stream->segments.num; i++) {
+		struct replay_segment *seg = stream->segments.array[i];
+		replay_segment_addref(seg);
+		da_push_back(stream->mux_segments, &seg);
+	}
+
+	for (size_t i = start; i < num_packets; i++) {
+		struct replay_packet *entry;
+		struct replay_packet copy;
+
+		entry = circlebuf_data(&stream->packets, i * size);
+		copy = *entry;
+
+		if (!entry->segment)
+			obs_encoder_packet_ref(&copy.packet, &entry->packet);
+
+		da_push_back(stream->mux_packets, &copy);
 	}
 
 	/* ---------------------------- */
@@ -925,7 +1296,7 @@ static void deactivate_replay_buffer(struct ffmpeg_muxer *stream, int code)
 static void replay_buffer_data(void *data, struct encoder_packet *packet)
 {
 	struct ffmpeg_muxer *stream = data;
-	struct encoder_packet pkt;
+	struct replay_packet entry = {0};
 
 	if (!active(stream))
 		return;
@@ -943,17 +1314,32 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
+	replay_buffer_purge(stream, packet);
+
+	/* store the data in the mapped segments, falling back to keeping the
+	 * packet in memory if the cache directory can't be used */
+	if (!stream->disk_backed || !store_packet(stream, packet, &entry)) {
+		if (stream->disk_backed && !stream->disk_store_failed) {
+			warn("Failed to store packet in replay cache, "
+			     "buffering in memory instead");
+			stream->disk_store_failed = true;
+		}
+
+		entry.segment = NULL;
+		obs_encoder_packet_ref(&entry.packet, packet);
+	}
 
 	if (!stream->packets.size)
-		stream->cur_time = pkt.dts_usec;
-	stream->cur_size += pkt.size;
+		stream->cur_time = entry.packet.dts_usec;
+	stream->cur_size += entry.packet.size;
 
-	circlebuf_push_back(&stream->packets, packet, sizeof(*packet));
+	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe) {
+		uint64_t seq = stream->first_packet +
+			       stream->packets.size / sizeof(entry);
+		circlebuf_push_back(&stream->keyframes, &seq, sizeof(seq));
+	}
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
-		stream->keyframes++;
+	circlebuf_push_back(&stream->packets, &entry, sizeof(entry));
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
 		if (os_atomic_load_bool(&stream->muxing))
@@ -976,6 +1362,8 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_bool(s, "disk_backed", false);
+	obs_data_set_default_bool(s, "mux_in_process", false);
 }
 
 struct obs_output_info replay_buffer = {
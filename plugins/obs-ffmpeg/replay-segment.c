@@ -0,0 +1,201 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/base.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "replay-segment.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+static volatile long segment_counter = 0;
+
+static void get_segment_path(struct dstr *path, const char *dir)
+{
+	dstr_copy(path, dir);
+	dstr_replace(path, "\\", "/");
+	if (dstr_end(path) != '/')
+		dstr_cat_ch(path, '/');
+
+	dstr_catf(path, "replay-%llx-%ld.seg",
+		  (unsigned long long)os_gettime_ns(),
+		  os_atomic_inc_long(&segment_counter));
+}
+
+#ifdef _WIN32
+static bool map_segment(struct replay_segment *seg, const char *path)
+{
+	wchar_t *wpath = NULL;
+	ULARGE_INTEGER size;
+
+	os_utf8_to_wcs_ptr(path, 0, &wpath);
+	if (!wpath)
+		return false;
+
+	seg->file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+				CREATE_NEW,
+				FILE_ATTRIBUTE_TEMPORARY |
+					FILE_FLAG_DELETE_ON_CLOSE,
+				NULL);
+	bfree(wpath);
+
+	if (seg->file == INVALID_HANDLE_VALUE) {
+		seg->file = NULL;
+		blog(LOG_WARNING, "replay_segment: Failed to create '%s': %lu",
+		     path, GetLastError());
+		return false;
+	}
+
+	size.QuadPart = seg->size;
+	seg->mapping = CreateFileMappingW(seg->file, NULL, PAGE_READWRITE,
+					  size.HighPart, size.LowPart, NULL);
+	if (!seg->mapping) {
+		blog(LOG_WARNING, "replay_segment: Failed to map '%s': %lu",
+		     path, GetLastError());
+		return false;
+	}
+
+	seg->data = MapViewOfFile(seg->mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+				  seg->size);
+	if (!seg->data) {
+		blog(LOG_WARNING, "replay_segment: Failed to map '%s': %lu",
+		     path, GetLastError());
+		return false;
+	}
+
+	return true;
+}
+
+static void unmap_segment(struct replay_segment *seg)
+{
+	if (seg->data)
+		UnmapViewOfFile(seg->data);
+	if (seg->mapping)
+		CloseHandle(seg->mapping);
+	if (seg->file)
+		CloseHandle(seg->file);
+}
+
+void replay_segment_evict(struct replay_segment *seg)
+{
+	/* trimming the working set of a single view isn't possible without
+	 * remapping it, the memory manager pages it out under pressure */
+	UNUSED_PARAMETER(seg);
+}
+
+#else
+static bool map_segment(struct replay_segment *seg, const char *path)
+{
+	int ret;
+
+	seg->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (seg->fd == -1) {
+		blog(LOG_WARNING, "replay_segment: Failed to create '%s': %d",
+		     path, errno);
+		return false;
+	}
+
+	/* the file stays alive until it is unmapped and closed */
+	unlink(path);
+
+#ifdef __linux__
+	ret = posix_fallocate(seg->fd, 0, (off_t)seg->size);
+#else
+	ret = ftruncate(seg->fd, (off_t)seg->size) == 0 ? 0 : errno;
+#endif
+	if (ret != 0) {
+		blog(LOG_WARNING,
+		     "replay_segment: Failed to allocate %zu bytes for "
+		     "'%s': %d",
+		     seg->size, path, ret);
+		return false;
+	}
+
+	seg->data = mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 seg->fd, 0);
+	if (seg->data == MAP_FAILED) {
+		seg->data = NULL;
+		blog(LOG_WARNING, "replay_segment: Failed to map '%s': %d",
+		     path, errno);
+		return false;
+	}
+
+	return true;
+}
+
+static void unmap_segment(struct replay_segment *seg)
+{
+	if (seg->data)
+		munmap(seg->data, seg->size);
+	if (seg->fd != -1)
+		close(seg->fd);
+}
+
+void replay_segment_evict(struct replay_segment *seg)
+{
+	/* dirty pages stay in the page cache and are written back to the
+	 * file, they just stop counting towards our resident set */
+	madvise(seg->data, seg->size, MADV_DONTNEED);
+}
+#endif
+
+struct replay_segment *replay_segment_create(const char *dir, size_t size)
+{
+	struct replay_segment *seg = bzalloc(sizeof(*seg));
+	struct dstr path = {0};
+
+	seg->size = size;
+	seg->refs = 1;
+#ifndef _WIN32
+	seg->fd = -1;
+#endif
+
+	get_segment_path(&path, dir);
+
+	if (!map_segment(seg, path.array)) {
+		unmap_segment(seg);
+		bfree(seg);
+		seg = NULL;
+	}
+
+	dstr_free(&path);
+	return seg;
+}
+
+void replay_segment_addref(struct replay_segment *seg)
+{
+	os_atomic_inc_long(&seg->refs);
+}
+
+void replay_segment_release(struct replay_segment *seg)
+{
+	if (seg && os_atomic_dec_long(&seg->refs) == 0) {
+		unmap_segment(seg);
+		bfree(seg);
+	}
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+
+#define REPLAY_SEGMENT_SIZE (64 * 1024 * 1024)
+
+/*
+ * A preallocated, memory-mapped temporary file that holds encoded packet
+ * data for the disk-backed replay buffer.  The file is deleted as soon as
+ * it is closed (or immediately on POSIX), so nothing is left behind if the
+ * program exits unexpectedly.
+ *
+ * Segments are reference counted so a save in progress can keep reading
+ * from them while the replay buffer moves on to new segments.
+ */
+struct replay_segment {
+	uint8_t *data;
+	size_t size;
+	size_t used;
+	size_t packets;
+	volatile long refs;
+
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#else
+	int fd;
+#endif
+};
+
+extern struct replay_segment *replay_segment_create(const char *dir,
+						    size_t size);
+extern void replay_segment_addref(struct replay_segment *seg);
+extern void replay_segment_release(struct replay_segment *seg);
+
+/* drops the segment's resident pages once it has been filled, the data
+ * remains available through the file */
+extern void replay_segment_evict(struct replay_segment *seg);
@@ -4,6 +4,7 @@
 
 #include <obs-module.h>
 #include <media-io/audio-math.h>
+#include <media-io/audio-dynamics.h>
 #include <util/platform.h>
 #include <util/circlebuf.h>
 #include <util/threading.h>
@@ -325,17 +326,9 @@ static void analyze_envelope(struct compressor_data *cd, float **samples,
 		if (!samples[chan])
 			continue;
 
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(samples[chan][i]);
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
+		audio_dyn_peak_envelope(cd->envelope_buf, samples[chan],
+					num_samples, cd->envelope, attack_gain,
+					release_gain);
 	}
 	cd->envelope = cd->envelope_buf[num_samples - 1];
 }
@@ -358,18 +351,9 @@ static void analyze_sidechain(struct compressor_data *cd,
 		if (!sidechain_buf[chan])
 			continue;
 
-		float *envelope_buf = cd->envelope_buf;
-		float env = cd->envelope;
-		for (uint32_t i = 0; i < num_samples; ++i) {
-			const float env_in = fabsf(sidechain_buf[chan][i]);
-
-			if (env < env_in) {
-				env = env_in + attack_gain * (env - env_in);
-			} else {
-				env = env_in + release_gain * (env - env_in);
-			}
-			envelope_buf[i] = fmaxf(envelope_buf[i], env);
-		}
+		audio_dyn_peak_envelope(cd->envelope_buf, sidechain_buf[chan],
+					num_samples, cd->envelope, attack_gain,
+					release_gain);
 	}
 	cd->envelope = cd->envelope_buf[num_samples - 1];
 }
@@ -377,16 +361,15 @@ static void analyze_sidechain(struct compressor_data *cd,
 static inline void process_compression(const struct compressor_data *cd,
 				       float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
+	/* the envelope is no longer needed once the gain is known, so it's
+	 * replaced with the gain */
+	float *gain = cd->envelope_buf;
+	audio_dyn_compressor_gain(gain, cd->envelope_buf, num_samples,
+				  cd->slope, cd->threshold, cd->output_gain);
+
+	for (size_t c = 0; c < cd->num_channels; ++c) {
+		if (samples[c])
+			audio_dyn_apply_gain(samples[c], gain, num_samples);
 	}
 }
 
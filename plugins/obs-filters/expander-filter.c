@@ -4,6 +4,7 @@
 
 #include <obs-module.h>
 #include <media-io/audio-math.h>
+#include <media-io/audio-dynamics.h>
 #include <util/platform.h>
 #include <util/circlebuf.h>
 #include <util/threading.h>
@@ -278,20 +279,20 @@ static void analyze_envelope(struct expander_data *cd, float **samples,
 		float *env_in = cd->env_in;
 
 		if (cd->detector == RMS_DETECT) {
-			runave[0] =
-				rmscoef * cd->runave[chan] +
-				(1 - rmscoef) * powf(samples[chan][0], 2.0f);
+			runave[0] = rmscoef * cd->runave[chan] +
+				    (1 - rmscoef) * samples[chan][0] *
+					    samples[chan][0];
 			env_in[0] = sqrtf(fmaxf(runave[0], 0));
 			for (uint32_t i = 1; i < num_samples; ++i) {
 				runave[i] =
 					rmscoef * runave[i - 1] +
-					(1 - rmscoef) *
-						powf(samples[chan][i], 2.0f);
+					(1 - rmscoef) * samples[chan][i] *
+						samples[chan][i];
 				env_in[i] = sqrtf(runave[i]);
 			}
 		} else if (cd->detector == PEAK_DETECT) {
 			for (uint32_t i = 0; i < num_samples; ++i) {
-				runave[i] = powf(samples[chan][i], 2);
+				runave[i] = samples[chan][i] * samples[chan][i];
 				env_in[i] = fabsf(samples[chan][i]);
 			}
 		}
@@ -317,15 +318,16 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 		       num_samples * sizeof(cd->gaindB[i][0]));
 
 	for (size_t chan = 0; chan < cd->num_channels; chan++) {
+		float *gain_db = cd->gaindB[chan];
+
+		// gain stage of expansion
+		audio_dyn_expander_gain_db(gain_db, cd->envelope_buf[chan],
+					   num_samples, cd->slope,
+					   cd->threshold);
+
 		for (size_t i = 0; i < num_samples; ++i) {
-			// gain stage of expansion
-			float env_db = mul_to_db(cd->envelope_buf[chan][i]);
-			float gain =
-				cd->threshold - env_db > 0.0f
-					? fmaxf(cd->slope * (cd->threshold -
-							     env_db),
-						-60.0f)
-					: 0.0f;
+			float gain = gain_db[i];
+
 			// ballistics (attack/release)
 			if (i > 0) {
 				if (gain > cd->gaindB[chan][i - 1])
@@ -350,11 +352,11 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 							cd->gaindB_buf[chan] +
 						(1.0f - release_gain) * gain;
 			}
-
-			gain = db_to_mul(fminf(0, cd->gaindB[chan][i]));
-			if (samples[chan])
-				samples[chan][i] *= gain * cd->output_gain;
 		}
+
+		if (samples[chan])
+			audio_dyn_apply_gain_db(samples[chan], gain_db,
+						num_samples, cd->output_gain);
 		cd->gaindB_buf[chan] = cd->gaindB[chan][num_samples - 1];
 	}
 }
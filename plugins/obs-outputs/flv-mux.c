@@ -169,16 +169,73 @@ void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 static int32_t last_time = 0;
 #endif
 
-static void flv_video(struct serializer *s, int32_t dts_offset,
+static inline uint8_t *put_8(uint8_t *p, uint8_t val)
+{
+	*p++ = val;
+	return p;
+}
+
+static inline uint8_t *put_be16(uint8_t *p, uint16_t val)
+{
+	*p++ = (uint8_t)(val >> 8);
+	*p++ = (uint8_t)val;
+	return p;
+}
+
+static inline uint8_t *put_be24(uint8_t *p, uint32_t val)
+{
+	*p++ = (uint8_t)(val >> 16);
+	*p++ = (uint8_t)(val >> 8);
+	*p++ = (uint8_t)val;
+	return p;
+}
+
+static inline uint8_t *put_be32(uint8_t *p, uint32_t val)
+{
+	*p++ = (uint8_t)(val >> 24);
+	*p++ = (uint8_t)(val >> 16);
+	*p++ = (uint8_t)(val >> 8);
+	*p++ = (uint8_t)val;
+	return p;
+}
+
+static uint8_t *put_tag_header(uint8_t *p, uint8_t type, uint32_t data_size,
+			       int32_t time_ms)
+{
+	p = put_8(p, type);
+	p = put_be24(p, data_size);
+	p = put_be24(p, time_ms);
+	p = put_8(p, (time_ms >> 24) & 0x7F);
+	return put_be24(p, 0);
+}
+
+/* fills in the iov list, the trailer ends with the tag size (starting byte
+ * doesn't count) */
+static void finish_tag(struct flv_tag *tag, uint8_t *header_end,
+		       struct encoder_packet *packet, uint8_t *trailer_end)
+{
+	size_t header_size = header_end - tag->header;
+	size_t tag_size = header_size + packet->size +
+			  (trailer_end - tag->trailer);
+
+	trailer_end = put_be32(trailer_end, (uint32_t)tag_size - 1);
+
+	tag->iov[0].data = tag->header;
+	tag->iov[0].size = header_size;
+	tag->iov[1].data = packet->data;
+	tag->iov[1].size = packet->size;
+	tag->iov[2].data = tag->trailer;
+	tag->iov[2].size = trailer_end - tag->trailer;
+	tag->iovcnt = 3;
+	tag->size = tag_size + 4;
+}
+
+static void flv_video(struct flv_tag *tag, int32_t dts_offset,
 		      struct encoder_packet *packet, bool is_header)
 {
 	int64_t offset = packet->pts - packet->dts;
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
-
-	if (!packet->data || !packet->size)
-		return;
-
-	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
+	uint8_t *p;
 
 #ifdef DEBUG_TIMESTAMPS
 	blog(LOG_DEBUG, "Video: %lu", time_ms);
@@ -189,30 +246,22 @@ static void flv_video(struct serializer *s, int32_t dts_offset,
 	last_time = time_ms;
 #endif
 
-	s_wb24(s, (uint32_t)packet->size + 5);
-	s_wb24(s, time_ms);
-	s_w8(s, (time_ms >> 24) & 0x7F);
-	s_wb24(s, 0);
+	p = put_tag_header(tag->header, RTMP_PACKET_TYPE_VIDEO,
+			   (uint32_t)packet->size + 5, time_ms);
 
 	/* these are the 5 extra bytes mentioned above */
-	s_w8(s, packet->keyframe ? 0x17 : 0x27);
-	s_w8(s, is_header ? 0 : 1);
-	s_wb24(s, get_ms_time(packet, offset));
-	s_write(s, packet->data, packet->size);
+	p = put_8(p, packet->keyframe ? 0x17 : 0x27);
+	p = put_8(p, is_header ? 0 : 1);
+	p = put_be24(p, get_ms_time(packet, offset));
 
-	/* write tag size (starting byte doesn't count) */
-	s_wb32(s, (uint32_t)serializer_get_pos(s) - 1);
+	finish_tag(tag, p, packet, tag->trailer);
 }
 
-static void flv_audio(struct serializer *s, int32_t dts_offset,
+static void flv_audio(struct flv_tag *tag, int32_t dts_offset,
 		      struct encoder_packet *packet, bool is_header)
 {
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
-
-	if (!packet->data || !packet->size)
-		return;
-
-	s_w8(s, RTMP_PACKET_TYPE_AUDIO);
+	uint8_t *p;
 
 #ifdef DEBUG_TIMESTAMPS
 	blog(LOG_DEBUG, "Audio: %lu", time_ms);
@@ -223,35 +272,54 @@ static void flv_audio(struct serializer *s, int32_t dts_offset,
 	last_time = time_ms;
 #endif
 
-	s_wb24(s, (uint32_t)packet->size + 2);
-	s_wb24(s, time_ms);
-	s_w8(s, (time_ms >> 24) & 0x7F);
-	s_wb24(s, 0);
+	p = put_tag_header(tag->header, RTMP_PACKET_TYPE_AUDIO,
+			   (uint32_t)packet->size + 2, time_ms);
 
 	/* these are the two extra bytes mentioned above */
-	s_w8(s, 0xaf);
-	s_w8(s, is_header ? 0 : 1);
-	s_write(s, packet->data, packet->size);
+	p = put_8(p, 0xaf);
+	p = put_8(p, is_header ? 0 : 1);
 
-	/* write tag size (starting byte doesn't count) */
-	s_wb32(s, (uint32_t)serializer_get_pos(s) - 1);
+	finish_tag(tag, p, packet, tag->trailer);
 }
 
-void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
-		    uint8_t **output, size_t *size, bool is_header)
+bool flv_packet_tag(struct encoder_packet *packet, int32_t dts_offset,
+		    struct flv_tag *tag, bool is_header)
 {
-	struct array_output_data data;
-	struct serializer s;
+	tag->iovcnt = 0;
+	tag->size = 0;
 
-	array_output_serializer_init(&s, &data);
+	if (!packet->data || !packet->size)
+		return false;
 
 	if (packet->type == OBS_ENCODER_VIDEO)
-		flv_video(&s, dts_offset, packet, is_header);
+		flv_video(tag, dts_offset, packet, is_header);
 	else
-		flv_audio(&s, dts_offset, packet, is_header);
+		flv_audio(tag, dts_offset, packet, is_header);
+	return true;
+}
 
-	*output = data.bytes.array;
-	*size = data.bytes.num;
+static void flv_tag_flatten(const struct flv_tag *tag, uint8_t **output,
+			    size_t *size)
+{
+	uint8_t *data = tag->size ? bmalloc(tag->size) : NULL;
+	size_t pos = 0;
+
+	for (size_t i = 0; i < tag->iovcnt; i++) {
+		memcpy(data + pos, tag->iov[i].data, tag->iov[i].size);
+		pos += tag->iov[i].size;
+	}
+
+	*output = data;
+	*size = pos;
+}
+
+void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
+		    uint8_t **output, size_t *size, bool is_header)
+{
+	struct flv_tag tag;
+
+	flv_packet_tag(packet, dts_offset, &tag, is_header);
+	flv_tag_flatten(&tag, output, size);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -386,81 +454,83 @@ void flv_additional_meta_data(obs_output_t *context, uint8_t **data,
 	*size = out.bytes.num;
 }
 
-static inline void s_u29(struct serializer *s, uint32_t val)
+static inline uint8_t *put_u29(uint8_t *p, uint32_t val)
 {
 	if (val <= 0x7F) {
-		s_w8(s, val);
+		p = put_8(p, val);
 	} else if (val <= 0x3FFF) {
-		s_w8(s, 0x80 | (val >> 7));
-		s_w8(s, val & 0x7F);
+		p = put_8(p, 0x80 | (val >> 7));
+		p = put_8(p, val & 0x7F);
 	} else if (val <= 0x1FFFFF) {
-		s_w8(s, 0x80 | (val >> 14));
-		s_w8(s, 0x80 | ((val >> 7) & 0x7F));
-		s_w8(s, val & 0x7F);
+		p = put_8(p, 0x80 | (val >> 14));
+		p = put_8(p, 0x80 | ((val >> 7) & 0x7F));
+		p = put_8(p, val & 0x7F);
 	} else {
-		s_w8(s, 0x80 | (val >> 22));
-		s_w8(s, 0x80 | ((val >> 15) & 0x7F));
-		s_w8(s, 0x80 | ((val >> 8) & 0x7F));
-		s_w8(s, val & 0xFF);
+		p = put_8(p, 0x80 | (val >> 22));
+		p = put_8(p, 0x80 | ((val >> 15) & 0x7F));
+		p = put_8(p, 0x80 | ((val >> 8) & 0x7F));
+		p = put_8(p, val & 0xFF);
 	}
+
+	return p;
 }
 
-static inline void s_u29b_value(struct serializer *s, uint32_t val)
+static inline uint8_t *put_u29b_value(uint8_t *p, uint32_t val)
 {
-	s_u29(s, 1 | ((val & 0xFFFFFFF) << 1));
+	return put_u29(p, 1 | ((val & 0xFFFFFFF) << 1));
 }
 
-static void flv_build_additional_audio(uint8_t **data, size_t *size,
-				       struct encoder_packet *packet,
-				       bool is_header, size_t index)
+static inline uint8_t *put_amf_conststring(uint8_t *p, const char *str,
+					   size_t len)
 {
-	UNUSED_PARAMETER(index);
-	struct array_output_data out;
-	struct serializer s;
+	p = put_be16(p, (uint16_t)len);
+	memcpy(p, str, len);
+	return p + len;
+}
 
-	array_output_serializer_init(&s, &out);
+#define put_amf_str(p, str) put_amf_conststring(p, str, sizeof(str) - 1)
 
-	s_w8(&s, AMF_STRING);
-	s_amf_conststring(&s, "additionalMedia");
+/* AMF wrapper in front of the payload of an additional audio packet */
+static uint8_t *put_additional_audio_prefix(uint8_t *p,
+					    struct encoder_packet *packet,
+					    bool is_header)
+{
+	p = put_8(p, AMF_STRING);
+	p = put_amf_str(p, "additionalMedia");
 
-	s_w8(&s, AMF_OBJECT);
+	p = put_8(p, AMF_OBJECT);
 	{
-		s_amf_conststring(&s, "id");
+		p = put_amf_str(p, "id");
 
-		s_w8(&s, AMF_STRING);
-		s_amf_conststring(&s, "stream0");
+		p = put_8(p, AMF_STRING);
+		p = put_amf_str(p, "stream0");
 
 		/* ----- */
 
-		s_amf_conststring(&s, "media");
+		p = put_amf_str(p, "media");
 
-		s_w8(&s, AMF_AVMPLUS);
-		s_w8(&s, AMF3_BYTE_ARRAY);
-		s_u29b_value(&s, (uint32_t)packet->size + 2);
-		s_w8(&s, 0xaf);
-		s_w8(&s, is_header ? 0 : 1);
-		s_write(&s, packet->data, packet->size);
+		p = put_8(p, AMF_AVMPLUS);
+		p = put_8(p, AMF3_BYTE_ARRAY);
+		p = put_u29b_value(p, (uint32_t)packet->size + 2);
+		p = put_8(p, 0xaf);
+		p = put_8(p, is_header ? 0 : 1);
 	}
-	s_wb24(&s, AMF_OBJECT_END);
 
-	*data = out.bytes.array;
-	*size = out.bytes.num;
+	return p;
 }
 
-static void flv_additional_audio(struct serializer *s, int32_t dts_offset,
+static void flv_additional_audio(struct flv_tag *tag, int32_t dts_offset,
 				 struct encoder_packet *packet, bool is_header,
 				 size_t index)
 {
+	UNUSED_PARAMETER(index);
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
-	uint8_t *data;
-	size_t size;
-
-	if (!packet->data || !packet->size)
-		return;
-
-	flv_build_additional_audio(&data, &size, packet, is_header, index);
+	uint8_t prefix[FLV_TAG_MAX_HEADER_SIZE - 11];
+	size_t prefix_size;
+	uint8_t *p;
 
-	s_w8(s, RTMP_PACKET_TYPE_INFO); //18
+	prefix_size = put_additional_audio_prefix(prefix, packet, is_header) -
+		      prefix;
 
 #ifdef DEBUG_TIMESTAMPS
 	blog(LOG_DEBUG, "Audio2: %lu", time_ms);
@@ -471,33 +541,40 @@ static void flv_additional_audio(struct serializer *s, int32_t dts_offset,
 	last_time = time_ms;
 #endif
 
-	s_wb24(s, (uint32_t)size);
-	s_wb24(s, time_ms);
-	s_w8(s, (time_ms >> 24) & 0x7F);
-	s_wb24(s, 0);
+	/* the AMF object end after the payload is part of the tag data */
+	p = put_tag_header(tag->header, RTMP_PACKET_TYPE_INFO, //18
+			   (uint32_t)(prefix_size + packet->size + 3), time_ms);
+	memcpy(p, prefix, prefix_size);
+	p += prefix_size;
 
-	serialize(s, data, size);
-	bfree(data);
-
-	s_wb32(s, (uint32_t)serializer_get_pos(s) - 1);
+	finish_tag(tag, p, packet, put_be24(tag->trailer, AMF_OBJECT_END));
 }
 
-void flv_additional_packet_mux(struct encoder_packet *packet,
-			       int32_t dts_offset, uint8_t **data, size_t *size,
+bool flv_additional_packet_tag(struct encoder_packet *packet,
+			       int32_t dts_offset, struct flv_tag *tag,
 			       bool is_header, size_t index)
 {
-	struct array_output_data out;
-	struct serializer s;
-
-	array_output_serializer_init(&s, &out);
+	tag->iovcnt = 0;
+	tag->size = 0;
 
 	if (packet->type == OBS_ENCODER_VIDEO) {
 		//currently unsupported
 		bcrash("who said you could output an additional video packet?");
-	} else {
-		flv_additional_audio(&s, dts_offset, packet, is_header, index);
 	}
 
-	*data = out.bytes.array;
-	*size = out.bytes.num;
+	if (!packet->data || !packet->size)
+		return false;
+
+	flv_additional_audio(tag, dts_offset, packet, is_header, index);
+	return true;
+}
+
+void flv_additional_packet_mux(struct encoder_packet *packet,
+			       int32_t dts_offset, uint8_t **data, size_t *size,
+			       bool is_header, size_t index)
+{
+	struct flv_tag tag;
+
+	flv_additional_packet_tag(packet, dts_offset, &tag, is_header, index);
+	flv_tag_flatten(&tag, data, size);
 }
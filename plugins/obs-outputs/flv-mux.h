@@ -26,6 +26,26 @@ static int32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 	return (int32_t)(val * MILLISECOND_DEN / packet->timebase_den);
 }
 
+/* largest tag prefix written by flv_packet_tag/flv_additional_packet_tag:
+ * the 11 byte tag header plus codec bytes or the AMF media wrapper */
+#define FLV_TAG_MAX_HEADER_SIZE 64
+#define FLV_TAG_MAX_TRAILER_SIZE 8
+
+struct flv_iov {
+	const uint8_t *data;
+	size_t size;
+};
+
+/* an FLV tag as header, packet payload (referenced, not copied) and
+ * trailer, ready for writev/fwrite */
+struct flv_tag {
+	uint8_t header[FLV_TAG_MAX_HEADER_SIZE];
+	uint8_t trailer[FLV_TAG_MAX_TRAILER_SIZE];
+	struct flv_iov iov[3];
+	size_t iovcnt;
+	size_t size;
+};
+
 extern void write_file_info(FILE *file, int64_t duration_ms, int64_t size);
 
 extern void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
@@ -34,6 +54,11 @@ extern void flv_additional_meta_data(obs_output_t *context, uint8_t **output,
 				     size_t *size);
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 			   uint8_t **output, size_t *size, bool is_header);
+extern bool flv_packet_tag(struct encoder_packet *packet, int32_t dts_offset,
+			   struct flv_tag *tag, bool is_header);
+extern bool flv_additional_packet_tag(struct encoder_packet *packet,
+				      int32_t dts_offset, struct flv_tag *tag,
+				      bool is_header, size_t index);
 extern void flv_additional_packet_mux(struct encoder_packet *packet,
 				      int32_t dts_offset, uint8_t **output,
 				      size_t *size, bool is_header,
@@ -87,16 +87,16 @@ static void *flv_output_create(obs_data_t *settings, obs_output_t *output)
 static int write_packet(struct flv_output *stream,
 			struct encoder_packet *packet, bool is_header)
 {
-	uint8_t *data;
-	size_t size;
+	struct flv_tag tag;
 	int ret = 0;
 
 	stream->last_packet_ts = get_ms_time(packet, packet->dts);
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data,
-		       &size, is_header);
-	fwrite(data, 1, size, stream->file);
-	bfree(data);
+	flv_packet_tag(packet, is_header ? 0 : stream->start_dts_offset, &tag,
+		       is_header);
+
+	for (size_t i = 0; i < tag.iovcnt; i++)
+		fwrite(tag.iov[i].data, 1, tag.iov[i].size, stream->file);
 
 	return ret;
 }
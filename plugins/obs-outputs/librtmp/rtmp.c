@@ -5356,3 +5356,86 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+/* Same as RTMP_Write for one complete FLV tag, but gathers the tag from
+ * several buffers so callers don't have to assemble it contiguously first.
+ * The trailing previous tag size is optional and ignored. */
+int
+RTMP_Writev(RTMP *r, const RTMPIOVec *iov, int iovcnt, int streamIdx)
+{
+    RTMPPacket *pkt = &r->m_write;
+    char hdr[11];
+    const char *src;
+    int total = 0, got = 0, idx = 0, off = 0, ret;
+    int i;
+
+    for (i = 0; i < iovcnt; i++)
+        total += iov[i].iov_len;
+
+    if (total < 11 || pkt->m_nBytesRead)
+        return 0;
+
+    /* the 11 byte tag header may span buffers */
+    while (got < 11)
+    {
+        int num = iov[idx].iov_len - off;
+        if (num > 11 - got)
+            num = 11 - got;
+        memcpy(hdr + got, iov[idx].iov_base + off, num);
+        got += num;
+        off += num;
+        if (off == iov[idx].iov_len)
+        {
+            idx++;
+            off = 0;
+        }
+    }
+
+    pkt->m_nChannel = 0x04;	/* source channel */
+    pkt->m_nInfoField2 = r->Link.streams[streamIdx].id;
+    pkt->m_packetType = hdr[0];
+    pkt->m_nBodySize = AMF_DecodeInt24(hdr + 1);
+    pkt->m_nTimeStamp = AMF_DecodeInt24(hdr + 4);
+    pkt->m_nTimeStamp |= hdr[7] << 24;
+
+    if (((pkt->m_packetType == RTMP_PACKET_TYPE_AUDIO
+            || pkt->m_packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !pkt->m_nTimeStamp) || pkt->m_packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        pkt->m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        pkt->m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    if ((int)pkt->m_nBodySize > total - 11)
+    {
+        RTMP_Log(RTMP_LOGDEBUG, "%s, FLV tag truncated", __FUNCTION__);
+        return 0;
+    }
+
+    if (!RTMPPacket_Alloc(pkt, pkt->m_nBodySize))
+    {
+        RTMP_Log(RTMP_LOGDEBUG, "%s, failed to allocate packet", __FUNCTION__);
+        return FALSE;
+    }
+
+    while (pkt->m_nBytesRead < pkt->m_nBodySize)
+    {
+        int num = iov[idx].iov_len - off;
+        if (num > (int)(pkt->m_nBodySize - pkt->m_nBytesRead))
+            num = pkt->m_nBodySize - pkt->m_nBytesRead;
+        src = iov[idx].iov_base + off;
+        memcpy(pkt->m_body + pkt->m_nBytesRead, src, num);
+        pkt->m_nBytesRead += num;
+        idx++;
+        off = 0;
+    }
+
+    ret = RTMP_SendPacket(r, pkt, FALSE);
+    RTMPPacket_Free(pkt);
+    pkt->m_nBytesRead = 0;
+
+    return ret ? total : -1;
+}
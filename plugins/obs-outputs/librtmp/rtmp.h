@@ -263,6 +263,12 @@ extern "C"
         char *m_body;
     } RTMPPacket;
 
+    typedef struct RTMPIOVec
+    {
+        const char *iov_base;
+        int iov_len;
+    } RTMPIOVec;
+
     typedef struct RTMPSockBuf
     {
         SOCKET sb_socket;
@@ -538,6 +544,7 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    int RTMP_Writev(RTMP *r, const RTMPIOVec *iov, int iovcnt, int streamIdx);
 
 #ifdef USE_HASHSWF
     /* hashswf.c */
@@ -0,0 +1,350 @@
+#ifdef __linux__
+#include "rtmp-stream.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+bool socket_thread_linux_init(struct rtmp_stream *stream)
+{
+	socket_thread_linux_free(stream);
+
+	stream->socket_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (stream->socket_wake_fd == -1) {
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Failed to create eventfd, %d",
+		     errno);
+		return false;
+	}
+
+	return true;
+}
+
+void socket_thread_linux_signal(struct rtmp_stream *stream)
+{
+	uint64_t one = 1;
+	ssize_t ret;
+
+	if (stream->socket_wake_fd == -1)
+		return;
+
+	/* EAGAIN only happens if the counter is saturated, in which case
+	 * the socket thread is already due to wake up */
+	ret = write(stream->socket_wake_fd, &one, sizeof(one));
+	UNUSED_PARAMETER(ret);
+}
+
+void socket_thread_linux_free(struct rtmp_stream *stream)
+{
+	if (stream->socket_wake_fd != -1) {
+		close(stream->socket_wake_fd);
+		stream->socket_wake_fd = -1;
+	}
+}
+
+static void drain_wake_fd(struct rtmp_stream *stream)
+{
+	uint64_t count;
+	ssize_t ret = read(stream->socket_wake_fd, &count, sizeof(count));
+	UNUSED_PARAMETER(ret);
+}
+
+static int get_socket_error(struct rtmp_stream *stream)
+{
+	int err_code = 0;
+	socklen_t size = sizeof(err_code);
+
+	getsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_ERROR,
+		   &err_code, &size);
+	return err_code;
+}
+
+static bool socket_event(struct rtmp_stream *stream, uint32_t events,
+			 bool *can_write, uint64_t last_send_time)
+{
+	if (events & EPOLLOUT)
+		*can_write = true;
+
+	if (events & EPOLLIN) {
+		char discard[16384];
+
+		for (;;) {
+			ssize_t ret = recv(stream->rtmp.m_sb.sb_socket,
+					   discard, sizeof(discard), 0);
+			if (ret > 0)
+				continue;
+
+			if (ret == -1 && errno == EINTR)
+				continue;
+			if (ret == -1 &&
+			    (errno == EAGAIN || errno == EWOULDBLOCK))
+				break;
+
+			/* 0 means the peer closed the connection, which is
+			 * handled as a hangup below */
+			if (ret == 0) {
+				events |= EPOLLRDHUP;
+				break;
+			}
+
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Socket error, recv() "
+			     "returned %d, errno %d",
+			     (int)ret, errno);
+			stream->rtmp.last_error_code = errno;
+			fatal_sock_shutdown(stream);
+			return false;
+		}
+	}
+
+	if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+		int err_code = get_socket_error(stream);
+
+		if (last_send_time) {
+			uint32_t diff =
+				(os_gettime_ns() / 1000000) - last_send_time;
+
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Received hangup, "
+			     "%u ms since last send (buffer: %d / %d)",
+			     diff, (int)stream->write_buf_len,
+			     (int)stream->write_buf_size);
+		}
+
+		if (os_event_try(stream->stop_event) != EAGAIN)
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due to hangup "
+			     "during shutdown, %d bytes lost, error %d",
+			     (int)stream->write_buf_len, err_code);
+		else
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due to "
+			     "hangup, error %d",
+			     err_code);
+
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+
+	return true;
+}
+
+enum data_ret { RET_BREAK, RET_FATAL, RET_CONTINUE };
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write,
+				uint64_t *last_send_time,
+				size_t latency_packet_size, int delay_time)
+{
+	bool exit_loop = false;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (!stream->write_buf_len) {
+		/* the buffer may have been emptied in a previous loop cycle,
+		 * especially if using low latency mode */
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+	}
+
+	size_t send_len = stream->write_buf_len;
+	if (stream->low_latency_mode && send_len > latency_packet_size)
+		send_len = latency_packet_size;
+
+	int ret = RTMPSockBuf_Send(&stream->rtmp.m_sb,
+				   (const char *)stream->write_buf,
+				   (int)send_len);
+
+	if (ret > 0) {
+		if (stream->write_buf_len - ret)
+			memmove(stream->write_buf, stream->write_buf + ret,
+				stream->write_buf_len - ret);
+		stream->write_buf_len -= ret;
+
+		*last_send_time = os_gettime_ns() / 1000000;
+
+		os_event_signal(stream->buffer_space_available_event);
+	} else {
+		int err_code = ret == -1 ? errno : 0;
+
+		if (ret == -1 && err_code == EINTR) {
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return RET_CONTINUE;
+		}
+
+		if (ret == -1 &&
+		    (err_code == EAGAIN || err_code == EWOULDBLOCK)) {
+			/* wait for the next EPOLLOUT edge */
+			*can_write = false;
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return RET_BREAK;
+		}
+
+		/* connection closed, or connection was aborted /
+		 * socket closed / etc, that's a fatal error. */
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Socket error, send() returned %d, "
+		     "errno %d",
+		     ret, err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	/* finish writing for now */
+	if (stream->write_buf_len <= 1000)
+		exit_loop = true;
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (delay_time)
+		os_sleep_ms(delay_time);
+
+	return exit_loop ? RET_BREAK : RET_CONTINUE;
+}
+
+#define LATENCY_FACTOR 20
+
+static inline void socket_thread_linux_internal(struct rtmp_stream *stream)
+{
+	struct epoll_event ev = {0};
+	bool can_write = false;
+	int epoll_fd;
+
+	int delay_time;
+	size_t latency_packet_size;
+	uint64_t last_send_time = 0;
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Aborting due to epoll_create1 "
+		     "failure, %d",
+		     errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	/* edge triggered, so EPOLLOUT is reported once on registration and
+	 * then again only after send() has returned EAGAIN */
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.fd = stream->rtmp.m_sb.sb_socket;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stream->rtmp.m_sb.sb_socket,
+		      &ev) == -1) {
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Aborting due to epoll_ctl "
+		     "failure on socket, %d",
+		     errno);
+		close(epoll_fd);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = stream->socket_wake_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stream->socket_wake_fd, &ev) ==
+	    -1) {
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Aborting due to epoll_ctl "
+		     "failure on eventfd, %d",
+		     errno);
+		close(epoll_fd);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	if (stream->low_latency_mode) {
+		delay_time = 1000 / LATENCY_FACTOR;
+		latency_packet_size =
+			stream->write_buf_size / (LATENCY_FACTOR - 2);
+	} else {
+		latency_packet_size = stream->write_buf_size;
+		delay_time = 0;
+	}
+
+	for (;;) {
+		struct epoll_event events[2];
+		int count;
+
+		if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+			pthread_mutex_lock(&stream->write_buf_mutex);
+			if (stream->write_buf_len == 0) {
+				pthread_mutex_unlock(&stream->write_buf_mutex);
+				os_event_reset(
+					stream->send_thread_signaled_exit);
+				break;
+			}
+
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+		}
+
+		count = epoll_wait(epoll_fd, events, 2, -1);
+		if (count == -1) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due "
+					"to epoll_wait failure, %d",
+			     errno);
+			close(epoll_fd);
+			fatal_sock_shutdown(stream);
+			return;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.fd == stream->socket_wake_fd) {
+				drain_wake_fd(stream);
+				continue;
+			}
+
+			if (!socket_event(stream, events[i].events, &can_write,
+					  last_send_time)) {
+				close(epoll_fd);
+				return;
+			}
+		}
+
+		while (can_write) {
+			enum data_ret ret = write_data(stream, &can_write,
+						       &last_send_time,
+						       latency_packet_size,
+						       delay_time);
+
+			if (ret == RET_FATAL) {
+				close(epoll_fd);
+				return;
+			}
+
+			/* when shutting down, flush the tail of the buffer
+			 * too, nothing else is going to wake us up for it */
+			if (ret == RET_BREAK &&
+			    !(can_write && stream->write_buf_len &&
+			      os_event_try(stream->send_thread_signaled_exit) !=
+				      EAGAIN))
+				break;
+		}
+	}
+
+	close(epoll_fd);
+	blog(LOG_INFO, "socket_thread_linux: Normal exit");
+}
+
+void *socket_thread_linux(void *data)
+{
+	struct rtmp_stream *stream = data;
+	os_set_thread_name("rtmp-stream: socket_thread");
+	socket_thread_linux_internal(stream);
+	return NULL;
+}
+#endif
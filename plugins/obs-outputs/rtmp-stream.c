@@ -133,6 +133,9 @@ static void rtmp_stream_destroy(void *data)
 	os_event_destroy(stream->socket_available_event);
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
+#ifdef __linux__
+	socket_thread_linux_free(stream);
+#endif
 
 	if (stream->write_buf)
 		bfree(stream->write_buf);
@@ -144,6 +147,9 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+#ifdef __linux__
+	stream->socket_wake_fd = -1;
+#endif
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_Init(&stream->rtmp);
@@ -363,6 +369,14 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
+static inline void signal_buffer_has_data(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+#ifdef __linux__
+	socket_thread_linux_signal(stream);
+#endif
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len,
 			     void *arg)
 {
@@ -393,7 +407,7 @@ retry_send:
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-	os_event_signal(stream->buffer_has_data_event);
+	signal_buffer_has_data(stream);
 
 	return len;
 }
@@ -402,7 +416,8 @@ static int send_packet(struct rtmp_stream *stream,
 		       struct encoder_packet *packet, bool is_header,
 		       size_t idx)
 {
-	uint8_t *data;
+	struct flv_tag tag;
+	RTMPIOVec iov[3];
 	size_t size;
 	int recv_size = 0;
 	int ret = 0;
@@ -424,20 +439,30 @@ static int send_packet(struct rtmp_stream *stream,
 	}
 
 	if (idx > 0) {
-		flv_additional_packet_mux(
-			packet, is_header ? 0 : stream->start_dts_offset, &data,
-			&size, is_header, idx);
+		flv_additional_packet_tag(packet,
+					  is_header ? 0
+						    : stream->start_dts_offset,
+					  &tag, is_header, idx);
 	} else {
-		flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset,
-			       &data, &size, is_header);
+		flv_packet_tag(packet, is_header ? 0 : stream->start_dts_offset,
+			       &tag, is_header);
 	}
 
+	size = tag.size;
+
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	/* the payload goes straight from the packet into the RTMP chunk
+	 * buffer, no intermediate copy of the whole tag */
+	for (size_t i = 0; i < tag.iovcnt; i++) {
+		iov[i].iov_base = (const char *)tag.iov[i].data;
+		iov[i].iov_len = (int)tag.iov[i].size;
+	}
+
+	if (tag.iovcnt)
+		ret = RTMP_Writev(&stream->rtmp, iov, (int)tag.iovcnt, 0);
 
 	if (is_header)
 		bfree(packet->data);
@@ -631,7 +656,7 @@ static void *send_thread(void *data)
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
-		os_event_signal(stream->buffer_has_data_event);
+		signal_buffer_has_data(stream);
 		pthread_join(stream->socket_thread, NULL);
 		stream->socket_thread_active = false;
 		stream->rtmp.m_bCustomSend = false;
@@ -861,6 +886,15 @@ static int init_send(struct rtmp_stream *stream)
 #ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL,
 				     socket_thread_windows, stream);
+#elif defined(__linux__)
+		if (!socket_thread_linux_init(stream)) {
+			RTMP_Close(&stream->rtmp);
+			warn("Failed to create socket wakeup event");
+			return OBS_OUTPUT_ERROR;
+		}
+
+		ret = pthread_create(&stream->socket_thread, NULL,
+				     socket_thread_linux, stream);
 #else
 		warn("New socket loop not supported on this platform");
 		return OBS_OUTPUT_ERROR;
@@ -128,8 +128,16 @@ struct rtmp_stream {
 	os_event_t *buffer_has_data_event;
 	os_event_t *socket_available_event;
 	os_event_t *send_thread_signaled_exit;
+#ifdef __linux__
+	int socket_wake_fd;
+#endif
 };
 
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#elif defined(__linux__)
+void *socket_thread_linux(void *data);
+bool socket_thread_linux_init(struct rtmp_stream *stream);
+void socket_thread_linux_signal(struct rtmp_stream *stream);
+void socket_thread_linux_free(struct rtmp_stream *stream);
 #endif
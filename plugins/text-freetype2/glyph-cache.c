@@ -0,0 +1,507 @@
+/******************************************************************************
+Copyright (C) 2026 by agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/bmem.h>
+#include "glyph-cache.h"
+
+extern FT_Library ft2_lib;
+
+static const wchar_t *standard_glyphs = L"abcdefghijklmnopqrstuvwxyz"
+					L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
+					L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"";
+
+/* protects the font table, and the FreeType library which doesn't allow
+ * faces to be created or destroyed concurrently */
+static pthread_mutex_t cache_mutex;
+static struct hash_table fonts;
+
+void glyph_cache_init(void)
+{
+	pthread_mutex_init(&cache_mutex, NULL);
+	hash_table_init(&fonts);
+}
+
+void glyph_cache_free(void)
+{
+	hash_table_free(&fonts);
+	pthread_mutex_destroy(&cache_mutex);
+}
+
+static inline uint64_t font_hash(const char *path, FT_Long face_index,
+				 uint16_t size, bool antialiasing)
+{
+	uint64_t key = ((uint64_t)face_index << 32) | ((uint64_t)size << 1) |
+		       (antialiasing ? 1 : 0);
+	return hash_str(path) ^ hash_uint64(key);
+}
+
+static inline FT_Render_Mode get_render_mode(struct glyph_font *font)
+{
+	return font->antialiasing ? FT_RENDER_MODE_NORMAL
+				  : FT_RENDER_MODE_MONO;
+}
+
+/* pages are sized to hold roughly a 16x16 grid of glyphs, so small fonts
+ * don't take up a full 2048x2048 page */
+static uint32_t get_page_size(uint16_t size)
+{
+	uint32_t page_size = GLYPH_MIN_PAGE_SIZE;
+
+	while (page_size < (uint32_t)size * 16 &&
+	       page_size < GLYPH_MAX_PAGE_SIZE)
+		page_size *= 2;
+
+	return page_size;
+}
+
+static struct glyph_entry *find_glyph(struct glyph_font *font,
+				      FT_UInt glyph_index)
+{
+	struct hash_node *node =
+		hash_table_first(&font->glyphs, hash_uint64(glyph_index));
+
+	while (node) {
+		struct glyph_entry *entry =
+			hash_entry(node, struct glyph_entry, node);
+		if (entry->index == glyph_index)
+			return entry;
+		node = hash_table_next(node);
+	}
+
+	return NULL;
+}
+
+static void clear_page(struct glyph_font *font, struct glyph_page *page)
+{
+	for (size_t i = 0; i < page->glyphs.num; i++) {
+		struct glyph_entry *entry = page->glyphs.array[i];
+		hash_table_remove(&font->glyphs, &entry->node);
+		bfree(entry);
+	}
+
+	da_resize(page->glyphs, 0);
+	memset(page->data, 0, (size_t)font->page_size * font->page_size);
+	page->x = 0;
+	page->y = 0;
+	page->row_h = 0;
+	page->dirty = true;
+}
+
+static struct glyph_page *add_page(struct glyph_font *font)
+{
+	struct glyph_page *page = bzalloc(sizeof(struct glyph_page));
+	page->data = bzalloc((size_t)font->page_size * font->page_size);
+	page->dirty = true;
+
+	font->cur_page = font->num_pages;
+	font->pages[font->num_pages++] = page;
+
+	blog(LOG_DEBUG, "FT2-text: Glyph atlas of %s at size %d grew to %u "
+			"pages of %ux%u",
+	     font->path, (int)font->size, font->num_pages, font->page_size,
+	     font->page_size);
+	return page;
+}
+
+/* reuses the least recently used page, excluding pages that hold glyphs of
+ * the text currently being cached */
+static struct glyph_page *evict_page(struct glyph_font *font)
+{
+	struct glyph_page *oldest = NULL;
+	uint32_t oldest_idx = 0;
+
+	for (uint32_t i = 0; i < font->num_pages; i++) {
+		struct glyph_page *page = font->pages[i];
+		if (page->last_used == font->use_stamp)
+			continue;
+		if (!oldest || page->last_used < oldest->last_used) {
+			oldest = page;
+			oldest_idx = i;
+		}
+	}
+
+	if (!oldest)
+		return NULL;
+
+	clear_page(font, oldest);
+	font->cur_page = oldest_idx;
+	os_atomic_inc_long(&font->generation);
+	return oldest;
+}
+
+static inline bool page_has_space(struct glyph_font *font,
+				  struct glyph_page *page, uint32_t g_w,
+				  uint32_t g_h)
+{
+	uint32_t x = page->x;
+	uint32_t y = page->y;
+
+	if (x + g_w >= font->page_size) {
+		x = 0;
+		y += page->row_h + 1;
+	}
+
+	return y + g_h < font->page_size;
+}
+
+static struct glyph_page *find_space(struct glyph_font *font, uint32_t g_w,
+				     uint32_t g_h)
+{
+	struct glyph_page *page = NULL;
+
+	if (font->num_pages) {
+		page = font->pages[font->cur_page];
+		if (page_has_space(font, page, g_w, g_h))
+			return page;
+	}
+
+	if (font->num_pages < GLYPH_MAX_PAGES)
+		return add_page(font);
+
+	return evict_page(font);
+}
+
+static uint8_t get_pixel_value(const unsigned char *buf_row,
+			       FT_Render_Mode render_mode, const uint32_t x)
+{
+	if (render_mode == FT_RENDER_MODE_NORMAL) {
+		return buf_row[x];
+	}
+
+	const uint32_t byte_index = x / 8;
+	const uint8_t bit_index = x % 8;
+	const bool pixel_set = (buf_row[byte_index] >> (7 - bit_index)) & 1;
+	return pixel_set ? 255 : 0;
+}
+
+static void rasterize(struct glyph_font *font, struct glyph_page *page,
+		      FT_GlyphSlot slot, const uint32_t dx, const uint32_t dy)
+{
+	/**
+	 * The pitch's absolute value is the number of bytes taken by one bitmap
+	 * row, including padding.
+	 *
+	 * Source: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html
+	 */
+	const FT_Render_Mode render_mode = get_render_mode(font);
+	const int pitch = abs(slot->bitmap.pitch);
+
+	for (uint32_t y = 0; y < slot->bitmap.rows; y++) {
+		const uint32_t row_start = y * pitch;
+		const uint32_t row = (dy + y) * font->page_size;
+
+		for (uint32_t x = 0; x < slot->bitmap.width; x++) {
+			const uint8_t pixel_value =
+				get_pixel_value(&slot->bitmap.buffer[row_start],
+						render_mode, x);
+			page->data[row + dx + x] = pixel_value;
+		}
+	}
+}
+
+/* renders a glyph into the atlas, returns true if a page was modified */
+static bool render_glyph(struct glyph_font *font, struct glyph_entry *entry)
+{
+	const FT_Render_Mode render_mode = get_render_mode(font);
+	const FT_Int32 load_mode = render_mode == FT_RENDER_MODE_MONO
+					   ? FT_LOAD_TARGET_MONO
+					   : FT_LOAD_DEFAULT;
+	FT_GlyphSlot slot = font->face->glyph;
+	struct glyph_info *glyph = &entry->info;
+	struct glyph_page *page;
+	uint32_t g_w, g_h;
+
+	FT_Load_Glyph(font->face, entry->index, load_mode);
+	FT_Render_Glyph(slot, render_mode);
+
+	g_w = slot->bitmap.width;
+	g_h = slot->bitmap.rows;
+
+	glyph->w = g_w;
+	glyph->h = g_h;
+	glyph->yoff = slot->bitmap_top;
+	glyph->xoff = slot->bitmap_left;
+	glyph->xadv = slot->advance.x >> 6;
+	glyph->page = GLYPH_NO_PAGE;
+
+	if (!g_w || !g_h)
+		return false;
+
+	page = g_w < font->page_size && g_h < font->page_size
+		       ? find_space(font, g_w, g_h)
+		       : NULL;
+	if (!page) {
+		if (!font->warned) {
+			blog(LOG_WARNING, "FT2-text: Out of space trying to "
+					  "render glyphs");
+			font->warned = true;
+		}
+		return false;
+	}
+
+	if (page->x + g_w >= font->page_size) {
+		page->x = 0;
+		page->y += page->row_h + 1;
+		page->row_h = 0;
+	}
+
+	rasterize(font, page, slot, page->x, page->y);
+
+	glyph->u = (float)page->x / (float)font->page_size;
+	glyph->u2 = (float)(page->x + g_w) / (float)font->page_size;
+	glyph->v = (float)page->y / (float)font->page_size;
+	glyph->v2 = (float)(page->y + g_h) / (float)font->page_size;
+	for (uint32_t i = 0; i < font->num_pages; i++) {
+		if (font->pages[i] == page)
+			glyph->page = i;
+	}
+
+	page->x += g_w + 1;
+	if (g_h > page->row_h)
+		page->row_h = g_h;
+	page->last_used = font->use_stamp;
+	page->dirty = true;
+	da_push_back(page->glyphs, &entry);
+	return true;
+}
+
+static inline bool glyph_missing(const struct glyph_info *glyph)
+{
+	return glyph->page == GLYPH_NO_PAGE && glyph->w && glyph->h;
+}
+
+bool glyph_font_cache_text(struct glyph_font *font, const wchar_t *text)
+{
+	bool changed = false;
+
+	if (!text)
+		return false;
+
+	/* mark the pages the text already uses so they aren't evicted while
+	 * making room for the rest of it */
+	font->use_stamp++;
+	for (const wchar_t *ch = text; *ch; ch++)
+		glyph_font_get(font, *ch);
+
+	for (const wchar_t *ch = text; *ch; ch++) {
+		FT_UInt glyph_index = FT_Get_Char_Index(font->face, *ch);
+		struct glyph_entry *entry = find_glyph(font, glyph_index);
+
+		if (entry) {
+			if (!glyph_missing(&entry->info))
+				continue;
+		} else {
+			entry = bzalloc(sizeof(struct glyph_entry));
+			entry->index = glyph_index;
+			hash_table_insert(&font->glyphs, &entry->node,
+					  hash_uint64(glyph_index));
+		}
+
+		if (render_glyph(font, entry))
+			changed = true;
+	}
+
+	return changed;
+}
+
+const struct glyph_info *glyph_font_get(struct glyph_font *font, wchar_t ch)
+{
+	FT_UInt glyph_index = FT_Get_Char_Index(font->face, ch);
+	struct glyph_entry *entry = find_glyph(font, glyph_index);
+
+	if (!entry)
+		return NULL;
+
+	if (entry->info.page != GLYPH_NO_PAGE)
+		font->pages[entry->info.page]->last_used = font->use_stamp;
+	return &entry->info;
+}
+
+uint32_t glyph_font_max_height(struct glyph_font *font, const wchar_t *text)
+{
+	uint32_t max_h = font->standard_max_h;
+
+	for (const wchar_t *ch = text; ch && *ch; ch++) {
+		const struct glyph_info *glyph = glyph_font_get(font, *ch);
+		if (glyph && (uint32_t)glyph->h > max_h)
+			max_h = glyph->h;
+	}
+
+	return max_h;
+}
+
+void glyph_font_upload(struct glyph_font *font)
+{
+	glyph_font_lock(font);
+
+	for (uint32_t i = 0; i < font->num_pages; i++) {
+		struct glyph_page *page = font->pages[i];
+
+		if (!page->dirty)
+			continue;
+
+		if (page->tex) {
+			gs_texture_set_image(page->tex, page->data,
+					     font->page_size, false);
+		} else {
+			page->tex = gs_texture_create(
+				font->page_size, font->page_size, GS_A8, 1,
+				(const uint8_t **)&page->data, GS_DYNAMIC);
+		}
+
+		page->dirty = false;
+	}
+
+	glyph_font_unlock(font);
+}
+
+size_t glyph_font_memory(struct glyph_font *font, uint32_t *pages)
+{
+	size_t page_bytes;
+	uint32_t num_pages;
+
+	glyph_font_lock(font);
+	page_bytes = (size_t)font->page_size * font->page_size;
+	num_pages = font->num_pages;
+	glyph_font_unlock(font);
+
+	if (pages)
+		*pages = num_pages;
+	return page_bytes * num_pages * 2;
+}
+
+static struct glyph_font *create_font(const char *path, FT_Long face_index,
+				      uint16_t size, bool antialiasing)
+{
+	struct glyph_font *font = bzalloc(sizeof(struct glyph_font));
+
+	if (FT_New_Face(ft2_lib, path, face_index, &font->face) != 0) {
+		bfree(font);
+		return NULL;
+	}
+
+	FT_Set_Pixel_Sizes(font->face, 0, size);
+	FT_Select_Charmap(font->face, FT_ENCODING_UNICODE);
+
+	pthread_mutex_init(&font->mutex, NULL);
+	font->path = bstrdup(path);
+	font->face_index = face_index;
+	font->size = size;
+	font->antialiasing = antialiasing;
+	font->page_size = get_page_size(size);
+	font->refs = 1;
+
+	glyph_font_cache_text(font, standard_glyphs);
+	font->standard_max_h = glyph_font_max_height(font, standard_glyphs);
+
+	return font;
+}
+
+struct glyph_font *glyph_font_acquire(const char *path, FT_Long face_index,
+				      uint16_t size, bool antialiasing)
+{
+	uint64_t hash = font_hash(path, face_index, size, antialiasing);
+	struct glyph_font *font = NULL;
+	struct hash_node *node;
+
+	pthread_mutex_lock(&cache_mutex);
+
+	node = hash_table_first(&fonts, hash);
+	while (node) {
+		struct glyph_font *cur =
+			hash_entry(node, struct glyph_font, node);
+
+		if (strcmp(cur->path, path) == 0 &&
+		    cur->face_index == face_index && cur->size == size &&
+		    cur->antialiasing == antialiasing) {
+			font = cur;
+			font->refs++;
+			break;
+		}
+
+		node = hash_table_next(node);
+	}
+
+	if (!font) {
+		font = create_font(path, face_index, size, antialiasing);
+		if (font)
+			hash_table_insert(&fonts, &font->node, hash);
+	}
+
+	pthread_mutex_unlock(&cache_mutex);
+	return font;
+}
+
+static void destroy_font(struct glyph_font *font)
+{
+	uint32_t num_pages;
+	size_t memory = glyph_font_memory(font, &num_pages);
+
+	blog(LOG_DEBUG,
+	     "FT2-text: Releasing glyph atlas of %s at size %d "
+	     "(%u pages, %zu KB)",
+	     font->path, (int)font->size, num_pages, memory / 1024);
+
+	obs_enter_graphics();
+	for (uint32_t i = 0; i < font->num_pages; i++)
+		gs_texture_destroy(font->pages[i]->tex);
+	obs_leave_graphics();
+
+	for (uint32_t i = 0; i < font->num_pages; i++) {
+		struct glyph_page *page = font->pages[i];
+		da_free(page->glyphs);
+		bfree(page->data);
+		bfree(page);
+	}
+
+	/* every glyph is in the table, including blank glyphs and glyphs that
+	 * didn't fit, which aren't on any page */
+	for (size_t i = 0; i < font->glyphs.num_buckets; i++) {
+		struct hash_node *node = font->glyphs.buckets[i];
+
+		while (node) {
+			struct hash_node *next = node->next;
+			bfree(hash_entry(node, struct glyph_entry, node));
+			node = next;
+		}
+	}
+
+	hash_table_free(&font->glyphs);
+	FT_Done_Face(font->face);
+	pthread_mutex_destroy(&font->mutex);
+	bfree(font->path);
+	bfree(font);
+}
+
+void glyph_font_release(struct glyph_font *font)
+{
+	bool destroy = false;
+
+	if (!font)
+		return;
+
+	pthread_mutex_lock(&cache_mutex);
+	if (--font->refs == 0) {
+		hash_table_remove(&fonts, &font->node);
+		destroy = true;
+	}
+
+	/* FT_Done_Face has to be serialized with FT_New_Face */
+	if (destroy)
+		destroy_font(font);
+	pthread_mutex_unlock(&cache_mutex);
+}
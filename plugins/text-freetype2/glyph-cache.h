@@ -0,0 +1,126 @@
+/******************************************************************************
+Copyright (C) 2026 by agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include <util/hash-table.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+/*
+ * Process-wide glyph cache
+ *
+ *   Sources using the same font file, face, size and render mode share one
+ *   glyph_font, which owns the FreeType face and a set of A8 atlas pages.
+ *   When every page is full, the least recently used page that isn't needed
+ *   by the text being cached is cleared and reused, and the font's
+ *   generation is bumped so other sources know to rebuild their vertices.
+ */
+
+#define GLYPH_MAX_PAGES 4
+#define GLYPH_MIN_PAGE_SIZE 256
+#define GLYPH_MAX_PAGE_SIZE 2048
+#define GLYPH_NO_PAGE UINT32_MAX
+
+struct glyph_info {
+	float u, v, u2, v2;
+	int32_t w, h, xoff, yoff;
+	int32_t xadv;
+	uint32_t page;
+};
+
+struct glyph_entry {
+	struct hash_node node;
+	FT_UInt index;
+	struct glyph_info info;
+};
+
+struct glyph_page {
+	uint8_t *data;
+	gs_texture_t *tex;
+	uint32_t x, y, row_h;
+	uint64_t last_used;
+	DARRAY(struct glyph_entry *) glyphs;
+	bool dirty;
+};
+
+struct glyph_font {
+	struct hash_node node;
+	char *path;
+	FT_Long face_index;
+	uint16_t size;
+	bool antialiasing;
+	long refs;
+
+	pthread_mutex_t mutex;
+	FT_Face face;
+	struct hash_table glyphs;
+	struct glyph_page *pages[GLYPH_MAX_PAGES];
+	uint32_t num_pages;
+	uint32_t cur_page;
+	uint32_t page_size;
+	uint32_t standard_max_h;
+	uint64_t use_stamp;
+	volatile long generation;
+	bool warned;
+};
+
+extern void glyph_cache_init(void);
+extern void glyph_cache_free(void);
+
+/* returns a referenced font shared with every other user of the same face,
+ * size and render mode, or NULL if the face couldn't be loaded */
+extern struct glyph_font *glyph_font_acquire(const char *path,
+					     FT_Long face_index, uint16_t size,
+					     bool antialiasing);
+extern void glyph_font_release(struct glyph_font *font);
+
+static inline void glyph_font_lock(struct glyph_font *font)
+{
+	pthread_mutex_lock(&font->mutex);
+}
+
+static inline void glyph_font_unlock(struct glyph_font *font)
+{
+	pthread_mutex_unlock(&font->mutex);
+}
+
+/* the face and the functions below require the font to be locked */
+
+/* rasterizes the glyphs of text that aren't cached yet, returns true if any
+ * page has to be uploaded with glyph_font_upload */
+extern bool glyph_font_cache_text(struct glyph_font *font,
+				  const wchar_t *text);
+
+/* returns the cached glyph for a character, NULL if it was never cached.
+ * glyphs that didn't fit in the atlas have their page set to GLYPH_NO_PAGE */
+extern const struct glyph_info *glyph_font_get(struct glyph_font *font,
+					       wchar_t ch);
+
+/* returns the tallest glyph of the standard set and of text */
+extern uint32_t glyph_font_max_height(struct glyph_font *font,
+				      const wchar_t *text);
+
+/* uploads modified pages.  requires the graphics context, the font must not
+ * be locked by the caller */
+extern void glyph_font_upload(struct glyph_font *font);
+
+/* returns the memory used by the atlas pages (system and video memory) */
+extern size_t glyph_font_memory(struct glyph_font *font, uint32_t *pages);
@@ -56,8 +56,10 @@ gs_vertbuffer_t *create_uv_vbuffer(uint32_t num_verts, bool add_color)
 	return tmp;
 }
 
+/* the vertex buffer has to be flushed by the caller */
 void draw_uv_vbuffer(gs_vertbuffer_t *vbuf, gs_texture_t *tex,
-		     gs_effect_t *effect, uint32_t num_verts)
+		     gs_effect_t *effect, uint32_t start_vert,
+		     uint32_t num_verts)
 {
 	gs_texture_t *texture = tex;
 	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
@@ -67,7 +69,6 @@ void draw_uv_vbuffer(gs_vertbuffer_t *vbuf, gs_texture_t *tex,
 	if (vbuf == NULL || tex == NULL)
 		return;
 
-	gs_vertexbuffer_flush(vbuf);
 	gs_load_vertexbuffer(vbuf);
 	gs_load_indexbuffer(NULL);
 
@@ -77,7 +78,7 @@ void draw_uv_vbuffer(gs_vertbuffer_t *vbuf, gs_texture_t *tex,
 		if (gs_technique_begin_pass(tech, i)) {
 			gs_effect_set_texture(image, texture);
 
-			gs_draw(GS_TRIS, 0, num_verts);
+			gs_draw(GS_TRIS, start_vert, num_verts);
 
 			gs_technique_end_pass(tech);
 		}
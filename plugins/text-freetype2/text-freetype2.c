@@ -33,8 +33,6 @@ MODULE_EXPORT const char *obs_module_description(void)
 	return "FreeType2 text source";
 }
 
-uint32_t texbuf_w = 2048, texbuf_h = 2048;
-
 static struct obs_source_info freetype2_source_info_v1 = {
 	.id = "text_ft2_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
@@ -101,6 +99,8 @@ bool obs_module_load()
 		bfree(config_dir);
 	}
 
+	glyph_cache_init();
+
 	obs_register_source(&freetype2_source_info_v1);
 	obs_register_source(&freetype2_source_info_v2);
 
@@ -113,6 +113,8 @@ void obs_module_unload(void)
 		free_os_font_list();
 		FT_Done_FreeType(ft2_lib);
 	}
+
+	glyph_cache_free();
 }
 
 static const char *ft2_source_get_name(void *unused)
@@ -191,17 +193,14 @@ static void ft2_source_destroy(void *data)
 {
 	struct ft2_source *srcdata = data;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
+	os_file_watch_remove(srcdata->file_watch);
+	pthread_mutex_destroy(&srcdata->file_mutex);
+	bfree(srcdata->pending_text);
+	dstr_free(&srcdata->log_text);
 
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
+	glyph_font_release(srcdata->font);
+	srcdata->font = NULL;
+	da_free(srcdata->runs);
 
 	if (srcdata->font_name != NULL)
 		bfree(srcdata->font_name);
@@ -209,8 +208,6 @@ static void ft2_source_destroy(void *data)
 		bfree(srcdata->font_style);
 	if (srcdata->text != NULL)
 		bfree(srcdata->text);
-	if (srcdata->texbuf != NULL)
-		bfree(srcdata->texbuf);
 	if (srcdata->colorbuf != NULL)
 		bfree(srcdata->colorbuf);
 	if (srcdata->text_file != NULL)
@@ -218,10 +215,6 @@ static void ft2_source_destroy(void *data)
 
 	obs_enter_graphics();
 
-	if (srcdata->tex != NULL) {
-		gs_texture_destroy(srcdata->tex);
-		srcdata->tex = NULL;
-	}
 	if (srcdata->vbuf != NULL) {
 		gs_vertexbuffer_destroy(srcdata->vbuf);
 		srcdata->vbuf = NULL;
@@ -242,7 +235,7 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata == NULL)
 		return;
 
-	if (srcdata->tex == NULL || srcdata->vbuf == NULL)
+	if (srcdata->vbuf == NULL || !srcdata->runs.num)
 		return;
 	if (srcdata->text == NULL || *srcdata->text == 0)
 		return;
@@ -253,8 +246,7 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata->drop_shadow)
 		draw_drop_shadow(srcdata);
 
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6);
+	draw_glyph_runs(srcdata);
 
 	UNUSED_PARAMETER(effect);
 }
@@ -264,48 +256,95 @@ static void ft2_video_tick(void *data, float seconds)
 	struct ft2_source *srcdata = data;
 	if (srcdata == NULL)
 		return;
-	if (!srcdata->from_file || !srcdata->text_file)
+
+	/* another source evicted atlas pages this source may be using */
+	long generation =
+		srcdata->font ? os_atomic_load_long(&srcdata->font->generation)
+			      : 0;
+	if (generation != srcdata->font_generation) {
+		srcdata->font_generation = generation;
+		cache_glyphs(srcdata, srcdata->text);
+		set_up_vertex_buffer(srcdata);
+	}
+
+	if (!srcdata->from_file || !srcdata->file_watch)
 		return;
 
-	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
-		time_t t = get_modified_timestamp(srcdata->text_file);
-		srcdata->last_checked = os_gettime_ns();
-
-		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-						    srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
-			srcdata->update_file = false;
-		}
+	/* the file was already read on the file watch thread */
+	pthread_mutex_lock(&srcdata->file_mutex);
+	wchar_t *text = srcdata->pending_text;
+	srcdata->pending_text = NULL;
+	pthread_mutex_unlock(&srcdata->file_mutex);
 
-		if (srcdata->m_timestamp != t) {
-			srcdata->m_timestamp = t;
-			srcdata->update_file = true;
-		}
+	if (text) {
+		bfree(srcdata->text);
+		srcdata->text = text;
+		cache_glyphs(srcdata, srcdata->text);
+		set_up_vertex_buffer(srcdata);
 	}
 
 	UNUSED_PARAMETER(seconds);
 }
 
+/* call with file_mutex held */
+static wchar_t *read_text_file(struct ft2_source *srcdata, const char *path)
+{
+	return srcdata->log_mode ? read_from_end(srcdata, path)
+				 : load_text_from_file(srcdata, path);
+}
+
+static void text_file_changed(void *param, const char *path)
+{
+	struct ft2_source *srcdata = param;
+	wchar_t *text;
+
+	pthread_mutex_lock(&srcdata->file_mutex);
+
+	text = read_text_file(srcdata, path);
+	if (text) {
+		bfree(srcdata->pending_text);
+		srcdata->pending_text = text;
+	}
+
+	pthread_mutex_unlock(&srcdata->file_mutex);
+}
+
+static void watch_text_file(struct ft2_source *srcdata, const char *path)
+{
+	os_file_watch_remove(srcdata->file_watch);
+	srcdata->file_watch = NULL;
+
+	pthread_mutex_lock(&srcdata->file_mutex);
+	bfree(srcdata->pending_text);
+	srcdata->pending_text = NULL;
+	pthread_mutex_unlock(&srcdata->file_mutex);
+
+	if (path && *path)
+		srcdata->file_watch =
+			os_file_watch_add(path, text_file_changed, srcdata);
+}
+
 static bool init_font(struct ft2_source *srcdata)
 {
 	FT_Long index;
 	const char *path = get_font_path(srcdata->font_name, srcdata->font_size,
 					 srcdata->font_style,
 					 srcdata->font_flags, &index);
+	struct glyph_font *old_font = srcdata->font;
+
 	if (!path)
 		return false;
 
-	if (srcdata->font_face != NULL) {
-		FT_Done_Face(srcdata->font_face);
-		srcdata->font_face = NULL;
-	}
+	/* runs refer to the pages of the old font, and are only read while
+	 * rendering */
+	obs_enter_graphics();
+	da_resize(srcdata->runs, 0);
+	obs_leave_graphics();
 
-	return FT_New_Face(ft2_lib, path, index, &srcdata->font_face) == 0;
+	srcdata->font = glyph_font_acquire(path, index, srcdata->font_size,
+					   srcdata->antialiasing);
+	glyph_font_release(old_font);
+	return srcdata->font != NULL;
 }
 
 static void ft2_source_update(void *data, obs_data_t *settings)
@@ -367,17 +406,18 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	bool chat_log_mode = obs_data_get_bool(settings, "log_mode");
 	uint32_t log_lines = (uint32_t)obs_data_get_int(settings, "log_lines");
 
+	pthread_mutex_lock(&srcdata->file_mutex);
 	if (srcdata->log_lines != log_lines) {
 		srcdata->log_lines = log_lines;
 		vbuf_needs_update = true;
 	}
 	srcdata->log_mode = chat_log_mode;
+	srcdata->log_offset = 0;
+	pthread_mutex_unlock(&srcdata->file_mutex);
 
 	if (ft2_lib == NULL)
 		goto error;
 
-	const size_t texbuf_size = (size_t)texbuf_w * (size_t)texbuf_h;
-
 	if (srcdata->draw_effect == NULL) {
 		char *effect_file = NULL;
 		char *error_string = NULL;
@@ -399,14 +439,12 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (srcdata->font_size != font_size || srcdata->from_file != from_file)
 		vbuf_needs_update = true;
 
+	/* antialiasing is part of the cached font */
 	const bool new_aa_setting = obs_data_get_bool(settings, "antialiasing");
 	const bool aa_changed = srcdata->antialiasing != new_aa_setting;
 	if (aa_changed) {
 		srcdata->antialiasing = new_aa_setting;
-		if (srcdata->texbuf != NULL) {
-			memset(srcdata->texbuf, 0, texbuf_size);
-		}
-		cache_standard_glyphs(srcdata);
+		vbuf_needs_update = true;
 	}
 
 	srcdata->file_load_failed = false;
@@ -416,7 +454,7 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 		if (strcmp(font_name, srcdata->font_name) == 0 &&
 		    strcmp(font_style, srcdata->font_style) == 0 &&
 		    font_flags == srcdata->font_flags &&
-		    font_size == srcdata->font_size)
+		    font_size == srcdata->font_size && !aa_changed)
 			goto skip_font_load;
 
 		bfree(srcdata->font_name);
@@ -432,29 +470,21 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	srcdata->font_size = font_size;
 	srcdata->font_flags = font_flags;
 
-	if (!init_font(srcdata) || srcdata->font_face == NULL) {
+	if (!init_font(srcdata) || srcdata->font == NULL) {
 		blog(LOG_WARNING, "FT2-text: Failed to load font %s",
 		     srcdata->font_name);
 		goto error;
-	} else {
-		FT_Set_Pixel_Sizes(srcdata->font_face, 0, srcdata->font_size);
-		FT_Select_Charmap(srcdata->font_face, FT_ENCODING_UNICODE);
-	}
-
-	if (srcdata->texbuf != NULL) {
-		bfree(srcdata->texbuf);
-		srcdata->texbuf = NULL;
 	}
-	srcdata->texbuf = bzalloc(texbuf_size);
-
-	if (srcdata->font_face)
-		cache_standard_glyphs(srcdata);
 
 skip_font_load:
 	if (from_file) {
 		const char *tmp = obs_data_get_string(settings, "text_file");
 
-		if (!tmp || !*tmp || !os_file_exists(tmp)) {
+		bool watch_changed = !srcdata->file_watch ||
+				     !srcdata->text_file ||
+				     strcmp(srcdata->text_file, tmp) != 0;
+
+		if (!*tmp || !os_file_exists(tmp)) {
 			const char *emptystr = " ";
 
 			bfree(srcdata->text);
@@ -466,22 +496,38 @@ skip_font_load:
 			     "FT2-text: Failed to open %s for "
 			     "reading",
 			     tmp);
+
+			/* picked up by the watch once the file is created */
+			if (watch_changed) {
+				bfree(srcdata->text_file);
+				srcdata->text_file = bstrdup(tmp);
+				watch_text_file(srcdata, tmp);
+			}
 		} else {
 			if (srcdata->text_file != NULL &&
 			    strcmp(srcdata->text_file, tmp) == 0 &&
-			    !vbuf_needs_update)
+			    !vbuf_needs_update && srcdata->file_watch)
 				goto error;
 
 			bfree(srcdata->text_file);
 
 			srcdata->text_file = bstrdup(tmp);
-			if (chat_log_mode)
-				read_from_end(srcdata, tmp);
-			else
-				load_text_from_file(srcdata, tmp);
-			srcdata->last_checked = os_gettime_ns();
+			if (watch_changed)
+				watch_text_file(srcdata, tmp);
+
+			pthread_mutex_lock(&srcdata->file_mutex);
+			wchar_t *text = read_text_file(srcdata, tmp);
+			pthread_mutex_unlock(&srcdata->file_mutex);
+
+			if (text) {
+				bfree(srcdata->text);
+				srcdata->text = text;
+			}
 		}
 	} else {
+		if (srcdata->file_watch)
+			watch_text_file(srcdata, NULL);
+
 		const char *tmp = obs_data_get_string(settings, "text");
 		if (!tmp || !*tmp)
 			goto error;
@@ -494,7 +540,7 @@ skip_font_load:
 		os_utf8_to_wcs_ptr(tmp, strlen(tmp), &srcdata->text);
 	}
 
-	if (srcdata->font_face) {
+	if (srcdata->font) {
 		cache_glyphs(srcdata, srcdata->text);
 		set_up_vertex_buffer(srcdata);
 	}
@@ -511,12 +557,27 @@ error:
 #define DEFAULT_FACE "Sans Serif"
 #endif
 
+static void get_atlas_memory_proc(void *data, calldata_t *cd)
+{
+	struct ft2_source *srcdata = data;
+	uint32_t pages = 0;
+	size_t bytes = 0;
+
+	if (srcdata->font)
+		bytes = glyph_font_memory(srcdata->font, &pages);
+
+	calldata_set_int(cd, "bytes", (long long)bytes);
+	calldata_set_int(cd, "pages", (long long)pages);
+}
+
 static void *ft2_source_create(obs_data_t *settings, obs_source_t *source,
 			       int ver)
 {
 	struct ft2_source *srcdata = bzalloc(sizeof(struct ft2_source));
 	obs_data_t *font_obj = obs_data_create();
 	srcdata->src = source;
+	pthread_mutex_init_value(&srcdata->file_mutex);
+	pthread_mutex_init(&srcdata->file_mutex, NULL);
 
 	init_plugin();
 
@@ -539,6 +600,13 @@ static void *ft2_source_create(obs_data_t *settings, obs_source_t *source,
 
 	obs_data_release(font_obj);
 
+	/* memory used by the atlas of the font, shared with every other text
+	 * source using the same font, size and antialiasing */
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph,
+			 "void get_atlas_memory(out int bytes, out int pages)",
+			 get_atlas_memory_proc, srcdata);
+
 	return srcdata;
 }
 
@@ -18,15 +18,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <obs-module.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include <util/file-watch.h>
 #include <ft2build.h>
+#include "glyph-cache.h"
 
-#define num_cache_slots 65535
-#define src_glyph srcdata->cacheglyphs[glyph_index]
-
-struct glyph_info {
-	float u, v, u2, v2;
-	int32_t w, h, xoff, yoff;
-	int32_t xadv;
+/* range of the vertex buffer drawn from one atlas page */
+struct glyph_run {
+	uint32_t page;
+	uint32_t start_vert;
+	uint32_t num_verts;
 };
 
 struct ft2_source {
@@ -40,25 +43,26 @@ struct ft2_source {
 	bool antialiasing;
 	char *text_file;
 	wchar_t *text;
-	time_t m_timestamp;
-	bool update_file;
-	uint64_t last_checked;
+
+	/* the file is read on the file watch thread, file_mutex protects the
+	 * read state and the text waiting to be picked up by the tick */
+	os_file_watch_t *file_watch;
+	pthread_mutex_t file_mutex;
+	wchar_t *pending_text;
+	uint64_t log_offset;
+	struct dstr log_text;
 
 	uint32_t cx, cy, max_h, custom_width;
 	uint32_t outline_width;
-	uint32_t texbuf_x, texbuf_y;
 	uint32_t color[2];
 	uint32_t *colorbuf;
 
 	int32_t cur_scroll, scroll_speed;
 
-	gs_texture_t *tex;
-
-	struct glyph_info *cacheglyphs[num_cache_slots];
-
-	FT_Face font_face;
+	struct glyph_font *font;
+	long font_generation;
 
-	uint8_t *texbuf;
+	DARRAY(struct glyph_run) runs;
 	gs_vertbuffer_t *vbuf;
 
 	gs_effect_t *draw_effect;
@@ -78,6 +82,7 @@ static void ft2_source_update(void *data, obs_data_t *settings);
 static void ft2_source_render(void *data, gs_effect_t *effect);
 static void ft2_video_tick(void *data, float seconds);
 
+void draw_glyph_runs(struct ft2_source *srcdata);
 void draw_outlines(struct ft2_source *srcdata);
 void draw_drop_shadow(struct ft2_source *srcdata);
 
@@ -90,11 +95,9 @@ static const char *ft2_source_get_name(void *unused);
 
 uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata);
 
-time_t get_modified_timestamp(char *filename);
-void load_text_from_file(struct ft2_source *srcdata, const char *filename);
-void read_from_end(struct ft2_source *srcdata, const char *filename);
+wchar_t *load_text_from_file(struct ft2_source *srcdata, const char *filename);
+wchar_t *read_from_end(struct ft2_source *srcdata, const char *filename);
 
-void cache_standard_glyphs(struct ft2_source *srcdata);
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
 
 void set_up_vertex_buffer(struct ft2_source *srcdata);
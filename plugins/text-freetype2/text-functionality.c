@@ -19,14 +19,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <util/platform.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <sys/stat.h>
 #include "text-freetype2.h"
 #include "obs-convenience.h"
 
 float offsets[16] = {-2.0f, 0.0f, 0.0f, -2.0f, 2.0f,  0.0f, 2.0f,  0.0f,
 		     0.0f,  2.0f, 0.0f, 2.0f,  -2.0f, 0.0f, -2.0f, 0.0f};
 
-extern uint32_t texbuf_w, texbuf_h;
+void draw_glyph_runs(struct ft2_source *srcdata)
+{
+	gs_vertexbuffer_flush(srcdata->vbuf);
+
+	for (size_t i = 0; i < srcdata->runs.num; i++) {
+		struct glyph_run *run = &srcdata->runs.array[i];
+		struct glyph_page *page = srcdata->font->pages[run->page];
+
+		draw_uv_vbuffer(srcdata->vbuf, page->tex, srcdata->draw_effect,
+				run->start_vert, run->num_verts);
+	}
+}
 
 void draw_outlines(struct ft2_source *srcdata)
 {
@@ -45,9 +55,7 @@ void draw_outlines(struct ft2_source *srcdata)
 	for (int32_t i = 0; i < 8; i++) {
 		gs_matrix_translate3f(offsets[i * 2], offsets[(i * 2) + 1],
 				      0.0f);
-		draw_uv_vbuffer(srcdata->vbuf, srcdata->tex,
-				srcdata->draw_effect,
-				(uint32_t)wcslen(srcdata->text) * 6);
+		draw_glyph_runs(srcdata);
 	}
 	gs_matrix_identity();
 	gs_matrix_pop();
@@ -70,8 +78,7 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 
 	gs_matrix_push();
 	gs_matrix_translate3f(4.0f, 4.0f, 0.0f);
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
-			(uint32_t)wcslen(srcdata->text) * 6);
+	draw_glyph_runs(srcdata);
 	gs_matrix_identity();
 	gs_matrix_pop();
 
@@ -80,30 +87,34 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 
 void set_up_vertex_buffer(struct ft2_source *srcdata)
 {
-	FT_UInt glyph_index = 0;
+	struct glyph_font *font = srcdata->font;
+	const struct glyph_info *glyph;
 	uint32_t x = 0, space_pos = 0, word_width = 0;
 	size_t len;
 
-	if (!srcdata->text)
+	if (!srcdata->text || !font)
 		return;
 
+	/* the font is locked inside the graphics context, the same order the
+	 * atlas pages are uploaded in */
+	obs_enter_graphics();
+	glyph_font_lock(font);
+
 	if (srcdata->custom_width >= 100)
 		srcdata->cx = srcdata->custom_width;
 	else
 		srcdata->cx = get_ft2_text_width(srcdata->text, srcdata);
 	srcdata->cy = srcdata->max_h;
 
-	obs_enter_graphics();
 	if (srcdata->vbuf != NULL) {
 		gs_vertbuffer_t *tmpvbuf = srcdata->vbuf;
 		srcdata->vbuf = NULL;
 		gs_vertexbuffer_destroy(tmpvbuf);
 	}
+	da_resize(srcdata->runs, 0);
 
-	if (*srcdata->text == 0) {
-		obs_leave_graphics();
-		return;
-	}
+	if (*srcdata->text == 0)
+		goto finish;
 
 	srcdata->vbuf =
 		create_uv_vbuffer((uint32_t)wcslen(srcdata->text) * 6, true);
@@ -138,27 +149,45 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 		if (srcdata->text[i] == L' ')
 			space_pos = i;
 	next_char:;
-		glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
-		word_width += src_glyph->xadv;
+		glyph = glyph_font_get(font, srcdata->text[i]);
+		if (glyph != NULL)
+			word_width += glyph->xadv;
 	eos_skip:;
 	}
 
 skip_word_wrap:;
 	fill_vertex_buffer(srcdata);
+
+finish:
+	glyph_font_unlock(font);
 	obs_leave_graphics();
 }
 
+static inline const struct glyph_info *get_drawn_glyph(struct glyph_font *font,
+						       wchar_t ch)
+{
+	const struct glyph_info *glyph;
+
+	if (ch == L'\n' || ch == L'\r')
+		return NULL;
+
+	glyph = glyph_font_get(font, ch);
+	return glyph && glyph->page != GLYPH_NO_PAGE ? glyph : NULL;
+}
+
 void fill_vertex_buffer(struct ft2_source *srcdata)
 {
 	struct gs_vb_data *vdata = gs_vertexbuffer_get_data(srcdata->vbuf);
 	if (vdata == NULL || !srcdata->text)
 		return;
 
+	struct glyph_font *font = srcdata->font;
 	struct vec2 *tvarray = (struct vec2 *)vdata->tvarray[0].array;
 	uint32_t *col = (uint32_t *)vdata->colors;
 
-	FT_UInt glyph_index = 0;
+	const struct glyph_info *glyph;
+	uint32_t page_glyphs[GLYPH_MAX_PAGES] = {0};
+	uint32_t page_start[GLYPH_MAX_PAGES];
 
 	uint32_t dx = 0, dy = srcdata->max_h, max_y = dy;
 	uint32_t cur_glyph = 0;
@@ -180,6 +209,27 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 		srcdata->colorbuf[i] = 0xFF000000;
 	}
 
+	/* glyphs are grouped by atlas page so each page is drawn with a
+	 * single call */
+	for (size_t i = 0; i < len; i++) {
+		glyph = get_drawn_glyph(font, srcdata->text[i]);
+		if (glyph != NULL)
+			page_glyphs[glyph->page]++;
+	}
+
+	da_resize(srcdata->runs, 0);
+	for (uint32_t page = 0; page < GLYPH_MAX_PAGES; page++) {
+		page_start[page] = cur_glyph;
+
+		if (page_glyphs[page]) {
+			struct glyph_run *run = da_push_back_new(srcdata->runs);
+			run->page = page;
+			run->start_vert = cur_glyph * 6;
+			run->num_verts = page_glyphs[page] * 6;
+			cur_glyph += page_glyphs[page];
+		}
+	}
+
 	for (size_t i = 0; i < len; i++) {
 	add_linebreak:;
 		if (srcdata->text[i] != L'\n')
@@ -196,217 +246,67 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 		if (srcdata->text[i] == L'\r')
 			goto skip_glyph;
 
-		glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, srcdata->text[i]);
-		if (src_glyph == NULL)
+		glyph = glyph_font_get(font, srcdata->text[i]);
+		if (glyph == NULL)
 			goto skip_glyph;
 
 		if (srcdata->custom_width < 100)
 			goto skip_custom_width;
 
-		if (dx + src_glyph->xadv > srcdata->custom_width) {
+		if (dx + glyph->xadv > srcdata->custom_width) {
 			dx = offset;
 			dy += srcdata->max_h + 4;
 		}
 
 	skip_custom_width:;
 
-		set_v3_rect(vdata->points + (cur_glyph * 6),
-			    (float)dx + (float)src_glyph->xoff,
-			    (float)dy - (float)src_glyph->yoff,
-			    (float)src_glyph->w, (float)src_glyph->h);
-		set_v2_uv(tvarray + (cur_glyph * 6), src_glyph->u, src_glyph->v,
-			  src_glyph->u2, src_glyph->v2);
-		set_rect_colors2(col + (cur_glyph * 6), srcdata->color[0],
-				 srcdata->color[1]);
-		dx += src_glyph->xadv;
-		if (dy - (float)src_glyph->yoff + src_glyph->h > max_y)
-			max_y = dy - src_glyph->yoff + src_glyph->h;
-		cur_glyph++;
-	skip_glyph:;
-	}
-
-	srcdata->cy = max_y;
-}
-
-void cache_standard_glyphs(struct ft2_source *srcdata)
-{
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
+		if (glyph->page != GLYPH_NO_PAGE) {
+			uint32_t idx = page_start[glyph->page]++ * 6;
+
+			set_v3_rect(vdata->points + idx,
+				    (float)dx + (float)glyph->xoff,
+				    (float)dy - (float)glyph->yoff,
+				    (float)glyph->w, (float)glyph->h);
+			set_v2_uv(tvarray + idx, glyph->u, glyph->v, glyph->u2,
+				  glyph->v2);
+			set_rect_colors2(col + idx, srcdata->color[0],
+					 srcdata->color[1]);
 		}
-	}
-
-	srcdata->texbuf_x = 0;
-	srcdata->texbuf_y = 0;
-
-	cache_glyphs(srcdata, L"abcdefghijklmnopqrstuvwxyz"
-			      L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
-			      L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"\0");
-}
-
-FT_Render_Mode get_render_mode(struct ft2_source *srcdata)
-{
-	return srcdata->antialiasing ? FT_RENDER_MODE_NORMAL
-				     : FT_RENDER_MODE_MONO;
-}
-
-void load_glyph(struct ft2_source *srcdata, const FT_UInt glyph_index,
-		const FT_Render_Mode render_mode)
-{
-	const FT_Int32 load_mode = render_mode == FT_RENDER_MODE_MONO
-					   ? FT_LOAD_TARGET_MONO
-					   : FT_LOAD_DEFAULT;
-	FT_Load_Glyph(srcdata->font_face, glyph_index, load_mode);
-}
 
-struct glyph_info *init_glyph(FT_GlyphSlot slot, const uint32_t dx,
-			      const uint32_t dy, const uint32_t g_w,
-			      const uint32_t g_h)
-{
-	struct glyph_info *glyph = bzalloc(sizeof(struct glyph_info));
-	glyph->u = (float)dx / (float)texbuf_w;
-	glyph->u2 = (float)(dx + g_w) / (float)texbuf_w;
-	glyph->v = (float)dy / (float)texbuf_h;
-	glyph->v2 = (float)(dy + g_h) / (float)texbuf_h;
-	glyph->w = g_w;
-	glyph->h = g_h;
-	glyph->yoff = slot->bitmap_top;
-	glyph->xoff = slot->bitmap_left;
-	glyph->xadv = slot->advance.x >> 6;
-
-	return glyph;
-}
-
-uint8_t get_pixel_value(const unsigned char *buf_row,
-			FT_Render_Mode render_mode, const uint32_t x)
-{
-	if (render_mode == FT_RENDER_MODE_NORMAL) {
-		return buf_row[x];
+		dx += glyph->xadv;
+		if (dy - (float)glyph->yoff + glyph->h > max_y)
+			max_y = dy - glyph->yoff + glyph->h;
+	skip_glyph:;
 	}
 
-	const uint32_t byte_index = x / 8;
-	const uint8_t bit_index = x % 8;
-	const bool pixel_set = (buf_row[byte_index] >> (7 - bit_index)) & 1;
-	return pixel_set ? 255 : 0;
-}
-
-void rasterize(struct ft2_source *srcdata, FT_GlyphSlot slot,
-	       const FT_Render_Mode render_mode, const uint32_t dx,
-	       const uint32_t dy)
-{
-	/**
-	 * The pitch's absolute value is the number of bytes taken by one bitmap
-	 * row, including padding.
-	 *
-	 * Source: https://www.freetype.org/freetype2/docs/reference/ft2-basic_types.html
-	 */
-	const int pitch = abs(slot->bitmap.pitch);
-
-	for (uint32_t y = 0; y < slot->bitmap.rows; y++) {
-		const uint32_t row_start = y * pitch;
-		const uint32_t row = (dy + y) * texbuf_w;
-
-		for (uint32_t x = 0; x < slot->bitmap.width; x++) {
-			const uint32_t row_pixel_position = dx + x;
-			const uint8_t pixel_value =
-				get_pixel_value(&slot->bitmap.buffer[row_start],
-						render_mode, x);
-			srcdata->texbuf[row_pixel_position + row] = pixel_value;
-		}
-	}
+	srcdata->cy = max_y;
 }
 
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
 {
-	if (!srcdata->font_face || !cache_glyphs)
-		return;
-
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
-
-	uint32_t dx = srcdata->texbuf_x;
-	uint32_t dy = srcdata->texbuf_y;
+	struct glyph_font *font = srcdata->font;
+	uint32_t max_h;
+	bool changed;
 
-	int32_t cached_glyphs = 0;
-	const size_t len = wcslen(cache_glyphs);
-
-	const FT_Render_Mode render_mode = get_render_mode(srcdata);
-
-	for (size_t i = 0; i < len; i++) {
-		const FT_UInt glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, cache_glyphs[i]);
-
-		if (src_glyph != NULL) {
-			continue;
-		}
-
-		load_glyph(srcdata, glyph_index, render_mode);
-		FT_Render_Glyph(slot, render_mode);
-
-		const uint32_t g_w = slot->bitmap.width;
-		const uint32_t g_h = slot->bitmap.rows;
-
-		if (srcdata->max_h < g_h) {
-			srcdata->max_h = g_h;
-		}
-
-		if (dx + g_w >= texbuf_w) {
-			dx = 0;
-			dy += srcdata->max_h + 1;
-		}
-
-		if (dy + g_h >= texbuf_h) {
-			blog(LOG_WARNING,
-			     "Out of space trying to render glyphs");
-			break;
-		}
-
-		src_glyph = init_glyph(slot, dx, dy, g_w, g_h);
-		rasterize(srcdata, slot, render_mode, dx, dy);
-
-		dx += (g_w + 1);
-		if (dx >= texbuf_w) {
-			dx = 0;
-			dy += srcdata->max_h;
-		}
-
-		cached_glyphs++;
-	}
+	if (!font || !cache_glyphs)
+		return;
 
-	srcdata->texbuf_x = dx;
-	srcdata->texbuf_y = dy;
+	glyph_font_lock(font);
+	changed = glyph_font_cache_text(font, cache_glyphs);
+	max_h = glyph_font_max_height(font, cache_glyphs);
+	srcdata->font_generation = os_atomic_load_long(&font->generation);
+	glyph_font_unlock(font);
 
-	if (cached_glyphs > 0) {
+	if (srcdata->max_h < max_h)
+		srcdata->max_h = max_h;
 
+	if (changed) {
 		obs_enter_graphics();
-
-		if (srcdata->tex != NULL) {
-			gs_texture_t *tmp_texture = srcdata->tex;
-			srcdata->tex = NULL;
-			gs_texture_destroy(tmp_texture);
-		}
-
-		srcdata->tex = gs_texture_create(
-			texbuf_w, texbuf_h, GS_A8, 1,
-			(const uint8_t **)&srcdata->texbuf, 0);
-
+		glyph_font_upload(font);
 		obs_leave_graphics();
 	}
 }
 
-time_t get_modified_timestamp(char *filename)
-{
-	struct stat stats;
-
-	// stat is apparently terrifying and horrible, but we only call it once
-	// every second at most.
-	if (os_stat(filename, &stats) != 0)
-		return -1;
-
-	return stats.st_mtime;
-}
-
 static void remove_cr(wchar_t *source)
 {
 	int j = 0;
@@ -418,13 +318,22 @@ static void remove_cr(wchar_t *source)
 	source[j] = '\0';
 }
 
-void load_text_from_file(struct ft2_source *srcdata, const char *filename)
+static wchar_t *utf8_to_text(const char *str, size_t len)
+{
+	wchar_t *text = bzalloc((len + 1) * sizeof(wchar_t));
+	os_utf8_to_wcs(str, len, text, len + 1);
+	remove_cr(text);
+	return text;
+}
+
+wchar_t *load_text_from_file(struct ft2_source *srcdata, const char *filename)
 {
 	FILE *tmp_file = NULL;
 	uint32_t filesize = 0;
 	char *tmp_read = NULL;
 	uint16_t header = 0;
 	size_t bytes_read;
+	wchar_t *text;
 
 	tmp_file = os_fopen(filename, "rb");
 	if (tmp_file == NULL) {
@@ -432,7 +341,7 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 			blog(LOG_WARNING, "Failed to open file %s", filename);
 			srcdata->file_load_failed = true;
 		}
-		return;
+		return NULL;
 	}
 	fseek(tmp_file, 0, SEEK_END);
 	filesize = (uint32_t)ftell(tmp_file);
@@ -441,17 +350,13 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 
 	if (bytes_read == 2 && header == 0xFEFF) {
 		// File is already in UTF-16 format
-		if (srcdata->text != NULL) {
-			bfree(srcdata->text);
-			srcdata->text = NULL;
-		}
-		srcdata->text = bzalloc(filesize);
-		bytes_read = fread(srcdata->text, filesize - 2, 1, tmp_file);
+		text = bzalloc(filesize);
+		bytes_read = fread(text, filesize - 2, 1, tmp_file);
 
 		bfree(tmp_read);
 		fclose(tmp_file);
 
-		return;
+		return text;
 	}
 
 	fseek(tmp_file, 0, SEEK_SET);
@@ -460,36 +365,109 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 	bytes_read = fread(tmp_read, filesize, 1, tmp_file);
 	fclose(tmp_file);
 
-	if (srcdata->text != NULL) {
-		bfree(srcdata->text);
-		srcdata->text = NULL;
+	text = utf8_to_text(tmp_read, strlen(tmp_read));
+	bfree(tmp_read);
+	return text;
+}
+
+/* keeps the last log_lines lines, where a trailing line break counts as a
+ * line like it always has */
+static void trim_log_lines(struct dstr *log, uint32_t log_lines)
+{
+	uint32_t line_breaks = 0;
+
+	for (size_t i = log->len; i > 0; i--) {
+		if (log->array[i - 1] == '\n' && ++line_breaks > log_lines) {
+			dstr_remove(log, 0, i);
+			return;
+		}
 	}
-	srcdata->text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
-	os_utf8_to_wcs(tmp_read, strlen(tmp_read), srcdata->text,
-		       (strlen(tmp_read) + 1));
+}
 
-	remove_cr(srcdata->text);
-	bfree(tmp_read);
+/* finds the start of the last log_lines lines, reading backwards in
+ * chunks */
+static uint64_t find_log_start(FILE *file, uint64_t size, uint32_t log_lines)
+{
+	char buf[4096];
+	uint32_t line_breaks = 0;
+	uint64_t pos = size;
+
+	while (pos > 0) {
+		size_t chunk = pos > sizeof(buf) ? sizeof(buf) : (size_t)pos;
+
+		pos -= chunk;
+		os_fseeki64(file, (int64_t)pos, SEEK_SET);
+		if (fread(buf, 1, chunk, file) != chunk)
+			return 0;
+
+		for (size_t i = chunk; i > 0; i--) {
+			if (buf[i - 1] == '\n' && ++line_breaks > log_lines)
+				return pos + i;
+		}
+	}
+
+	return 0;
 }
 
-void read_from_end(struct ft2_source *srcdata, const char *filename)
+static bool read_file_range(FILE *file, uint64_t start, uint64_t end,
+			    struct dstr *out)
+{
+	size_t len = (size_t)(end - start);
+	size_t old_len = out->len;
+
+	dstr_ensure_capacity(out, old_len + len + 1);
+	os_fseeki64(file, (int64_t)start, SEEK_SET);
+	if (fread(out->array + old_len, 1, len, file) != len) {
+		out->array[old_len] = 0;
+		return false;
+	}
+
+	out->len = old_len + len;
+	out->array[out->len] = 0;
+	return true;
+}
+
+/* the file only grew if the end of what was read last time is still the
+ * same, otherwise it was rewritten and has to be read again */
+static bool log_was_appended(struct ft2_source *srcdata, FILE *file,
+			     uint64_t size)
+{
+	struct dstr *log = &srcdata->log_text;
+	uint64_t offset = srcdata->log_offset;
+	char buf[64];
+	size_t check;
+
+	if (!offset || size < offset)
+		return false;
+
+	check = log->len < sizeof(buf) ? log->len : sizeof(buf);
+	if (check > offset)
+		return false;
+
+	os_fseeki64(file, (int64_t)(offset - check), SEEK_SET);
+	if (fread(buf, 1, check, file) != check)
+		return false;
+
+	return memcmp(buf, log->array + log->len - check, check) == 0;
+}
+
+wchar_t *read_from_end(struct ft2_source *srcdata, const char *filename)
 {
 	FILE *tmp_file = NULL;
 	uint32_t filesize = 0, cur_pos = 0, log_lines = 0;
-	char *tmp_read = NULL;
 	uint16_t value = 0, line_breaks = 0;
 	size_t bytes_read;
-	char bvalue;
-
+	wchar_t *text;
 	bool utf16 = false;
+	bool appended;
 
-	tmp_file = fopen(filename, "rb");
+	tmp_file = os_fopen(filename, "rb");
 	if (tmp_file == NULL) {
 		if (!srcdata->file_load_failed) {
 			blog(LOG_WARNING, "Failed to open file %s", filename);
 			srcdata->file_load_failed = true;
 		}
-		return;
+		return NULL;
 	}
 	bytes_read = fread(&value, 2, 1, tmp_file);
 
@@ -498,83 +476,81 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 
 	fseek(tmp_file, 0, SEEK_END);
 	filesize = (uint32_t)ftell(tmp_file);
-	cur_pos = filesize;
 	log_lines = srcdata->log_lines;
 
-	while (line_breaks <= log_lines && cur_pos != 0) {
-		if (!utf16)
-			cur_pos--;
-		else
-			cur_pos -= 2;
-		fseek(tmp_file, cur_pos, SEEK_SET);
-
-		if (!utf16) {
-			bytes_read = fread(&bvalue, 1, 1, tmp_file);
-			if (bytes_read == 1 && bvalue == '\n')
-				line_breaks++;
+	if (!utf16) {
+		/* only the bytes appended since the last read are read when
+		 * the file grew */
+		appended = log_was_appended(srcdata, tmp_file, filesize);
+		if (!appended) {
+			dstr_free(&srcdata->log_text);
+			cur_pos = (uint32_t)find_log_start(tmp_file, filesize,
+							   log_lines);
 		} else {
-			bytes_read = fread(&value, 2, 1, tmp_file);
-			if (bytes_read == 2 && value == L'\n')
-				line_breaks++;
+			cur_pos = (uint32_t)srcdata->log_offset;
 		}
-	}
-
-	if (cur_pos != 0)
-		cur_pos += (utf16) ? 2 : 1;
-
-	fseek(tmp_file, cur_pos, SEEK_SET);
 
-	if (utf16) {
-		if (srcdata->text != NULL) {
-			bfree(srcdata->text);
-			srcdata->text = NULL;
+		if (!read_file_range(tmp_file, cur_pos, filesize,
+				     &srcdata->log_text)) {
+			fclose(tmp_file);
+			srcdata->log_offset = 0;
+			dstr_free(&srcdata->log_text);
+			return NULL;
 		}
-		srcdata->text = bzalloc(filesize - cur_pos);
-		bytes_read =
-			fread(srcdata->text, (filesize - cur_pos), 1, tmp_file);
 
-		remove_cr(srcdata->text);
-		bfree(tmp_read);
 		fclose(tmp_file);
 
-		return;
+		trim_log_lines(&srcdata->log_text, log_lines);
+		srcdata->log_offset = filesize;
+
+		return utf8_to_text(srcdata->log_text.array
+					    ? srcdata->log_text.array
+					    : "",
+				    srcdata->log_text.len);
 	}
 
-	tmp_read = bzalloc((filesize - cur_pos) + 1);
-	bytes_read = fread(tmp_read, filesize - cur_pos, 1, tmp_file);
-	fclose(tmp_file);
+	cur_pos = filesize;
+
+	while (line_breaks <= log_lines && cur_pos != 0) {
+		cur_pos -= 2;
+		fseek(tmp_file, cur_pos, SEEK_SET);
 
-	if (srcdata->text != NULL) {
-		bfree(srcdata->text);
-		srcdata->text = NULL;
+		bytes_read = fread(&value, 2, 1, tmp_file);
+		if (bytes_read == 2 && value == L'\n')
+			line_breaks++;
 	}
-	srcdata->text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
-	os_utf8_to_wcs(tmp_read, strlen(tmp_read), srcdata->text,
-		       (strlen(tmp_read) + 1));
 
-	remove_cr(srcdata->text);
-	bfree(tmp_read);
+	if (cur_pos != 0)
+		cur_pos += 2;
+
+	fseek(tmp_file, cur_pos, SEEK_SET);
+
+	text = bzalloc(filesize - cur_pos);
+	bytes_read = fread(text, (filesize - cur_pos), 1, tmp_file);
+
+	remove_cr(text);
+	fclose(tmp_file);
+
+	return text;
 }
 
+/* requires the font to be locked */
 uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata)
 {
 	if (!text) {
 		return 0;
 	}
 
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
 	uint32_t w = 0, max_w = 0;
 	const size_t len = wcslen(text);
 	for (size_t i = 0; i < len; i++) {
-		const FT_UInt glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, text[i]);
-
-		load_glyph(srcdata, glyph_index, get_render_mode(srcdata));
+		const struct glyph_info *glyph =
+			glyph_font_get(srcdata->font, text[i]);
 
 		if (text[i] == L'\n')
 			w = 0;
-		else {
-			w += slot->advance.x >> 6;
+		else if (glyph != NULL) {
+			w += glyph->xadv;
 			if (w > max_w)
 				max_w = w;
 		}
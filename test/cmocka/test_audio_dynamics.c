@@ -0,0 +1,218 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <util/platform.h>
+#include <media-io/audio-math.h>
+#include <media-io/audio-dynamics.h>
+
+#define TEST_FLOATS 1027 /* not a multiple of the vector width */
+#define BENCH_FLOATS 1024
+#define BENCH_ITERATIONS 20000
+
+/* compressor settings: 10:1 at -18 dB, +3 dB output gain */
+#define SLOPE (1.0f - 1.0f / 10.0f)
+#define THRESHOLD -18.0f
+#define OUTPUT_GAIN 1.4125375f
+
+static void fill_envelope(float *data, size_t count)
+{
+	/* log spaced from -140 dB to +6 dB, with silence and denormals */
+	for (size_t i = 0; i < count; i++)
+		data[i] = db_to_mul(-140.0f + 146.0f * (float)i / (float)count);
+
+	data[0] = 0.0f;
+	data[1] = 1e-40f;
+}
+
+static void fill_random(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+/* the per-sample code the filters used before */
+static void compressor_gain_scalar(float *gain, const float *env, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		const float env_db = mul_to_db(env[i]);
+		float g = SLOPE * (THRESHOLD - env_db);
+		gain[i] = db_to_mul(fminf(0, g)) * OUTPUT_GAIN;
+	}
+}
+
+static float db_error(float a, float b)
+{
+	if (a == b)
+		return 0.0f;
+	return fabsf(mul_to_db(a) - mul_to_db(b));
+}
+
+/* runs a check against every kernel set this CPU supports, not just the one
+ * picked at runtime */
+static const char *kernel_names[] = {"SSE2", "AVX2"};
+
+static void for_each_kernel(void (*check)(void))
+{
+	for (size_t i = 0; i < sizeof(kernel_names) / sizeof(*kernel_names);
+	     i++) {
+		if (!audio_dyn_set_kernel(kernel_names[i])) {
+			print_message("%s kernels not supported, skipping\n",
+				      kernel_names[i]);
+			continue;
+		}
+
+		check();
+	}
+
+	audio_dyn_set_kernel(NULL);
+}
+
+static void check_compressor_gain(void)
+{
+	float env[TEST_FLOATS], gain[TEST_FLOATS], ref[TEST_FLOATS];
+	float max_error = 0.0f;
+
+	fill_envelope(env, TEST_FLOATS);
+	compressor_gain_scalar(ref, env, TEST_FLOATS);
+	audio_dyn_compressor_gain(gain, env, TEST_FLOATS, SLOPE, THRESHOLD,
+				  OUTPUT_GAIN);
+
+	for (size_t i = 0; i < TEST_FLOATS; i++)
+		max_error = fmaxf(max_error, db_error(gain[i], ref[i]));
+
+	print_message("audio_dyn_compressor_gain (%s): max error %.6f dB\n",
+		      audio_dyn_get_kernel_name(), max_error);
+	assert_true(max_error < AUDIO_DYN_MAX_DB_ERROR);
+}
+
+static void compressor_gain_test(void **state)
+{
+	for_each_kernel(check_compressor_gain);
+}
+
+static void check_expander_gain(void)
+{
+	float env[TEST_FLOATS], gain_db[TEST_FLOATS];
+	const float slope = 1.0f - 4.0f;
+	float max_error = 0.0f;
+
+	fill_envelope(env, TEST_FLOATS);
+	audio_dyn_expander_gain_db(gain_db, env, TEST_FLOATS, slope, -40.0f);
+
+	for (size_t i = 0; i < TEST_FLOATS; i++) {
+		float env_db = mul_to_db(env[i]);
+		float ref = -40.0f - env_db > 0.0f
+				    ? fmaxf(slope * (-40.0f - env_db), -60.0f)
+				    : 0.0f;
+
+		max_error = fmaxf(max_error, fabsf(gain_db[i] - ref));
+	}
+
+	assert_true(max_error < AUDIO_DYN_MAX_DB_ERROR * 4.0f);
+}
+
+static void expander_gain_test(void **state)
+{
+	for_each_kernel(check_expander_gain);
+}
+
+static void check_apply_gain_db(void)
+{
+	float samples[TEST_FLOATS], ref[TEST_FLOATS], gain_db[TEST_FLOATS];
+	float max_error = 0.0f;
+
+	fill_random(samples, TEST_FLOATS);
+	for (size_t i = 0; i < TEST_FLOATS; i++)
+		gain_db[i] = -70.0f + 80.0f * (float)i / (float)TEST_FLOATS;
+	memcpy(ref, samples, sizeof(samples));
+
+	audio_dyn_apply_gain_db(samples, gain_db, TEST_FLOATS, OUTPUT_GAIN);
+	for (size_t i = 0; i < TEST_FLOATS; i++)
+		ref[i] *= db_to_mul(fminf(0, gain_db[i])) * OUTPUT_GAIN;
+
+	for (size_t i = 0; i < TEST_FLOATS; i++)
+		max_error = fmaxf(max_error, db_error(fabsf(samples[i]),
+						      fabsf(ref[i])));
+
+	assert_true(max_error < AUDIO_DYN_MAX_DB_ERROR);
+}
+
+static void apply_gain_db_test(void **state)
+{
+	for_each_kernel(check_apply_gain_db);
+}
+
+static void peak_envelope_test(void **state)
+{
+	float samples[TEST_FLOATS], env_buf[TEST_FLOATS];
+	const float attack = 0.9f, release = 0.999f;
+	float env = 0.0f, ref_env = 0.0f;
+
+	fill_random(samples, TEST_FLOATS);
+	memset(env_buf, 0, sizeof(env_buf));
+
+	env = audio_dyn_peak_envelope(env_buf, samples, TEST_FLOATS, env,
+				      attack, release);
+
+	for (size_t i = 0; i < TEST_FLOATS; i++) {
+		const float env_in = fabsf(samples[i]);
+		if (ref_env < env_in)
+			ref_env = env_in + attack * (ref_env - env_in);
+		else
+			ref_env = env_in + release * (ref_env - env_in);
+		assert_true(env_buf[i] == ref_env);
+	}
+
+	assert_true(env == ref_env);
+}
+
+#ifdef RUN_BENCHMARKS
+static void compressor_benchmark(void **state)
+{
+	float env[BENCH_FLOATS], gain[BENCH_FLOATS];
+	uint64_t start, scalar_ns, kernel_ns;
+
+	fill_envelope(env, BENCH_FLOATS);
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+		compressor_gain_scalar(gain, env, BENCH_FLOATS);
+	scalar_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+		audio_dyn_compressor_gain(gain, env, BENCH_FLOATS, SLOPE,
+					  THRESHOLD, OUTPUT_GAIN);
+	kernel_ns = os_gettime_ns() - start;
+
+	print_message("audio_dyn_compressor_gain (%s): scalar %.1f ns/block, "
+		      "kernel %.1f ns/block (%.2fx)\n",
+		      audio_dyn_get_kernel_name(),
+		      (double)scalar_ns / BENCH_ITERATIONS,
+		      (double)kernel_ns / BENCH_ITERATIONS,
+		      (double)scalar_ns / (double)kernel_ns);
+}
+#endif
+
+int main()
+{
+#ifdef RUN_BENCHMARKS
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(compressor_benchmark),
+	};
+#else
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(compressor_gain_test),
+		cmocka_unit_test(expander_gain_test),
+		cmocka_unit_test(apply_gain_db_test),
+		cmocka_unit_test(peak_envelope_test),
+	};
+#endif
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
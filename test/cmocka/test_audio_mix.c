@@ -0,0 +1,108 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/platform.h>
+#include <media-io/audio-mix.h>
+
+#define TEST_FLOATS 1027 /* not a multiple of the vector width */
+#define BENCH_FLOATS 1024
+#define BENCH_ITERATIONS 200000
+
+static void fill_random(float *data, size_t count, float scale)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) *
+			  scale;
+}
+
+static void mix_scalar(float *dst, const float *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void clamp_scalar(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float val = data[i];
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+
+static void audio_mix_test(void **state)
+{
+	float dst[TEST_FLOATS], ref[TEST_FLOATS], src[TEST_FLOATS];
+
+	fill_random(dst, TEST_FLOATS, 1.0f);
+	fill_random(src, TEST_FLOATS, 1.0f);
+	memcpy(ref, dst, sizeof(dst));
+
+	/* unaligned start, as used when a source starts mid-tick */
+	audio_mix_float(dst + 1, src, TEST_FLOATS - 1);
+	mix_scalar(ref + 1, src, TEST_FLOATS - 1);
+
+	assert_memory_equal(dst, ref, sizeof(dst));
+}
+
+static void audio_clamp_test(void **state)
+{
+	float data[TEST_FLOATS], ref[TEST_FLOATS];
+
+	fill_random(data, TEST_FLOATS, 3.0f);
+	memcpy(ref, data, sizeof(data));
+
+	audio_clamp_float(data, TEST_FLOATS);
+	clamp_scalar(ref, TEST_FLOATS);
+
+	assert_memory_equal(data, ref, sizeof(data));
+}
+
+#ifdef RUN_BENCHMARKS
+static void audio_mix_benchmark(void **state)
+{
+	float dst[BENCH_FLOATS], src[BENCH_FLOATS];
+	uint64_t start, scalar_ns, kernel_ns;
+
+	fill_random(dst, BENCH_FLOATS, 0.0001f);
+	fill_random(src, BENCH_FLOATS, 0.0001f);
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+		mix_scalar(dst, src, BENCH_FLOATS);
+	scalar_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+		audio_mix_float(dst, src, BENCH_FLOATS);
+	kernel_ns = os_gettime_ns() - start;
+
+	print_message("audio_mix_float (%s): scalar %.1f ns/block, "
+		      "kernel %.1f ns/block (%.2fx)\n",
+		      audio_mix_get_kernel_name(),
+		      (double)scalar_ns / BENCH_ITERATIONS,
+		      (double)kernel_ns / BENCH_ITERATIONS,
+		      (double)scalar_ns / (double)kernel_ns);
+}
+#endif
+
+int main()
+{
+#ifdef RUN_BENCHMARKS
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(audio_mix_benchmark),
+	};
+#else
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(audio_mix_test),
+		cmocka_unit_test(audio_clamp_test),
+	};
+#endif
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
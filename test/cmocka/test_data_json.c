@@ -0,0 +1,260 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <obs-data.h>
+
+static void json_round_trip_test(void **state)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_t *obj = obs_data_create();
+	obs_data_array_t *array = obs_data_array_create();
+
+	obs_data_set_string(obj, "escaped", "\"quote\"\n\ttab \\ \x01");
+	obs_data_set_string(obj, "utf8", "\xc3\xa9\xf0\x9f\x98\x80");
+	obs_data_array_push_back(array, obj);
+
+	obs_data_set_int(data, "int", -9007199254740993LL);
+	obs_data_set_double(data, "double", 0.1);
+	obs_data_set_double(data, "whole", 3.0);
+	obs_data_set_bool(data, "bool", true);
+	obs_data_set_obj(data, "obj", obj);
+	obs_data_set_array(data, "array", array);
+	obs_data_set_default_int(data, "default_only", 5);
+
+	const char *json = obs_data_get_json(data);
+	obs_data_t *loaded = obs_data_create_from_json(json);
+
+	assert_non_null(loaded);
+	assert_string_equal(obs_data_get_json(loaded), json);
+	assert_false(obs_data_has_user_value(loaded, "default_only"));
+	assert_true(obs_data_get_int(loaded, "int") == -9007199254740993LL);
+	assert_true(obs_data_get_double(loaded, "whole") == 3.0);
+
+	obs_data_array_t *loaded_array = obs_data_get_array(loaded, "array");
+	obs_data_t *loaded_obj = obs_data_array_item(loaded_array, 0);
+	assert_string_equal(obs_data_get_string(loaded_obj, "escaped"),
+			    "\"quote\"\n\ttab \\ \x01");
+	assert_string_equal(obs_data_get_string(loaded_obj, "utf8"),
+			    "\xc3\xa9\xf0\x9f\x98\x80");
+
+	obs_data_release(loaded_obj);
+	obs_data_array_release(loaded_array);
+	obs_data_release(loaded);
+	obs_data_array_release(array);
+	obs_data_release(obj);
+	obs_data_release(data);
+}
+
+static void json_format_test(void **state)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_t *empty = obs_data_create();
+
+	obs_data_set_obj(data, "b", empty);
+	obs_data_set_int(data, "a", 1);
+	obs_data_set_double(data, "c", 1e300);
+
+	assert_string_equal(obs_data_get_json(data),
+			    "{\n"
+			    "    \"a\": 1,\n"
+			    "    \"b\": {},\n"
+			    "    \"c\": 1.0000000000000001e300\n"
+			    "}");
+
+	obs_data_release(empty);
+	obs_data_release(data);
+}
+
+static void json_reject_test(void **state)
+{
+	static const char *invalid[] = {
+		"",
+		"1",
+		"{\"a\": 1,}",
+		"{\"a\": 1, \"a\": 2}",
+		"{\"a\": null, \"a\": 2}",
+		"{\"a\": 01}",
+		"{\"a\": 1.}",
+		"{\"a\": 99999999999999999999}",
+		"{\"a\": 1e999}",
+		"{\"a\": \"\\u0000\"}",
+		"{\"a\": \"\\ud800\"}",
+		"{\"a\": \"\xff\"}",
+		"{\"a\": \"\n\"}",
+		"{\"a\": [tru]}",
+		"{} {}",
+	};
+
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+		assert_null(obs_data_create_from_json(invalid[i]));
+
+	obs_data_t *data = obs_data_create_from_json(
+		" {\"a\": null, \"b\": [1, \"x\", [{}], {\"c\": true}],"
+		" \"d\": \"\\ud83d\\ude00\\/\"} ");
+	assert_non_null(data);
+	assert_false(obs_data_has_user_value(data, "a"));
+	assert_string_equal(obs_data_get_string(data, "d"),
+			    "\xf0\x9f\x98\x80/");
+
+	obs_data_array_t *array = obs_data_get_array(data, "b");
+	assert_int_equal(obs_data_array_count(array), 1);
+	obs_data_array_release(array);
+	obs_data_release(data);
+}
+
+/* large objects are looked up through the index, make sure it stays in sync
+ * with the item list through erases and reallocations */
+static void data_index_test(void **state)
+{
+	obs_data_t *data = obs_data_create();
+	struct dstr name = {0};
+
+	for (int i = 0; i < 1000; i++) {
+		dstr_printf(&name, "item%d", i);
+		obs_data_set_int(data, name.array, i);
+	}
+
+	for (int i = 0; i < 1000; i += 3) {
+		dstr_printf(&name, "item%d", i);
+		obs_data_erase(data, name.array);
+	}
+
+	for (int i = 1; i < 1000; i += 3) {
+		dstr_printf(&name, "item%d", i);
+		obs_data_set_string(data, name.array,
+				    "a string long enough to grow the item");
+	}
+
+	for (int i = 0; i < 1000; i++) {
+		dstr_printf(&name, "item%d", i);
+
+		if (i % 3 == 0)
+			assert_false(obs_data_has_user_value(data, name.array));
+		else if (i % 3 == 1)
+			assert_string_equal(
+				obs_data_get_string(data, name.array),
+				"a string long enough to grow the item");
+		else
+			assert_int_equal(obs_data_get_int(data, name.array),
+					 i);
+	}
+
+	obs_data_set_int(data, "zzz", 1);
+	obs_data_set_int(data, "aaa", 2);
+	assert_int_equal(obs_data_get_int(data, "zzz"), 1);
+	assert_int_equal(obs_data_get_int(data, "aaa"), 2);
+
+	dstr_free(&name);
+	obs_data_release(data);
+}
+
+#ifdef RUN_BENCHMARKS
+/* ------------------------------------------------------------------------- */
+/* load/save benchmark over a synthetic scene collection */
+
+#define BENCH_SOURCES 4000
+#define BENCH_FILTERS 3
+
+static obs_data_t *create_collection(void)
+{
+	obs_data_t *collection = obs_data_create();
+	obs_data_array_t *sources = obs_data_array_create();
+	struct dstr str = {0};
+
+	for (int i = 0; i < BENCH_SOURCES; i++) {
+		obs_data_t *source = obs_data_create();
+		obs_data_t *settings = obs_data_create();
+		obs_data_array_t *filters = obs_data_array_create();
+
+		for (int j = 0; j < BENCH_FILTERS; j++) {
+			obs_data_t *filter = obs_data_create();
+			obs_data_t *filter_settings = obs_data_create();
+
+			dstr_printf(&str, "Filter %d", j);
+			obs_data_set_string(filter, "name", str.array);
+			obs_data_set_string(filter, "id", "color_filter");
+			obs_data_set_double(filter_settings, "gamma", j * 0.1);
+			obs_data_set_int(filter_settings, "color", 0xFFFFFF);
+			obs_data_set_obj(filter, "settings", filter_settings);
+			obs_data_array_push_back(filters, filter);
+
+			obs_data_release(filter_settings);
+			obs_data_release(filter);
+		}
+
+		dstr_printf(&str, "/home/user/media/clip %d \"final\".mp4", i);
+		obs_data_set_string(settings, "local_file", str.array);
+		obs_data_set_bool(settings, "looping", i % 2);
+		obs_data_set_int(settings, "speed_percent", 100);
+
+		dstr_printf(&str, "Source %d", i);
+		obs_data_set_string(source, "name", str.array);
+		obs_data_set_string(source, "id", "ffmpeg_source");
+		obs_data_set_double(source, "volume", 1.0 / (i + 1));
+		obs_data_set_obj(source, "settings", settings);
+		obs_data_set_array(source, "filters", filters);
+		obs_data_array_push_back(sources, source);
+
+		obs_data_array_release(filters);
+		obs_data_release(settings);
+		obs_data_release(source);
+	}
+
+	obs_data_set_array(collection, "sources", sources);
+	obs_data_set_string(collection, "name", "Benchmark");
+	obs_data_array_release(sources);
+	dstr_free(&str);
+	return collection;
+}
+
+static void json_benchmark_test(void **state)
+{
+	obs_data_t *collection = create_collection();
+	obs_data_t *loaded;
+	uint64_t start, save_ns, load_ns;
+	char *json;
+	size_t size;
+
+	start = os_gettime_ns();
+	json = bstrdup(obs_data_get_json(collection));
+	save_ns = os_gettime_ns() - start;
+	size = strlen(json);
+
+	start = os_gettime_ns();
+	loaded = obs_data_create_from_json(json);
+	load_ns = os_gettime_ns() - start;
+
+	assert_non_null(loaded);
+	assert_string_equal(obs_data_get_json(loaded), json);
+
+	print_message("%zu KiB collection: save %.2f ms, load %.2f ms\n",
+		      size / 1024, (double)save_ns / 1000000.0,
+		      (double)load_ns / 1000000.0);
+
+	bfree(json);
+	obs_data_release(loaded);
+	obs_data_release(collection);
+}
+#endif
+
+int main()
+{
+#ifdef RUN_BENCHMARKS
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(json_benchmark_test),
+	};
+#else
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(json_round_trip_test),
+		cmocka_unit_test(json_format_test),
+		cmocka_unit_test(json_reject_test),
+		cmocka_unit_test(data_index_test),
+	};
+#endif
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,113 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/file-watch.h>
+
+#define WAIT_MS 3000
+
+struct watch_data {
+	os_event_t *event;
+	volatile long count;
+};
+
+static void changed(void *param, const char *path)
+{
+	struct watch_data *data = param;
+
+	os_atomic_inc_long(&data->count);
+	os_event_signal(data->event);
+	UNUSED_PARAMETER(path);
+}
+
+static char *get_temp_path(const char *name)
+{
+	struct dstr path = {0};
+	char *dir = os_get_abs_path_ptr(".");
+
+	dstr_printf(&path, "%s/%s", dir, name);
+	bfree(dir);
+	return path.array;
+}
+
+static void file_watch_modify_test(void **state)
+{
+	struct watch_data data = {0};
+	char *path = get_temp_path("test_file_watch_modify.txt");
+	os_file_watch_t *watch;
+
+	os_unlink(path);
+	assert_int_equal(os_event_init(&data.event, OS_EVENT_TYPE_AUTO), 0);
+
+	watch = os_file_watch_add(path, changed, &data);
+	assert_non_null(watch);
+
+	/* created, then written several times in quick succession */
+	for (int i = 0; i < 5; i++)
+		assert_true(os_quick_write_utf8_file(path, "score", 5, false));
+
+	assert_int_equal(os_event_timedwait(data.event, WAIT_MS), 0);
+	os_sleep_ms(OS_FILE_WATCH_COALESCE_MS * 3);
+	assert_true(os_atomic_load_long(&data.count) <= 2);
+
+	/* replaced atomically */
+	os_atomic_set_long(&data.count, 0);
+	assert_true(os_quick_write_utf8_file_safe(path, "new score", 9, false,
+						  "tmp", NULL));
+	assert_int_equal(os_event_timedwait(data.event, WAIT_MS), 0);
+	assert_true(os_atomic_load_long(&data.count) >= 1);
+
+	/* no more notifications once removed */
+	os_file_watch_remove(watch);
+	os_atomic_set_long(&data.count, 0);
+	assert_true(os_quick_write_utf8_file(path, "ignored", 7, false));
+	os_sleep_ms(1000);
+	assert_int_equal(os_atomic_load_long(&data.count), 0);
+
+	os_unlink(path);
+	os_event_destroy(data.event);
+	bfree(path);
+	UNUSED_PARAMETER(state);
+}
+
+static void file_watch_unrelated_test(void **state)
+{
+	struct watch_data data = {0};
+	char *path = get_temp_path("test_file_watch_a.txt");
+	char *other = get_temp_path("test_file_watch_b.txt");
+	os_file_watch_t *watch;
+
+	assert_int_equal(os_event_init(&data.event, OS_EVENT_TYPE_AUTO), 0);
+	assert_true(os_quick_write_utf8_file(path, "a", 1, false));
+
+	watch = os_file_watch_add(path, changed, &data);
+	assert_non_null(watch);
+
+	/* files next to the watched file don't trigger it */
+	assert_true(os_quick_write_utf8_file(other, "b", 1, false));
+	assert_int_equal(os_event_timedwait(data.event, 1000), ETIMEDOUT);
+
+	os_file_watch_remove(watch);
+	os_unlink(path);
+	os_unlink(other);
+	os_event_destroy(data.event);
+	bfree(path);
+	bfree(other);
+	UNUSED_PARAMETER(state);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(file_watch_modify_test),
+		cmocka_unit_test(file_watch_unrelated_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
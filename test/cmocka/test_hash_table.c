@@ -0,0 +1,93 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/hash-table.h>
+
+struct entry {
+	int64_t id;
+	struct hash_node node;
+};
+
+static struct entry *find(struct hash_table *ht, int64_t id)
+{
+	struct hash_node *node = hash_table_first(ht, hash_uint64(id));
+
+	while (node) {
+		struct entry *entry = hash_entry(node, struct entry, node);
+		if (entry->id == id)
+			return entry;
+		node = hash_table_next(node);
+	}
+
+	return NULL;
+}
+
+static void hash_table_basic_test(void **state)
+{
+	struct entry entries[1000];
+	struct hash_table ht;
+
+	hash_table_init(&ht);
+	assert_null(find(&ht, 1));
+
+	for (int i = 0; i < 1000; i++) {
+		entries[i].id = i;
+		hash_table_insert(&ht, &entries[i].node, hash_uint64(i));
+	}
+
+	assert_int_equal(ht.num, 1000);
+	assert_true(ht.num_buckets >= ht.num);
+
+	for (int i = 0; i < 1000; i++)
+		assert_ptr_equal(find(&ht, i), &entries[i]);
+	assert_null(find(&ht, 1000));
+
+	for (int i = 0; i < 1000; i += 2)
+		assert_true(hash_table_remove(&ht, &entries[i].node));
+	assert_false(hash_table_remove(&ht, &entries[0].node));
+	assert_int_equal(ht.num, 500);
+
+	for (int i = 0; i < 1000; i++)
+		assert_ptr_equal(find(&ht, i), i % 2 ? &entries[i] : NULL);
+
+	hash_table_clear(&ht);
+	assert_int_equal(ht.num, 0);
+	assert_null(find(&ht, 1));
+
+	hash_table_free(&ht);
+}
+
+static void hash_table_duplicate_test(void **state)
+{
+	struct entry entries[3] = {{.id = 5}, {.id = 5}, {.id = 7}};
+	struct hash_table ht;
+	struct hash_node *node;
+	int count = 0;
+
+	hash_table_init(&ht);
+	for (int i = 0; i < 3; i++)
+		hash_table_insert(&ht, &entries[i].node,
+				  hash_str(entries[i].id == 5 ? "a" : "b"));
+
+	node = hash_table_first(&ht, hash_str("a"));
+	while (node) {
+		assert_int_equal(hash_entry(node, struct entry, node)->id, 5);
+		node = hash_table_next(node);
+		count++;
+	}
+
+	assert_int_equal(count, 2);
+	hash_table_free(&ht);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(hash_table_basic_test),
+		cmocka_unit_test(hash_table_duplicate_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
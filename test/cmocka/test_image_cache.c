@@ -0,0 +1,91 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <graphics/image-cache.h>
+
+/* 2x2 24-bit bitmap */
+static const uint8_t bmp_2x2[] = {
+	'B', 'M', 70, 0, 0, 0, 0, 0, 0, 0, 54, 0, 0, 0, /* file header */
+	40,  0,   0,  0, 2, 0, 0, 0, 2, 0, 0, 0, 1, 0,  /* info header */
+	24,  0,   0,  0, 0, 0, 16, 0, 0, 0, 0, 0, 0, 0,
+	0,   0,   0,  0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0,   0,   255, 0, 255, 0, 0, 0, /* rows are padded to 4 bytes */
+	255, 0,   0,   255, 255, 255, 0, 0,
+};
+
+static void write_bmp(const char *path, size_t extra)
+{
+	FILE *f = os_fopen(path, "wb");
+
+	assert_non_null(f);
+	fwrite(bmp_2x2, 1, sizeof(bmp_2x2), f);
+	for (size_t i = 0; i < extra; i++)
+		fputc(0, f);
+	fclose(f);
+}
+
+static void image_cache_share_test(void **state)
+{
+	const char *path = "test_image_cache.bmp";
+	gs_cached_image_t *a, *b, *c;
+
+	write_bmp(path, 0);
+
+	a = gs_image_cache_acquire(path, false);
+	assert_non_null(a);
+	assert_true(gs_cached_image_ready(a));
+	assert_true(gs_cached_image_loaded(a));
+	assert_int_equal(gs_cached_image_get_width(a), 2);
+	assert_int_equal(gs_cached_image_get_height(a), 2);
+
+	/* the same file is only decoded once */
+	b = gs_image_cache_acquire(path, true);
+	assert_ptr_equal(a, b);
+
+	/* a modified file is a different image */
+	write_bmp(path, 2);
+	c = gs_image_cache_acquire(path, true);
+	assert_non_null(c);
+	assert_ptr_not_equal(a, c);
+
+	gs_cached_image_wait(c);
+	assert_true(gs_cached_image_loaded(c));
+
+	gs_cached_image_release(a);
+	gs_cached_image_release(b);
+	gs_cached_image_release(c);
+
+	assert_null(gs_image_cache_acquire("does_not_exist.bmp", true));
+
+	os_unlink(path);
+	UNUSED_PARAMETER(state);
+}
+
+static void image_cache_release_pending_test(void **state)
+{
+	const char *path = "test_image_cache_pending.bmp";
+
+	write_bmp(path, 0);
+
+	/* releasing images that are still being decoded is fine */
+	for (int i = 0; i < 100; i++)
+		gs_cached_image_release(gs_image_cache_acquire(path, true));
+
+	gs_image_cache_free();
+	os_unlink(path);
+	UNUSED_PARAMETER(state);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(image_cache_share_test),
+		cmocka_unit_test(image_cache_release_pending_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
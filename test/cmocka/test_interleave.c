@@ -0,0 +1,179 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-interleave.h>
+
+/* the sorted-insert interleaving previously used by obs-output.c, kept as
+ * the reference ordering for the merge queue */
+static void reference_insert(struct darray *da, struct encoder_packet *out)
+{
+	DARRAY(struct encoder_packet) packets;
+	size_t idx;
+
+	packets.da = *da;
+
+	for (idx = 0; idx < packets.num; idx++) {
+		struct encoder_packet *cur_packet = packets.array + idx;
+
+		if (out->dts_usec == cur_packet->dts_usec &&
+		    out->type == OBS_ENCODER_VIDEO) {
+			break;
+		} else if (out->dts_usec < cur_packet->dts_usec) {
+			break;
+		}
+	}
+
+	da_insert(packets, idx, out);
+	*da = packets.da;
+}
+
+static uint32_t rand_state;
+
+static uint32_t next_rand(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (rand_state >> 16) & 0x7FFF;
+}
+
+struct stream {
+	enum obs_encoder_type type;
+	size_t track_idx;
+	int64_t interval;
+	int64_t next_dts;
+};
+
+static void make_packet(struct encoder_packet *packet, struct stream *stream,
+			int64_t id)
+{
+	memset(packet, 0, sizeof(*packet));
+	packet->type = stream->type;
+	packet->track_idx = stream->track_idx;
+	packet->dts_usec = stream->next_dts;
+	packet->pts = id;
+
+	stream->next_dts += stream->interval;
+}
+
+/* feeds the same packets to both implementations, popping from the front at
+ * random points, and checks every popped packet matches */
+static void compare_orderings(size_t num_audio, int64_t video_interval,
+			      int64_t audio_interval, uint32_t seed,
+			      size_t pop_chance)
+{
+	struct stream streams[INTERLEAVE_TRACKS];
+	size_t num_streams = num_audio + 1;
+	DARRAY(struct encoder_packet) reference;
+	struct interleave_queue queue;
+	int64_t id = 0;
+
+	da_init(reference);
+	interleave_queue_init(&queue);
+	rand_state = seed;
+
+	streams[0].type = OBS_ENCODER_VIDEO;
+	streams[0].track_idx = 0;
+	streams[0].interval = video_interval;
+	streams[0].next_dts = 0;
+
+	for (size_t i = 0; i < num_audio; i++) {
+		streams[i + 1].type = OBS_ENCODER_AUDIO;
+		streams[i + 1].track_idx = i;
+		streams[i + 1].interval = audio_interval;
+		streams[i + 1].next_dts = 0;
+	}
+
+	for (size_t i = 0; i < 5000; i++) {
+		struct stream *stream = &streams[next_rand() % num_streams];
+		struct encoder_packet packet;
+
+		make_packet(&packet, stream, id++);
+		reference_insert(&reference.da, &packet);
+		interleave_queue_push(&queue, &packet);
+
+		assert_int_equal(reference.num, interleave_queue_size(&queue));
+		assert_true(interleave_queue_peek(&queue)->pts ==
+			    reference.array[0].pts);
+
+		if ((size_t)(next_rand() % 100) < pop_chance) {
+			struct encoder_packet popped;
+
+			assert_true(interleave_queue_pop(&queue, &popped));
+			assert_true(popped.pts == reference.array[0].pts);
+			da_erase(reference, 0);
+		}
+	}
+
+	while (reference.num) {
+		struct encoder_packet popped;
+
+		assert_true(interleave_queue_pop(&queue, &popped));
+		assert_true(popped.pts == reference.array[0].pts);
+		da_erase(reference, 0);
+	}
+
+	assert_false(interleave_queue_pop(&queue, NULL));
+	assert_null(interleave_queue_peek(&queue));
+
+	interleave_queue_free(&queue);
+	da_free(reference);
+}
+
+static void interleave_single_track_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	compare_orderings(1, 33333, 21333, 1, 50);
+}
+
+static void interleave_multi_track_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	compare_orderings(MAX_AUDIO_MIXES, 16667, 21333, 2, 70);
+}
+
+static void interleave_equal_ts_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* identical intervals produce many equal timestamps across tracks,
+	 * exercising the video-first and arrival-order tie breaks */
+	compare_orderings(3, 20000, 20000, 3, 30);
+	compare_orderings(MAX_AUDIO_MIXES, 10000, 20000, 4, 80);
+}
+
+static void interleave_out_of_order_test(void **state)
+{
+	struct interleave_queue queue;
+	struct encoder_packet packet = {0};
+	int64_t dts[] = {0, 20, 10, 30, 5};
+	int64_t expected[] = {0, 5, 10, 20, 30};
+
+	UNUSED_PARAMETER(state);
+	interleave_queue_init(&queue);
+
+	packet.type = OBS_ENCODER_AUDIO;
+	for (size_t i = 0; i < 5; i++) {
+		packet.dts_usec = dts[i];
+		interleave_queue_push(&queue, &packet);
+	}
+
+	for (size_t i = 0; i < 5; i++) {
+		assert_true(interleave_queue_pop(&queue, &packet));
+		assert_true(packet.dts_usec == expected[i]);
+	}
+
+	interleave_queue_free(&queue);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(interleave_single_track_test),
+		cmocka_unit_test(interleave_multi_track_test),
+		cmocka_unit_test(interleave_equal_ts_test),
+		cmocka_unit_test(interleave_out_of_order_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
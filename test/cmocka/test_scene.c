@@ -0,0 +1,77 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+
+static int setup(void **state)
+{
+	return obs_startup("en-US", NULL, NULL) ? 0 : -1;
+}
+
+static int teardown(void **state)
+{
+	obs_shutdown();
+	return 0;
+}
+
+static void scene_item_id_load_test(void **state)
+{
+	obs_scene_t *child1 = obs_scene_create("child 1");
+	obs_scene_t *child2 = obs_scene_create("child 2");
+	obs_scene_t *scene = obs_scene_create("scene");
+	obs_sceneitem_t *items[3];
+	obs_source_t *loaded;
+	obs_scene_t *loaded_scene;
+	obs_sceneitem_t *item;
+	obs_data_t *data;
+	int64_t id1, id2;
+
+	/* remove the first item so that the saved ids aren't the ones a new
+	 * scene would assign */
+	items[0] = obs_scene_add(scene, obs_scene_get_source(child1));
+	items[1] = obs_scene_add(scene, obs_scene_get_source(child1));
+	items[2] = obs_scene_add(scene, obs_scene_get_source(child2));
+	obs_sceneitem_remove(items[0]);
+
+	id1 = obs_sceneitem_get_id(items[1]);
+	id2 = obs_sceneitem_get_id(items[2]);
+	assert_ptr_equal(obs_scene_find_sceneitem_by_id(scene, id1), items[1]);
+	assert_ptr_equal(obs_scene_find_sceneitem_by_id(scene, id2), items[2]);
+
+	data = obs_save_source(obs_scene_get_source(scene));
+	obs_scene_release(scene);
+
+	loaded = obs_load_source(data);
+	loaded_scene = obs_scene_from_source(loaded);
+	assert_non_null(loaded_scene);
+
+	item = obs_scene_find_sceneitem_by_id(loaded_scene, id1);
+	assert_non_null(item);
+	assert_int_equal(obs_sceneitem_get_id(item), id1);
+	assert_ptr_equal(obs_sceneitem_get_source(item),
+			 obs_scene_get_source(child1));
+
+	item = obs_scene_find_sceneitem_by_id(loaded_scene, id2);
+	assert_non_null(item);
+	assert_int_equal(obs_sceneitem_get_id(item), id2);
+	assert_ptr_equal(obs_sceneitem_get_source(item),
+			 obs_scene_get_source(child2));
+
+	assert_null(obs_scene_find_sceneitem_by_id(loaded_scene, 1));
+
+	obs_source_release(loaded);
+	obs_data_release(data);
+	obs_scene_release(child1);
+	obs_scene_release(child2);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(scene_item_id_load_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,118 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/task-pool.h>
+
+#define NUM_TASKS 1000
+
+struct pool_data {
+	os_task_pool_t *pool;
+	volatile long count;
+	volatile long requeued;
+};
+
+static void count_task(void *param)
+{
+	struct pool_data *data = param;
+	os_atomic_inc_long(&data->count);
+}
+
+static void requeue_task(void *param)
+{
+	struct pool_data *data = param;
+
+	if (os_atomic_inc_long(&data->requeued) < NUM_TASKS)
+		os_task_pool_queue(data->pool, requeue_task, data);
+	os_atomic_inc_long(&data->count);
+}
+
+static void task_pool_wait_test(void **state)
+{
+	struct pool_data data = {0};
+
+	data.pool = os_task_pool_create("test pool", 4);
+	assert_non_null(data.pool);
+	assert_int_equal(os_task_pool_num_threads(data.pool), 4);
+
+	for (int i = 0; i < NUM_TASKS; i++)
+		os_task_pool_queue(data.pool, count_task, &data);
+
+	os_task_pool_wait(data.pool);
+	assert_int_equal(os_atomic_load_long(&data.count), NUM_TASKS);
+
+	/* waiting on an idle pool returns immediately */
+	os_task_pool_wait(data.pool);
+
+	os_task_pool_destroy(data.pool);
+	UNUSED_PARAMETER(state);
+}
+
+static void task_pool_requeue_test(void **state)
+{
+	struct pool_data data = {0};
+
+	data.pool = os_task_pool_create("test pool", 0);
+	assert_non_null(data.pool);
+
+	os_task_pool_queue(data.pool, requeue_task, &data);
+
+	/* tasks queued from tasks finish before destroy returns */
+	os_task_pool_destroy(data.pool);
+	assert_int_equal(data.count, NUM_TASKS);
+	UNUSED_PARAMETER(state);
+}
+
+struct batch_item {
+	volatile long *count;
+	int index;
+	int done;
+};
+
+static void batch_task(void *param)
+{
+	struct batch_item *item = param;
+
+	item->done = item->index + 1;
+	os_atomic_inc_long(item->count);
+}
+
+static void task_pool_run_test(void **state)
+{
+	struct batch_item items[16];
+	volatile long count = 0;
+	os_task_pool_t *pool = os_task_pool_create("test pool", 3);
+
+	assert_non_null(pool);
+
+	for (int i = 0; i < 16; i++)
+		items[i] = (struct batch_item){&count, i, 0};
+
+	/* returns once every item has run, exactly once */
+	os_task_pool_run(pool, batch_task, items, sizeof(items[0]), 16);
+	assert_int_equal(os_atomic_load_long(&count), 16);
+	for (int i = 0; i < 16; i++)
+		assert_int_equal(items[i].done, i + 1);
+
+	/* without a pool everything runs on the calling thread */
+	os_task_pool_run(NULL, batch_task, items, sizeof(items[0]), 4);
+	assert_int_equal(os_atomic_load_long(&count), 20);
+
+	os_task_pool_destroy(pool);
+	UNUSED_PARAMETER(state);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(task_pool_wait_test),
+		cmocka_unit_test(task_pool_requeue_test),
+		cmocka_unit_test(task_pool_run_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,527 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/video-convert.h>
+
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+#define BENCH_FRAMES 20
+
+/* linesizes are padded to catch writes past the end of the rows */
+#define PADDING 24
+#define PAD_BYTE 0xCD
+
+enum layout { PLANAR, SEMI_PLANAR, YUYV, UYVY, YVYU, LUMA };
+
+struct test_format {
+	enum video_format format;
+	const char *name;
+	enum layout layout;
+	uint32_t shift_x;
+	uint32_t shift_y;
+	bool alpha;
+};
+
+static const struct test_format formats[] = {
+	{VIDEO_FORMAT_I420, "I420", PLANAR, 1, 1, false},
+	{VIDEO_FORMAT_NV12, "NV12", SEMI_PLANAR, 1, 1, false},
+	{VIDEO_FORMAT_I422, "I422", PLANAR, 1, 0, false},
+	{VIDEO_FORMAT_I444, "I444", PLANAR, 0, 0, false},
+	{VIDEO_FORMAT_YUY2, "YUY2", YUYV, 1, 0, false},
+	{VIDEO_FORMAT_UYVY, "UYVY", UYVY, 1, 0, false},
+	{VIDEO_FORMAT_YVYU, "YVYU", YVYU, 1, 0, false},
+	{VIDEO_FORMAT_Y800, "Y800", LUMA, 0, 0, false},
+	{VIDEO_FORMAT_I40A, "I40A", PLANAR, 1, 1, true},
+	{VIDEO_FORMAT_I42A, "I42A", PLANAR, 1, 0, true},
+	{VIDEO_FORMAT_YUVA, "YUVA", PLANAR, 0, 0, true},
+};
+
+#define NUM_FORMATS (sizeof(formats) / sizeof(formats[0]))
+
+struct test_frame {
+	uint8_t *data[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+	size_t row_bytes[MAX_AV_PLANES];
+	uint32_t rows[MAX_AV_PLANES];
+	size_t planes;
+};
+
+static void frame_init(struct test_frame *frame, const struct test_format *f,
+		       uint32_t width, uint32_t height)
+{
+	memset(frame, 0, sizeof(*frame));
+
+	switch (f->layout) {
+	case PLANAR:
+		frame->planes = f->alpha ? 4 : 3;
+		for (size_t i = 0; i < frame->planes; i++) {
+			const bool chroma = i == 1 || i == 2;
+			frame->row_bytes[i] = chroma ? width >> f->shift_x
+						     : width;
+			frame->rows[i] = chroma ? height >> f->shift_y : height;
+		}
+		break;
+	case SEMI_PLANAR:
+		frame->planes = 2;
+		frame->row_bytes[0] = frame->row_bytes[1] = width;
+		frame->rows[0] = height;
+		frame->rows[1] = height / 2;
+		break;
+	case YUYV:
+	case UYVY:
+	case YVYU:
+		frame->planes = 1;
+		frame->row_bytes[0] = (size_t)width * 2;
+		frame->rows[0] = height;
+		break;
+	case LUMA:
+		frame->planes = 1;
+		frame->row_bytes[0] = width;
+		frame->rows[0] = height;
+		break;
+	}
+
+	for (size_t i = 0; i < frame->planes; i++) {
+		const size_t size = (frame->row_bytes[i] + PADDING) *
+				    frame->rows[i];
+
+		frame->linesize[i] = (uint32_t)(frame->row_bytes[i] + PADDING);
+		frame->data[i] = bmalloc(size);
+		memset(frame->data[i], PAD_BYTE, size);
+	}
+}
+
+static void frame_free(struct test_frame *frame)
+{
+	for (size_t i = 0; i < frame->planes; i++)
+		bfree(frame->data[i]);
+}
+
+static void frame_fill_random(struct test_frame *frame)
+{
+	for (size_t i = 0; i < frame->planes; i++) {
+		for (uint32_t y = 0; y < frame->rows[i]; y++) {
+			uint8_t *row = frame->data[i] + y * frame->linesize[i];
+			for (size_t x = 0; x < frame->row_bytes[i]; x++)
+				row[x] = (uint8_t)rand();
+		}
+	}
+}
+
+static bool frame_equal(const struct test_frame *a,
+			const struct test_frame *b)
+{
+	for (size_t i = 0; i < a->planes; i++) {
+		/* compares the padding as well */
+		const size_t size = (size_t)a->linesize[i] * a->rows[i];
+		if (memcmp(a->data[i], b->data[i], size) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* straightforward per pixel reference                                       */
+
+struct ref_image {
+	uint32_t width;
+	uint32_t height;
+	uint8_t *y, *u, *v, *a;
+};
+
+static inline uint8_t avg(uint8_t a, uint8_t b)
+{
+	return (uint8_t)((a + b + 1) >> 1);
+}
+
+static inline uint8_t *px(uint8_t *plane, const struct ref_image *img,
+			  uint32_t x, uint32_t y)
+{
+	return plane + (size_t)y * img->width + x;
+}
+
+static void ref_init(struct ref_image *img, uint32_t width, uint32_t height)
+{
+	const size_t size = (size_t)width * height;
+
+	img->width = width;
+	img->height = height;
+	img->y = bmalloc(size);
+	img->u = bmalloc(size);
+	img->v = bmalloc(size);
+	img->a = bmalloc(size);
+}
+
+static void ref_free(struct ref_image *img)
+{
+	bfree(img->y);
+	bfree(img->u);
+	bfree(img->v);
+	bfree(img->a);
+}
+
+/* reads the frame with chroma at the resolution of its format */
+static void ref_read(struct ref_image *img, const struct test_format *f,
+		     const struct test_frame *frame)
+{
+	const uint32_t cx = img->width >> f->shift_x;
+	const uint32_t cy = img->height >> f->shift_y;
+
+	for (uint32_t y = 0; y < img->height; y++) {
+		const uint8_t *row = frame->data[0] + y * frame->linesize[0];
+		const uint8_t *alpha = f->alpha ? frame->data[3] +
+							  y * frame->linesize[3]
+						: NULL;
+
+		for (uint32_t x = 0; x < img->width; x++) {
+			uint8_t *luma = px(img->y, img, x, y);
+			*px(img->a, img, x, y) = alpha ? alpha[x] : 255;
+
+			switch (f->layout) {
+			case YUYV:
+			case YVYU:
+				*luma = row[x * 2];
+				break;
+			case UYVY:
+				*luma = row[x * 2 + 1];
+				break;
+			default:
+				*luma = row[x];
+			}
+		}
+	}
+
+	for (uint32_t y = 0; y < cy; y++) {
+		for (uint32_t x = 0; x < cx; x++) {
+			const uint8_t *row = frame->data[0] +
+					     y * frame->linesize[0];
+			uint8_t *u = px(img->u, img, x, y);
+			uint8_t *v = px(img->v, img, x, y);
+
+			switch (f->layout) {
+			case PLANAR:
+				*u = frame->data[1][y * frame->linesize[1] + x];
+				*v = frame->data[2][y * frame->linesize[2] + x];
+				break;
+			case SEMI_PLANAR:
+				*u = frame->data[1][y * frame->linesize[1] +
+						    x * 2];
+				*v = frame->data[1][y * frame->linesize[1] +
+						    x * 2 + 1];
+				break;
+			case YUYV:
+				*u = row[x * 4 + 1];
+				*v = row[x * 4 + 3];
+				break;
+			case UYVY:
+				*u = row[x * 4];
+				*v = row[x * 4 + 2];
+				break;
+			case YVYU:
+				*u = row[x * 4 + 3];
+				*v = row[x * 4 + 1];
+				break;
+			case LUMA:
+				*u = *v = 128;
+			}
+		}
+	}
+}
+
+static void ref_resample_plane(struct ref_image *img, uint8_t *plane,
+			       const struct test_format *dst,
+			       const struct test_format *src)
+{
+	const uint32_t src_cx = img->width >> src->shift_x;
+	const uint32_t dst_cx = img->width >> dst->shift_x;
+	const uint32_t dst_cy = img->height >> dst->shift_y;
+	uint8_t *tmp = bmalloc((size_t)img->width * img->height);
+
+	/* vertical first, at the source width */
+	for (uint32_t y = 0; y < dst_cy; y++) {
+		for (uint32_t x = 0; x < src_cx; x++) {
+			uint8_t val;
+
+			if (dst->shift_y == src->shift_y)
+				val = *px(plane, img, x, y);
+			else if (dst->shift_y)
+				val = avg(*px(plane, img, x, y * 2),
+					  *px(plane, img, x, y * 2 + 1));
+			else
+				val = *px(plane, img, x, y / 2);
+
+			*px(tmp, img, x, y) = val;
+		}
+	}
+
+	for (uint32_t y = 0; y < dst_cy; y++) {
+		for (uint32_t x = 0; x < dst_cx; x++) {
+			uint8_t val;
+
+			if (dst->shift_x == src->shift_x) {
+				val = *px(tmp, img, x, y);
+			} else if (dst->shift_x) {
+				val = avg(*px(tmp, img, x * 2, y),
+					  *px(tmp, img, x * 2 + 1, y));
+			} else {
+				const uint32_t i = x / 2;
+				const uint32_t next = i + 1 < src_cx ? i + 1
+								     : i;
+				val = (x & 1) ? avg(*px(tmp, img, i, y),
+						    *px(tmp, img, next, y))
+					      : *px(tmp, img, i, y);
+			}
+
+			*px(plane, img, x, y) = val;
+		}
+	}
+
+	bfree(tmp);
+}
+
+static void ref_write(const struct ref_image *img, const struct test_format *f,
+		      struct test_frame *frame)
+{
+	const uint32_t cx = img->width >> f->shift_x;
+	const uint32_t cy = img->height >> f->shift_y;
+
+	for (uint32_t y = 0; y < img->height; y++) {
+		uint8_t *row = frame->data[0] + y * frame->linesize[0];
+
+		for (uint32_t x = 0; x < img->width; x++) {
+			const uint8_t luma = *px(img->y, img, x, y);
+			const uint8_t u = *px(img->u, img, x / 2, y);
+			const uint8_t v = *px(img->v, img, x / 2, y);
+
+			if (f->alpha)
+				frame->data[3][y * frame->linesize[3] + x] =
+					*px(img->a, img, x, y);
+
+			switch (f->layout) {
+			case YUYV:
+				row[x * 2] = luma;
+				row[x * 2 + 1] = (x & 1) ? v : u;
+				break;
+			case UYVY:
+				row[x * 2] = (x & 1) ? v : u;
+				row[x * 2 + 1] = luma;
+				break;
+			case YVYU:
+				row[x * 2] = luma;
+				row[x * 2 + 1] = (x & 1) ? u : v;
+				break;
+			default:
+				row[x] = luma;
+			}
+		}
+	}
+
+	for (uint32_t y = 0; y < cy; y++) {
+		for (uint32_t x = 0; x < cx; x++) {
+			const uint8_t u = *px(img->u, img, x, y);
+			const uint8_t v = *px(img->v, img, x, y);
+
+			if (f->layout == PLANAR) {
+				frame->data[1][y * frame->linesize[1] + x] = u;
+				frame->data[2][y * frame->linesize[2] + x] = v;
+			} else if (f->layout == SEMI_PLANAR) {
+				uint8_t *uv = frame->data[1] +
+					      y * frame->linesize[1] + x * 2;
+				uv[0] = u;
+				uv[1] = v;
+			}
+		}
+	}
+}
+
+static void ref_convert(struct test_frame *out, const struct test_format *dst,
+			const struct test_frame *in,
+			const struct test_format *src, uint32_t width,
+			uint32_t height)
+{
+	struct ref_image img;
+
+	ref_init(&img, width, height);
+	ref_read(&img, src, in);
+	ref_resample_plane(&img, img.u, dst, src);
+	ref_resample_plane(&img, img.v, dst, src);
+	ref_write(&img, dst, out);
+	ref_free(&img);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void convert_pair(const struct test_format *dst,
+			 const struct test_format *src, uint32_t width,
+			 uint32_t height)
+{
+	struct test_frame in, out, expected;
+	bool success;
+
+	frame_init(&in, src, width, height);
+	frame_init(&out, dst, width, height);
+	frame_init(&expected, dst, width, height);
+	frame_fill_random(&in);
+
+	success = video_convert(out.data, out.linesize, dst->format,
+				(const uint8_t *const *)in.data, in.linesize,
+				src->format, width, height);
+	ref_convert(&expected, dst, &in, src, width, height);
+
+	if (!success || !frame_equal(&out, &expected))
+		print_message("%s -> %s at %ux%u: mismatch\n", src->name,
+			      dst->name, width, height);
+	assert_true(success);
+	assert_true(frame_equal(&out, &expected));
+
+	frame_free(&in);
+	frame_free(&out);
+	frame_free(&expected);
+}
+
+static void convert_test(void **state)
+{
+	for (size_t i = 0; i < NUM_FORMATS; i++) {
+		for (size_t j = 0; j < NUM_FORMATS; j++) {
+			assert_true(video_convert_supported(
+				formats[j].format, formats[i].format));
+
+			/* not a multiple of the vector widths */
+			convert_pair(&formats[j], &formats[i], 70, 6);
+			/* large enough to be split across threads */
+			convert_pair(&formats[j], &formats[i], 1280, 720);
+		}
+	}
+
+	print_message("video_convert (%s): %zu format pairs match\n",
+		      video_convert_get_kernel_name(),
+		      NUM_FORMATS * NUM_FORMATS);
+}
+
+static void unsupported_test(void **state)
+{
+	uint8_t in[4][64] = {{0}};
+	uint8_t out[4][64];
+	const uint8_t *in_planes[MAX_AV_PLANES] = {in[0], in[1], in[2], in[3]};
+	uint8_t *out_planes[MAX_AV_PLANES] = {out[0], out[1], out[2], out[3]};
+	const uint32_t linesize[MAX_AV_PLANES] = {64, 64, 64, 64};
+
+	/* RGB only to the same format */
+	assert_false(video_convert_supported(VIDEO_FORMAT_I420,
+					     VIDEO_FORMAT_RGBA));
+	assert_false(video_convert_supported(VIDEO_FORMAT_BGRA,
+					     VIDEO_FORMAT_RGBA));
+	assert_true(video_convert_supported(VIDEO_FORMAT_BGRA,
+					    VIDEO_FORMAT_BGRA));
+	assert_false(video_convert_supported(VIDEO_FORMAT_NONE,
+					     VIDEO_FORMAT_NONE));
+
+	/* 4:2:0 needs an even size */
+	assert_false(video_convert(out_planes, linesize, VIDEO_FORMAT_I420,
+				   in_planes, linesize, VIDEO_FORMAT_I444, 63,
+				   2));
+	assert_false(video_convert(out_planes, linesize, VIDEO_FORMAT_I420,
+				   in_planes, linesize, VIDEO_FORMAT_I444, 64,
+				   1));
+	assert_true(video_convert(out_planes, linesize, VIDEO_FORMAT_I422,
+				  in_planes, linesize, VIDEO_FORMAT_I444, 64,
+				  1));
+
+	/* copies round the chroma planes down, like video_frame */
+	assert_true(video_convert(out_planes, linesize, VIDEO_FORMAT_I420,
+				  in_planes, linesize, VIDEO_FORMAT_I420, 63,
+				  3));
+}
+
+static void copy_test(void **state)
+{
+	const uint32_t width = 1283, height = 721;
+	const uint32_t in_linesize[1] = {width * 4 + 32};
+	const uint32_t out_linesize[1] = {width * 4};
+	uint8_t *in = bmalloc((size_t)in_linesize[0] * height);
+	uint8_t *out = bmalloc((size_t)out_linesize[0] * height);
+	const uint8_t *in_planes[1] = {in};
+	uint8_t *out_planes[1] = {out};
+
+	for (size_t i = 0; i < (size_t)in_linesize[0] * height; i++)
+		in[i] = (uint8_t)rand();
+
+	assert_true(video_convert(out_planes, out_linesize, VIDEO_FORMAT_BGRA,
+				  in_planes, in_linesize, VIDEO_FORMAT_BGRA,
+				  width, height));
+
+	for (uint32_t y = 0; y < height; y++)
+		assert_true(memcmp(out + y * out_linesize[0],
+				   in + y * in_linesize[0], width * 4) == 0);
+
+	bfree(in);
+	bfree(out);
+}
+
+#ifdef RUN_BENCHMARKS
+static void convert_benchmark(void **state)
+{
+	for (size_t i = 0; i < NUM_FORMATS; i++) {
+		for (size_t j = 0; j < NUM_FORMATS; j++) {
+			const struct test_format *src = &formats[i];
+			const struct test_format *dst = &formats[j];
+			struct test_frame in, out;
+			uint64_t start, ns;
+
+			frame_init(&in, src, BENCH_WIDTH, BENCH_HEIGHT);
+			frame_init(&out, dst, BENCH_WIDTH, BENCH_HEIGHT);
+			frame_fill_random(&in);
+
+			start = os_gettime_ns();
+			for (size_t k = 0; k < BENCH_FRAMES; k++)
+				video_convert(out.data, out.linesize,
+					      dst->format,
+					      (const uint8_t *const *)in.data,
+					      in.linesize, src->format,
+					      BENCH_WIDTH, BENCH_HEIGHT);
+			ns = os_gettime_ns() - start;
+
+			print_message("video_convert (%s) %s -> %s: "
+				      "%.2f ms/frame, %.0f fps at %dx%d\n",
+				      video_convert_get_kernel_name(),
+				      src->name, dst->name,
+				      (double)ns / BENCH_FRAMES / 1000000.0,
+				      1000000000.0 * BENCH_FRAMES / (double)ns,
+				      BENCH_WIDTH, BENCH_HEIGHT);
+
+			frame_free(&in);
+			frame_free(&out);
+		}
+	}
+}
+#endif
+
+static int teardown(void **state)
+{
+	video_convert_free_pool();
+	return 0;
+}
+
+int main()
+{
+#ifdef RUN_BENCHMARKS
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(convert_benchmark),
+	};
+#else
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(convert_test),
+		cmocka_unit_test(unsupported_test),
+		cmocka_unit_test(copy_test),
+	};
+#endif
+
+	return cmocka_run_group_tests(tests, NULL, teardown);
+}